@@ -230,6 +230,49 @@ extern const char *(*MEM_name_ptr)(void *vmemh);
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/* Switch allocator to faster mode with per-thread caches of small blocks,
+ * for allocation heavy tasks. Like the guarded mode, this must be done before any allocation. */
+void MEM_use_cached_allocator(void);
+
+/* Sampling allocation profiler, estimating the memory used per tag (the string passed when
+ * allocating). Only supported by the lock-free and thread cached allocators, the guarded
+ * allocator keeps track of all blocks already. Can be started and stopped at any time. */
+enum {
+  /* Aggregate per call site as well as per tag. */
+  MEM_PROFILE_CALL_SITE = (1 << 0),
+  /* Print the profile when the program exits. */
+  MEM_PROFILE_PRINT_AT_EXIT = (1 << 1),
+};
+/* Sample one allocation per sample_interval allocated bytes on average. */
+void MEM_profile_start(const size_t sample_interval, const int flag);
+void MEM_profile_stop(void);
+bool MEM_profile_is_enabled(void);
+/* Print live, peak & total memory per tag, sorted by live memory. */
+void MEM_profile_print(FILE *fp);
+
+/* Memory budget, for running many instances on one machine without running out of memory.
+ * When the memory in use goes over the soft limit, the budget callbacks are asked to free
+ * memory (by evicting caches). Allocations that would still go over the hard limit report an
+ * error through the error callback and abort, unless the allocating thread allows them to
+ * return NULL. Zero disables a limit. Only allocations of #MEM_BUDGET_CHECK_MIN_LEN bytes or
+ * more are checked, so the limits are approximate. */
+#define MEM_BUDGET_CHECK_MIN_LEN (64 * 1024)
+void MEM_set_memory_budget(const size_t soft_limit, const size_t hard_limit);
+void MEM_get_memory_budget(size_t *r_soft_limit, size_t *r_hard_limit);
+/* Free at least size bytes if possible, returning the amount of memory freed.
+ * Called from any thread while it is allocating: callbacks must only try-lock, since the
+ * allocating thread may hold the lock of the cache already. */
+typedef size_t (*MEM_BudgetFreeFn)(size_t size, void *user_data);
+void MEM_add_budget_callback(MEM_BudgetFreeFn func, void *user_data);
+void MEM_remove_budget_callback(MEM_BudgetFreeFn func, void *user_data);
+/* Run the budget callbacks, returns the amount of memory freed
+ * (zero when another thread is already running them). */
+size_t MEM_free_budget_memory(const size_t size);
+/* Between these calls, allocations of the calling thread going over the hard limit return NULL
+ * instead of aborting. For callers which handle failing allocations, calls can be nested. */
+void MEM_budget_allow_null_begin(void);
+void MEM_budget_allow_null_end(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
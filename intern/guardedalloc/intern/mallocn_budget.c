@@ -0,0 +1,237 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Memory budget, shared by all allocators.
+ *
+ * Allocations of #MEM_BUDGET_CHECK_MIN_LEN bytes or more check the memory in use against the
+ * soft limit. Over the soft limit the registered callbacks are asked to free memory, usually by
+ * evicting cache entries. Smaller allocations are not checked so they stay as fast as without a
+ * budget, the limits are therefore approximate. Only one thread evicts at a time, others don't
+ * wait for it unless they would go over the hard limit.
+ *
+ * Allocations that still go over the hard limit report an error and abort, since most callers
+ * don't handle failing allocations. Callers which do can opt in to get NULL instead, see
+ * #MEM_budget_allow_null_begin.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "mallocn_intern.h"
+
+typedef struct MemBudgetCallback {
+  MEM_BudgetFreeFn func;
+  void *user_data;
+} MemBudgetCallback;
+
+bool mem_budget_enabled = false;
+static size_t mem_budget_soft_limit = 0, mem_budget_hard_limit = 0;
+
+/* Callbacks are called with the mutex locked, so only one thread evicts at a time. */
+static pthread_mutex_t budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Allocated with the system allocator, to not be counted in the memory in use. */
+static MemBudgetCallback *budget_callbacks = NULL;
+static int budget_callbacks_len = 0, budget_callbacks_len_alloc = 0;
+/* Thread calling the callbacks, allocations done by the callbacks don't evict again. */
+static volatile bool budget_evicting = false;
+static pthread_t budget_evicting_thread;
+
+/* Per thread depth of #MEM_budget_allow_null_begin. */
+#ifdef __APPLE__
+static pthread_key_t allow_null_key;
+static pthread_once_t allow_null_key_once = PTHREAD_ONCE_INIT;
+
+static void allow_null_key_create(void)
+{
+  pthread_key_create(&allow_null_key, NULL);
+}
+
+static int allow_null_depth_get(void)
+{
+  pthread_once(&allow_null_key_once, allow_null_key_create);
+  return (int)(intptr_t)pthread_getspecific(allow_null_key);
+}
+
+static void allow_null_depth_set(const int depth)
+{
+  pthread_once(&allow_null_key_once, allow_null_key_create);
+  pthread_setspecific(allow_null_key, (void *)(intptr_t)depth);
+}
+#else
+#  ifdef _MSC_VER
+static __declspec(thread) int allow_null_depth = 0;
+#  else
+static __thread int allow_null_depth = 0;
+#  endif
+
+static int allow_null_depth_get(void)
+{
+  return allow_null_depth;
+}
+
+static void allow_null_depth_set(const int depth)
+{
+  allow_null_depth = depth;
+}
+#endif
+
+static void mem_budget_update_enabled(void)
+{
+  mem_budget_enabled = (mem_budget_soft_limit != 0 || mem_budget_hard_limit != 0);
+}
+
+void MEM_set_memory_budget(const size_t soft_limit, const size_t hard_limit)
+{
+  pthread_mutex_lock(&budget_mutex);
+  mem_budget_soft_limit = soft_limit;
+  mem_budget_hard_limit = hard_limit;
+  mem_budget_update_enabled();
+  pthread_mutex_unlock(&budget_mutex);
+}
+
+void MEM_get_memory_budget(size_t *r_soft_limit, size_t *r_hard_limit)
+{
+  *r_soft_limit = mem_budget_soft_limit;
+  *r_hard_limit = mem_budget_hard_limit;
+}
+
+void MEM_add_budget_callback(MEM_BudgetFreeFn func, void *user_data)
+{
+  pthread_mutex_lock(&budget_mutex);
+  if (budget_callbacks_len == budget_callbacks_len_alloc) {
+    const int len_alloc_new = budget_callbacks_len_alloc ? budget_callbacks_len_alloc * 2 : 8;
+    MemBudgetCallback *callbacks_new = realloc(
+        budget_callbacks, sizeof(*budget_callbacks) * (size_t)len_alloc_new);
+    if (callbacks_new == NULL) {
+      /* Keep the callbacks added so far, this one is not called. */
+      pthread_mutex_unlock(&budget_mutex);
+      return;
+    }
+    budget_callbacks = callbacks_new;
+    budget_callbacks_len_alloc = len_alloc_new;
+  }
+  budget_callbacks[budget_callbacks_len].func = func;
+  budget_callbacks[budget_callbacks_len].user_data = user_data;
+  budget_callbacks_len++;
+  pthread_mutex_unlock(&budget_mutex);
+}
+
+void MEM_remove_budget_callback(MEM_BudgetFreeFn func, void *user_data)
+{
+  pthread_mutex_lock(&budget_mutex);
+  for (int i = 0; i < budget_callbacks_len; i++) {
+    if (budget_callbacks[i].func == func && budget_callbacks[i].user_data == user_data) {
+      budget_callbacks_len--;
+      budget_callbacks[i] = budget_callbacks[budget_callbacks_len];
+      break;
+    }
+  }
+  if (budget_callbacks_len == 0) {
+    free(budget_callbacks);
+    budget_callbacks = NULL;
+    budget_callbacks_len_alloc = 0;
+  }
+  pthread_mutex_unlock(&budget_mutex);
+}
+
+void MEM_budget_allow_null_begin(void)
+{
+  allow_null_depth_set(allow_null_depth_get() + 1);
+}
+
+void MEM_budget_allow_null_end(void)
+{
+  allow_null_depth_set(allow_null_depth_get() - 1);
+}
+
+static size_t mem_budget_evict(const size_t size, const bool wait)
+{
+  /* Allocations done by the callbacks (or by code they call) never wait for themselves. */
+  if (budget_evicting && pthread_equal(budget_evicting_thread, pthread_self())) {
+    return 0;
+  }
+
+  if (wait) {
+    pthread_mutex_lock(&budget_mutex);
+  }
+  else if (pthread_mutex_trylock(&budget_mutex) != 0) {
+    /* Another thread is already freeing memory, don't wait for it to free more. */
+    return 0;
+  }
+  budget_evicting_thread = pthread_self();
+  budget_evicting = true;
+
+  size_t freed = 0;
+  for (int i = 0; i < budget_callbacks_len && freed < size; i++) {
+    freed += budget_callbacks[i].func(size - freed, budget_callbacks[i].user_data);
+  }
+
+  budget_evicting = false;
+  pthread_mutex_unlock(&budget_mutex);
+  return freed;
+}
+
+size_t MEM_free_budget_memory(const size_t size)
+{
+  return mem_budget_evict(size, false);
+}
+
+bool mem_budget_alloc_check(const size_t len,
+                            const char *str,
+                            void (*print_error)(const char *str, ...))
+{
+  const size_t soft_limit = mem_budget_soft_limit;
+  const size_t hard_limit = mem_budget_hard_limit;
+
+  /* Without a soft limit, caches are still evicted before failing at the hard limit. */
+  const size_t evict_limit = soft_limit ? soft_limit : hard_limit;
+
+  size_t mem_in_use = MEM_get_memory_in_use();
+  if (mem_in_use + len > evict_limit) {
+    mem_budget_evict(mem_in_use + len - evict_limit, false);
+    mem_in_use = MEM_get_memory_in_use();
+  }
+  if (hard_limit == 0 || mem_in_use + len <= hard_limit) {
+    return true;
+  }
+
+  /* Another thread might have been evicting, wait for it and evict again. */
+  mem_budget_evict(mem_in_use + len - evict_limit, true);
+  mem_in_use = MEM_get_memory_in_use();
+  if (mem_in_use + len <= hard_limit) {
+    return true;
+  }
+
+  if (allow_null_depth_get() > 0) {
+    return false;
+  }
+  print_error("Memory budget exceeded: len=" SIZET_FORMAT " in %s, in use " SIZET_FORMAT
+              ", hard limit " SIZET_FORMAT "\n",
+              SIZET_ARG(len),
+              str,
+              SIZET_ARG(mem_in_use),
+              SIZET_ARG(hard_limit));
+  abort();
+  return false;
+}
@@ -0,0 +1,909 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Memory allocation with per-thread caches of size-classed blocks.
+ *
+ * Small blocks are rounded up to a size class, each thread keeps a free list per size class,
+ * so most allocations and frees don't lock, don't use atomics and don't call into the system
+ * allocator. Free lists are refilled from and released to a central free list per size class
+ * in batches, the central free lists get new blocks by splitting slabs allocated from the
+ * system. Slabs are never returned to the system.
+ *
+ * Large blocks are allocated from the system directly, very large blocks are mapped,
+ * so they are always returned to the system when freed.
+ *
+ * Memory counters are kept per thread and added to the global counters in batches,
+ * so the memory in use is only exact when no other threads are allocating,
+ * the peak memory may be missed by up to a batch of blocks per thread.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <sys/types.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+typedef struct MemHead {
+  /* Length of allocated memory block. */
+  size_t len;
+} MemHead;
+
+typedef struct MemHeadAligned {
+  short alignment;
+  size_t len;
+} MemHeadAligned;
+
+enum {
+  MEMHEAD_MMAP_FLAG = 1,
+  MEMHEAD_ALIGN_FLAG = 2,
+};
+
+#define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
+#define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
+#define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
+#define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t)MEMHEAD_MMAP_FLAG)
+#define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t)MEMHEAD_ALIGN_FLAG)
+
+/* Size classes are 16 bytes apart up to 128 bytes, then 4 classes per power of two. */
+#define SIZE_CLASS_SMALL_MAX 128
+#define SIZE_CLASS_NUM 40
+/* Largest block (including #MemHead) handled by the thread caches. */
+#define SIZE_CLASS_MAX 32768
+/* Blocks are split from slabs of at least this size. */
+#define SLAB_SIZE (64 * 1024)
+/* Blocks of at least this size are mapped instead of using the system allocator. */
+#define MMAP_THRESHOLD (1024 * 1024)
+/* Maximum number of blocks moved between a thread cache and the central free list at once. */
+#define BATCH_MAX 64
+
+typedef struct MemFreeBlock {
+  struct MemFreeBlock *next;
+} MemFreeBlock;
+
+typedef struct MemFreeList {
+  MemFreeBlock *first;
+  unsigned int len;
+} MemFreeList;
+
+typedef struct MemThreadCache {
+  MemFreeList bins[SIZE_CLASS_NUM];
+
+  /* Counters not yet added to the global counters, these wrap around when more memory is
+   * freed than allocated by this thread. */
+  size_t mem_in_use;
+  unsigned int totblock;
+
+  struct MemThreadCache *prev, *next;
+} MemThreadCache;
+
+typedef struct MemCentralBin {
+  pthread_mutex_t mutex;
+  MemFreeList free_list;
+} MemCentralBin;
+
+static size_t size_class_block_size[SIZE_CLASS_NUM];
+static unsigned int size_class_batch[SIZE_CLASS_NUM];
+/* Size class from the block size, in steps of 16 bytes. */
+static unsigned char size_class_table[(SIZE_CLASS_MAX >> 4) + 1];
+
+static MemCentralBin central_bins[SIZE_CLASS_NUM];
+
+/* All thread caches, for the memory counters. */
+static MemThreadCache *thread_caches = NULL;
+static pthread_mutex_t thread_caches_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t thread_cache_key;
+
+/* Apple only supports thread local storage through pthread. */
+#ifdef __APPLE__
+#  define THREAD_CACHE_GET() ((MemThreadCache *)pthread_getspecific(thread_cache_key))
+#  define THREAD_CACHE_SET(cache) (void)0
+#else
+#  ifdef _MSC_VER
+static __declspec(thread) MemThreadCache *thread_cache = NULL;
+#  else
+static __thread MemThreadCache *thread_cache = NULL;
+#  endif
+#  define THREAD_CACHE_GET() thread_cache
+#  define THREAD_CACHE_SET(cache) thread_cache = cache
+#endif
+
+static unsigned int totblock = 0;
+static size_t mem_in_use = 0, mmap_in_use = 0, slab_in_use = 0, peak_mem = 0;
+static bool malloc_debug_memset = false;
+
+static void (*error_callback)(const char *) = NULL;
+static void (*thread_lock_callback)(void) = NULL;
+static void (*thread_unlock_callback)(void) = NULL;
+
+#ifdef __GNUC__
+__attribute__((format(printf, 1, 2)))
+#endif
+static void
+print_error(const char *str, ...)
+{
+  char buf[512];
+  va_list ap;
+
+  va_start(ap, str);
+  vsnprintf(buf, sizeof(buf), str, ap);
+  va_end(ap);
+  buf[sizeof(buf) - 1] = '\0';
+
+  if (error_callback) {
+    error_callback(buf);
+  }
+}
+
+#if defined(WIN32)
+static void mem_lock_thread(void)
+{
+  if (thread_lock_callback)
+    thread_lock_callback();
+}
+
+static void mem_unlock_thread(void)
+{
+  if (thread_unlock_callback)
+    thread_unlock_callback();
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+/** \name Size Classes
+ * \{ */
+
+static size_t size_class_block_size_calc(const unsigned int size_class)
+{
+  if (size_class < SIZE_CLASS_SMALL_MAX / 16) {
+    return (size_class + 1) * 16;
+  }
+  const unsigned int step = size_class - SIZE_CLASS_SMALL_MAX / 16;
+  const size_t base = (size_t)SIZE_CLASS_SMALL_MAX << (step / 4);
+  return base + (base / 4) * (step % 4 + 1);
+}
+
+static void size_classes_init(void)
+{
+  unsigned int size_class = 0;
+  for (unsigned int i = 0; i < SIZE_CLASS_NUM; i++) {
+    size_class_block_size[i] = size_class_block_size_calc(i);
+    const size_t batch = SLAB_SIZE / size_class_block_size[i];
+    size_class_batch[i] = (unsigned int)(batch < 2 ? 2 : (batch > BATCH_MAX ? BATCH_MAX : batch));
+  }
+  for (unsigned int i = 0; i < sizeof(size_class_table); i++) {
+    while (size_class_block_size[size_class] < (size_t)i * 16) {
+      size_class++;
+    }
+    size_class_table[i] = (unsigned char)size_class;
+  }
+}
+
+/* Block size includes the #MemHead, must not be larger than #SIZE_CLASS_MAX. */
+MEM_INLINE unsigned int size_class_from_block_size(const size_t block_size)
+{
+  return size_class_table[(block_size + 15) >> 4];
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Thread Caches
+ * \{ */
+
+static void free_list_push(MemFreeList *free_list, void *block)
+{
+  MemFreeBlock *free_block = block;
+  free_block->next = free_list->first;
+  free_list->first = free_block;
+  free_list->len++;
+}
+
+/* Move up to len blocks from the start of one free list to another. */
+static void free_list_move(MemFreeList *dst, MemFreeList *src, unsigned int len)
+{
+  if (len > src->len) {
+    len = src->len;
+  }
+  if (len == 0) {
+    return;
+  }
+  MemFreeBlock *first = src->first, *last = src->first;
+  for (unsigned int i = 1; i < len; i++) {
+    last = last->next;
+  }
+  src->first = last->next;
+  src->len -= len;
+  last->next = dst->first;
+  dst->first = first;
+  dst->len += len;
+}
+
+/* Add the counters of the thread cache to the global counters. */
+static void thread_cache_counters_flush(MemThreadCache *cache)
+{
+  if (cache->totblock != 0) {
+    atomic_add_and_fetch_u(&totblock, cache->totblock);
+    cache->totblock = 0;
+  }
+  if (cache->mem_in_use != 0) {
+    const size_t mem_in_use_new = atomic_add_and_fetch_z(&mem_in_use, cache->mem_in_use);
+    atomic_fetch_and_update_max_z(&peak_mem, mem_in_use_new);
+    cache->mem_in_use = 0;
+  }
+}
+
+static bool central_bin_refill(MemThreadCache *cache, const unsigned int size_class)
+{
+  MemCentralBin *bin = &central_bins[size_class];
+  const unsigned int batch = size_class_batch[size_class];
+
+  pthread_mutex_lock(&bin->mutex);
+  if (bin->free_list.first == NULL) {
+    const size_t block_size = size_class_block_size[size_class];
+    const size_t slab_size = SLAB_SIZE > block_size * batch ? SLAB_SIZE : block_size * batch;
+    char *slab = malloc(slab_size);
+    if (slab == NULL) {
+      pthread_mutex_unlock(&bin->mutex);
+      return false;
+    }
+    atomic_add_and_fetch_z(&slab_in_use, slab_size);
+    /* Push in reverse, so blocks are handed out in memory order. */
+    for (size_t i = slab_size / block_size; i > 0; i--) {
+      free_list_push(&bin->free_list, slab + (i - 1) * block_size);
+    }
+  }
+  free_list_move(&cache->bins[size_class], &bin->free_list, batch);
+  pthread_mutex_unlock(&bin->mutex);
+
+  thread_cache_counters_flush(cache);
+  return true;
+}
+
+static void central_bin_release(MemThreadCache *cache,
+                                const unsigned int size_class,
+                                const unsigned int len)
+{
+  MemCentralBin *bin = &central_bins[size_class];
+
+  pthread_mutex_lock(&bin->mutex);
+  free_list_move(&bin->free_list, &cache->bins[size_class], len);
+  pthread_mutex_unlock(&bin->mutex);
+
+  thread_cache_counters_flush(cache);
+}
+
+/* Called on thread exit, returns all cached blocks to the central free lists. */
+static void thread_cache_free(void *cache_v)
+{
+  MemThreadCache *cache = cache_v;
+  for (unsigned int i = 0; i < SIZE_CLASS_NUM; i++) {
+    central_bin_release(cache, i, cache->bins[i].len);
+  }
+
+  pthread_mutex_lock(&thread_caches_mutex);
+  thread_cache_counters_flush(cache);
+  if (cache->prev) {
+    cache->prev->next = cache->next;
+  }
+  else {
+    thread_caches = cache->next;
+  }
+  if (cache->next) {
+    cache->next->prev = cache->prev;
+  }
+  pthread_mutex_unlock(&thread_caches_mutex);
+
+  THREAD_CACHE_SET(NULL);
+  free(cache);
+}
+
+static MemThreadCache *thread_cache_create(void)
+{
+  MemThreadCache *cache = calloc(1, sizeof(*cache));
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&thread_caches_mutex);
+  cache->next = thread_caches;
+  if (thread_caches) {
+    thread_caches->prev = cache;
+  }
+  thread_caches = cache;
+  pthread_mutex_unlock(&thread_caches_mutex);
+
+  /* The key is only used for the destructor, except on Apple. */
+  pthread_setspecific(thread_cache_key, cache);
+  THREAD_CACHE_SET(cache);
+  return cache;
+}
+
+MEM_INLINE MemThreadCache *thread_cache_ensure(void)
+{
+  MemThreadCache *cache = THREAD_CACHE_GET();
+  if (UNLIKELY(cache == NULL)) {
+    cache = thread_cache_create();
+  }
+  return cache;
+}
+
+/* Returns the block including the #MemHead. */
+static void *block_alloc(const size_t len)
+{
+  const unsigned int size_class = size_class_from_block_size(len + sizeof(MemHead));
+  MemThreadCache *cache = thread_cache_ensure();
+  if (UNLIKELY(cache == NULL)) {
+    return NULL;
+  }
+
+  MemFreeList *free_list = &cache->bins[size_class];
+  if (UNLIKELY(free_list->first == NULL)) {
+    if (!central_bin_refill(cache, size_class)) {
+      return NULL;
+    }
+  }
+  MemFreeBlock *block = free_list->first;
+  free_list->first = block->next;
+  free_list->len--;
+
+  cache->mem_in_use += len;
+  cache->totblock++;
+  return block;
+}
+
+static void block_free(void *block, const size_t len)
+{
+  const unsigned int size_class = size_class_from_block_size(len + sizeof(MemHead));
+  MemThreadCache *cache = thread_cache_ensure();
+  if (UNLIKELY(cache == NULL)) {
+    /* Out of memory for the cache itself, return the block to the central free list. */
+    MemCentralBin *bin = &central_bins[size_class];
+    pthread_mutex_lock(&bin->mutex);
+    free_list_push(&bin->free_list, block);
+    pthread_mutex_unlock(&bin->mutex);
+    atomic_sub_and_fetch_u(&totblock, 1);
+    atomic_sub_and_fetch_z(&mem_in_use, len);
+    return;
+  }
+
+  MemFreeList *free_list = &cache->bins[size_class];
+  free_list_push(free_list, block);
+  cache->mem_in_use -= len;
+  cache->totblock--;
+
+  const unsigned int batch = size_class_batch[size_class];
+  if (UNLIKELY(free_list->len > batch * 2)) {
+    central_bin_release(cache, size_class, batch);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Large Blocks
+ * \{ */
+
+static MemHead *large_alloc(const size_t len, const bool use_calloc, const char *str)
+{
+  MemHead *memh;
+  if (!mem_budget_alloc(len, str, print_error)) {
+    return NULL;
+  }
+  if (len >= MMAP_THRESHOLD) {
+#if defined(WIN32)
+    /* our windows mmap implementation is not thread safe */
+    mem_lock_thread();
+#endif
+    /* Mapped memory is always zero initialized. */
+    memh = mmap(
+        NULL, len + sizeof(MemHead), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+#if defined(WIN32)
+    mem_unlock_thread();
+#endif
+    if (memh == (MemHead *)-1) {
+      return NULL;
+    }
+    memh->len = len | (size_t)MEMHEAD_MMAP_FLAG;
+    atomic_add_and_fetch_z(&mmap_in_use, len);
+  }
+  else {
+    memh = use_calloc ? calloc(1, len + sizeof(MemHead)) : malloc(len + sizeof(MemHead));
+    if (memh == NULL) {
+      return NULL;
+    }
+    memh->len = len;
+  }
+
+  atomic_add_and_fetch_u(&totblock, 1);
+  atomic_fetch_and_update_max_z(&peak_mem, atomic_add_and_fetch_z(&mem_in_use, len));
+  return memh;
+}
+
+/** \} */
+
+size_t MEM_cached_allocN_len(const void *vmemh)
+{
+  if (vmemh) {
+    return MEMHEAD_FROM_PTR(vmemh)->len &
+           ~((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG) | MEMHEAD_SAMPLED_FLAG);
+  }
+  else {
+    return 0;
+  }
+}
+
+void MEM_cached_freeN(void *vmemh)
+{
+  MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+  size_t len = MEM_cached_allocN_len(vmemh);
+
+  if (vmemh == NULL) {
+    print_error("Attempt to free NULL pointer\n");
+#ifdef WITH_ASSERT_ABORT
+    abort();
+#endif
+    return;
+  }
+
+  mem_profile_free(memh->len, vmemh);
+
+  if (UNLIKELY(malloc_debug_memset && len && !MEMHEAD_IS_MMAP(memh))) {
+    memset(memh + 1, 255, len);
+  }
+
+  if (MEMHEAD_IS_MMAP(memh)) {
+    atomic_sub_and_fetch_u(&totblock, 1);
+    atomic_sub_and_fetch_z(&mem_in_use, len);
+    atomic_sub_and_fetch_z(&mmap_in_use, len);
+#if defined(WIN32)
+    /* our windows mmap implementation is not thread safe */
+    mem_lock_thread();
+#endif
+    if (munmap(memh, len + sizeof(MemHead)))
+      printf("Couldn't unmap memory\n");
+#if defined(WIN32)
+    mem_unlock_thread();
+#endif
+  }
+  else if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+    MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+    atomic_sub_and_fetch_u(&totblock, 1);
+    atomic_sub_and_fetch_z(&mem_in_use, len);
+    aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+  }
+  else if (LIKELY(len + sizeof(MemHead) <= SIZE_CLASS_MAX)) {
+    block_free(memh, len);
+  }
+  else {
+    atomic_sub_and_fetch_u(&totblock, 1);
+    atomic_sub_and_fetch_z(&mem_in_use, len);
+    free(memh);
+  }
+}
+
+void *MEM_cached_dupallocN(const void *vmemh)
+{
+  void *newp = NULL;
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    const size_t prev_size = MEM_cached_allocN_len(vmemh);
+    if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_cached_mallocN_aligned(
+          prev_size, (size_t)memh_aligned->alignment, "dupli_malloc");
+    }
+    else {
+      newp = MEM_cached_mallocN(prev_size, "dupli_malloc");
+    }
+    memcpy(newp, vmemh, prev_size);
+  }
+  return newp;
+}
+
+/**
+ * Resize small blocks in place when the new length has the same size class.
+ */
+static bool mem_cached_resize_in_place(void *vmemh, const size_t len)
+{
+  MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+  if (MEMHEAD_IS_MMAP(memh) || MEMHEAD_IS_ALIGNED(memh) || (memh->len & MEMHEAD_SAMPLED_FLAG)) {
+    return false;
+  }
+  const size_t old_len = memh->len;
+  if (old_len + sizeof(MemHead) > SIZE_CLASS_MAX || len + sizeof(MemHead) > SIZE_CLASS_MAX ||
+      size_class_from_block_size(old_len + sizeof(MemHead)) !=
+          size_class_from_block_size(len + sizeof(MemHead))) {
+    return false;
+  }
+  MemThreadCache *cache = thread_cache_ensure();
+  if (UNLIKELY(cache == NULL)) {
+    return false;
+  }
+  memh->len = len;
+  cache->mem_in_use += len - old_len;
+  return true;
+}
+
+void *MEM_cached_reallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = NULL;
+
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    size_t old_len = MEM_cached_allocN_len(vmemh);
+
+    if (mem_cached_resize_in_place(vmemh, SIZET_ALIGN_4(len))) {
+      return vmemh;
+    }
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_cached_mallocN(len, "realloc");
+    }
+    else {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_cached_mallocN_aligned(len, (size_t)memh_aligned->alignment, "realloc");
+    }
+
+    if (newp) {
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        /* grow (or remain same size) */
+        memcpy(newp, vmemh, old_len);
+      }
+    }
+
+    MEM_cached_freeN(vmemh);
+  }
+  else {
+    newp = MEM_cached_mallocN(len, str);
+  }
+
+  return newp;
+}
+
+void *MEM_cached_recallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = NULL;
+
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    size_t old_len = MEM_cached_allocN_len(vmemh);
+
+    if (mem_cached_resize_in_place(vmemh, SIZET_ALIGN_4(len))) {
+      if (len > old_len) {
+        /* zero new bytes */
+        memset(((char *)vmemh) + old_len, 0, len - old_len);
+      }
+      return vmemh;
+    }
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_cached_mallocN(len, "recalloc");
+    }
+    else {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_cached_mallocN_aligned(len, (size_t)memh_aligned->alignment, "recalloc");
+    }
+
+    if (newp) {
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        memcpy(newp, vmemh, old_len);
+
+        if (len > old_len) {
+          /* grow */
+          /* zero new bytes */
+          memset(((char *)newp) + old_len, 0, len - old_len);
+        }
+      }
+    }
+
+    MEM_cached_freeN(vmemh);
+  }
+  else {
+    newp = MEM_cached_callocN(len, str);
+  }
+
+  return newp;
+}
+
+void *MEM_cached_callocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_4(len);
+
+  if (LIKELY(len + sizeof(MemHead) <= SIZE_CLASS_MAX)) {
+    memh = block_alloc(len);
+    if (LIKELY(memh)) {
+      memh->len = len;
+      memset(memh + 1, 0, len);
+    }
+  }
+  else {
+    memh = large_alloc(len, true, str);
+  }
+
+  if (LIKELY(memh)) {
+    mem_profile_alloc(&memh->len, PTR_FROM_MEMHEAD(memh), len, str, MEM_CALL_SITE());
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)mem_in_use);
+  return NULL;
+}
+
+void *MEM_cached_calloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Calloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        (unsigned int)mem_in_use);
+    abort();
+    return NULL;
+  }
+
+  return MEM_cached_callocN(total_size, str);
+}
+
+void *MEM_cached_mallocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_4(len);
+
+  if (LIKELY(len + sizeof(MemHead) <= SIZE_CLASS_MAX)) {
+    memh = block_alloc(len);
+    if (LIKELY(memh)) {
+      memh->len = len;
+    }
+  }
+  else {
+    memh = large_alloc(len, false, str);
+  }
+
+  if (LIKELY(memh)) {
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    mem_profile_alloc(&memh->len, PTR_FROM_MEMHEAD(memh), len, str, MEM_CALL_SITE());
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)mem_in_use);
+  return NULL;
+}
+
+void *MEM_cached_malloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Malloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        (unsigned int)mem_in_use);
+    abort();
+    return NULL;
+  }
+
+  return MEM_cached_mallocN(total_size, str);
+}
+
+void *MEM_cached_mallocN_aligned(size_t len, size_t alignment, const char *str)
+{
+  /* Huge alignment values doesn't make sense and they wouldn't fit into 'short' used in the
+   * MemHead. */
+  assert(alignment < 1024);
+
+  /* We only support alignments that are a power of two. */
+  assert(IS_POW2(alignment));
+
+  /* Regular blocks are aligned to the size of the #MemHead. */
+  if (alignment <= sizeof(MemHead)) {
+    return MEM_cached_mallocN(len, str);
+  }
+
+  /* It's possible that MemHead's size is not properly aligned,
+   * do extra padding to deal with this.
+   *
+   * We only support small alignments which fits into short in
+   * order to save some bits in MemHead structure.
+   */
+  size_t extra_padding = MEMHEAD_ALIGN_PADDING(alignment);
+
+  len = SIZET_ALIGN_4(len);
+
+  MemHeadAligned *memh = mem_budget_alloc(len, str, print_error) ?
+                             (MemHeadAligned *)aligned_malloc(
+                                 len + extra_padding + sizeof(MemHeadAligned), alignment) :
+                             NULL;
+
+  if (LIKELY(memh)) {
+    /* We keep padding in the beginning of MemHead,
+     * this way it's always possible to get MemHead
+     * from the data pointer.
+     */
+    memh = (MemHeadAligned *)((char *)memh + extra_padding);
+
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    memh->len = len | (size_t)MEMHEAD_ALIGN_FLAG;
+    memh->alignment = (short)alignment;
+    atomic_add_and_fetch_u(&totblock, 1);
+    atomic_fetch_and_update_max_z(&peak_mem, atomic_add_and_fetch_z(&mem_in_use, len));
+    mem_profile_alloc(&memh->len, PTR_FROM_MEMHEAD(memh), len, str, MEM_CALL_SITE());
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)mem_in_use);
+  return NULL;
+}
+
+void *MEM_cached_mapallocN(size_t len, const char *str)
+{
+  /* Large blocks are already mapped. */
+  return MEM_cached_callocN(len, str);
+}
+
+void MEM_cached_printmemlist_pydict(void)
+{
+}
+
+void MEM_cached_printmemlist(void)
+{
+}
+
+/* unused */
+void MEM_cached_callbackmemlist(void (*func)(void *))
+{
+  (void)func; /* Ignored. */
+}
+
+void MEM_cached_printmemlist_stats(void)
+{
+  printf("\ntotal memory len: %.3f MB\n",
+         (double)MEM_cached_get_memory_in_use() / (double)(1024 * 1024));
+  printf("peak memory len: %.3f MB\n", (double)peak_mem / (double)(1024 * 1024));
+  printf("slab memory len: %.3f MB\n", (double)slab_in_use / (double)(1024 * 1024));
+  printf(
+      "\nFor more detailed per-block statistics run Blender with memory debugging command line "
+      "argument.\n");
+
+#ifdef HAVE_MALLOC_STATS
+  printf("System Statistics:\n");
+  malloc_stats();
+#endif
+}
+
+void MEM_cached_set_error_callback(void (*func)(const char *))
+{
+  error_callback = func;
+}
+
+bool MEM_cached_consistency_check(void)
+{
+  return true;
+}
+
+void MEM_cached_set_lock_callback(void (*lock)(void), void (*unlock)(void))
+{
+  thread_lock_callback = lock;
+  thread_unlock_callback = unlock;
+}
+
+void MEM_cached_set_memory_debug(void)
+{
+  malloc_debug_memset = true;
+}
+
+size_t MEM_cached_get_memory_in_use(void)
+{
+  pthread_mutex_lock(&thread_caches_mutex);
+  size_t mem_in_use_sum = mem_in_use;
+  for (MemThreadCache *cache = thread_caches; cache; cache = cache->next) {
+    mem_in_use_sum += cache->mem_in_use;
+  }
+  pthread_mutex_unlock(&thread_caches_mutex);
+  return mem_in_use_sum;
+}
+
+size_t MEM_cached_get_mapped_memory_in_use(void)
+{
+  return mmap_in_use;
+}
+
+unsigned int MEM_cached_get_memory_blocks_in_use(void)
+{
+  pthread_mutex_lock(&thread_caches_mutex);
+  unsigned int totblock_sum = totblock;
+  for (MemThreadCache *cache = thread_caches; cache; cache = cache->next) {
+    totblock_sum += cache->totblock;
+  }
+  pthread_mutex_unlock(&thread_caches_mutex);
+  return totblock_sum;
+}
+
+void MEM_cached_reset_peak_memory(void)
+{
+  peak_mem = MEM_cached_get_memory_in_use();
+}
+
+size_t MEM_cached_get_peak_memory(void)
+{
+  return peak_mem;
+}
+
+#ifndef NDEBUG
+const char *MEM_cached_name_ptr(void *vmemh)
+{
+  if (vmemh) {
+    return "unknown block name ptr";
+  }
+  else {
+    return "MEM_cached_name_ptr(NULL)";
+  }
+}
+#endif /* NDEBUG */
+
+void MEM_cached_init(void)
+{
+  static bool is_init = false;
+  if (is_init) {
+    return;
+  }
+  is_init = true;
+
+  size_classes_init();
+  for (unsigned int i = 0; i < SIZE_CLASS_NUM; i++) {
+    pthread_mutex_init(&central_bins[i].mutex, NULL);
+  }
+  pthread_key_create(&thread_cache_key, thread_cache_free);
+}
@@ -511,7 +511,8 @@ void *MEM_guarded_mallocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)malloc(len + sizeof(MemHead) + sizeof(MemTail));
+  memh = mem_budget_alloc(len, str, print_error) ? (MemHead *)malloc(len + sizeof(MemHead) + sizeof(MemTail)) :
+                                 NULL;
 
   if (LIKELY(memh)) {
     make_memhead_header(memh, len, str);
@@ -575,8 +576,10 @@ void *MEM_guarded_mallocN_aligned(size_t len, size_t alignment, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  MemHead *memh = (MemHead *)aligned_malloc(
-      len + extra_padding + sizeof(MemHead) + sizeof(MemTail), alignment);
+  MemHead *memh = mem_budget_alloc(len, str, print_error) ?
+                      (MemHead *)aligned_malloc(
+                          len + extra_padding + sizeof(MemHead) + sizeof(MemTail), alignment) :
+                      NULL;
 
   if (LIKELY(memh)) {
     /* We keep padding in the beginning of MemHead,
@@ -610,7 +613,8 @@ void *MEM_guarded_callocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)calloc(len + sizeof(MemHead) + sizeof(MemTail), 1);
+  memh = mem_budget_alloc(len, str, print_error) ? (MemHead *)calloc(len + sizeof(MemHead) + sizeof(MemTail), 1) :
+                                 NULL;
 
   if (memh) {
     make_memhead_header(memh, len, str);
@@ -659,6 +663,14 @@ void *MEM_guarded_mapallocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
+  if (!mem_budget_alloc(len, str, print_error)) {
+    print_error("Mapalloc over the memory budget: len=" SIZET_FORMAT " in %s, total %u\n",
+                SIZET_ARG(len),
+                str,
+                (unsigned int)mem_in_use);
+    return NULL;
+  }
+
 #if defined(WIN32)
   /* our windows mmap implementation is not thread safe */
   mem_lock_thread();
@@ -109,6 +109,62 @@ size_t malloc_usable_size(void *ptr);
 
 #define ALIGNED_MALLOC_MINIMUM_ALIGNMENT sizeof(void *)
 
+/* Sampled by the allocation profiler, the highest bit of the length in the MemHead. */
+#define MEMHEAD_SAMPLED_FLAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+#ifdef __GNUC__
+#  define MEM_CALL_SITE() __builtin_return_address(0)
+#else
+#  define MEM_CALL_SITE() NULL
+#endif
+
+/* Allocation profiler, zero when disabled. */
+extern size_t mem_profile_sample_interval;
+
+bool mem_profile_alloc_sample(const void *vmemh,
+                              const size_t len,
+                              const char *str,
+                              const void *call_site);
+void mem_profile_free_sample(const void *vmemh);
+
+/* Call after allocating, with the length member of the MemHead. */
+MEM_INLINE void mem_profile_alloc(
+    size_t *memh_len, const void *vmemh, size_t len, const char *str, const void *call_site)
+{
+  if (UNLIKELY(mem_profile_sample_interval != 0)) {
+    if (mem_profile_alloc_sample(vmemh, len, str, call_site)) {
+      *memh_len |= MEMHEAD_SAMPLED_FLAG;
+    }
+  }
+}
+
+/* Call before freeing, with the length member of the MemHead. */
+MEM_INLINE void mem_profile_free(const size_t memh_len, const void *vmemh)
+{
+  if (UNLIKELY(memh_len & MEMHEAD_SAMPLED_FLAG)) {
+    mem_profile_free_sample(vmemh);
+  }
+}
+
+/* Memory budget, false when disabled. */
+extern bool mem_budget_enabled;
+
+bool mem_budget_alloc_check(const size_t len,
+                            const char *str,
+                            void (*print_error)(const char *str, ...));
+
+/* Call before allocating, false when the allocation would go over the hard limit and the
+ * caller allows NULL (#MEM_budget_allow_null_begin), otherwise this reports & aborts. */
+MEM_INLINE bool mem_budget_alloc(const size_t len,
+                                 const char *str,
+                                 void (*print_error)(const char *str, ...))
+{
+  if (UNLIKELY(mem_budget_enabled) && len >= MEM_BUDGET_CHECK_MIN_LEN) {
+    return mem_budget_alloc_check(len, str, print_error);
+  }
+  return true;
+}
+
 void *aligned_malloc(size_t size, size_t alignment);
 void aligned_free(void *ptr);
 
@@ -160,6 +216,55 @@ size_t MEM_lockfree_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
 const char *MEM_lockfree_name_ptr(void *vmemh);
 #endif
 
+/* Prototypes for thread cached allocator functions */
+size_t MEM_cached_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
+void MEM_cached_freeN(void *vmemh);
+void *MEM_cached_dupallocN(const void *vmemh) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void *MEM_cached_reallocN_id(void *vmemh,
+                             size_t len,
+                             const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(2);
+void *MEM_cached_recallocN_id(void *vmemh,
+                              size_t len,
+                              const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(2);
+void *MEM_cached_callocN(size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_cached_calloc_arrayN(size_t len,
+                               size_t size,
+                               const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void *MEM_cached_mallocN(size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_cached_malloc_arrayN(size_t len,
+                               size_t size,
+                               const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void *MEM_cached_mallocN_aligned(size_t len,
+                                 size_t alignment,
+                                 const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(3);
+void *MEM_cached_mapallocN(size_t len,
+                           const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void MEM_cached_printmemlist_pydict(void);
+void MEM_cached_printmemlist(void);
+void MEM_cached_callbackmemlist(void (*func)(void *));
+void MEM_cached_printmemlist_stats(void);
+void MEM_cached_set_error_callback(void (*func)(const char *));
+bool MEM_cached_consistency_check(void);
+void MEM_cached_set_lock_callback(void (*lock)(void), void (*unlock)(void));
+void MEM_cached_set_memory_debug(void);
+size_t MEM_cached_get_memory_in_use(void);
+size_t MEM_cached_get_mapped_memory_in_use(void);
+unsigned int MEM_cached_get_memory_blocks_in_use(void);
+void MEM_cached_reset_peak_memory(void);
+size_t MEM_cached_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
+void MEM_cached_init(void);
+#ifndef NDEBUG
+const char *MEM_cached_name_ptr(void *vmemh);
+#endif
+
 /* Prototypes for fully guarded allocator functions */
 size_t MEM_guarded_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_guarded_freeN(void *vmemh);
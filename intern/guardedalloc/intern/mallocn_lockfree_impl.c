@@ -110,7 +110,8 @@ static void mem_unlock_thread(void)
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (vmemh) {
-    return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG));
+    return MEMHEAD_FROM_PTR(vmemh)->len &
+           ~((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG) | MEMHEAD_SAMPLED_FLAG);
   }
   else {
     return 0;
@@ -130,6 +131,8 @@ void MEM_lockfree_freeN(void *vmemh)
     return;
   }
 
+  mem_profile_free(memh->len, vmemh);
+
   atomic_sub_and_fetch_u(&totblock, 1);
   atomic_sub_and_fetch_z(&mem_in_use, len);
 
@@ -264,13 +267,14 @@ void *MEM_lockfree_callocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+  memh = mem_budget_alloc(len, str, print_error) ? (MemHead *)calloc(1, len + sizeof(MemHead)) : NULL;
 
   if (LIKELY(memh)) {
     memh->len = len;
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
+    mem_profile_alloc(&memh->len, PTR_FROM_MEMHEAD(memh), len, str, MEM_CALL_SITE());
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -305,7 +309,7 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)malloc(len + sizeof(MemHead));
+  memh = mem_budget_alloc(len, str, print_error) ? (MemHead *)malloc(len + sizeof(MemHead)) : NULL;
 
   if (LIKELY(memh)) {
     if (UNLIKELY(malloc_debug_memset && len)) {
@@ -316,6 +320,7 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
+    mem_profile_alloc(&memh->len, PTR_FROM_MEMHEAD(memh), len, str, MEM_CALL_SITE());
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -368,8 +373,10 @@ void *MEM_lockfree_mallocN_aligned(size_t len, size_t alignment, const char *str
 
   len = SIZET_ALIGN_4(len);
 
-  MemHeadAligned *memh = (MemHeadAligned *)aligned_malloc(
-      len + extra_padding + sizeof(MemHeadAligned), alignment);
+  MemHeadAligned *memh = mem_budget_alloc(len, str, print_error) ?
+                             (MemHeadAligned *)aligned_malloc(
+                                 len + extra_padding + sizeof(MemHeadAligned), alignment) :
+                             NULL;
 
   if (LIKELY(memh)) {
     /* We keep padding in the beginning of MemHead,
@@ -387,6 +394,7 @@ void *MEM_lockfree_mallocN_aligned(size_t len, size_t alignment, const char *str
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
+    mem_profile_alloc(&memh->len, PTR_FROM_MEMHEAD(memh), len, str, MEM_CALL_SITE());
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -409,6 +417,14 @@ void *MEM_lockfree_mapallocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
+  if (!mem_budget_alloc(len, str, print_error)) {
+    print_error("Mapalloc over the memory budget: len=" SIZET_FORMAT " in %s, total %u\n",
+                SIZET_ARG(len),
+                str,
+                (unsigned int)mem_in_use);
+    return NULL;
+  }
+
 #if defined(WIN32)
   /* our windows mmap implementation is not thread safe */
   mem_lock_thread();
@@ -426,6 +442,7 @@ void *MEM_lockfree_mapallocN(size_t len, const char *str)
 
     update_maximum(&peak_mem, mem_in_use);
     update_maximum(&peak_mem, mmap_in_use);
+    mem_profile_alloc(&memh->len, PTR_FROM_MEMHEAD(memh), len, str, MEM_CALL_SITE());
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -0,0 +1,381 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Sampling allocation profiler for the lock-free and thread cached allocators.
+ *
+ * Each thread counts down the bytes it allocates, when the count reaches zero the allocation
+ * is sampled and stands for all bytes allocated by the thread since the previous sample.
+ * The countdown is randomized around the sample interval to avoid aliasing with
+ * allocation patterns. Sampled blocks are flagged in their #MemHead, so frees only do
+ * a lookup for sampled blocks.
+ *
+ * Samples are aggregated per tag (the contents of the string passed to #MEM_mallocN and
+ * friends, which is copied since it might be freed before the profile is printed),
+ * and optionally per call site.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "mallocn_intern.h"
+
+/* Aggregated samples for a tag & call site. */
+typedef struct MemProfileRecord {
+  struct MemProfileRecord *next;
+  /* Copy of the tag, allocated together with the record. */
+  const char *tag;
+  const void *call_site;
+  size_t hash;
+
+  /* Estimated from the samples. */
+  size_t live_bytes, peak_bytes, total_bytes;
+  size_t live_blocks, total_blocks;
+} MemProfileRecord;
+
+/* A sampled block which is not freed yet. */
+typedef struct MemProfileSample {
+  struct MemProfileSample *next;
+  const void *ptr;
+  MemProfileRecord *record;
+  size_t weight_bytes, weight_blocks;
+} MemProfileSample;
+
+typedef struct MemProfileThreadState {
+  /* Bytes to allocate until the next sample. */
+  size_t countdown;
+  /* Bytes allocated since the previous sample. */
+  size_t accumulated;
+  unsigned int rand_state;
+} MemProfileThreadState;
+
+size_t mem_profile_sample_interval = 0;
+/* The interval of the last profile, still printed after stopping it. */
+static size_t mem_profile_sample_interval_last = 0;
+static int mem_profile_flag = 0;
+
+/* Records & samples are in chained hash tables, allocated from the system. */
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static MemProfileRecord **records = NULL;
+static size_t records_len = 0, records_buckets_len = 0;
+static MemProfileSample **samples = NULL;
+static size_t samples_len = 0, samples_buckets_len = 0;
+
+#ifdef __APPLE__
+static pthread_key_t thread_state_key;
+static pthread_once_t thread_state_key_once = PTHREAD_ONCE_INIT;
+
+static void thread_state_key_create(void)
+{
+  pthread_key_create(&thread_state_key, free);
+}
+
+static MemProfileThreadState *thread_state_get(void)
+{
+  pthread_once(&thread_state_key_once, thread_state_key_create);
+  MemProfileThreadState *state = pthread_getspecific(thread_state_key);
+  if (state == NULL) {
+    state = calloc(1, sizeof(*state));
+    if (state) {
+      pthread_setspecific(thread_state_key, state);
+    }
+  }
+  return state;
+}
+#else
+#  ifdef _MSC_VER
+static __declspec(thread) MemProfileThreadState thread_state = {0, 0, 0};
+#  else
+static __thread MemProfileThreadState thread_state = {0, 0, 0};
+#  endif
+
+static MemProfileThreadState *thread_state_get(void)
+{
+  return &thread_state;
+}
+#endif
+
+MEM_INLINE size_t hash_ptr(const void *ptr)
+{
+  size_t hash = (size_t)(uintptr_t)ptr;
+  hash ^= hash >> 17;
+  hash *= (size_t)0x9E3779B97F4A7C15ull;
+  return hash ^ (hash >> 29);
+}
+
+/* Grow a chained hash table when it has more entries than buckets.
+ * The next pointer is the first member of the entries. */
+static void **hash_table_ensure(void **buckets,
+                               size_t *buckets_len,
+                               const size_t len,
+                               size_t (*hash_fn)(const void *entry))
+{
+  if (len < *buckets_len) {
+    return buckets;
+  }
+  const size_t buckets_len_new = *buckets_len ? *buckets_len * 2 : 1024;
+  void **buckets_new = calloc(buckets_len_new, sizeof(void *));
+  if (buckets_new == NULL) {
+    /* Keep using the smaller table. */
+    return buckets;
+  }
+  for (size_t i = 0; i < *buckets_len; i++) {
+    void *entry = buckets[i];
+    while (entry) {
+      void *entry_next = *(void **)entry;
+      void **bucket = &buckets_new[hash_fn(entry) & (buckets_len_new - 1)];
+      *(void **)entry = *bucket;
+      *bucket = entry;
+      entry = entry_next;
+    }
+  }
+  free(buckets);
+  *buckets_len = buckets_len_new;
+  return buckets_new;
+}
+
+static size_t record_hash(const char *tag, const void *call_site)
+{
+  /* FNV-1a. */
+  size_t hash = (size_t)0xCBF29CE484222325ull;
+  for (const char *c = tag; *c; c++) {
+    hash = (hash ^ (size_t)(unsigned char)*c) * (size_t)0x100000001B3ull;
+  }
+  return hash ^ hash_ptr(call_site);
+}
+
+static size_t record_hash_fn(const void *entry)
+{
+  return ((const MemProfileRecord *)entry)->hash;
+}
+
+static size_t sample_hash_fn(const void *entry)
+{
+  return hash_ptr(((const MemProfileSample *)entry)->ptr);
+}
+
+static MemProfileRecord *record_ensure(const char *tag, const void *call_site)
+{
+  records = (MemProfileRecord **)hash_table_ensure(
+      (void **)records, &records_buckets_len, records_len, record_hash_fn);
+  if (records == NULL) {
+    return NULL;
+  }
+  /* The same tag can be passed from different strings, e.g. literals in different units. */
+  const size_t hash = record_hash(tag, call_site);
+  MemProfileRecord **bucket = &records[hash & (records_buckets_len - 1)];
+  for (MemProfileRecord *record = *bucket; record; record = record->next) {
+    if (record->hash == hash && record->call_site == call_site &&
+        strcmp(record->tag, tag) == 0) {
+      return record;
+    }
+  }
+  const size_t tag_size = strlen(tag) + 1;
+  MemProfileRecord *record = calloc(1, sizeof(*record) + tag_size);
+  if (record) {
+    memcpy(record + 1, tag, tag_size);
+    record->tag = (const char *)(record + 1);
+    record->call_site = call_site;
+    record->hash = hash;
+    record->next = *bucket;
+    *bucket = record;
+    records_len++;
+  }
+  return record;
+}
+
+static unsigned int rand_next(unsigned int *state)
+{
+  /* xorshift32, seeded per thread. */
+  unsigned int x = *state ? *state : (unsigned int)hash_ptr(state) | 1u;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* Returns true when the block was sampled, the caller flags the #MemHead. */
+bool mem_profile_alloc_sample(const void *vmemh,
+                              const size_t len,
+                              const char *str,
+                              const void *call_site)
+{
+  MemProfileThreadState *state = thread_state_get();
+  if (UNLIKELY(state == NULL)) {
+    return false;
+  }
+  state->accumulated += len;
+  if (state->countdown > len) {
+    state->countdown -= len;
+    return false;
+  }
+
+  const size_t interval = mem_profile_sample_interval;
+  if (interval == 0) {
+    return false;
+  }
+  /* Uniform in [interval / 2, interval * 3 / 2). */
+  state->countdown = interval / 2 + (size_t)rand_next(&state->rand_state) % (interval | 1);
+
+  const size_t weight_bytes = state->accumulated;
+  state->accumulated = 0;
+
+  MemProfileSample *sample = malloc(sizeof(*sample));
+  if (sample == NULL) {
+    return false;
+  }
+  sample->ptr = vmemh;
+  sample->weight_bytes = weight_bytes;
+  sample->weight_blocks = len ? (weight_bytes + len / 2) / len : 1;
+
+  pthread_mutex_lock(&profile_mutex);
+  if (!(mem_profile_flag & MEM_PROFILE_CALL_SITE)) {
+    call_site = NULL;
+  }
+  sample->record = record_ensure(str, call_site);
+  samples = (MemProfileSample **)hash_table_ensure(
+      (void **)samples, &samples_buckets_len, samples_len, sample_hash_fn);
+  if (sample->record == NULL || samples == NULL) {
+    pthread_mutex_unlock(&profile_mutex);
+    free(sample);
+    return false;
+  }
+
+  MemProfileRecord *record = sample->record;
+  record->live_bytes += sample->weight_bytes;
+  record->total_bytes += sample->weight_bytes;
+  record->live_blocks += sample->weight_blocks;
+  record->total_blocks += sample->weight_blocks;
+  if (record->live_bytes > record->peak_bytes) {
+    record->peak_bytes = record->live_bytes;
+  }
+
+  MemProfileSample **bucket = &samples[hash_ptr(vmemh) & (samples_buckets_len - 1)];
+  sample->next = *bucket;
+  *bucket = sample;
+  samples_len++;
+  pthread_mutex_unlock(&profile_mutex);
+  return true;
+}
+
+void mem_profile_free_sample(const void *vmemh)
+{
+  pthread_mutex_lock(&profile_mutex);
+  MemProfileSample **sample_p = &samples[hash_ptr(vmemh) & (samples_buckets_len - 1)];
+  while (*sample_p && (*sample_p)->ptr != vmemh) {
+    sample_p = &(*sample_p)->next;
+  }
+  MemProfileSample *sample = *sample_p;
+  if (sample) {
+    *sample_p = sample->next;
+    samples_len--;
+    sample->record->live_bytes -= sample->weight_bytes;
+    sample->record->live_blocks -= sample->weight_blocks;
+  }
+  pthread_mutex_unlock(&profile_mutex);
+  free(sample);
+}
+
+static void mem_profile_print_at_exit(void)
+{
+  MEM_profile_print(stdout);
+}
+
+void MEM_profile_start(const size_t sample_interval, const int flag)
+{
+  static bool print_at_exit_registered = false;
+  if ((flag & MEM_PROFILE_PRINT_AT_EXIT) && !print_at_exit_registered) {
+    atexit(mem_profile_print_at_exit);
+    print_at_exit_registered = true;
+  }
+  mem_profile_flag = flag;
+  mem_profile_sample_interval = sample_interval;
+  mem_profile_sample_interval_last = sample_interval;
+}
+
+void MEM_profile_stop(void)
+{
+  /* Records & samples are kept, so frees of sampled blocks are still counted. */
+  mem_profile_sample_interval = 0;
+}
+
+bool MEM_profile_is_enabled(void)
+{
+  return mem_profile_sample_interval != 0;
+}
+
+static int record_cmp_live_bytes(const void *a, const void *b)
+{
+  const MemProfileRecord *record_a = *(const MemProfileRecord **)a;
+  const MemProfileRecord *record_b = *(const MemProfileRecord **)b;
+  if (record_a->live_bytes != record_b->live_bytes) {
+    return record_a->live_bytes < record_b->live_bytes ? 1 : -1;
+  }
+  if (record_a->peak_bytes != record_b->peak_bytes) {
+    return record_a->peak_bytes < record_b->peak_bytes ? 1 : -1;
+  }
+  return 0;
+}
+
+void MEM_profile_print(FILE *fp)
+{
+  pthread_mutex_lock(&profile_mutex);
+  MemProfileRecord **records_sorted = malloc(sizeof(*records_sorted) * (records_len + 1));
+  if (records_sorted == NULL) {
+    pthread_mutex_unlock(&profile_mutex);
+    return;
+  }
+  size_t records_sorted_len = 0;
+  for (size_t i = 0; i < records_buckets_len; i++) {
+    for (MemProfileRecord *record = records[i]; record; record = record->next) {
+      records_sorted[records_sorted_len++] = record;
+    }
+  }
+  qsort(records_sorted, records_sorted_len, sizeof(*records_sorted), record_cmp_live_bytes);
+
+  const double mb = 1024.0 * 1024.0;
+  fprintf(fp,
+          "\nMemory profile (estimated from samples every " SIZET_FORMAT " bytes):\n",
+          SIZET_ARG(mem_profile_sample_interval_last));
+  fprintf(fp, "%12s %12s %12s %12s  %s\n", "live MB", "peak MB", "total MB", "live blocks", "tag");
+  for (size_t i = 0; i < records_sorted_len; i++) {
+    const MemProfileRecord *record = records_sorted[i];
+    fprintf(fp,
+            "%12.3f %12.3f %12.3f %12lu  %s",
+            (double)record->live_bytes / mb,
+            (double)record->peak_bytes / mb,
+            (double)record->total_bytes / mb,
+            (unsigned long)record->live_blocks,
+            record->tag);
+    if (record->call_site) {
+      fprintf(fp, " [%p]", record->call_site);
+    }
+    fprintf(fp, "\n");
+  }
+  pthread_mutex_unlock(&profile_mutex);
+
+  free(records_sorted);
+  fflush(fp);
+}
@@ -229,6 +229,36 @@ template<class T> class MEM_CacheLimiter {
     }
   }
 
+  /* Free the least priority elements until size bytes are freed, regardless of the maximum.
+   * Returns the amount of memory freed. */
+  size_t free_memory(size_t size)
+  {
+    size_t freed = 0;
+
+    while (!queue.empty() && freed < size) {
+      MEM_CacheElementPtr elem = get_least_priority_destroyable_element();
+
+      if (!elem)
+        break;
+
+      size_t cur_size = data_size_func ? data_size_func(elem->get()->get_data()) :
+                                         MEM_get_memory_in_use();
+
+      if (!elem->destroy_if_possible())
+        break;
+
+      if (data_size_func) {
+        freed += cur_size;
+      }
+      else {
+        size_t mem_in_use = MEM_get_memory_in_use();
+        freed += (cur_size > mem_in_use) ? cur_size - mem_in_use : 0;
+      }
+    }
+
+    return freed;
+  }
+
   void touch(MEM_CacheLimiterHandle<T> *handle)
   {
     /* If we're using custom priority callback re-arranging the queue
@@ -90,6 +90,16 @@ MEM_CacheLimiterHandleC *MEM_CacheLimiter_insert(MEM_CacheLimiterC *This, void *
 
 void MEM_CacheLimiter_enforce_limits(MEM_CacheLimiterC *This);
 
+/**
+ * Free objects until size bytes are freed, regardless of the maximum
+ * (used to stay within the memory budget).
+ *
+ * \param This: "This" pointer.
+ * \return The amount of memory freed.
+ */
+
+size_t MEM_CacheLimiter_free_memory(MEM_CacheLimiterC *This, size_t size);
+
 /**
  * Unmanage object previously inserted object.
  * Does _not_ delete managed object!
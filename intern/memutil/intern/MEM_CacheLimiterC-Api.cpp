@@ -181,6 +181,11 @@ void MEM_CacheLimiter_enforce_limits(MEM_CacheLimiterC *This)
   cast(This)->get_cache()->enforce_limits();
 }
 
+size_t MEM_CacheLimiter_free_memory(MEM_CacheLimiterC *This, size_t size)
+{
+  return cast(This)->get_cache()->free_memory(size);
+}
+
 void MEM_CacheLimiter_unmanage(MEM_CacheLimiterHandleC *handle)
 {
   cast(handle)->unmanage();
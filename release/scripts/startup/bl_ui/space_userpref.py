@@ -1312,6 +1312,7 @@ class USERPREF_PT_saveload_blend(SaveLoadPanel, CenterAlignMixIn, Panel):
         col = layout.column(heading="Save")
         col.prop(view, "use_save_prompt")
         col.prop(paths, "use_save_preview_images")
+        col.prop(paths, "use_save_background")
 
         col = layout.column(heading="Default to")
         col.prop(paths, "use_relative_paths")
@@ -1343,6 +1344,7 @@ class USERPREF_PT_saveload_blend_autosave(SaveLoadPanel, CenterAlignMixIn, Panel
         col = layout.column()
         col.active = paths.use_auto_save_temporary_files
         col.prop(paths, "auto_save_time", text="Timer (mins)")
+        col.prop(paths, "use_auto_save_incremental", text="Incremental")
 
 
 class USERPREF_PT_saveload_file_browser(SaveLoadPanel, CenterAlignMixIn, Panel):
@@ -73,6 +73,8 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /** Share the data of simple layers with the source, duplicate other layers. */
+  CD_SHARE = 5,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -230,6 +232,13 @@ void *CustomData_duplicate_referenced_layer_named(struct CustomData *data,
                                                   const int type,
                                                   const char *name,
                                                   const int totelem);
+/* duplicate data of a layer shared with other layers (CD_FLAG_SHARED), to write to it.
+ * returns the layer data */
+void *CustomData_duplicate_shared_layer(struct CustomData *data,
+                                        const int type,
+                                        const int totelem);
+/* duplicate the data of all shared layers, returns true when any layer data changed */
+bool CustomData_duplicate_shared_layers(struct CustomData *data, const int totelem);
 bool CustomData_is_referenced_layer(struct CustomData *data, int type);
 
 /* set the CD_FLAG_NOCOPY flag in custom data layers where the mask is
@@ -155,6 +155,9 @@ enum {
   G_DEBUG_GPU_FORCE_WORKAROUNDS = (1 << 19), /* force gpu workarounds bypassing detections. */
   G_DEBUG_XR = (1 << 20),                    /* XR/OpenXR messages */
   G_DEBUG_XR_TIME = (1 << 21),               /* XR/OpenXR timing messages */
+  G_DEBUG_IO_PROFILE = (1 << 22),            /* .blend file reading timing report */
+  G_DEBUG_TASK_STATS = (1 << 23),            /* parallel range statistics report on exit */
+  G_DEBUG_DEPSGRAPH_VERIFY = (1 << 24),      /* verify incremental depsgraph builds */
 
   G_DEBUG_GHOST = (1 << 20), /* Debug GHOST module. */
 };
@@ -186,10 +189,14 @@ enum {
   /** On write, restore paths after editing them (G_FILE_RELATIVE_REMAP) */
   G_FILE_SAVE_COPY = (1 << 27),
   /* #define G_FILE_GLSL_NO_ENV_LIGHTING (1 << 28) */ /* deprecated */
+  /** On write, also store the IDs used by each ID in the file index,
+   * this walks over all ID pointers so it's only done on request. */
+  G_FILE_INDEX_DEPS = (1 << 29),
 };
 
 /** Don't overwrite these flags when reading a file. */
-#define G_FILE_FLAG_ALL_RUNTIME (G_FILE_NO_UI | G_FILE_RELATIVE_REMAP | G_FILE_SAVE_COPY)
+#define G_FILE_FLAG_ALL_RUNTIME \
+  (G_FILE_NO_UI | G_FILE_RELATIVE_REMAP | G_FILE_SAVE_COPY | G_FILE_INDEX_DEPS)
 
 /** ENDIAN_ORDER: indicates what endianness the platform where the file was written had. */
 #if !defined(__BIG_ENDIAN__) && !defined(__LITTLE_ENDIAN__)
@@ -801,6 +801,9 @@ static void mesh_calc_modifier_final_normals(const Mesh *mesh_input,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, NULL, mesh_final->totpoly);
+      /* Vertex normals are written too, the vertices may be shared with the original mesh. */
+      mesh_final->mvert = CustomData_duplicate_shared_layer(
+          &mesh_final->vdata, CD_MVERT, mesh_final->totvert);
       BKE_mesh_calc_normals_poly(mesh_final->mvert,
                                  NULL,
                                  mesh_final->totvert,
@@ -1806,7 +1806,7 @@ void armature_deform_verts(Object *armOb,
 
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
-  settings.min_iter_per_thread = 32;
+  settings.use_adaptive_grain = true;
   BLI_task_parallel_range(0, numVerts, &data, armature_vert_task, &settings);
 
   if (defnrToPC) {
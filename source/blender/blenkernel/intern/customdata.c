@@ -35,12 +35,14 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_pointcloud_types.h"
 
+#include "BLI_ghash.h"
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
 #include "BLI_mempool.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -1860,6 +1862,101 @@ void CustomData_update_typemap(CustomData *data)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/* shared layers
+ *
+ * Layers of types without copy and free callbacks can share their data, which is used by the
+ * copy-on-write copies of meshes in the dependency graph. Shared layers are flagged with
+ * CD_FLAG_SHARED and the number of layers using the data is counted in a global table.
+ * The data is freed with its last user, writing to it requires un-sharing the layer first with
+ * CustomData_duplicate_referenced_layer. */
+
+/* Layer data -> number of layers using it. */
+static GHash *shared_layers = NULL;
+static ThreadMutex shared_layers_lock = BLI_MUTEX_INITIALIZER;
+
+static bool customData_layer_can_share(const CustomDataLayer *layer)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+  return layer->data && !(layer->flag & CD_FLAG_NOFREE) && !typeInfo->copy && !typeInfo->free;
+}
+
+static void customData_layer_share(CustomDataLayer *layer, CustomDataLayer *newlayer)
+{
+  BLI_mutex_lock(&shared_layers_lock);
+  if (shared_layers == NULL) {
+    shared_layers = BLI_ghash_ptr_new(__func__);
+  }
+  void **users_p;
+  if (BLI_ghash_ensure_p(shared_layers, layer->data, &users_p)) {
+    *users_p = POINTER_FROM_INT(POINTER_AS_INT(*users_p) + 1);
+  }
+  else {
+    /* First time the data is shared, the source is a user too. */
+    *users_p = POINTER_FROM_INT(2);
+  }
+  layer->flag |= CD_FLAG_SHARED;
+  newlayer->flag |= CD_FLAG_SHARED;
+  BLI_mutex_unlock(&shared_layers_lock);
+}
+
+/* Returns the number of layers still using the data, must be called with the lock held. */
+static int customData_layer_share_remove_user_locked(void *data)
+{
+  if (shared_layers == NULL) {
+    return 0;
+  }
+  void **users_p = BLI_ghash_lookup_p(shared_layers, data);
+  if (users_p == NULL) {
+    return 0;
+  }
+  const int users = POINTER_AS_INT(*users_p) - 1;
+  if (users > 0) {
+    *users_p = POINTER_FROM_INT(users);
+    return users;
+  }
+  BLI_ghash_remove(shared_layers, data, NULL, NULL);
+  if (BLI_ghash_len(shared_layers) == 0) {
+    BLI_ghash_free(shared_layers, NULL, NULL);
+    shared_layers = NULL;
+  }
+  return 0;
+}
+
+/* Returns true when the caller was the last user and has to free the data. */
+static bool customData_layer_share_remove_user(void *data)
+{
+  BLI_mutex_lock(&shared_layers_lock);
+  const int users = customData_layer_share_remove_user_locked(data);
+  BLI_mutex_unlock(&shared_layers_lock);
+  return users == 0;
+}
+
+/* Give the layer its own copy of the data, unless nothing else uses it anymore. */
+static void customData_layer_unshare(CustomDataLayer *layer)
+{
+  BLI_mutex_lock(&shared_layers_lock);
+  if (customData_layer_share_remove_user_locked(layer->data) > 0) {
+    /* Other users can't free the data while the lock is held. */
+    layer->data = MEM_dupallocN(layer->data);
+  }
+  BLI_mutex_unlock(&shared_layers_lock);
+  layer->flag &= ~CD_FLAG_SHARED;
+}
+
+/* Stop sharing the data of a layer which gets new data assigned. The previous data stays with
+ * its other users if there are any, otherwise it belongs to the caller like for other layers. */
+static void customData_layer_share_release(CustomDataLayer *layer, const void *data_new)
+{
+  if (!(layer->flag & CD_FLAG_SHARED) || layer->data == data_new) {
+    return;
+  }
+  if (!(layer->flag & CD_FLAG_NOFREE)) {
+    customData_layer_share_remove_user(layer->data);
+  }
+  layer->flag &= ~CD_FLAG_SHARED;
+}
+
 /* currently only used in BLI_assert */
 #ifndef NDEBUG
 static bool customdata_typemap_is_valid(const CustomData *data)
@@ -1921,6 +2018,7 @@ bool CustomData_merge(const struct CustomData *source,
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
+      case CD_SHARE:
         data = layer->data;
         break;
       default:
@@ -1932,6 +2030,20 @@ bool CustomData_merge(const struct CustomData *source,
       newlayer = customData_add_layer__internal(
           dest, type, CD_REFERENCE, data, totelem, layer->name);
     }
+    else if (alloctype == CD_SHARE) {
+      if (customData_layer_can_share(layer)) {
+        newlayer = customData_add_layer__internal(
+            dest, type, CD_ASSIGN, data, totelem, layer->name);
+        if (newlayer) {
+          /* The source is not modified, besides being flagged as shared. */
+          customData_layer_share((CustomDataLayer *)layer, newlayer);
+        }
+      }
+      else {
+        newlayer = customData_add_layer__internal(
+            dest, type, CD_DUPLICATE, data, totelem, layer->name);
+      }
+    }
     else {
       newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
     }
@@ -1944,6 +2056,10 @@ bool CustomData_merge(const struct CustomData *source,
       newlayer->active_clone = lastclone;
       newlayer->active_mask = lastmask;
       newlayer->flag |= flag & (CD_FLAG_EXTERNAL | CD_FLAG_IN_MEMORY);
+      /* References to shared data have to be duplicated before writing to them too. */
+      if (ELEM(alloctype, CD_ASSIGN, CD_REFERENCE)) {
+        newlayer->flag |= flag & CD_FLAG_SHARED;
+      }
       changed = true;
     }
   }
@@ -1962,6 +2078,9 @@ void CustomData_realloc(CustomData *data, int totelem)
     if (layer->flag & CD_FLAG_NOFREE) {
       continue;
     }
+    if (layer->flag & CD_FLAG_SHARED) {
+      customData_layer_unshare(layer);
+    }
     typeInfo = layerType_getInfo(layer->type);
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
@@ -1987,6 +2106,11 @@ static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
   const LayerTypeInfo *typeInfo;
 
   if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
+    if ((layer->flag & CD_FLAG_SHARED) && !customData_layer_share_remove_user(layer->data)) {
+      /* Still used by other layers. */
+      return;
+    }
+
     typeInfo = layerType_getInfo(layer->type);
 
     if (typeInfo->free) {
@@ -2586,7 +2710,10 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
       layer->data = MEM_dupallocN(layer->data);
     }
 
-    layer->flag &= ~CD_FLAG_NOFREE;
+    layer->flag &= ~(CD_FLAG_NOFREE | CD_FLAG_SHARED);
+  }
+  else if (layer->flag & CD_FLAG_SHARED) {
+    customData_layer_unshare(layer);
   }
 
   return layer->data;
@@ -2628,6 +2755,35 @@ void *CustomData_duplicate_referenced_layer_named(CustomData *data,
   return customData_duplicate_referenced_layer_index(data, layer_index, totelem);
 }
 
+/* Like CustomData_duplicate_referenced_layer, but only duplicates data shared with other
+ * layers, references to data that isn't shared are written to in place. */
+void *CustomData_duplicate_shared_layer(CustomData *data, const int type, const int totelem)
+{
+  const int layer_index = CustomData_get_active_layer_index(data, type);
+
+  if (layer_index == -1) {
+    return NULL;
+  }
+  if (data->layers[layer_index].flag & CD_FLAG_SHARED) {
+    return customData_duplicate_referenced_layer_index(data, layer_index, totelem);
+  }
+  return data->layers[layer_index].data;
+}
+
+bool CustomData_duplicate_shared_layers(CustomData *data, const int totelem)
+{
+  bool changed = false;
+
+  for (int i = 0; i < data->totlayer; i++) {
+    if (data->layers[i].flag & CD_FLAG_SHARED) {
+      void *data_prev = data->layers[i].data;
+      changed |= (customData_duplicate_referenced_layer_index(data, i, totelem) != data_prev);
+    }
+  }
+
+  return changed;
+}
+
 bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 {
   CustomDataLayer *layer;
@@ -2641,7 +2797,7 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 
   layer = &data->layers[layer_index];
 
-  return (layer->flag & CD_FLAG_NOFREE) != 0;
+  return (layer->flag & (CD_FLAG_NOFREE | CD_FLAG_SHARED)) != 0;
 }
 
 void CustomData_free_temporary(CustomData *data, int totelem)
@@ -3075,6 +3231,7 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
+  customData_layer_share_release(&data->layers[layer_index], ptr);
   data->layers[layer_index].data = ptr;
 
   return ptr;
@@ -3088,6 +3245,7 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
+  customData_layer_share_release(&data->layers[layer_index], ptr);
   data->layers[layer_index].data = ptr;
 
   return ptr;
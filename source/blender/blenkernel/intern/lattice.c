@@ -853,16 +853,14 @@ void curve_deform_verts(Object *cuOb,
       /* set mesh min max bounds */
       INIT_MINMAX(cd.dmin, cd.dmax);
 
-      for (a = 0; a < numVerts; a++) {
-        mul_m4_v3(cd.curvespace, vert_coords[a]);
-        minmax_v3v3_v3(cd.dmin, cd.dmax, vert_coords[a]);
-      }
+      mul_v3_m4v3_array(vert_coords, cd.curvespace, (const float(*)[3])vert_coords, numVerts);
+      minmax_v3v3_v3_array(cd.dmin, cd.dmax, (const float(*)[3])vert_coords, numVerts);
 
       for (a = 0; a < numVerts; a++) {
         /* already in 'cd.curvespace', prev for loop */
         calc_curve_deform(cuOb, vert_coords[a], defaxis, &cd, NULL);
-        mul_m4_v3(cd.objectspace, vert_coords[a]);
       }
+      mul_v3_m4v3_array(vert_coords, cd.objectspace, (const float(*)[3])vert_coords, numVerts);
     }
   }
 }
@@ -981,7 +979,7 @@ void lattice_deform_verts(Object *laOb,
 
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
-  settings.min_iter_per_thread = 32;
+  settings.use_adaptive_grain = true;
   BLI_task_parallel_range(0, numVerts, &data, lattice_deform_vert_task, &settings);
 
   end_latt_deform(lattice_deform_data);
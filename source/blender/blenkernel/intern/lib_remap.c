@@ -195,6 +195,7 @@ static int foreach_libblock_remap_callback(LibraryIDLinkCallbackData *cb_data)
         DEG_id_tag_update_ex(id_remap_data->bmain,
                              id_self,
                              ID_RECALC_COPY_ON_WRITE | ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY);
+        DEG_relations_tag_update_id(id_remap_data->bmain, id_self);
         if (id_self != id_owner) {
           DEG_id_tag_update_ex(id_remap_data->bmain,
                                id_owner,
@@ -541,8 +542,18 @@ void BKE_libblock_remap_locked(Main *bmain, void *old_idv, void *new_idv, const
   libblock_remap_data_postprocess_nodetree_update(bmain, new_id);
   BKE_main_lock(bmain);
 
-  /* Full rebuild of DEG! */
-  DEG_relations_tag_update(bmain);
+  if (GS(old_id->name) == ID_OB) {
+    /* Only relations of the objects and of the IDs which used them change, those were tagged
+     * while remapping. */
+    DEG_relations_tag_update_id(bmain, old_id);
+    if (new_id != NULL) {
+      DEG_relations_tag_update_id(bmain, new_id);
+    }
+  }
+  else {
+    /* Full rebuild of DEG! */
+    DEG_relations_tag_update(bmain);
+  }
 }
 
 void BKE_libblock_remap(Main *bmain, void *old_idv, void *new_idv, const short remap_flags)
@@ -650,7 +661,13 @@ void BKE_libblock_relink_ex(
       break;
   }
 
-  DEG_relations_tag_update(bmain);
+  if (GS(id->name) == ID_OB) {
+    /* Only relations of the object change. */
+    DEG_relations_tag_update_id(bmain, id);
+  }
+  else {
+    DEG_relations_tag_update(bmain);
+  }
 }
 
 static int id_relink_to_newid_looper(LibraryIDLinkCallbackData *cb_data)
@@ -109,7 +109,9 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
 
   mesh_dst->mat = MEM_dupallocN(mesh_src->mat);
 
-  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
+  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ?
+                                      CD_REFERENCE :
+                                      (flag & LIB_ID_COPY_CD_SHARE) ? CD_SHARE : CD_DUPLICATE;
   CustomData_copy(&mesh_src->vdata, &mesh_dst->vdata, mask.vmask, alloc_type, mesh_dst->totvert);
   CustomData_copy(&mesh_src->edata, &mesh_dst->edata, mask.emask, alloc_type, mesh_dst->totedge);
   CustomData_copy(&mesh_src->ldata, &mesh_dst->ldata, mask.lmask, alloc_type, mesh_dst->totloop);
@@ -585,6 +587,25 @@ void BKE_mesh_update_customdata_pointers(Mesh *me, const bool do_ensure_tess_cd)
   me->mloopuv = CustomData_get_layer(&me->ldata, CD_MLOOPUV);
 }
 
+/**
+ * Give the mesh its own copy of the layers it shares with copy-on-write meshes, needed before
+ * modifying them in place. Returns true when the layer arrays were re-allocated.
+ */
+bool BKE_mesh_ensure_unshared_customdata(Mesh *me)
+{
+  bool changed = false;
+  changed |= CustomData_duplicate_shared_layers(&me->vdata, me->totvert);
+  changed |= CustomData_duplicate_shared_layers(&me->edata, me->totedge);
+  changed |= CustomData_duplicate_shared_layers(&me->fdata, me->totface);
+  changed |= CustomData_duplicate_shared_layers(&me->ldata, me->totloop);
+  changed |= CustomData_duplicate_shared_layers(&me->pdata, me->totpoly);
+
+  if (changed) {
+    BKE_mesh_update_customdata_pointers(me, false);
+  }
+  return changed;
+}
+
 bool BKE_mesh_has_custom_loop_normals(Mesh *me)
 {
   if (me->edit_mesh) {
@@ -1662,7 +1683,7 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
   const float split_angle = (mesh->flag & ME_AUTOSMOOTH) != 0 ? mesh->smoothresh : (float)M_PI;
 
   if (CustomData_has_layer(&mesh->ldata, CD_NORMAL)) {
-    r_loopnors = CustomData_get_layer(&mesh->ldata, CD_NORMAL);
+    r_loopnors = CustomData_duplicate_shared_layer(&mesh->ldata, CD_NORMAL, mesh->totloop);
     memset(r_loopnors, 0, sizeof(float[3]) * mesh->totloop);
   }
   else {
@@ -1681,6 +1702,8 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
   }
   else {
     polynors = MEM_malloc_arrayN(mesh->totpoly, sizeof(float[3]), __func__);
+    /* Vertex normals are computed too, the vertices may be shared with other meshes. */
+    mesh->mvert = CustomData_duplicate_shared_layer(&mesh->vdata, CD_MVERT, mesh->totvert);
     BKE_mesh_calc_normals_poly(mesh->mvert,
                                NULL,
                                mesh->totvert,
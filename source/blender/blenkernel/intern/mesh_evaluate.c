@@ -323,7 +323,7 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
 
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
-  settings.min_iter_per_thread = 1024;
+  settings.use_adaptive_grain = true;
 
   if (only_face_normals) {
     BLI_assert((pnors != NULL) || (numPolys == 0));
@@ -405,6 +405,13 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
     if (do_add_poly_nors_cddata) {
       poly_nors = MEM_malloc_arrayN((size_t)mesh->totpoly, sizeof(*poly_nors), __func__);
     }
+    else {
+      poly_nors = CustomData_duplicate_shared_layer(&mesh->pdata, CD_NORMAL, mesh->totpoly);
+    }
+    if (do_vert_normals) {
+      /* The vertices may be shared with the original mesh, which is read from other threads. */
+      mesh->mvert = CustomData_duplicate_shared_layer(&mesh->vdata, CD_MVERT, mesh->totvert);
+    }
 
     /* calculate poly/vert normals */
     BKE_mesh_calc_normals_poly(mesh->mvert,
@@ -433,6 +440,7 @@ void BKE_mesh_calc_normals(Mesh *mesh)
 #ifdef DEBUG_TIME
   TIMEIT_START_AVERAGED(BKE_mesh_calc_normals);
 #endif
+  mesh->mvert = CustomData_duplicate_shared_layer(&mesh->vdata, CD_MVERT, mesh->totvert);
   BKE_mesh_calc_normals_poly(mesh->mvert,
                              NULL,
                              mesh->totvert,
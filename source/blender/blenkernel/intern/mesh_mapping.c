@@ -26,9 +26,12 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_vec_types.h"
 
+#include "BLI_array_utils.h"
 #include "BLI_bitmap.h"
 #include "BLI_buffer.h"
 #include "BLI_math.h"
+#include "BLI_sort.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_customdata.h"
@@ -201,6 +204,108 @@ void BKE_mesh_uv_vert_map_free(UvVertMap *vmap)
  *
  * Wrapped by #BKE_mesh_vert_poly_map_create & BKE_mesh_vert_loop_map_create
  */
+/* Meshes with more loops are mapped by sorting the loops by vertex, using multiple threads. */
+#define MESH_MAP_PARALLEL_MIN_LOOPS 100000
+
+typedef struct VertPolyMapData {
+  const MPoly *mpoly;
+  const MLoop *mloop;
+  bool do_loops;
+  /* Offset of the corners of each poly, in poly order (loops may not be). */
+  int *poly_offsets;
+  /* Vertex of each corner, sorted. */
+  uint *loop_verts;
+  /* Poly or loop index of each corner, sorted by vertex (the result). */
+  int *indices;
+  /* Number of corners, the loops used by polys. */
+  int totcorner;
+  MeshElemMap *map;
+} VertPolyMapData;
+
+static void mesh_vert_poly_map_fill_fn(void *__restrict userdata,
+                                       const int i,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  VertPolyMapData *data = userdata;
+  const MPoly *p = &data->mpoly[i];
+  const int offset = data->poly_offsets[i];
+  for (int j = 0; j < p->totloop; j++) {
+    const int loop = p->loopstart + j;
+    data->loop_verts[offset + j] = data->mloop[loop].v;
+    data->indices[offset + j] = data->do_loops ? loop : i;
+  }
+}
+
+static void mesh_vert_poly_map_start_fn(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  VertPolyMapData *data = userdata;
+  const uint v = data->loop_verts[i];
+  if (i == 0 || data->loop_verts[i - 1] != v) {
+    data->map[v].indices = &data->indices[i];
+  }
+}
+
+static void mesh_vert_poly_map_count_fn(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  VertPolyMapData *data = userdata;
+  const uint v = data->loop_verts[i];
+  if (i == data->totcorner - 1 || data->loop_verts[i + 1] != v) {
+    data->map[v].count = (int)(&data->indices[i + 1] - data->map[v].indices);
+  }
+}
+
+/**
+ * Same result as the single threaded loops in #mesh_vert_poly_or_loop_map_create,
+ * but instead of counting the users of every vertex the corners are sorted by vertex.
+ * Corners are laid out in poly order and the sort is stable, so the users of each vertex
+ * are in the same order too.
+ */
+static void mesh_vert_poly_or_loop_map_create_parallel(MeshElemMap *map,
+                                                       int *indices,
+                                                       const MPoly *mpoly,
+                                                       const MLoop *mloop,
+                                                       int totvert,
+                                                       int totpoly,
+                                                       int totloop,
+                                                       const bool do_loops)
+{
+  VertPolyMapData data;
+  data.mpoly = mpoly;
+  data.mloop = mloop;
+  data.do_loops = do_loops;
+  data.poly_offsets = MEM_mallocN(sizeof(*data.poly_offsets) * (size_t)totpoly, __func__);
+  for (int i = 0; i < totpoly; i++) {
+    data.poly_offsets[i] = mpoly[i].totloop;
+  }
+  data.totcorner = BLI_array_scan_exclusive_int(data.poly_offsets, totpoly);
+  BLI_assert(data.totcorner <= totloop);
+  UNUSED_VARS_NDEBUG(totloop);
+  data.loop_verts = MEM_mallocN(sizeof(*data.loop_verts) * (size_t)data.totcorner, __func__);
+  data.indices = indices;
+  data.map = map;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+
+  BLI_task_parallel_range(0, totpoly, &data, mesh_vert_poly_map_fill_fn, &settings);
+  BLI_sort_radix_uint(data.loop_verts, indices, data.totcorner);
+
+  /* Vertices without users keep pointing to the memory, as in the single threaded version. */
+  for (int i = 0; i < totvert; i++) {
+    map[i].indices = indices;
+  }
+  BLI_task_parallel_range(0, data.totcorner, &data, mesh_vert_poly_map_start_fn, &settings);
+  BLI_task_parallel_range(0, data.totcorner, &data, mesh_vert_poly_map_count_fn, &settings);
+
+  MEM_freeN(data.poly_offsets);
+  MEM_freeN(data.loop_verts);
+}
+
 static void mesh_vert_poly_or_loop_map_create(MeshElemMap **r_map,
                                               int **r_mem,
                                               const MPoly *mpoly,
@@ -211,6 +316,16 @@ static void mesh_vert_poly_or_loop_map_create(MeshElemMap **r_map,
                                               const bool do_loops)
 {
   MeshElemMap *map = MEM_callocN(sizeof(MeshElemMap) * (size_t)totvert, __func__);
+
+  if (totloop >= MESH_MAP_PARALLEL_MIN_LOOPS && BLI_task_scheduler_num_threads() > 1) {
+    int *indices = MEM_mallocN(sizeof(int) * (size_t)totloop, __func__);
+    mesh_vert_poly_or_loop_map_create_parallel(
+        map, indices, mpoly, mloop, totvert, totpoly, totloop, do_loops);
+    *r_map = map;
+    *r_mem = indices;
+    return;
+  }
+
   int *indices, *index_iter;
   int i, j;
 
@@ -235,9 +235,8 @@ Mesh *BKE_mesh_mirror_apply_mirror_on_axis(MirrorModifierData *mmd,
   totshape = CustomData_number_of_layers(&result->vdata, CD_SHAPEKEY);
   for (a = 0; a < totshape; a++) {
     float(*cos)[3] = CustomData_get_layer_n(&result->vdata, CD_SHAPEKEY, a);
-    for (i = maxVerts; i < result->totvert; i++) {
-      mul_m4_v3(mtx, cos[i]);
-    }
+    const float(*cos_src)[3] = cos + maxVerts;
+    mul_v3_m4v3_array(cos + maxVerts, mtx, cos_src, result->totvert - maxVerts);
   }
 
   /* adjust mirrored edge vertex indices */
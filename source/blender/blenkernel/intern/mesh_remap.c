@@ -112,6 +112,43 @@ static bool mesh_remap_bvhtree_query_raycast(BVHTreeFromMesh *treedata,
   }
 }
 
+/**
+ * Batched nearest query for all destination vertices (see #mesh_remap_bvhtree_query_nearest).
+ *
+ * \param r_cos: The vertex coordinates in tree space.
+ * \return An array of \a numverts_dst results, an index of -1 means no source was found
+ * within \a max_dist_sq.
+ */
+static BVHTreeNearest *mesh_remap_bvhtree_query_nearest_verts(
+    BVHTreeFromMesh *treedata,
+    const MVert *verts_dst,
+    const int numverts_dst,
+    const SpaceTransform *space_transform,
+    const float max_dist_sq,
+    float (**r_cos)[3])
+{
+  BVHTreeNearest *nearest = MEM_mallocN(sizeof(*nearest) * (size_t)numverts_dst, __func__);
+  float(*cos)[3] = MEM_mallocN(sizeof(*cos) * (size_t)numverts_dst, __func__);
+
+  for (int i = 0; i < numverts_dst; i++) {
+    copy_v3_v3(cos[i], verts_dst[i].co);
+
+    /* Convert the vertex to tree coordinates, if needed. */
+    if (space_transform) {
+      BLI_space_transform_apply(space_transform, cos[i]);
+    }
+
+    nearest[i].index = -1;
+    nearest[i].dist_sq = max_dist_sq;
+  }
+
+  BLI_bvhtree_find_nearest_batch(
+      treedata->tree, cos, numverts_dst, nearest, treedata->nearest_callback, treedata, 0);
+
+  *r_cos = cos;
+  return nearest;
+}
+
 /** \} */
 
 /**
@@ -525,51 +562,47 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
     float tmp_co[3], tmp_no[3];
 
     if (mode == MREMAP_MODE_VERT_NEAREST) {
+      float(*cos_dst)[3];
+
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
-      nearest.index = -1;
+      BVHTreeNearest *nearest_dst = mesh_remap_bvhtree_query_nearest_verts(
+          &treedata, verts_dst, numverts_dst, space_transform, max_dist_sq, &cos_dst);
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
-
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
-
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest.index, &full_weight);
+        if (nearest_dst[i].index != -1) {
+          hit_dist = sqrtf(nearest_dst[i].dist_sq);
+          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest_dst[i].index, &full_weight);
         }
         else {
           /* No source for this dest vertex! */
           BKE_mesh_remap_item_define_invalid(r_map, i);
         }
       }
+
+      MEM_freeN(nearest_dst);
+      MEM_freeN(cos_dst);
     }
     else if (ELEM(mode, MREMAP_MODE_VERT_EDGE_NEAREST, MREMAP_MODE_VERT_EDGEINTERP_NEAREST)) {
       MEdge *edges_src = me_src->medge;
       float(*vcos_src)[3] = BKE_mesh_vert_coords_alloc(me_src, NULL);
+      float(*cos_dst)[3];
 
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_EDGES, 2);
-      nearest.index = -1;
+      BVHTreeNearest *nearest_dst = mesh_remap_bvhtree_query_nearest_verts(
+          &treedata, verts_dst, numverts_dst, space_transform, max_dist_sq, &cos_dst);
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
-
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
+        const float *co_dst = cos_dst[i];
 
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          MEdge *me = &edges_src[nearest.index];
+        if (nearest_dst[i].index != -1) {
+          MEdge *me = &edges_src[nearest_dst[i].index];
+          hit_dist = sqrtf(nearest_dst[i].dist_sq);
           const float *v1cos = vcos_src[me->v1];
           const float *v2cos = vcos_src[me->v2];
 
           if (mode == MREMAP_MODE_VERT_EDGE_NEAREST) {
-            const float dist_v1 = len_squared_v3v3(tmp_co, v1cos);
-            const float dist_v2 = len_squared_v3v3(tmp_co, v2cos);
+            const float dist_v1 = len_squared_v3v3(co_dst, v1cos);
+            const float dist_v2 = len_squared_v3v3(co_dst, v2cos);
             const int index = (int)((dist_v1 > dist_v2) ? me->v2 : me->v1);
             mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &index, &full_weight);
           }
@@ -581,7 +614,7 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
             indices[1] = (int)me->v2;
 
             /* Weight is inverse of point factor here... */
-            weights[0] = line_point_factor_v3(tmp_co, v2cos, v1cos);
+            weights[0] = line_point_factor_v3(co_dst, v2cos, v1cos);
             CLAMP(weights[0], 0.0f, 1.0f);
             weights[1] = 1.0f - weights[0];
 
@@ -594,6 +627,8 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
         }
       }
 
+      MEM_freeN(nearest_dst);
+      MEM_freeN(cos_dst);
       MEM_freeN(vcos_src);
     }
     else if (ELEM(mode,
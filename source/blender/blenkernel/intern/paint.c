@@ -1503,6 +1503,14 @@ static void sculpt_update_object(
   /* tessfaces aren't used and will become invalid */
   BKE_mesh_tessface_clear(me);
 
+  /* Sculpting writes to the original geometry in place, which is not shared with the evaluated
+   * mesh in paint modes. It still can be when the mode was just entered, give the mesh its own
+   * copy then, the PBVH is rebuilt for the new arrays. */
+  if (BKE_mesh_ensure_unshared_customdata(me)) {
+    BLI_assert(ss->cache == NULL);
+    sculptsession_free_pbvh(ob);
+  }
+
   ss->shapekey_active = (mmd == NULL) ? BKE_keyblock_from_object(ob) : NULL;
 
   /* NOTE: Weight pPaint require mesh info for loop lookup, but it never uses multires code path,
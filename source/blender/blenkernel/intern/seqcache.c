@@ -1008,6 +1008,35 @@ bool BKE_sequencer_cache_recycle_item(Scene *scene)
   return true;
 }
 
+/* Memory budget callback, recycle frames as when the cache is full. */
+static size_t seq_cache_budget_free(size_t size, void *user_data)
+{
+  Scene *scene = user_data;
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+  if (!cache) {
+    return 0;
+  }
+
+  /* The allocating thread may be putting an image in the cache. */
+  if (!BLI_mutex_trylock(&cache->iterator_mutex)) {
+    return 0;
+  }
+
+  const size_t memory_used = cache->memory_used;
+  while (memory_used - cache->memory_used < size) {
+    SeqCacheKey *finalkey = seq_cache_get_item_for_removal(scene);
+
+    if (finalkey == NULL) {
+      break;
+    }
+    seq_cache_recycle_linked(scene, finalkey);
+  }
+  const size_t freed = memory_used - cache->memory_used;
+
+  BLI_mutex_unlock(&cache->iterator_mutex);
+  return freed;
+}
+
 static void seq_cache_set_temp_cache_linked(Scene *scene, SeqCacheKey *base)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
@@ -1066,6 +1095,7 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->bmain = bmain;
     BLI_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
+    MEM_add_budget_callback(seq_cache_budget_free, scene);
 
     if (scene->ed->disk_cache_timestamp == 0) {
       scene->ed->disk_cache_timestamp = time(NULL);
@@ -1106,6 +1136,8 @@ void BKE_sequencer_cache_destruct(Scene *scene)
     return;
   }
 
+  MEM_remove_budget_callback(seq_cache_budget_free, scene);
+
   BLI_ghash_free(cache->hash, seq_cache_keyfree, seq_cache_valfree);
   BLI_mempool_destroy(cache->keys_pool);
   BLI_mempool_destroy(cache->items_pool);
@@ -40,6 +40,8 @@
 #include "BKE_main.h"
 #include "BKE_undo_system.h"
 
+#include "BLO_undofile.h"
+
 #include "MEM_guardedalloc.h"
 
 #define undo_stack _wm_undo_stack_disallow /* pass in as a variable always. */
@@ -892,6 +894,14 @@ void BKE_undosys_print(UndoStack *ustack)
            us->name);
     index++;
   }
+
+  MemFileStats stats;
+  BLO_memfile_stats_get(&stats);
+  printf("Global undo: %zu chunks (%zu bytes) using %zu buffers (%zu bytes)\n",
+         stats.chunks_len,
+         stats.chunks_size,
+         stats.buffers_len,
+         stats.buffers_size);
 }
 
 /** \} */
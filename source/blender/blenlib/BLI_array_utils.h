@@ -90,6 +90,8 @@ bool _bli_array_iter_span(const void *arr,
 bool _bli_array_is_zeroed(const void *arr, unsigned int arr_len, size_t arr_stride);
 #define BLI_array_is_zeroed(arr, arr_len) _bli_array_is_zeroed(arr, arr_len, sizeof(*(arr)))
 
+int BLI_array_scan_exclusive_int(int *arr, const int arr_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,266 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_CONCURRENT_MAP_HH__
+#define __BLI_CONCURRENT_MAP_HH__
+
+/** \file
+ * \ingroup bli
+ *
+ * This file provides a map that can be used from multiple threads at once.
+ *
+ * Items are distributed over shards by their hash, each shard being a regular #Map protected by a
+ * reader-writer lock. Threads only contend when accessing the same shard, and lookups within the
+ * same shard don't block each other. Shards grow independently, so there is no global resize.
+ *
+ * Values are returned as copies, or passed to callbacks while their shard is locked, because
+ * pointers into a shard are invalidated when another thread makes it grow.
+ */
+
+#include "BLI_map.hh"
+#include "BLI_threads.h"
+#include "BLI_utility_mixins.hh"
+
+namespace BLI {
+
+template<typename KeyT,
+         typename ValueT,
+         uint32_t ShardsNum = 64,
+         typename Allocator = GuardedAllocator>
+class ConcurrentMap {
+ private:
+  static_assert(ShardsNum > 0 && (ShardsNum & (ShardsNum - 1)) == 0,
+                "Number of shards must be a power of two");
+
+  struct Shard {
+    /* Mutable, locking is needed for const access too. */
+    mutable ThreadRWMutex mutex;
+    Map<KeyT, ValueT, 4, Allocator> map;
+
+    Shard()
+    {
+      BLI_rw_mutex_init(&mutex);
+    }
+
+    ~Shard()
+    {
+      BLI_rw_mutex_end(&mutex);
+    }
+  };
+
+  /* Locks a shard for the lifetime of the lock. */
+  class ShardLock : NonCopyable, NonMovable {
+   private:
+    ThreadRWMutex *m_mutex;
+
+   public:
+    ShardLock(const Shard &shard, const int mode) : m_mutex(&shard.mutex)
+    {
+      BLI_rw_mutex_lock(m_mutex, mode);
+    }
+
+    ~ShardLock()
+    {
+      BLI_rw_mutex_unlock(m_mutex);
+    }
+  };
+
+  Shard m_shards[ShardsNum];
+
+  Shard &shard_for_key(const KeyT &key)
+  {
+    return m_shards[shard_index(key)];
+  }
+
+  const Shard &shard_for_key(const KeyT &key) const
+  {
+    return m_shards[shard_index(key)];
+  }
+
+  static uint32_t shard_index(const KeyT &key)
+  {
+    /* Use the high bits of a multiplicative hash, the maps of the shards use the low bits. */
+    const uint32_t hash = DefaultHash<KeyT>{}(key);
+    const uint32_t hash_mixed = hash * 2654435761u;
+    return (ShardsNum > 1) ? (hash_mixed >> (32 - shards_bits())) : 0;
+  }
+
+  static constexpr uint32_t shards_bits()
+  {
+    uint32_t bits = 0;
+    while ((1u << bits) < ShardsNum) {
+      bits++;
+    }
+    return bits;
+  }
+
+ public:
+  ConcurrentMap() = default;
+
+  ConcurrentMap(const ConcurrentMap &other) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &other) = delete;
+
+  /**
+   * Allocate memory such that at least min_usable_slots can be added before any shard has to
+   * grow, assuming keys are evenly distributed. Not thread-safe.
+   */
+  void reserve(uint min_usable_slots)
+  {
+    for (Shard &shard : m_shards) {
+      shard.map.reserve(min_usable_slots / ShardsNum + 1);
+    }
+  }
+
+  /**
+   * Remove all elements from the map.
+   */
+  void clear()
+  {
+    for (Shard &shard : m_shards) {
+      ShardLock lock(shard, THREAD_LOCK_WRITE);
+      shard.map.clear();
+    }
+  }
+
+  /**
+   * Insert a new key-value-pair in the map if the key does not exist yet.
+   * Returns true when the pair was newly inserted, otherwise false.
+   */
+  bool add(const KeyT &key, const ValueT &value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    ShardLock lock(shard, THREAD_LOCK_WRITE);
+    return shard.map.add(key, value);
+  }
+
+  /**
+   * Similar to add, but overrides the value for the key when it exists already.
+   */
+  bool add_override(const KeyT &key, const ValueT &value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    ShardLock lock(shard, THREAD_LOCK_WRITE);
+    return shard.map.add_override(key, value);
+  }
+
+  /**
+   * Remove the key from the map.
+   * Returns true when the key existed, otherwise false.
+   */
+  bool remove(const KeyT &key)
+  {
+    Shard &shard = this->shard_for_key(key);
+    ShardLock lock(shard, THREAD_LOCK_WRITE);
+    if (!shard.map.contains(key)) {
+      return false;
+    }
+    shard.map.remove(key);
+    return true;
+  }
+
+  /**
+   * Returns true when the key exists in the map, otherwise false.
+   */
+  bool contains(const KeyT &key) const
+  {
+    const Shard &shard = this->shard_for_key(key);
+    ShardLock lock(shard, THREAD_LOCK_READ);
+    return shard.map.contains(key);
+  }
+
+  /**
+   * Check if the key exists in the map.
+   * If it does, return a copy of the value.
+   * Otherwise, return the default value.
+   */
+  ValueT lookup_default(const KeyT &key, ValueT default_value) const
+  {
+    const Shard &shard = this->shard_for_key(key);
+    ShardLock lock(shard, THREAD_LOCK_READ);
+    return shard.map.lookup_default(key, default_value);
+  }
+
+  /**
+   * Return a copy of the value that corresponds to the given key.
+   * If it does not exist yet, create and insert it first. Only one thread creates the value when
+   * multiple threads add the same key at once.
+   */
+  template<typename CreateValueF>
+  ValueT lookup_or_add(const KeyT &key, const CreateValueF &create_value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    {
+      ShardLock lock(shard, THREAD_LOCK_READ);
+      const ValueT *value = shard.map.lookup_ptr(key);
+      if (value != nullptr) {
+        return *value;
+      }
+    }
+    ShardLock lock(shard, THREAD_LOCK_WRITE);
+    return shard.map.lookup_or_add(key, create_value);
+  }
+
+  /**
+   * Same as #Map::add_or_modify. The shard of the key is locked while the callback runs, so it
+   * must not access the map.
+   */
+  template<typename CreateValueF, typename ModifyValueF>
+  auto add_or_modify(const KeyT &key,
+                     const CreateValueF &create_value,
+                     const ModifyValueF &modify_value) -> decltype(create_value(nullptr))
+  {
+    Shard &shard = this->shard_for_key(key);
+    ShardLock lock(shard, THREAD_LOCK_WRITE);
+    return shard.map.add_or_modify(key, create_value, modify_value);
+  }
+
+  /**
+   * Get the number of elements in the map. Only exact when no other thread modifies the map.
+   */
+  uint32_t size() const
+  {
+    uint32_t size = 0;
+    for (const Shard &shard : m_shards) {
+      ShardLock lock(shard, THREAD_LOCK_READ);
+      size += shard.map.size();
+    }
+    return size;
+  }
+
+  /**
+   * Returns true if there are no elements in the map.
+   */
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Calls the given function for each key-value-pair. Each shard is locked while its items are
+   * visited, other threads can keep using the map, but the function must not modify it.
+   */
+  template<typename FuncT> void foreach_item(const FuncT &func) const
+  {
+    for (const Shard &shard : m_shards) {
+      ShardLock lock(shard, THREAD_LOCK_READ);
+      shard.map.foreach_item(func);
+    }
+  }
+};
+
+}  // namespace BLI
+
+#endif /* __BLI_CONCURRENT_MAP_HH__ */
@@ -0,0 +1,86 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_GHASH_CONCURRENT_H__
+#define __BLI_GHASH_CONCURRENT_H__
+
+/** \file
+ * \ingroup bli
+ *
+ * A #GHash that can be used from multiple threads at once,
+ * see `BLI_concurrent_map.hh` for the C++ equivalent.
+ *
+ * Items are distributed over shards by their hash, each shard being a #GHash protected by a
+ * reader-writer lock, so threads only contend when accessing the same shard.
+ */
+
+#include "BLI_ghash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ConcurrentGHash ConcurrentGHash;
+
+typedef void (*ConcurrentGHashForeachFP)(void *key, void *val, void *userdata);
+
+/* ************************************************************************** */
+/* NOTE: These functions are NOT safe for use from threads. */
+
+ConcurrentGHash *BLI_ghash_concurrent_new(GHashHashFP hashfp,
+                                          GHashCmpFP cmpfp,
+                                          const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_ghash_concurrent_free(ConcurrentGHash *cgh,
+                               GHashKeyFreeFP keyfreefp,
+                               GHashValFreeFP valfreefp);
+void BLI_ghash_concurrent_clear(ConcurrentGHash *cgh,
+                                GHashKeyFreeFP keyfreefp,
+                                GHashValFreeFP valfreefp);
+
+/* ************************************************************************** */
+/* NOTE: These functions are safe for use from threads. */
+
+/* Insert when the key doesn't exist yet, returns true when inserted. */
+bool BLI_ghash_concurrent_add(ConcurrentGHash *cgh, void *key, void *val);
+/* Insert when the key doesn't exist yet, returns true when it existed.
+ * \a r_val is set to the value in the map, either \a val or the existing one. */
+bool BLI_ghash_concurrent_ensure(ConcurrentGHash *cgh, void *key, void *val, void **r_val);
+bool BLI_ghash_concurrent_remove(ConcurrentGHash *cgh,
+                                 const void *key,
+                                 GHashKeyFreeFP keyfreefp,
+                                 GHashValFreeFP valfreefp);
+
+void *BLI_ghash_concurrent_lookup(const ConcurrentGHash *cgh,
+                                  const void *key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_ghash_concurrent_lookup_default(const ConcurrentGHash *cgh,
+                                          const void *key,
+                                          void *val_default) ATTR_WARN_UNUSED_RESULT;
+bool BLI_ghash_concurrent_haskey(const ConcurrentGHash *cgh,
+                                 const void *key) ATTR_WARN_UNUSED_RESULT;
+/* Only exact when no other thread modifies the map. */
+unsigned int BLI_ghash_concurrent_len(const ConcurrentGHash *cgh) ATTR_WARN_UNUSED_RESULT;
+
+/* Call \a func for all items. Each shard is locked while its items are visited,
+ * so other threads can keep using the map, but \a func must not modify it. */
+void BLI_ghash_concurrent_foreach(const ConcurrentGHash *cgh,
+                                  ConcurrentGHashForeachFP func,
+                                  void *userdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_GHASH_CONCURRENT_H__ */
@@ -65,6 +65,7 @@
  */
 
 #include "BLI_math_base.h"
+#include "BLI_math_bulk.h"
 #include "BLI_math_color.h"
 #include "BLI_math_geom.h"
 #include "BLI_math_interp.h"
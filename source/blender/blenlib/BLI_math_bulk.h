@@ -0,0 +1,61 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_MATH_BULK_H__
+#define __BLI_MATH_BULK_H__
+
+/** \file
+ * \ingroup bli
+ *
+ * Math functions operating on arrays of vectors at once, using SIMD instructions.
+ * The instruction set is chosen at runtime from what the CPU supports,
+ * results match the functions operating on single vectors up to rounding.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum eMathBulkISA {
+  MATH_BULK_ISA_SCALAR = 0,
+  MATH_BULK_ISA_SSE2 = 1,
+  MATH_BULK_ISA_AVX2 = 2,
+} eMathBulkISA;
+
+/* Instruction set used by the bulk functions. */
+eMathBulkISA BLI_math_bulk_isa_get(void);
+/* Limit the instruction set used (for tests & benchmarks),
+ * clamped to what the CPU supports. Not thread-safe. */
+void BLI_math_bulk_isa_set(const eMathBulkISA isa);
+const char *BLI_math_bulk_isa_name(const eMathBulkISA isa);
+
+/* r may be the same array as v. */
+void mul_v3_m4v3_array(float (*r)[3], const float M[4][4], const float (*v)[3], const int len);
+/* Zero length vectors are set to zero, as #normalize_v3 does. */
+void normalize_v3_array(float (*vecs)[3], const int len);
+void interp_v3_v3v3_array(float (*r)[3],
+                          const float (*a)[3],
+                          const float (*b)[3],
+                          const float t,
+                          const int len);
+
+/* #minmax_v3v3_v3_array is declared in BLI_math_vector.h. */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_MATH_BULK_H__ */
@@ -33,8 +33,10 @@ extern "C" {
 
 struct BLI_mempool;
 struct BLI_mempool_chunk;
+struct BLI_mempool_thread;
 
 typedef struct BLI_mempool BLI_mempool;
+typedef struct BLI_mempool_thread BLI_mempool_thread;
 
 BLI_mempool *BLI_mempool_create(unsigned int esize,
                                 unsigned int totelem,
@@ -84,6 +86,12 @@ enum {
    * order of allocation when no chunks have been freed.
    */
   BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+  /** Allow allocating from multiple threads at once, see #BLI_mempool_thread_begin.
+   *
+   * \note While any thread cache is active, only the `BLI_mempool_thread_*` functions
+   * may be used to allocate & free elements (iterating and clearing aren't supported either).
+   */
+  BLI_MEMPOOL_CONCURRENT = (1 << 1),
 };
 
 void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
@@ -94,6 +102,15 @@ BLI_mempool_iter *BLI_mempool_iter_threadsafe_create(BLI_mempool *pool,
     ATTR_NONNULL();
 void BLI_mempool_iter_threadsafe_free(BLI_mempool_iter *iter_arr) ATTR_NONNULL();
 
+BLI_mempool_thread *BLI_mempool_thread_begin(BLI_mempool *pool) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL();
+void BLI_mempool_thread_end(BLI_mempool_thread *cache) ATTR_NONNULL();
+void *BLI_mempool_thread_alloc(BLI_mempool_thread *cache) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL(1);
+void *BLI_mempool_thread_calloc(BLI_mempool_thread *cache) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL(1);
+void BLI_mempool_thread_free(BLI_mempool_thread *cache, void *addr) ATTR_NONNULL(1, 2);
+
 #ifdef __cplusplus
 }
 #endif
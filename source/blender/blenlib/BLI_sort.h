@@ -26,6 +26,8 @@
 
 #include <stdlib.h>
 
+#include "BLI_sys_types.h"
+
 /* glibc 2.8+ */
 #if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 8))
 #  define BLI_qsort_r qsort_r
@@ -40,4 +42,15 @@ void BLI_qsort_r(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk)
 #endif
     ;
 
+/* Parallel sorting, for large arrays (see sort_parallel.c). */
+void BLI_sort_parallel_r(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk)
+#ifdef __GNUC__
+    __attribute__((nonnull(1, 4)))
+#endif
+    ;
+
+void BLI_sort_radix_uint(uint *keys, int *values, const int len);
+void BLI_sort_radix_int(int *keys, int *values, const int len);
+void BLI_sort_radix_float(float *keys, int *values, const int len);
+
 #endif /* __BLI_SORT_H__ */
@@ -47,6 +47,24 @@ void BLI_task_scheduler_init(void);
 void BLI_task_scheduler_exit(void);
 int BLI_task_scheduler_num_threads(void);
 
+/* NUMA
+ *
+ * Optionally the scheduler uses a task arena per NUMA node, with threads pinned
+ * to the node. Large parallel ranges are then split over the nodes, always in
+ * the same way, so memory first touched by a parallel range is local to the
+ * node processing the same iterations in later ranges.
+ *
+ * Must be set before #BLI_task_scheduler_init. */
+
+void BLI_task_scheduler_use_numa_set(const bool use_numa);
+/* Number of NUMA nodes work is split over,
+ * 1 when not using NUMA or when called from work already running on a node. */
+int BLI_task_scheduler_numa_nodes_num(void);
+
+typedef void (*TaskNumaNodeFunc)(void *__restrict userdata, const int node_index);
+/* Run func once for each NUMA node, on threads of that node, and wait for all to finish. */
+void BLI_task_scheduler_numa_run(TaskNumaNodeFunc func, void *userdata);
+
 /* Task Pool
  *
  * Pool of tasks that will be executed by the central task scheduler. For each
@@ -113,6 +131,36 @@ void *BLI_task_pool_user_data(TaskPool *pool);
 /* optional mutex to use from run function */
 ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 
+/* Task Graph
+ *
+ * Graph of tasks with dependencies, a node runs once all nodes with an edge
+ * to it have finished. Each node keeps an atomic counter of its pending
+ * dependencies, so no locking is needed while the graph runs.
+ *
+ * Nodes and edges must be created before running the graph, which may be run
+ * any number of times. The graph must not contain cycles.
+ */
+
+typedef struct TaskGraph TaskGraph;
+typedef struct TaskNode TaskNode;
+
+typedef void (*TaskGraphNodeRunFunction)(void *__restrict task_data);
+typedef void (*TaskGraphNodeFreeFunction)(void *task_data);
+
+TaskGraph *BLI_task_graph_create(void);
+void BLI_task_graph_free(TaskGraph *task_graph);
+
+/* Run all nodes of the graph and wait for them to finish. */
+void BLI_task_graph_work_and_wait(TaskGraph *task_graph);
+
+/* free_func is optional, called for task_data when the graph is freed. */
+TaskNode *BLI_task_graph_node_create(TaskGraph *task_graph,
+                                     TaskGraphNodeRunFunction run_func,
+                                     void *task_data,
+                                     TaskGraphNodeFreeFunction free_func);
+/* to_node will only run after from_node has finished. */
+void BLI_task_graph_edge_create(TaskNode *from_node, TaskNode *to_node);
+
 /* Parallel for routines */
 
 /* Per-thread specific data passed to the callback. */
@@ -166,15 +214,41 @@ typedef struct TaskParallelSettings {
    * having a global use_threading switch based on just range size.
    */
   int min_iter_per_thread;
+  /* Choose the number of iterations handled at once from the measured cost of iterations
+   * in previous calls (from the same call site), instead of #min_iter_per_thread.
+   * Ranges too small to be worth threading are run single threaded.
+   * This is a preferred way for loops which cost per iteration depends on the input.
+   */
+  bool use_adaptive_grain;
 } TaskParallelSettings;
 
 BLI_INLINE void BLI_parallel_range_settings_defaults(TaskParallelSettings *settings);
 
-void BLI_task_parallel_range(const int start,
-                             const int stop,
-                             void *userdata,
-                             TaskParallelRangeFunc func,
-                             const TaskParallelSettings *settings);
+/* State of a #BLI_task_parallel_range call site (for adaptive grain and statistics),
+ * only accessed with atomic operations. */
+typedef struct TaskParallelRangeSite {
+  const char *name;
+  /* Estimated cost of a single iteration (bits of a double), zero until measured. */
+  uint64_t time_per_iter;
+} TaskParallelRangeSite;
+
+void BLI_task_parallel_range_ex(const int start,
+                                const int stop,
+                                void *userdata,
+                                TaskParallelRangeFunc func,
+                                TaskParallelRangeSite *site,
+                                const TaskParallelSettings *settings);
+/* Each call site has its own state, named after the callback. */
+#define BLI_task_parallel_range(start, stop, userdata, func, settings) \
+  do { \
+    static TaskParallelRangeSite _range_site = {#func, 0}; \
+    BLI_task_parallel_range_ex(start, stop, userdata, func, &_range_site, settings); \
+  } while (0)
+
+/* Per call site statistics of #BLI_task_parallel_range, for tuning threading of loops. */
+void BLI_task_parallel_range_stats_enable(const bool enable);
+void BLI_task_parallel_range_stats_print(void);
+void BLI_task_parallel_range_stats_clear(void);
 
 /* This data is shared between all tasks, its access needs thread lock or similar protection.
  */
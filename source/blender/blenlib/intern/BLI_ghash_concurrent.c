@@ -0,0 +1,176 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Sharded #GHash, for concurrent access from multiple threads.
+ */
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_ghash.h"
+#include "BLI_ghash_concurrent.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BLI_strict_flags.h"
+
+/* Must be a power of two. */
+#define SHARDS_BITS 6
+#define SHARDS_NUM (1 << SHARDS_BITS)
+
+typedef struct ConcurrentGHashShard {
+  ThreadRWMutex lock;
+  GHash *gh;
+} ConcurrentGHashShard;
+
+struct ConcurrentGHash {
+  GHashHashFP hashfp;
+  ConcurrentGHashShard shards[SHARDS_NUM];
+};
+
+BLI_INLINE ConcurrentGHashShard *ghash_concurrent_shard(const ConcurrentGHash *cgh,
+                                                        const void *key)
+{
+  /* Use the high bits of a multiplicative hash, the #GHash of the shards uses the low bits. */
+  const uint hash = cgh->hashfp(key) * 2654435761u;
+  /* Locking modifies the shard, even for const access to the map. */
+  return (ConcurrentGHashShard *)&cgh->shards[hash >> (32 - SHARDS_BITS)];
+}
+
+ConcurrentGHash *BLI_ghash_concurrent_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+  ConcurrentGHash *cgh = MEM_mallocN(sizeof(*cgh), info);
+  cgh->hashfp = hashfp;
+  for (int i = 0; i < SHARDS_NUM; i++) {
+    BLI_rw_mutex_init(&cgh->shards[i].lock);
+    cgh->shards[i].gh = BLI_ghash_new(hashfp, cmpfp, info);
+  }
+  return cgh;
+}
+
+void BLI_ghash_concurrent_free(ConcurrentGHash *cgh,
+                               GHashKeyFreeFP keyfreefp,
+                               GHashValFreeFP valfreefp)
+{
+  for (int i = 0; i < SHARDS_NUM; i++) {
+    BLI_ghash_free(cgh->shards[i].gh, keyfreefp, valfreefp);
+    BLI_rw_mutex_end(&cgh->shards[i].lock);
+  }
+  MEM_freeN(cgh);
+}
+
+void BLI_ghash_concurrent_clear(ConcurrentGHash *cgh,
+                                GHashKeyFreeFP keyfreefp,
+                                GHashValFreeFP valfreefp)
+{
+  for (int i = 0; i < SHARDS_NUM; i++) {
+    BLI_ghash_clear(cgh->shards[i].gh, keyfreefp, valfreefp);
+  }
+}
+
+bool BLI_ghash_concurrent_add(ConcurrentGHash *cgh, void *key, void *val)
+{
+  void *val_existing;
+  return !BLI_ghash_concurrent_ensure(cgh, key, val, &val_existing);
+}
+
+bool BLI_ghash_concurrent_ensure(ConcurrentGHash *cgh, void *key, void *val, void **r_val)
+{
+  ConcurrentGHashShard *shard = ghash_concurrent_shard(cgh, key);
+  void **val_p;
+
+  BLI_rw_mutex_lock(&shard->lock, THREAD_LOCK_WRITE);
+  const bool exists = BLI_ghash_ensure_p(shard->gh, key, &val_p);
+  if (!exists) {
+    *val_p = val;
+  }
+  *r_val = *val_p;
+  BLI_rw_mutex_unlock(&shard->lock);
+
+  return exists;
+}
+
+bool BLI_ghash_concurrent_remove(ConcurrentGHash *cgh,
+                                 const void *key,
+                                 GHashKeyFreeFP keyfreefp,
+                                 GHashValFreeFP valfreefp)
+{
+  ConcurrentGHashShard *shard = ghash_concurrent_shard(cgh, key);
+
+  BLI_rw_mutex_lock(&shard->lock, THREAD_LOCK_WRITE);
+  const bool removed = BLI_ghash_remove(shard->gh, key, keyfreefp, valfreefp);
+  BLI_rw_mutex_unlock(&shard->lock);
+
+  return removed;
+}
+
+void *BLI_ghash_concurrent_lookup(const ConcurrentGHash *cgh, const void *key)
+{
+  return BLI_ghash_concurrent_lookup_default(cgh, key, NULL);
+}
+
+void *BLI_ghash_concurrent_lookup_default(const ConcurrentGHash *cgh,
+                                          const void *key,
+                                          void *val_default)
+{
+  ConcurrentGHashShard *shard = ghash_concurrent_shard(cgh, key);
+
+  BLI_rw_mutex_lock(&shard->lock, THREAD_LOCK_READ);
+  void *val = BLI_ghash_lookup_default(shard->gh, key, val_default);
+  BLI_rw_mutex_unlock(&shard->lock);
+
+  return val;
+}
+
+bool BLI_ghash_concurrent_haskey(const ConcurrentGHash *cgh, const void *key)
+{
+  ConcurrentGHashShard *shard = ghash_concurrent_shard(cgh, key);
+
+  BLI_rw_mutex_lock(&shard->lock, THREAD_LOCK_READ);
+  const bool haskey = BLI_ghash_haskey(shard->gh, key);
+  BLI_rw_mutex_unlock(&shard->lock);
+
+  return haskey;
+}
+
+unsigned int BLI_ghash_concurrent_len(const ConcurrentGHash *cgh)
+{
+  uint len = 0;
+  for (int i = 0; i < SHARDS_NUM; i++) {
+    ConcurrentGHashShard *shard = (ConcurrentGHashShard *)&cgh->shards[i];
+    BLI_rw_mutex_lock(&shard->lock, THREAD_LOCK_READ);
+    len += BLI_ghash_len(shard->gh);
+    BLI_rw_mutex_unlock(&shard->lock);
+  }
+  return len;
+}
+
+void BLI_ghash_concurrent_foreach(const ConcurrentGHash *cgh,
+                                  ConcurrentGHashForeachFP func,
+                                  void *userdata)
+{
+  for (int i = 0; i < SHARDS_NUM; i++) {
+    ConcurrentGHashShard *shard = (ConcurrentGHashShard *)&cgh->shards[i];
+    GHashIterator gh_iter;
+    BLI_rw_mutex_lock(&shard->lock, THREAD_LOCK_READ);
+    GHASH_ITER (gh_iter, shard->gh) {
+      func(BLI_ghashIterator_getKey(&gh_iter), BLI_ghashIterator_getValue(&gh_iter), userdata);
+    }
+    BLI_rw_mutex_unlock(&shard->lock);
+  }
+}
@@ -46,6 +46,7 @@
 #include "BLI_heap_simple.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_math_bits.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
@@ -560,6 +561,228 @@ static void bvhtree_verify(BVHTree *tree)
 }
 #endif /* USE_VERIFY_TREE */
 
+/* Parallel building:
+ *
+ * Branches on the top levels of the tree are few (less than the number of threads),
+ * while each of them covers most of the leafs. Threading over the leafs of these branches
+ * (refitting their bounds & splitting their leafs) keeps all threads busy
+ * while building the first levels. The resulting tree is equivalent to a single threaded build
+ * (nodes only differ in order when their split values are equal).
+ *
+ * The leafs are processed in blocks, so per-thread work remains large enough. */
+
+/* Number of leafs below which a branch is built single threaded. */
+#ifdef DEBUG
+#  define KDOPBVH_THREAD_SPLIT_THRESHOLD 64
+#else
+#  define KDOPBVH_THREAD_SPLIT_THRESHOLD (1 << 15)
+#endif
+#define KDOPBVH_THREAD_SPLIT_BLOCK_SIZE (KDOPBVH_THREAD_SPLIT_THRESHOLD / 8)
+
+static int bvh_split_blocks_num(const int begin, const int end)
+{
+  return (end - begin + KDOPBVH_THREAD_SPLIT_BLOCK_SIZE - 1) / KDOPBVH_THREAD_SPLIT_BLOCK_SIZE;
+}
+
+typedef struct BVHRefitData {
+  const BVHTree *tree;
+  int begin, end;
+  /** Bounds of each block, `tree->axis` floats per block. */
+  float *blocks_bv;
+} BVHRefitData;
+
+static void refit_kdop_hull_task_cb(void *__restrict userdata,
+                                    const int block,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRefitData *data = userdata;
+  const int begin = data->begin + block * KDOPBVH_THREAD_SPLIT_BLOCK_SIZE;
+  const int end = min_ii(begin + KDOPBVH_THREAD_SPLIT_BLOCK_SIZE, data->end);
+
+  BVHNode node_block;
+  node_block.bv = &data->blocks_bv[block * data->tree->axis];
+  refit_kdop_hull(data->tree, &node_block, begin, end);
+}
+
+/**
+ * A version of #refit_kdop_hull which is threaded for large ranges of nodes.
+ */
+static void refit_kdop_hull_parallel(const BVHTree *tree, BVHNode *node, int start, int end)
+{
+  if (end - start <= KDOPBVH_THREAD_SPLIT_THRESHOLD) {
+    refit_kdop_hull(tree, node, start, end);
+    return;
+  }
+
+  const int blocks_num = bvh_split_blocks_num(start, end);
+  BVHRefitData data = {
+      .tree = tree,
+      .begin = start,
+      .end = end,
+      .blocks_bv = MEM_mallocN(sizeof(float) * (size_t)(blocks_num * tree->axis), __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, blocks_num, &data, refit_kdop_hull_task_cb, &settings);
+
+  float *__restrict bv = node->bv;
+  node_minmax_init(tree, node);
+  for (int block = 0; block < blocks_num; block++) {
+    const float *__restrict block_bv = &data.blocks_bv[block * tree->axis];
+    for (axis_t axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+      bv[(2 * axis_iter)] = min_ff(bv[(2 * axis_iter)], block_bv[(2 * axis_iter)]);
+      bv[(2 * axis_iter) + 1] = max_ff(bv[(2 * axis_iter) + 1], block_bv[(2 * axis_iter) + 1]);
+    }
+  }
+
+  MEM_freeN(data.blocks_bv);
+}
+
+enum {
+  BVH_SPLIT_LESS = 0,
+  BVH_SPLIT_EQUAL = 1,
+  BVH_SPLIT_GREATER = 2,
+};
+
+typedef struct BVHSplitData {
+  BVHNode **a;
+  /** Destination of the partitioned range, copied back into `a` afterwards. */
+  BVHNode **a_tmp;
+  int begin, end;
+  int axis;
+  float pivot;
+  /** Number of nodes per block and partition (then offsets of each block into `a_tmp`). */
+  int (*blocks_count)[3];
+} BVHSplitData;
+
+static int bvh_split_partition_of(const BVHSplitData *data, const BVHNode *node)
+{
+  const float value = node->bv[data->axis];
+  return (value < data->pivot) ? BVH_SPLIT_LESS :
+                                 ((data->pivot < value) ? BVH_SPLIT_GREATER : BVH_SPLIT_EQUAL);
+}
+
+static void bvh_split_count_task_cb(void *__restrict userdata,
+                                    const int block,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSplitData *data = userdata;
+  const int begin = data->begin + block * KDOPBVH_THREAD_SPLIT_BLOCK_SIZE;
+  const int end = min_ii(begin + KDOPBVH_THREAD_SPLIT_BLOCK_SIZE, data->end);
+  int count[3] = {0, 0, 0};
+
+  for (int i = begin; i < end; i++) {
+    count[bvh_split_partition_of(data, data->a[i])]++;
+  }
+  copy_v3_v3_int(data->blocks_count[block], count);
+}
+
+static void bvh_split_scatter_task_cb(void *__restrict userdata,
+                                      const int block,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSplitData *data = userdata;
+  const int begin = data->begin + block * KDOPBVH_THREAD_SPLIT_BLOCK_SIZE;
+  const int end = min_ii(begin + KDOPBVH_THREAD_SPLIT_BLOCK_SIZE, data->end);
+  int offset[3];
+
+  copy_v3_v3_int(offset, data->blocks_count[block]);
+  for (int i = begin; i < end; i++) {
+    data->a_tmp[offset[bvh_split_partition_of(data, data->a[i])]++] = data->a[i];
+  }
+}
+
+static void bvh_split_copy_task_cb(void *__restrict userdata,
+                                   const int block,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSplitData *data = userdata;
+  const int begin = data->begin + block * KDOPBVH_THREAD_SPLIT_BLOCK_SIZE;
+  const int end = min_ii(begin + KDOPBVH_THREAD_SPLIT_BLOCK_SIZE, data->end);
+
+  memcpy(&data->a[begin],
+         &data->a_tmp[begin - data->begin],
+         sizeof(*data->a) * (size_t)(end - begin));
+}
+
+/**
+ * A version of #partition_nth_element which is threaded for large ranges of nodes.
+ *
+ * Each step does a three-way partition around the pivot (counting the nodes of each partition
+ * per block, then scattering them at their offset), continuing in the partition containing n.
+ */
+static void partition_nth_element_parallel(
+    BVHNode **a, int begin, int end, const int n, const int axis)
+{
+  if (end - begin <= KDOPBVH_THREAD_SPLIT_THRESHOLD) {
+    partition_nth_element(a, begin, end, n, axis);
+    return;
+  }
+
+  const int blocks_num_max = bvh_split_blocks_num(begin, end);
+  BVHSplitData data = {
+      .a = a,
+      .a_tmp = MEM_mallocN(sizeof(*a) * (size_t)(end - begin), __func__),
+      .axis = axis,
+      .blocks_count = MEM_mallocN(sizeof(*data.blocks_count) * (size_t)blocks_num_max, __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  while (end - begin > KDOPBVH_THREAD_SPLIT_THRESHOLD) {
+    const int blocks_num = bvh_split_blocks_num(begin, end);
+    data.begin = begin;
+    data.end = end;
+    data.pivot = bvh_medianof3(a, begin, (begin + end) / 2, end - 1, axis)->bv[axis];
+
+    BLI_task_parallel_range(0, blocks_num, &data, bvh_split_count_task_cb, &settings);
+
+    /* Convert the counts into offsets, partitions are stored one after the other. */
+    int total[3] = {0, 0, 0};
+    for (int block = 0; block < blocks_num; block++) {
+      for (int p = 0; p < 3; p++) {
+        total[p] += data.blocks_count[block][p];
+      }
+    }
+    int offset[3] = {0, total[BVH_SPLIT_LESS], total[BVH_SPLIT_LESS] + total[BVH_SPLIT_EQUAL]};
+    for (int block = 0; block < blocks_num; block++) {
+      for (int p = 0; p < 3; p++) {
+        const int count = data.blocks_count[block][p];
+        data.blocks_count[block][p] = offset[p];
+        offset[p] += count;
+      }
+    }
+
+    BLI_task_parallel_range(0, blocks_num, &data, bvh_split_scatter_task_cb, &settings);
+    BLI_task_parallel_range(0, blocks_num, &data, bvh_split_copy_task_cb, &settings);
+
+    /* The pivot itself is in the equal partition, so the range always shrinks. */
+    const int less_end = begin + total[BVH_SPLIT_LESS];
+    const int equal_end = less_end + total[BVH_SPLIT_EQUAL];
+    if (n < less_end) {
+      end = less_end;
+    }
+    else if (n < equal_end) {
+      /* All nodes of the equal partition may be the n-th element. */
+      begin = end;
+    }
+    else {
+      begin = equal_end;
+    }
+  }
+
+  MEM_freeN(data.a_tmp);
+  MEM_freeN(data.blocks_count);
+
+  if (begin < end) {
+    partition_nth_element(a, begin, end, n, axis);
+  }
+}
+
 /* Helper data and structures to build a min-leaf generalized implicit tree
  * This code can be easily reduced
  * (basically this is only method to calculate pow(k, n) in O(1).. and stuff like that) */
@@ -680,7 +903,7 @@ static void split_leafs(BVHNode **leafs_array,
       break;
     }
 
-    partition_nth_element(leafs_array, nth[i], nth[partitions], nth[i + 1], split_axis);
+    partition_nth_element_parallel(leafs_array, nth[i], nth[partitions], nth[i + 1], split_axis);
   }
 }
 
@@ -716,7 +939,7 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
 
   /* This calculates the bounding box of this branch
    * and chooses the largest axis as the axis to divide leafs */
-  refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  refit_kdop_hull_parallel(data->tree, parent, parent_leafs_begin, parent_leafs_end);
   split_axis = get_largest_axis(parent->bv);
 
   /* Save split axis (this can be used on raytracing to speedup the query time) */
@@ -1989,6 +2212,335 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_ray_cast_batch
+ *
+ * Casts many rays through the tree in a single call.
+ *
+ * Rays are grouped in packets of #BVH_RAY_PACKET_SIZE which traverse the tree together,
+ * each node being tested against all (still active) rays of the packet at once.
+ * The node test is a branch-less slab test over a structure-of-arrays,
+ * so the compiler can vectorize it. Packets are distributed over threads.
+ *
+ * Coherent rays (e.g. projecting along a fixed axis) benefit the most,
+ * incoherent packets degrade to roughly the cost of single ray casts.
+ *
+ * \{ */
+
+#define BVH_RAY_PACKET_SIZE 8
+/* Packets per thread, below this threading overhead isn't worth it. */
+#define BVH_BATCH_PACKETS_PER_THREAD 16
+#define BVH_BATCH_QUERIES_PER_THREAD (BVH_RAY_PACKET_SIZE * BVH_BATCH_PACKETS_PER_THREAD)
+
+typedef struct BVHRayPacket {
+  /* Structure of arrays, used for the vectorized node tests. */
+  float origin[3][BVH_RAY_PACKET_SIZE];
+  /* Zero for axis aligned rays, which are tested against the slab bounds instead. */
+  float idot_axis[3][BVH_RAY_PACKET_SIZE];
+  /* Mirrors `data[i].hit.dist`, negative for unused rays so they never hit. */
+  float hit_dist[BVH_RAY_PACKET_SIZE];
+  float radius;
+
+  BVHRayCastData data[BVH_RAY_PACKET_SIZE];
+} BVHRayPacket;
+
+typedef struct BVHRayPacketStackItem {
+  BVHNode *node;
+  uint mask;
+} BVHRayPacketStackItem;
+
+typedef struct BVHRayPacketStack {
+  BVHRayPacketStackItem *items;
+  int len, alloc_len;
+  bool is_alloc;
+} BVHRayPacketStack;
+
+typedef struct BVHRayCastBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  const float (*dir)[3];
+  int rays_num;
+  float radius;
+  BVHTreeRayHit *hits;
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayCastBatchData;
+
+/**
+ * Test a node against all rays of the packet.
+ *
+ * \param r_dist: The distance along each ray to the node bounds (only valid for hit rays).
+ * \return The bit-mask of rays in \a mask hitting the node before their current hit.
+ */
+static uint ray_packet_node_test(const BVHRayPacket *packet,
+                                 const float bv[6],
+                                 const uint mask,
+                                 float r_dist[BVH_RAY_PACKET_SIZE])
+{
+  const float bv_min[3] = {bv[0] - packet->radius, bv[2] - packet->radius, bv[4] - packet->radius};
+  const float bv_max[3] = {bv[1] + packet->radius, bv[3] + packet->radius, bv[5] + packet->radius};
+  uint hit_mask = 0;
+
+  for (int i = 0; i < BVH_RAY_PACKET_SIZE; i++) {
+    float t_near = 0.0f;
+    float t_far = packet->hit_dist[i];
+    bool is_inside = true;
+    for (int axis = 0; axis < 3; axis++) {
+      const float origin = packet->origin[axis][i];
+      const float idot_axis = packet->idot_axis[axis][i];
+      if (idot_axis == 0.0f) {
+        /* Axis aligned ray, same as #ray_nearest_hit. */
+        is_inside &= (origin >= bv_min[axis]) & (origin <= bv_max[axis]);
+        continue;
+      }
+      const float t1 = (bv_min[axis] - origin) * idot_axis;
+      const float t2 = (bv_max[axis] - origin) * idot_axis;
+      t_near = max_ff(t_near, min_ff(t1, t2));
+      t_far = min_ff(t_far, max_ff(t1, t2));
+    }
+    r_dist[i] = t_near;
+    hit_mask |= (uint)(is_inside & (t_near <= t_far) & (t_near < packet->hit_dist[i])) << i;
+  }
+  return hit_mask & mask;
+}
+
+static void ray_packet_stack_push(BVHRayPacketStack *stack, BVHNode *node, const uint mask)
+{
+  if (UNLIKELY(stack->len == stack->alloc_len)) {
+    stack->alloc_len *= 2;
+    if (stack->is_alloc) {
+      stack->items = MEM_reallocN(stack->items, sizeof(*stack->items) * (size_t)stack->alloc_len);
+    }
+    else {
+      BVHRayPacketStackItem *items = MEM_mallocN(sizeof(*items) * (size_t)stack->alloc_len,
+                                                 __func__);
+      memcpy(items, stack->items, sizeof(*items) * (size_t)stack->len);
+      stack->items = items;
+      stack->is_alloc = true;
+    }
+  }
+  stack->items[stack->len].node = node;
+  stack->items[stack->len].mask = mask;
+  stack->len++;
+}
+
+static void ray_packet_traverse(BVHRayPacket *packet,
+                                BVHRayPacketStack *stack,
+                                BVHNode *root,
+                                const uint mask)
+{
+  float dist[BVH_RAY_PACKET_SIZE];
+
+  ray_packet_stack_push(stack, root, mask);
+
+  while (stack->len != 0) {
+    const BVHRayPacketStackItem item = stack->items[--stack->len];
+    BVHNode *node = item.node;
+
+    /* Nodes are tested when popped, since hits found meanwhile may cull them. */
+    const uint node_mask = ray_packet_node_test(packet, node->bv, item.mask, dist);
+    if (node_mask == 0) {
+      continue;
+    }
+
+    if (node->totnode == 0) {
+      for (int i = 0; i < BVH_RAY_PACKET_SIZE; i++) {
+        if ((node_mask & (1u << i)) == 0) {
+          continue;
+        }
+        BVHRayCastData *data = &packet->data[i];
+        if (data->callback) {
+          data->callback(data->userdata, node->index, &data->ray, &data->hit);
+        }
+        else {
+          data->hit.index = node->index;
+          data->hit.dist = dist[i];
+          madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist[i]);
+        }
+        packet->hit_dist[i] = data->hit.dist;
+      }
+    }
+    else {
+      /* Pick the order to dive into the tree from the first active ray,
+       * pushing in reverse since the last pushed node is visited first. */
+      const BVHRayCastData *data = &packet->data[bitscan_forward_uint(node_mask)];
+      if (data->ray_dot_axis[node->main_axis] > 0.0f) {
+        for (int i = node->totnode - 1; i >= 0; i--) {
+          ray_packet_stack_push(stack, node->children[i], node_mask);
+        }
+      }
+      else {
+        for (int i = 0; i != node->totnode; i++) {
+          ray_packet_stack_push(stack, node->children[i], node_mask);
+        }
+      }
+    }
+  }
+}
+
+static void bvhtree_ray_cast_batch_task_cb(void *__restrict userdata,
+                                           const int packet_index,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRayCastBatchData *batch = userdata;
+  BVHNode *root = batch->tree->nodes[batch->tree->totleaf];
+  const int ray_start = packet_index * BVH_RAY_PACKET_SIZE;
+  const int rays_num = min_ii(batch->rays_num - ray_start, BVH_RAY_PACKET_SIZE);
+
+  BVHRayPacket packet;
+  packet.radius = batch->radius;
+
+  for (int i = 0; i < BVH_RAY_PACKET_SIZE; i++) {
+    if (i >= rays_num) {
+      packet.hit_dist[i] = -1.0f;
+      for (int axis = 0; axis < 3; axis++) {
+        packet.origin[axis][i] = 0.0f;
+        packet.idot_axis[axis][i] = 0.0f;
+      }
+      continue;
+    }
+
+    BVHRayCastData *data = &packet.data[i];
+    BLI_ASSERT_UNIT_V3(batch->dir[ray_start + i]);
+
+    data->tree = batch->tree;
+    data->callback = batch->callback;
+    data->userdata = batch->userdata;
+
+    copy_v3_v3(data->ray.origin, batch->co[ray_start + i]);
+    copy_v3_v3(data->ray.direction, batch->dir[ray_start + i]);
+    data->ray.radius = batch->radius;
+
+    bvhtree_ray_cast_data_precalc(data, batch->flag);
+    data->hit = batch->hits[ray_start + i];
+
+    packet.hit_dist[i] = data->hit.dist;
+    for (int axis = 0; axis < 3; axis++) {
+      packet.origin[axis][i] = data->ray.origin[axis];
+      packet.idot_axis[axis][i] = (data->ray_dot_axis[axis] == 0.0f) ? 0.0f :
+                                                                        data->idot_axis[axis];
+    }
+  }
+
+  BVHRayPacketStackItem stack_items[256];
+  BVHRayPacketStack stack = {stack_items, 0, ARRAY_SIZE(stack_items), false};
+
+  ray_packet_traverse(&packet, &stack, root, (1u << rays_num) - 1);
+
+  if (stack.is_alloc) {
+    MEM_freeN(stack.items);
+  }
+
+  for (int i = 0; i < rays_num; i++) {
+    batch->hits[ray_start + i] = packet.data[i].hit;
+  }
+}
+
+/**
+ * Cast \a rays_num rays, the batched equivalent of #BLI_bvhtree_ray_cast_ex.
+ *
+ * \param hits: Array of \a rays_num hits, which must be initialized by the caller
+ * (`index` to -1 and `dist` to the maximum distance, #BVH_RAYCAST_DIST_MAX when unlimited).
+ * \note The \a callback may be called from multiple threads at once.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int rays_num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag)
+{
+  if (rays_num == 0 || tree->nodes[tree->totleaf] == NULL) {
+    return;
+  }
+
+  BVHRayCastBatchData batch = {
+      .tree = tree,
+      .co = co,
+      .dir = dir,
+      .rays_num = rays_num,
+      .radius = radius,
+      .hits = hits,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+
+  const int packets_num = (rays_num + BVH_RAY_PACKET_SIZE - 1) / BVH_RAY_PACKET_SIZE;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (rays_num > BVH_BATCH_QUERIES_PER_THREAD);
+  settings.min_iter_per_thread = BVH_BATCH_PACKETS_PER_THREAD;
+  BLI_task_parallel_range(0, packets_num, &batch, bvhtree_ray_cast_batch_task_cb, &settings);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_find_nearest_batch
+ * \{ */
+
+typedef struct BVHNearestBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  BVHTreeNearest *nearest;
+  BVHTree_NearestPointCallback callback;
+  void *userdata;
+  int flag;
+} BVHNearestBatchData;
+
+static void bvhtree_find_nearest_batch_task_cb(void *__restrict userdata,
+                                               const int index,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHNearestBatchData *batch = userdata;
+  BLI_bvhtree_find_nearest_ex(batch->tree,
+                              batch->co[index],
+                              &batch->nearest[index],
+                              batch->callback,
+                              batch->userdata,
+                              batch->flag);
+}
+
+/**
+ * Find the nearest node for \a co_num coordinates,
+ * the batched equivalent of #BLI_bvhtree_find_nearest_ex.
+ *
+ * \param nearest: Array of \a co_num results, which must be initialized by the caller
+ * (`index` to -1 and `dist_sq` to the squared search radius, `FLT_MAX` when unlimited).
+ * \note The \a callback may be called from multiple threads at once.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int co_num,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag)
+{
+  BVHNearestBatchData batch = {
+      .tree = tree,
+      .co = co,
+      .nearest = nearest,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (co_num > BVH_BATCH_QUERIES_PER_THREAD);
+  settings.min_iter_per_thread = BVH_BATCH_QUERIES_PER_THREAD;
+  BLI_task_parallel_range(0, co_num, &batch, bvhtree_find_nearest_batch_task_cb, &settings);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
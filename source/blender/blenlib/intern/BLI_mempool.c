@@ -27,11 +27,17 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating from multiple threads, using per-thread caches of free elements
+ *   (optionally when using the #BLI_MEMPOOL_CONCURRENT flag).
  */
 
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#endif
+
 #include "atomic_ops.h"
 
 #include "BLI_utildefines.h"
@@ -135,6 +141,27 @@ struct BLI_mempool {
   /** Number of elements allocated in total. */
   uint totalloc;
 #endif
+
+  /**
+   * Protects \a chunks and \a free, only used with #BLI_MEMPOOL_CONCURRENT.
+   * A plain atomic spin-lock, since `makesdna` builds this file without the threading API.
+   */
+  uint32_t lock;
+  /** Number of thread caches in use, while non-zero only they may allocate & free elements. */
+  uint threads_len;
+};
+
+/**
+ * A per-thread cache of free elements, so threads only need to lock the pool
+ * once every #BLI_mempool.pchunk allocations or frees.
+ */
+struct BLI_mempool_thread {
+  BLI_mempool *pool;
+  /** Free elements owned by this thread. */
+  BLI_freenode *free;
+  uint free_len;
+  /** Elements allocated minus elements freed, applied to #BLI_mempool.totused when done. */
+  int totused_delta;
 };
 
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
@@ -185,23 +212,10 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
 }
 
 /**
- * Initialize a chunk and add into \a pool->chunks
- *
- * \param pool: The pool to add the chunk into.
- * \param mpchunk: The new uninitialized chunk (can be malloc'd)
- * \param last_tail: The last element of the previous chunk
- * (used when building free chunks initially)
- * \return The last chunk,
+ * Append a chunk to \a pool->chunks (without initializing its elements).
  */
-static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
-                                       BLI_mempool_chunk *mpchunk,
-                                       BLI_freenode *last_tail)
+static void mempool_chunk_append(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
 {
-  const uint esize = pool->esize;
-  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
-  uint j;
-
-  /* append */
   if (pool->chunk_tail) {
     pool->chunk_tail->next = mpchunk;
   }
@@ -212,10 +226,18 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
 
   mpchunk->next = NULL;
   pool->chunk_tail = mpchunk;
+}
 
-  if (UNLIKELY(pool->free == NULL)) {
-    pool->free = curnode;
-  }
+/**
+ * Link all elements of a chunk into a free list, starting at the chunks data.
+ *
+ * \return The last element of the list (its next pointer is NULL).
+ */
+static BLI_freenode *mempool_chunk_nodes_init(const BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  const uint esize = pool->esize;
+  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+  uint j;
 
   /* loop through the allocated data, building the pointer structures */
   j = pool->pchunk;
@@ -238,6 +260,33 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
   curnode = NODE_STEP_PREV(curnode);
   curnode->next = NULL;
 
+  return curnode;
+}
+
+/**
+ * Initialize a chunk and add into \a pool->chunks
+ *
+ * \param pool: The pool to add the chunk into.
+ * \param mpchunk: The new uninitialized chunk (can be malloc'd)
+ * \param last_tail: The last element of the previous chunk
+ * (used when building free chunks initially)
+ * \return The last chunk,
+ */
+static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
+                                       BLI_mempool_chunk *mpchunk,
+                                       BLI_freenode *last_tail)
+{
+  BLI_freenode *curnode;
+
+  /* append */
+  mempool_chunk_append(pool, mpchunk);
+
+  if (UNLIKELY(pool->free == NULL)) {
+    pool->free = CHUNK_DATA(mpchunk);
+  }
+
+  curnode = mempool_chunk_nodes_init(pool, mpchunk);
+
 #ifdef USE_TOTALLOC
   pool->totalloc += pool->pchunk;
 #endif
@@ -315,6 +364,8 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag
   pool->totalloc = 0;
 #endif
   pool->totused = 0;
+  pool->threads_len = 0;
+  pool->lock = 0;
 
   if (totelem) {
     /* Allocate the actual chunks. */
@@ -335,6 +386,8 @@ void *BLI_mempool_alloc(BLI_mempool *pool)
 {
   BLI_freenode *free_pop;
 
+  BLI_assert(pool->threads_len == 0);
+
   if (UNLIKELY(pool->free == NULL)) {
     /* Need to allocate a new chunk. */
     BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
@@ -375,6 +428,8 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 {
   BLI_freenode *newhead = addr;
 
+  BLI_assert(pool->threads_len == 0);
+
 #ifndef NDEBUG
   {
     BLI_mempool_chunk *chunk;
@@ -685,6 +740,218 @@ void *BLI_mempool_iterstep(BLI_mempool_iter *iter)
 
 #endif
 
+/* Concurrent allocation:
+ *
+ * Each thread allocates from (and frees into) its own list of free elements,
+ * only locking the pool to take a batch of free elements (or add a new chunk) when it runs out,
+ * and to give a batch back when it holds too many (so freed elements can be reused by others).
+ *
+ * Typical usage from #BLI_task_parallel_range is to begin a thread cache lazily,
+ * storing it in the TLS `userdata_chunk`, ending it from #TaskParallelSettings.func_free. */
+
+/**
+ * Detach up to \a len elements from the start of the list \a *r_head.
+ *
+ * \return The detached list.
+ */
+static BLI_freenode *mempool_freelist_split(BLI_freenode **r_head, const uint len, uint *r_len)
+{
+  BLI_freenode *head = *r_head;
+  BLI_freenode *tail = head;
+  uint i = 1;
+
+  if (head == NULL) {
+    *r_len = 0;
+    return NULL;
+  }
+
+  while ((i < len) && tail->next) {
+    tail = tail->next;
+    i++;
+  }
+  *r_head = tail->next;
+  tail->next = NULL;
+  *r_len = i;
+  return head;
+}
+
+BLI_INLINE void mempool_lock(BLI_mempool *pool)
+{
+  while (atomic_cas_uint32(&pool->lock, 0, 1) != 0) {
+    /* Wait with loads until the lock looks free, so waiting threads don't keep
+     * taking the cache line from the thread holding the lock. */
+    while (atomic_load_uint32(&pool->lock) != 0) {
+#if defined(__SSE2__) || defined(_M_X64)
+      _mm_pause();
+#endif
+    }
+  }
+}
+
+BLI_INLINE void mempool_unlock(BLI_mempool *pool)
+{
+  atomic_store_uint32(&pool->lock, 0);
+}
+
+/**
+ * Take a batch of free elements from the pool, or allocate a new chunk when there are none.
+ */
+static void mempool_thread_refill(BLI_mempool_thread *cache)
+{
+  BLI_mempool *pool = cache->pool;
+
+  mempool_lock(pool);
+  cache->free = mempool_freelist_split(&pool->free, pool->pchunk, &cache->free_len);
+  mempool_unlock(pool);
+
+  if (cache->free == NULL) {
+    /* Initialize the chunk outside the lock, no other thread can access its elements yet. */
+    BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+    mempool_chunk_nodes_init(pool, mpchunk);
+
+    mempool_lock(pool);
+    mempool_chunk_append(pool, mpchunk);
+#ifdef USE_TOTALLOC
+    pool->totalloc += pool->pchunk;
+#endif
+    mempool_unlock(pool);
+
+    cache->free = CHUNK_DATA(mpchunk);
+    cache->free_len = pool->pchunk;
+  }
+}
+
+/**
+ * Give the free elements of \a list back to the pool.
+ */
+static void mempool_thread_reclaim(BLI_mempool *pool, BLI_freenode *list)
+{
+  BLI_freenode *tail = list;
+  while (tail->next) {
+    tail = tail->next;
+  }
+
+  mempool_lock(pool);
+  tail->next = pool->free;
+  pool->free = list;
+  mempool_unlock(pool);
+}
+
+/**
+ * Begin allocating from the calling thread, the pool must use #BLI_MEMPOOL_CONCURRENT.
+ *
+ * \return A cache which must only be used by the calling thread,
+ * ended with #BLI_mempool_thread_end.
+ */
+BLI_mempool_thread *BLI_mempool_thread_begin(BLI_mempool *pool)
+{
+  BLI_assert(pool->flag & BLI_MEMPOOL_CONCURRENT);
+
+  BLI_mempool_thread *cache = MEM_mallocN(sizeof(*cache), __func__);
+  cache->pool = pool;
+  cache->free = NULL;
+  cache->free_len = 0;
+  cache->totused_delta = 0;
+
+  atomic_add_and_fetch_u(&pool->threads_len, 1);
+
+  return cache;
+}
+
+/**
+ * End allocating from a thread, giving its free elements back to the pool.
+ */
+void BLI_mempool_thread_end(BLI_mempool_thread *cache)
+{
+  BLI_mempool *pool = cache->pool;
+
+  if (cache->free) {
+    mempool_thread_reclaim(pool, cache->free);
+  }
+
+  mempool_lock(pool);
+  pool->totused = (uint)((int)pool->totused + cache->totused_delta);
+  mempool_unlock(pool);
+
+  atomic_sub_and_fetch_u(&pool->threads_len, 1);
+
+  MEM_freeN(cache);
+}
+
+void *BLI_mempool_thread_alloc(BLI_mempool_thread *cache)
+{
+  BLI_freenode *free_pop;
+
+  if (UNLIKELY(cache->free == NULL)) {
+    mempool_thread_refill(cache);
+  }
+
+  free_pop = cache->free;
+
+  if (cache->pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    free_pop->freeword = USEDWORD;
+  }
+
+  cache->free = free_pop->next;
+  cache->free_len--;
+  cache->totused_delta++;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_ALLOC(cache->pool, free_pop, cache->pool->esize);
+#endif
+
+  return (void *)free_pop;
+}
+
+void *BLI_mempool_thread_calloc(BLI_mempool_thread *cache)
+{
+  void *retval = BLI_mempool_thread_alloc(cache);
+  memset(retval, 0, (size_t)cache->pool->esize);
+  return retval;
+}
+
+/**
+ * Free an element from any thread, it doesn't need to be allocated by the same thread.
+ *
+ * \note Unlike #BLI_mempool_free, chunks are never freed (until the pool is cleared).
+ */
+void BLI_mempool_thread_free(BLI_mempool_thread *cache, void *addr)
+{
+  BLI_mempool *pool = cache->pool;
+  BLI_freenode *newhead = addr;
+
+#ifndef NDEBUG
+  if (UNLIKELY(mempool_debug_memset)) {
+    memset(addr, 255, pool->esize);
+  }
+#endif
+
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+    /* This will detect double free's. */
+    BLI_assert(newhead->freeword != FREEWORD);
+#endif
+    newhead->freeword = FREEWORD;
+  }
+
+  newhead->next = cache->free;
+  cache->free = newhead;
+  cache->free_len++;
+  cache->totused_delta--;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+
+  /* Don't hoard free elements, give a batch back so other threads can use them. */
+  if (UNLIKELY(cache->free_len > pool->pchunk * 2)) {
+    uint reclaim_len;
+    BLI_freenode *reclaim = mempool_freelist_split(&cache->free, pool->pchunk, &reclaim_len);
+    cache->free_len -= reclaim_len;
+    mempool_thread_reclaim(pool, reclaim);
+  }
+}
+
 /**
  * Empty the pool, as if it were just created.
  *
@@ -700,6 +967,8 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
   BLI_mempool_chunk *chunks_temp;
   BLI_freenode *last_tail = NULL;
 
+  BLI_assert(pool->threads_len == 0);
+
 #ifdef WITH_MEM_VALGRIND
   VALGRIND_DESTROY_MEMPOOL(pool);
   VALGRIND_CREATE_MEMPOOL(pool, 0, false);
@@ -756,6 +1025,8 @@ void BLI_mempool_clear(BLI_mempool *pool)
  */
 void BLI_mempool_destroy(BLI_mempool *pool)
 {
+  BLI_assert(pool->threads_len == 0);
+
   mempool_chunk_free_all(pool->chunks);
 
 #ifdef WITH_MEM_VALGRIND
@@ -30,7 +30,9 @@
 #include "BLI_array_utils.h"
 
 #include "BLI_alloca.h"
+#include "BLI_math_base.h"
 #include "BLI_sys_types.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLI_strict_flags.h"
@@ -318,3 +320,78 @@ bool _bli_array_is_zeroed(const void *arr_v, unsigned int arr_len, size_t arr_st
   }
   return true;
 }
+
+/* Arrays smaller than this are scanned on a single thread. */
+#define SCAN_CHUNK_LEN 16384
+
+typedef struct ScanData {
+  int *arr;
+  int arr_len;
+  /* Sum of each chunk, then the sum of all chunks before it. */
+  int *chunk_sums;
+} ScanData;
+
+static void array_scan_sum_fn(void *__restrict userdata,
+                              const int chunk,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ScanData *data = userdata;
+  const int start = chunk * SCAN_CHUNK_LEN;
+  const int end = min_ii(start + SCAN_CHUNK_LEN, data->arr_len);
+  int sum = 0;
+  for (int i = start; i < end; i++) {
+    sum += data->arr[i];
+  }
+  data->chunk_sums[chunk] = sum;
+}
+
+static void array_scan_write_fn(void *__restrict userdata,
+                                const int chunk,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ScanData *data = userdata;
+  const int start = chunk * SCAN_CHUNK_LEN;
+  const int end = min_ii(start + SCAN_CHUNK_LEN, data->arr_len);
+  int sum = data->chunk_sums[chunk];
+  for (int i = start; i < end; i++) {
+    const int value = data->arr[i];
+    data->arr[i] = sum;
+    sum += value;
+  }
+}
+
+/**
+ * In-place exclusive prefix sum, each item is replaced by the sum of all items before it.
+ * Typically used to turn counts into offsets. Large arrays are scanned using multiple threads.
+ *
+ * \return The sum of all items.
+ */
+int BLI_array_scan_exclusive_int(int *arr, const int arr_len)
+{
+  const int chunks_num = (arr_len + SCAN_CHUNK_LEN - 1) / SCAN_CHUNK_LEN;
+  if (chunks_num <= 1) {
+    int sum = 0;
+    for (int i = 0; i < arr_len; i++) {
+      const int value = arr[i];
+      arr[i] = sum;
+      sum += value;
+    }
+    return sum;
+  }
+
+  ScanData data;
+  data.arr = arr;
+  data.arr_len = arr_len;
+  data.chunk_sums = MEM_mallocN(sizeof(*data.chunk_sums) * (size_t)chunks_num, __func__);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(0, chunks_num, &data, array_scan_sum_fn, &settings);
+  const int sum = BLI_array_scan_exclusive_int(data.chunk_sums, chunks_num);
+  BLI_task_parallel_range(0, chunks_num, &data, array_scan_write_fn, &settings);
+
+  MEM_freeN(data.chunk_sums);
+  return sum;
+}
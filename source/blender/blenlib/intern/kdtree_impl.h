@@ -23,6 +23,7 @@
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
 #include "BLI_strict_flags.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #define _CONCAT_AUX(MACRO_ARG1, MACRO_ARG2) MACRO_ARG1##MACRO_ARG2
@@ -56,6 +57,11 @@ struct KDTree {
 #define KD_NEAR_ALLOC_INC 100 /* alloc increment for collecting nearest */
 #define KD_FOUND_ALLOC_INC 50 /* alloc increment for collecting nearest */
 
+#define KD_BALANCE_TASK_MIN_NODES 16384  /* smaller sub-trees are balanced in a single task */
+#define KD_BATCH_QUERIES_PER_THREAD 1024 /* minimum number of batched queries per thread */
+#define KD_DUPLICATES_BLOCK_SIZE 16384u  /* duplicate searches collected in parallel at once */
+#define KD_DUPLICATES_CANDIDATES_MAX 16  /* candidates stored per search, more are redone */
+
 #define KD_NODE_UNSET ((uint)-1)
 
 /**
@@ -145,19 +151,14 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+/**
+ * Quick-select the median along \a axis, nodes before it are smaller or equal.
+ */
+static uint kdtree_balance_partition(KDTreeNode *nodes, uint nodes_len, uint axis)
 {
-  KDTreeNode *node;
   float co;
   uint left, right, median, i, j;
 
-  if (nodes_len <= 0) {
-    return KD_NODE_UNSET;
-  }
-  else if (nodes_len == 1) {
-    return 0 + ofs;
-  }
-
   /* quicksort style sorting around median */
   left = 0;
   right = nodes_len - 1;
@@ -190,6 +191,23 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
     }
   }
 
+  return median;
+}
+
+static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  KDTreeNode *node;
+  uint median;
+
+  if (nodes_len <= 0) {
+    return KD_NODE_UNSET;
+  }
+  else if (nodes_len == 1) {
+    return 0 + ofs;
+  }
+
+  median = kdtree_balance_partition(nodes, nodes_len, axis);
+
   /* set node and sort subnodes */
   node = &nodes[median];
   node->d = axis;
@@ -201,6 +219,55 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   return median + ofs;
 }
 
+/**
+ * Balancing the two sides of a node is independent,
+ * so large sub-trees are balanced in tasks, with the same result as #kdtree_balance.
+ */
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+  /* The left or right member of the parent node. */
+  uint *r_node;
+} KDTreeBalanceTask;
+
+static uint kdtree_balance_parallel(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs);
+
+static void kdtree_balance_task_run(TaskPool *__restrict pool, void *taskdata)
+{
+  KDTreeBalanceTask *task = taskdata;
+  *task->r_node = kdtree_balance_parallel(
+      pool, task->nodes, task->nodes_len, task->axis, task->ofs);
+}
+
+static uint kdtree_balance_parallel(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  if (nodes_len < KD_BALANCE_TASK_MIN_NODES) {
+    return kdtree_balance(nodes, nodes_len, axis, ofs);
+  }
+
+  const uint median = kdtree_balance_partition(nodes, nodes_len, axis);
+  KDTreeNode *node = &nodes[median];
+  node->d = axis;
+  axis = (axis + 1) % KD_DIMS;
+
+  KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+  task->nodes = nodes;
+  task->nodes_len = median;
+  task->axis = axis;
+  task->ofs = ofs;
+  task->r_node = &node->left;
+  BLI_task_pool_push(pool, kdtree_balance_task_run, task, true, NULL);
+
+  node->right = kdtree_balance_parallel(
+      pool, nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
+
+  return median + ofs;
+}
+
 void BLI_kdtree_nd_(balance)(KDTree *tree)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
@@ -210,7 +277,15 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  if (tree->nodes_len >= KD_BALANCE_TASK_MIN_NODES * 2) {
+    TaskPool *pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+    tree->root = kdtree_balance_parallel(pool, tree->nodes, tree->nodes_len, 0, 0);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
+  else {
+    tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -806,6 +881,137 @@ finally:
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Query many coordinates at once, using multiple threads.
+ * \{ */
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  KDTreeNearest *nearest;
+  KDTreeNearest **nearest_arrays;
+  int *nearest_len;
+  uint nearest_len_capacity;
+  float range;
+} KDTreeBatchData;
+
+static void kdtree_batch_settings(TaskParallelSettings *settings, const int co_len)
+{
+  BLI_parallel_range_settings_defaults(settings);
+  settings->use_threading = (co_len > KD_BATCH_QUERIES_PER_THREAD);
+  settings->min_iter_per_thread = KD_BATCH_QUERIES_PER_THREAD;
+}
+
+static void kdtree_find_nearest_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  KDTreeNearest *nearest = &data->nearest[i];
+  if (BLI_kdtree_nd_(find_nearest)(data->tree, data->co[i], nearest) == -1) {
+    nearest->index = -1;
+    nearest->dist = FLT_MAX;
+  }
+}
+
+/**
+ * The batched equivalent of #BLI_kdtree_3d_find_nearest.
+ *
+ * \param r_nearest: Array of \a co_len results, the index is -1 when the tree is empty.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const int co_len,
+                                        KDTreeNearest *r_nearest)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .nearest = r_nearest,
+  };
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_find_nearest_batch_cb, &settings);
+}
+
+static void kdtree_find_nearest_n_batch_cb(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  data->nearest_len[i] = BLI_kdtree_nd_(find_nearest_n)(
+      data->tree,
+      data->co[i],
+      &data->nearest[(size_t)i * data->nearest_len_capacity],
+      data->nearest_len_capacity);
+}
+
+/**
+ * The batched equivalent of #BLI_kdtree_3d_find_nearest_n.
+ *
+ * \param r_nearest: Array of \a co_len * \a nearest_len_capacity results,
+ * sorted by distance for each coordinate.
+ * \param r_nearest_len: Array of \a co_len, the number of results for each coordinate.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co)[KD_DIMS],
+                                          const int co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .nearest = r_nearest,
+      .nearest_len = r_nearest_len,
+      .nearest_len_capacity = nearest_len_capacity,
+  };
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_find_nearest_n_batch_cb, &settings);
+}
+
+static void kdtree_range_search_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  data->nearest_arrays[i] = NULL;
+  data->nearest_len[i] = BLI_kdtree_nd_(range_search)(
+      data->tree, data->co[i], &data->nearest_arrays[i], data->range);
+}
+
+/**
+ * The batched equivalent of #BLI_kdtree_3d_range_search.
+ *
+ * \param r_nearest: Array of \a co_len result arrays, sorted by distance,
+ * NULL when nothing is found, otherwise to be freed by the caller.
+ * \param r_nearest_len: Array of \a co_len, the number of results for each coordinate.
+ */
+void BLI_kdtree_nd_(range_search_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const int co_len,
+                                        const float range,
+                                        KDTreeNearest **r_nearest,
+                                        int *r_nearest_len)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .nearest_arrays = r_nearest,
+      .nearest_len = r_nearest_len,
+      .range = range,
+  };
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_range_search_batch_cb, &settings);
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
@@ -866,6 +1072,196 @@ static void deduplicate_recursive(const struct DeDuplicateParams *p, uint i)
   }
 }
 
+/**
+ * The index & node of the search at position \a i of the iteration order.
+ */
+BLI_INLINE int deduplicate_search_index(const KDTree *tree,
+                                        const uint *order,
+                                        const uint i,
+                                        uint *r_node_index)
+{
+  if (order) {
+    *r_node_index = order[i];
+    return (int)i;
+  }
+  *r_node_index = i;
+  return tree->nodes[i].index;
+}
+
+static void deduplicate_search(struct DeDuplicateParams *p,
+                               const uint root,
+                               const int index,
+                               const float search_co[KD_DIMS])
+{
+  p->search = index;
+  copy_vn_vn(p->search_co, search_co);
+  int found_prev = *p->duplicates_found;
+  deduplicate_recursive(p, root);
+  if (*p->duplicates_found != found_prev) {
+    /* Prevent chains of doubles. */
+    p->duplicates[index] = index;
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Parallel Duplicate Search
+ *
+ * Searches are done in blocks of #KD_DUPLICATES_BLOCK_SIZE,
+ * first the candidates of all searches in a block are collected in parallel,
+ * then they are applied in iteration order, giving the same result as the serial search.
+ *
+ * This works because a duplicate is only ever set once:
+ * candidates already set before the block can be skipped while collecting,
+ * candidates set by an earlier search in the same block are skipped while applying.
+ * \{ */
+
+typedef struct DeDuplicateBlock {
+  const KDTree *tree;
+  const uint *order;
+  const int *duplicates;
+  float range;
+  float range_sq;
+  uint block_start;
+
+  /* Per search in the block. */
+  int *candidates;
+  uint *candidates_len;
+} DeDuplicateBlock;
+
+typedef struct DeDuplicateCollect {
+  const KDTreeNode *nodes;
+  const int *duplicates;
+  float range;
+  float range_sq;
+  float search_co[KD_DIMS];
+  int search;
+  int *candidates;
+  uint candidates_len;
+} DeDuplicateCollect;
+
+static void deduplicate_collect_recursive(DeDuplicateCollect *c, uint i)
+{
+  const KDTreeNode *node = &c->nodes[i];
+  if (c->search_co[node->d] + c->range <= node->co[node->d]) {
+    if (node->left != KD_NODE_UNSET) {
+      deduplicate_collect_recursive(c, node->left);
+    }
+  }
+  else if (c->search_co[node->d] - c->range >= node->co[node->d]) {
+    if (node->right != KD_NODE_UNSET) {
+      deduplicate_collect_recursive(c, node->right);
+    }
+  }
+  else {
+    if ((c->search != node->index) && (c->duplicates[node->index] == -1)) {
+      if (len_squared_vnvn(node->co, c->search_co) <= c->range_sq) {
+        /* Searches with more candidates than fit are re-done when applying. */
+        if (c->candidates_len < KD_DUPLICATES_CANDIDATES_MAX) {
+          c->candidates[c->candidates_len] = node->index;
+        }
+        c->candidates_len++;
+      }
+    }
+    if (node->left != KD_NODE_UNSET) {
+      deduplicate_collect_recursive(c, node->left);
+    }
+    if (node->right != KD_NODE_UNSET) {
+      deduplicate_collect_recursive(c, node->right);
+    }
+  }
+}
+
+static void deduplicate_collect_cb(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const DeDuplicateBlock *block = userdata;
+  const KDTree *tree = block->tree;
+  uint node_index;
+  const int index = deduplicate_search_index(
+      tree, block->order, block->block_start + (uint)i, &node_index);
+
+  if (!ELEM(block->duplicates[index], -1, index)) {
+    block->candidates_len[i] = 0;
+    return;
+  }
+
+  DeDuplicateCollect c = {
+      .nodes = tree->nodes,
+      .duplicates = block->duplicates,
+      .range = block->range,
+      .range_sq = block->range_sq,
+      .search = index,
+      .candidates = &block->candidates[(size_t)i * KD_DUPLICATES_CANDIDATES_MAX],
+      .candidates_len = 0,
+  };
+  copy_vn_vn(c.search_co, tree->nodes[node_index].co);
+  deduplicate_collect_recursive(&c, tree->root);
+  block->candidates_len[i] = c.candidates_len;
+}
+
+static void deduplicate_parallel(const KDTree *tree,
+                                 struct DeDuplicateParams *p,
+                                 const uint *order)
+{
+  int *duplicates = p->duplicates;
+  DeDuplicateBlock block = {
+      .tree = tree,
+      .order = order,
+      .duplicates = duplicates,
+      .range = p->range,
+      .range_sq = p->range_sq,
+      .candidates = MEM_mallocN(
+          sizeof(int) * KD_DUPLICATES_BLOCK_SIZE * KD_DUPLICATES_CANDIDATES_MAX, __func__),
+      .candidates_len = MEM_mallocN(sizeof(uint) * KD_DUPLICATES_BLOCK_SIZE, __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = KD_BATCH_QUERIES_PER_THREAD;
+
+  for (uint block_start = 0; block_start < tree->nodes_len;
+       block_start += KD_DUPLICATES_BLOCK_SIZE) {
+    const uint block_len = MIN2(tree->nodes_len - block_start, KD_DUPLICATES_BLOCK_SIZE);
+    block.block_start = block_start;
+    BLI_task_parallel_range(0, (int)block_len, &block, deduplicate_collect_cb, &settings);
+
+    for (uint i = 0; i < block_len; i++) {
+      const uint candidates_len = block.candidates_len[i];
+      if (candidates_len == 0) {
+        continue;
+      }
+      uint node_index;
+      const int index = deduplicate_search_index(tree, order, block_start + i, &node_index);
+      if (!ELEM(duplicates[index], -1, index)) {
+        /* Merged by an earlier search in this block. */
+        continue;
+      }
+      if (candidates_len > KD_DUPLICATES_CANDIDATES_MAX) {
+        deduplicate_search(p, tree->root, index, tree->nodes[node_index].co);
+        continue;
+      }
+      const int *candidates = &block.candidates[(size_t)i * KD_DUPLICATES_CANDIDATES_MAX];
+      int found_prev = *p->duplicates_found;
+      for (uint j = 0; j < candidates_len; j++) {
+        if (duplicates[candidates[j]] == -1) {
+          duplicates[candidates[j]] = index;
+          *p->duplicates_found += 1;
+        }
+      }
+      if (*p->duplicates_found != found_prev) {
+        /* Prevent chains of doubles. */
+        duplicates[index] = index;
+      }
+    }
+  }
+
+  MEM_freeN(block.candidates);
+  MEM_freeN(block.candidates_len);
+}
+
+/** \} */
+
 /**
  * Find duplicate points in \a range.
  * Favors speed over quality since it doesn't find the best target vertex for merging.
@@ -898,40 +1294,24 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
       .duplicates_found = &found,
   };
 
-  if (use_index_order) {
-    uint *order = kdtree_order(tree);
-    for (uint i = 0; i < tree->nodes_len; i++) {
-      const uint node_index = order[i];
-      const int index = (int)i;
-      if (ELEM(duplicates[index], -1, index)) {
-        p.search = index;
-        copy_vn_vn(p.search_co, tree->nodes[node_index].co);
-        int found_prev = found;
-        deduplicate_recursive(&p, tree->root);
-        if (found != found_prev) {
-          /* Prevent chains of doubles. */
-          duplicates[index] = index;
-        }
-      }
-    }
-    MEM_freeN(order);
+  uint *order = use_index_order ? kdtree_order(tree) : NULL;
+
+  if (tree->nodes_len > KD_DUPLICATES_BLOCK_SIZE) {
+    deduplicate_parallel(tree, &p, order);
   }
   else {
     for (uint i = 0; i < tree->nodes_len; i++) {
-      const uint node_index = i;
-      const int index = p.nodes[node_index].index;
+      uint node_index;
+      const int index = deduplicate_search_index(tree, order, i, &node_index);
       if (ELEM(duplicates[index], -1, index)) {
-        p.search = index;
-        copy_vn_vn(p.search_co, tree->nodes[node_index].co);
-        int found_prev = found;
-        deduplicate_recursive(&p, tree->root);
-        if (found != found_prev) {
-          /* Prevent chains of doubles. */
-          duplicates[index] = index;
-        }
+        deduplicate_search(&p, tree->root, index, tree->nodes[node_index].co);
       }
     }
   }
+
+  if (order) {
+    MEM_freeN(order);
+  }
   return found;
 }
 
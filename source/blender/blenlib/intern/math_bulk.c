@@ -0,0 +1,477 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Each function has a scalar, an SSE2 and an AVX2 version. SSE2 is always available when
+ * Blender is built with it, AVX2 functions are compiled for that target individually
+ * (so no global compiler flags are needed) and only used when the CPU supports them.
+ */
+
+#include "BLI_math.h"
+#include "BLI_math_bulk.h"
+#include "BLI_system.h"
+#include "BLI_utildefines.h"
+
+#include "BLI_strict_flags.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(_M_X64)) && \
+    (defined(__GNUC__) || defined(_MSC_VER))
+#  define MATH_BULK_USE_AVX2
+#  include <immintrin.h>
+#  if defined(__GNUC__)
+#    define ATTR_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#  else
+#    define ATTR_TARGET_AVX2
+#  endif
+#endif
+
+/* -------------------------------------------------------------------- */
+/** \name Instruction Set
+ * \{ */
+
+/* Detected on first use, -1 when not yet known. */
+static int math_bulk_isa = -1;
+
+static eMathBulkISA math_bulk_isa_supported(void)
+{
+#ifdef MATH_BULK_USE_AVX2
+  if (BLI_cpu_support_avx2()) {
+    return MATH_BULK_ISA_AVX2;
+  }
+#endif
+#ifdef __SSE2__
+  return MATH_BULK_ISA_SSE2;
+#else
+  return MATH_BULK_ISA_SCALAR;
+#endif
+}
+
+eMathBulkISA BLI_math_bulk_isa_get(void)
+{
+  /* Threads running into this at the same time all store the same value. */
+  if (math_bulk_isa == -1) {
+    math_bulk_isa = (int)math_bulk_isa_supported();
+  }
+  return (eMathBulkISA)math_bulk_isa;
+}
+
+void BLI_math_bulk_isa_set(const eMathBulkISA isa)
+{
+  math_bulk_isa = (int)MIN2(isa, math_bulk_isa_supported());
+}
+
+const char *BLI_math_bulk_isa_name(const eMathBulkISA isa)
+{
+  switch (isa) {
+    case MATH_BULK_ISA_SCALAR:
+      return "Scalar";
+    case MATH_BULK_ISA_SSE2:
+      return "SSE2";
+    case MATH_BULK_ISA_AVX2:
+      return "AVX2";
+  }
+  return "Unknown";
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Scalar
+ * \{ */
+
+static void mul_v3_m4v3_array_scalar(float (*r)[3],
+                                     const float M[4][4],
+                                     const float (*v)[3],
+                                     const int len)
+{
+  for (int i = 0; i < len; i++) {
+    mul_v3_m4v3(r[i], M, v[i]);
+  }
+}
+
+static void normalize_v3_array_scalar(float (*vecs)[3], const int len)
+{
+  for (int i = 0; i < len; i++) {
+    normalize_v3(vecs[i]);
+  }
+}
+
+/* Arrays of vectors are handled as flat arrays of floats. */
+static void interp_fl_array_scalar(
+    float *r, const float *a, const float *b, const float t, const int len)
+{
+  const float s = 1.0f - t;
+  for (int i = 0; i < len; i++) {
+    r[i] = s * a[i] + t * b[i];
+  }
+}
+
+static void minmax_v3v3_v3_array_scalar(float r_min[3],
+                                        float r_max[3],
+                                        const float (*vec_arr)[3],
+                                        const int len)
+{
+  for (int i = 0; i < len; i++) {
+    minmax_v3v3_v3(r_min, r_max, vec_arr[i]);
+  }
+}
+
+/** \} */
+
+#ifdef __SSE2__
+
+/* -------------------------------------------------------------------- */
+/** \name SSE2
+ * \{ */
+
+/* Transpose 4 vectors (12 floats) to registers with x, y and z of all vectors. */
+BLI_INLINE void load_v3_x4_sse2(const float *fl, __m128 *r_x, __m128 *r_y, __m128 *r_z)
+{
+  const __m128 m0 = _mm_loadu_ps(&fl[0]); /* x0 y0 z0 x1 */
+  const __m128 m1 = _mm_loadu_ps(&fl[4]); /* y1 z1 x2 y2 */
+  const __m128 m2 = _mm_loadu_ps(&fl[8]); /* z2 x3 y3 z3 */
+  const __m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+  const __m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+  *r_x = _mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+  *r_y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+  *r_z = _mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+BLI_INLINE void store_v3_x4_sse2(float *fl, const __m128 x, const __m128 y, const __m128 z)
+{
+  const __m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+  const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+  const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+  _mm_storeu_ps(&fl[0], _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+  _mm_storeu_ps(&fl[4], _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+  _mm_storeu_ps(&fl[8], _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+static void mul_v3_m4v3_array_sse2(float (*r)[3],
+                                   const float M[4][4],
+                                   const float (*v)[3],
+                                   const int len)
+{
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 x, y, z;
+    load_v3_x4_sse2(v[i], &x, &y, &z);
+    __m128 res[3];
+    for (int j = 0; j < 3; j++) {
+      const __m128 xy = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(M[0][j])),
+                                   _mm_mul_ps(y, _mm_set1_ps(M[1][j])));
+      const __m128 zw = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(M[2][j])), _mm_set1_ps(M[3][j]));
+      res[j] = _mm_add_ps(xy, zw);
+    }
+    store_v3_x4_sse2(r[i], res[0], res[1], res[2]);
+  }
+  mul_v3_m4v3_array_scalar(&r[i], M, &v[i], len - i);
+}
+
+static void normalize_v3_array_sse2(float (*vecs)[3], const int len)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 eps = _mm_set1_ps(1.0e-35f);
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 x, y, z;
+    load_v3_x4_sse2(vecs[i], &x, &y, &z);
+    const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    const __m128 fac = _mm_and_ps(_mm_div_ps(one, _mm_sqrt_ps(d)), _mm_cmpgt_ps(d, eps));
+    store_v3_x4_sse2(vecs[i], _mm_mul_ps(x, fac), _mm_mul_ps(y, fac), _mm_mul_ps(z, fac));
+  }
+  normalize_v3_array_scalar(&vecs[i], len - i);
+}
+
+static void interp_fl_array_sse2(
+    float *r, const float *a, const float *b, const float t, const int len)
+{
+  const __m128 s4 = _mm_set1_ps(1.0f - t);
+  const __m128 t4 = _mm_set1_ps(t);
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    const __m128 sa = _mm_mul_ps(s4, _mm_loadu_ps(&a[i]));
+    _mm_storeu_ps(&r[i], _mm_add_ps(sa, _mm_mul_ps(t4, _mm_loadu_ps(&b[i]))));
+  }
+  interp_fl_array_scalar(&r[i], &a[i], &b[i], t, len - i);
+}
+
+static void minmax_v3v3_v3_array_sse2(float r_min[3],
+                                      float r_max[3],
+                                      const float (*vec_arr)[3],
+                                      const int len)
+{
+  /* Blocks of 4 vectors in 3 registers, each lane always holds the same component. */
+  const int blocks_len = len / 4;
+  if (blocks_len != 0) {
+    const float *fl = (const float *)vec_arr;
+    __m128 min[3], max[3];
+    for (int j = 0; j < 3; j++) {
+      min[j] = max[j] = _mm_loadu_ps(&fl[j * 4]);
+    }
+    for (int block = 0; block < blocks_len; block++, fl += 12) {
+      for (int j = 0; j < 3; j++) {
+        const __m128 v = _mm_loadu_ps(&fl[j * 4]);
+        min[j] = _mm_min_ps(min[j], v);
+        max[j] = _mm_max_ps(max[j], v);
+      }
+    }
+    float min_fl[12], max_fl[12];
+    for (int j = 0; j < 3; j++) {
+      _mm_storeu_ps(&min_fl[j * 4], min[j]);
+      _mm_storeu_ps(&max_fl[j * 4], max[j]);
+    }
+    for (int j = 0; j < 12; j += 3) {
+      minmax_v3v3_v3(r_min, r_max, &min_fl[j]);
+      minmax_v3v3_v3(r_min, r_max, &max_fl[j]);
+    }
+  }
+  minmax_v3v3_v3_array_scalar(r_min, r_max, &vec_arr[blocks_len * 4], len - blocks_len * 4);
+}
+
+/** \} */
+
+#endif /* __SSE2__ */
+
+#ifdef MATH_BULK_USE_AVX2
+
+/* -------------------------------------------------------------------- */
+/** \name AVX2
+ *
+ * Same as SSE2, the lower and upper half of registers hold 4 vectors each.
+ * \{ */
+
+ATTR_TARGET_AVX2 BLI_INLINE void load_v3_x8_avx2(const float *fl,
+                                                 __m256 *r_x,
+                                                 __m256 *r_y,
+                                                 __m256 *r_z)
+{
+  const __m256 m03 = _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm_loadu_ps(&fl[0])), _mm_loadu_ps(&fl[12]), 1);
+  const __m256 m14 = _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm_loadu_ps(&fl[4])), _mm_loadu_ps(&fl[16]), 1);
+  const __m256 m25 = _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm_loadu_ps(&fl[8])), _mm_loadu_ps(&fl[20]), 1);
+  const __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+  const __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+  *r_x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+  *r_y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+  *r_z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+ATTR_TARGET_AVX2 BLI_INLINE void store_v3_x8_avx2(float *fl,
+                                                  const __m256 x,
+                                                  const __m256 y,
+                                                  const __m256 z)
+{
+  const __m256 xy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+  const __m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+  const __m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+  const __m256 m03 = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+  const __m256 m14 = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+  const __m256 m25 = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+  _mm_storeu_ps(&fl[0], _mm256_castps256_ps128(m03));
+  _mm_storeu_ps(&fl[4], _mm256_castps256_ps128(m14));
+  _mm_storeu_ps(&fl[8], _mm256_castps256_ps128(m25));
+  _mm_storeu_ps(&fl[12], _mm256_extractf128_ps(m03, 1));
+  _mm_storeu_ps(&fl[16], _mm256_extractf128_ps(m14, 1));
+  _mm_storeu_ps(&fl[20], _mm256_extractf128_ps(m25, 1));
+}
+
+ATTR_TARGET_AVX2 static void mul_v3_m4v3_array_avx2(float (*r)[3],
+                                                    const float M[4][4],
+                                                    const float (*v)[3],
+                                                    const int len)
+{
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 x, y, z;
+    load_v3_x8_avx2(v[i], &x, &y, &z);
+    __m256 res[3];
+    for (int j = 0; j < 3; j++) {
+      res[j] = _mm256_fmadd_ps(
+          x,
+          _mm256_set1_ps(M[0][j]),
+          _mm256_fmadd_ps(y,
+                          _mm256_set1_ps(M[1][j]),
+                          _mm256_fmadd_ps(z, _mm256_set1_ps(M[2][j]), _mm256_set1_ps(M[3][j]))));
+    }
+    store_v3_x8_avx2(r[i], res[0], res[1], res[2]);
+  }
+  mul_v3_m4v3_array_sse2(&r[i], M, &v[i], len - i);
+}
+
+ATTR_TARGET_AVX2 static void normalize_v3_array_avx2(float (*vecs)[3], const int len)
+{
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 eps = _mm256_set1_ps(1.0e-35f);
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 x, y, z;
+    load_v3_x8_avx2(vecs[i], &x, &y, &z);
+    const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+                                   _mm256_mul_ps(z, z));
+    const __m256 fac = _mm256_and_ps(_mm256_div_ps(one, _mm256_sqrt_ps(d)),
+                                     _mm256_cmp_ps(d, eps, _CMP_GT_OQ));
+    store_v3_x8_avx2(vecs[i], _mm256_mul_ps(x, fac), _mm256_mul_ps(y, fac), _mm256_mul_ps(z, fac));
+  }
+  normalize_v3_array_sse2(&vecs[i], len - i);
+}
+
+ATTR_TARGET_AVX2 static void interp_fl_array_avx2(
+    float *r, const float *a, const float *b, const float t, const int len)
+{
+  const __m256 s8 = _mm256_set1_ps(1.0f - t);
+  const __m256 t8 = _mm256_set1_ps(t);
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    const __m256 sa = _mm256_mul_ps(s8, _mm256_loadu_ps(&a[i]));
+    _mm256_storeu_ps(&r[i], _mm256_add_ps(sa, _mm256_mul_ps(t8, _mm256_loadu_ps(&b[i]))));
+  }
+  interp_fl_array_scalar(&r[i], &a[i], &b[i], t, len - i);
+}
+
+ATTR_TARGET_AVX2 static void minmax_v3v3_v3_array_avx2(float r_min[3],
+                                                       float r_max[3],
+                                                       const float (*vec_arr)[3],
+                                                       const int len)
+{
+  /* Blocks of 8 vectors in 3 registers, each lane always holds the same component. */
+  const int blocks_len = len / 8;
+  if (blocks_len != 0) {
+    const float *fl = (const float *)vec_arr;
+    __m256 min[3], max[3];
+    for (int j = 0; j < 3; j++) {
+      min[j] = max[j] = _mm256_loadu_ps(&fl[j * 8]);
+    }
+    for (int block = 0; block < blocks_len; block++, fl += 24) {
+      for (int j = 0; j < 3; j++) {
+        const __m256 v = _mm256_loadu_ps(&fl[j * 8]);
+        min[j] = _mm256_min_ps(min[j], v);
+        max[j] = _mm256_max_ps(max[j], v);
+      }
+    }
+    float min_fl[24], max_fl[24];
+    for (int j = 0; j < 3; j++) {
+      _mm256_storeu_ps(&min_fl[j * 8], min[j]);
+      _mm256_storeu_ps(&max_fl[j * 8], max[j]);
+    }
+    for (int j = 0; j < 24; j += 3) {
+      minmax_v3v3_v3(r_min, r_max, &min_fl[j]);
+      minmax_v3v3_v3(r_min, r_max, &max_fl[j]);
+    }
+  }
+  minmax_v3v3_v3_array_scalar(r_min, r_max, &vec_arr[blocks_len * 8], len - blocks_len * 8);
+}
+
+/** \} */
+
+#endif /* MATH_BULK_USE_AVX2 */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+void mul_v3_m4v3_array(float (*r)[3], const float M[4][4], const float (*v)[3], const int len)
+{
+  switch (BLI_math_bulk_isa_get()) {
+#ifdef MATH_BULK_USE_AVX2
+    case MATH_BULK_ISA_AVX2:
+      mul_v3_m4v3_array_avx2(r, M, v, len);
+      return;
+#endif
+#ifdef __SSE2__
+    case MATH_BULK_ISA_SSE2:
+      mul_v3_m4v3_array_sse2(r, M, v, len);
+      return;
+#endif
+    default:
+      mul_v3_m4v3_array_scalar(r, M, v, len);
+      return;
+  }
+}
+
+void normalize_v3_array(float (*vecs)[3], const int len)
+{
+  switch (BLI_math_bulk_isa_get()) {
+#ifdef MATH_BULK_USE_AVX2
+    case MATH_BULK_ISA_AVX2:
+      normalize_v3_array_avx2(vecs, len);
+      return;
+#endif
+#ifdef __SSE2__
+    case MATH_BULK_ISA_SSE2:
+      normalize_v3_array_sse2(vecs, len);
+      return;
+#endif
+    default:
+      normalize_v3_array_scalar(vecs, len);
+      return;
+  }
+}
+
+void interp_v3_v3v3_array(float (*r)[3],
+                          const float (*a)[3],
+                          const float (*b)[3],
+                          const float t,
+                          const int len)
+{
+  float *r_fl = (float *)r;
+  const float *a_fl = (const float *)a;
+  const float *b_fl = (const float *)b;
+  switch (BLI_math_bulk_isa_get()) {
+#ifdef MATH_BULK_USE_AVX2
+    case MATH_BULK_ISA_AVX2:
+      interp_fl_array_avx2(r_fl, a_fl, b_fl, t, len * 3);
+      return;
+#endif
+#ifdef __SSE2__
+    case MATH_BULK_ISA_SSE2:
+      interp_fl_array_sse2(r_fl, a_fl, b_fl, t, len * 3);
+      return;
+#endif
+    default:
+      interp_fl_array_scalar(r_fl, a_fl, b_fl, t, len * 3);
+      return;
+  }
+}
+
+void minmax_v3v3_v3_array(float r_min[3], float r_max[3], const float (*vec_arr)[3], int nbr)
+{
+  switch (BLI_math_bulk_isa_get()) {
+#ifdef MATH_BULK_USE_AVX2
+    case MATH_BULK_ISA_AVX2:
+      minmax_v3v3_v3_array_avx2(r_min, r_max, vec_arr, nbr);
+      return;
+#endif
+#ifdef __SSE2__
+    case MATH_BULK_ISA_SSE2:
+      minmax_v3v3_v3_array_sse2(r_min, r_max, vec_arr, nbr);
+      return;
+#endif
+    default:
+      minmax_v3v3_v3_array_scalar(r_min, r_max, vec_arr, nbr);
+      return;
+  }
+}
+
+/** \} */
@@ -0,0 +1,370 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Sorting of large arrays using the task scheduler.
+ *
+ * Arrays are split into chunks depending only on their length (not on the number of threads),
+ * so the results are always the same.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math_base.h"
+#include "BLI_sort.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "BLI_strict_flags.h"
+
+/* Minimum number of items in a chunk, smaller arrays are sorted on a single thread. */
+#define SORT_CHUNK_MIN_LEN 4096
+/* Must be a power of two. */
+#define SORT_CHUNKS_MAX 64
+
+static int sort_chunks_num(const int len)
+{
+  int chunks_num = 1;
+  while (chunks_num < SORT_CHUNKS_MAX && len / (chunks_num * 2) >= SORT_CHUNK_MIN_LEN) {
+    chunks_num *= 2;
+  }
+  return chunks_num;
+}
+
+static void sort_parallel_settings(TaskParallelSettings *settings, const int chunks_num)
+{
+  BLI_parallel_range_settings_defaults(settings);
+  settings->use_threading = chunks_num > 1;
+  settings->min_iter_per_thread = 1;
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Radix Sort
+ *
+ * Least significant digit first, each pass counts the digits of every chunk in parallel,
+ * then moves the items of every chunk to their place in parallel.
+ * \{ */
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES (32 / RADIX_BITS)
+
+typedef enum eRadixKeyConvert {
+  RADIX_KEY_INT_TO_UINT,
+  RADIX_KEY_FLOAT_TO_UINT,
+  RADIX_KEY_UINT_TO_FLOAT,
+} eRadixKeyConvert;
+
+typedef struct RadixSortData {
+  const uint *keys_src;
+  uint *keys_dst;
+  const int *values_src;
+  int *values_dst;
+  int len;
+  int chunk_len;
+  int shift;
+  eRadixKeyConvert convert;
+  /* Digit counts of each chunk, then the offset of the digits of each chunk in keys_dst. */
+  int (*counts)[RADIX_SIZE];
+} RadixSortData;
+
+static void radix_sort_chunk_range(const RadixSortData *data,
+                                   const int chunk,
+                                   int *r_start,
+                                   int *r_end)
+{
+  *r_start = chunk * data->chunk_len;
+  *r_end = min_ii(*r_start + data->chunk_len, data->len);
+}
+
+static void radix_sort_count_fn(void *__restrict userdata,
+                                const int chunk,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  RadixSortData *data = userdata;
+  int *counts = data->counts[chunk];
+  int start, end;
+  radix_sort_chunk_range(data, chunk, &start, &end);
+
+  memset(counts, 0, sizeof(*data->counts));
+  for (int i = start; i < end; i++) {
+    counts[(data->keys_src[i] >> data->shift) & (RADIX_SIZE - 1)]++;
+  }
+}
+
+static void radix_sort_scatter_fn(void *__restrict userdata,
+                                  const int chunk,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  RadixSortData *data = userdata;
+  int *offsets = data->counts[chunk];
+  int start, end;
+  radix_sort_chunk_range(data, chunk, &start, &end);
+
+  for (int i = start; i < end; i++) {
+    const uint key = data->keys_src[i];
+    const int dst = offsets[(key >> data->shift) & (RADIX_SIZE - 1)]++;
+    data->keys_dst[dst] = key;
+    if (data->values_src) {
+      data->values_dst[dst] = data->values_src[i];
+    }
+  }
+}
+
+/* Map keys to unsigned integers with the same order and back. */
+static void radix_sort_convert_fn(void *__restrict userdata,
+                                  const int chunk,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  RadixSortData *data = userdata;
+  uint *keys = data->keys_dst;
+  int start, end;
+  radix_sort_chunk_range(data, chunk, &start, &end);
+
+  switch (data->convert) {
+    case RADIX_KEY_INT_TO_UINT:
+      for (int i = start; i < end; i++) {
+        keys[i] ^= 0x80000000u;
+      }
+      break;
+    case RADIX_KEY_FLOAT_TO_UINT:
+      /* Flip the sign bit of positive numbers, all bits of negative numbers. */
+      for (int i = start; i < end; i++) {
+        keys[i] ^= (keys[i] & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+      }
+      break;
+    case RADIX_KEY_UINT_TO_FLOAT:
+      for (int i = start; i < end; i++) {
+        keys[i] ^= (keys[i] & 0x80000000u) ? 0x80000000u : 0xffffffffu;
+      }
+      break;
+  }
+}
+
+static void radix_sort_convert(uint *keys, const int len, const eRadixKeyConvert convert)
+{
+  RadixSortData data = {NULL};
+  const int chunks_num = sort_chunks_num(len);
+  data.keys_dst = keys;
+  data.len = len;
+  data.chunk_len = (len + chunks_num - 1) / chunks_num;
+  data.convert = convert;
+
+  TaskParallelSettings settings;
+  sort_parallel_settings(&settings, chunks_num);
+  BLI_task_parallel_range(0, chunks_num, &data, radix_sort_convert_fn, &settings);
+}
+
+static void radix_sort_uint(uint *keys, int *values, const int len)
+{
+  const int chunks_num = sort_chunks_num(len);
+  uint *keys_tmp = MEM_mallocN(sizeof(*keys) * (size_t)len, __func__);
+  int *values_tmp = values ? MEM_mallocN(sizeof(*values) * (size_t)len, __func__) : NULL;
+
+  RadixSortData data = {NULL};
+  data.len = len;
+  data.chunk_len = (len + chunks_num - 1) / chunks_num;
+  data.counts = MEM_mallocN(sizeof(*data.counts) * (size_t)chunks_num, __func__);
+
+  TaskParallelSettings settings;
+  sort_parallel_settings(&settings, chunks_num);
+
+  uint *keys_a = keys, *keys_b = keys_tmp;
+  int *values_a = values, *values_b = values_tmp;
+  for (int pass = 0; pass < RADIX_PASSES; pass++) {
+    data.keys_src = keys_a;
+    data.keys_dst = keys_b;
+    data.values_src = values_a;
+    data.values_dst = values_b;
+    data.shift = pass * RADIX_BITS;
+    BLI_task_parallel_range(0, chunks_num, &data, radix_sort_count_fn, &settings);
+
+    /* Items of earlier chunks go first within each digit, so the sort is stable. */
+    bool is_single_digit = false;
+    int offset = 0;
+    for (int digit = 0; digit < RADIX_SIZE; digit++) {
+      const int offset_prev = offset;
+      for (int chunk = 0; chunk < chunks_num; chunk++) {
+        const int count = data.counts[chunk][digit];
+        data.counts[chunk][digit] = offset;
+        offset += count;
+      }
+      if (offset - offset_prev == len) {
+        is_single_digit = true;
+        break;
+      }
+    }
+    if (is_single_digit) {
+      /* All keys have the same digit, nothing would be moved. */
+      continue;
+    }
+
+    BLI_task_parallel_range(0, chunks_num, &data, radix_sort_scatter_fn, &settings);
+    SWAP(uint *, keys_a, keys_b);
+    SWAP(int *, values_a, values_b);
+  }
+
+  if (keys_a != keys) {
+    memcpy(keys, keys_a, sizeof(*keys) * (size_t)len);
+    if (values) {
+      memcpy(values, values_a, sizeof(*values) * (size_t)len);
+    }
+  }
+
+  MEM_freeN(data.counts);
+  MEM_freeN(keys_tmp);
+  MEM_SAFE_FREE(values_tmp);
+}
+
+/**
+ * Stable sort of keys in ascending order, values (optional, may be NULL)
+ * are moved along with their keys. For example to sort indices by a key.
+ */
+void BLI_sort_radix_uint(uint *keys, int *values, const int len)
+{
+  if (len < 2) {
+    return;
+  }
+  radix_sort_uint(keys, values, len);
+}
+
+void BLI_sort_radix_int(int *keys, int *values, const int len)
+{
+  if (len < 2) {
+    return;
+  }
+  radix_sort_convert((uint *)keys, len, RADIX_KEY_INT_TO_UINT);
+  radix_sort_uint((uint *)keys, values, len);
+  radix_sort_convert((uint *)keys, len, RADIX_KEY_INT_TO_UINT);
+}
+
+/**
+ * \note NaN values are sorted before or after all other values, depending on their sign bit.
+ */
+void BLI_sort_radix_float(float *keys, int *values, const int len)
+{
+  if (len < 2) {
+    return;
+  }
+  radix_sort_convert((uint *)keys, len, RADIX_KEY_FLOAT_TO_UINT);
+  radix_sort_uint((uint *)keys, values, len);
+  radix_sort_convert((uint *)keys, len, RADIX_KEY_UINT_TO_FLOAT);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Merge Sort
+ *
+ * Chunks are sorted in parallel, then pairs of sorted runs are merged in parallel,
+ * doubling the run length each round.
+ * \{ */
+
+typedef struct MergeSortData {
+  char *src;
+  char *dst;
+  size_t len;
+  size_t es;
+  /* Length of the sorted runs. */
+  size_t run_len;
+  BLI_sort_cmp_t cmp;
+  void *thunk;
+} MergeSortData;
+
+static void merge_sort_chunk_fn(void *__restrict userdata,
+                                const int chunk,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MergeSortData *data = userdata;
+  const size_t start = (size_t)chunk * data->run_len;
+  const size_t len = MIN2(data->run_len, data->len - start);
+  BLI_qsort_r(data->src + start * data->es, len, data->es, data->cmp, data->thunk);
+}
+
+static void merge_sort_merge_fn(void *__restrict userdata,
+                                const int pair,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MergeSortData *data = userdata;
+  const size_t es = data->es;
+  const size_t start = (size_t)pair * data->run_len * 2;
+  const size_t mid = MIN2(start + data->run_len, data->len);
+  const size_t end = MIN2(start + data->run_len * 2, data->len);
+
+  const char *a = data->src + start * es, *a_end = data->src + mid * es;
+  const char *b = a_end, *b_end = data->src + end * es;
+  char *dst = data->dst + start * es;
+  while (a != a_end && b != b_end) {
+    /* Take from the first run when equal, so merging is stable. */
+    if (data->cmp(b, a, data->thunk) < 0) {
+      memcpy(dst, b, es);
+      b += es;
+    }
+    else {
+      memcpy(dst, a, es);
+      a += es;
+    }
+    dst += es;
+  }
+  memcpy(dst, a, (size_t)(a_end - a));
+  dst += a_end - a;
+  memcpy(dst, b, (size_t)(b_end - b));
+}
+
+/**
+ * Same as #BLI_qsort_r (also not stable), using multiple threads for large arrays.
+ */
+void BLI_sort_parallel_r(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk)
+{
+  const int chunks_num = (n > INT_MAX) ? SORT_CHUNKS_MAX : sort_chunks_num((int)n);
+  if (chunks_num == 1) {
+    BLI_qsort_r(a, n, es, cmp, thunk);
+    return;
+  }
+
+  char *tmp = MEM_mallocN(n * es, __func__);
+
+  MergeSortData data;
+  data.src = a;
+  data.dst = tmp;
+  data.len = n;
+  data.es = es;
+  data.run_len = (n + (size_t)chunks_num - 1) / (size_t)chunks_num;
+  data.cmp = cmp;
+  data.thunk = thunk;
+
+  TaskParallelSettings settings;
+  sort_parallel_settings(&settings, chunks_num);
+  BLI_task_parallel_range(0, chunks_num, &data, merge_sort_chunk_fn, &settings);
+
+  for (int runs_num = chunks_num; runs_num > 1; runs_num /= 2) {
+    BLI_task_parallel_range(0, runs_num / 2, &data, merge_sort_merge_fn, &settings);
+    SWAP(char *, data.src, data.dst);
+    data.run_len *= 2;
+  }
+
+  if (data.src != a) {
+    memcpy(a, data.src, n * es);
+  }
+  MEM_freeN(tmp);
+}
+
+/** \} */
@@ -127,6 +127,16 @@ static void __cpuid(int data[4], int selector)
   data[0] = data[1] = data[2] = data[3] = 0;
 #  endif
 }
+
+/* Only used for x86-64 features. */
+#  if defined(__x86_64__)
+static void __cpuidex(int data[4], int selector, int subselector)
+{
+  asm("cpuid"
+      : "=a"(data[0]), "=b"(data[1]), "=c"(data[2]), "=d"(data[3])
+      : "a"(selector), "c"(subselector));
+}
+#  endif
 #endif
 
 char *BLI_cpu_brand_string(void)
@@ -158,6 +168,44 @@ int BLI_cpu_support_sse41(void)
   return 0;
 }
 
+/**
+ * AVX2 and FMA, only checked on x86-64 where they are used by the bulk math kernels.
+ * The OS must also save the AVX registers on context switches.
+ */
+int BLI_cpu_support_avx2(void)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+  int result[4];
+  __cpuid(result, 0);
+  if (result[0] < 7) {
+    return 0;
+  }
+
+  __cpuid(result, 0x00000001);
+  const int osxsave = (int)1 << 27, avx = (int)1 << 28, fma = (int)1 << 12;
+  if ((result[2] & (osxsave | avx | fma)) != (osxsave | avx | fma)) {
+    return 0;
+  }
+
+  /* XMM and YMM state enabled by the OS. */
+#  if defined(_MSC_VER)
+  const unsigned long long xcr0 = _xgetbv(0);
+#  else
+  unsigned int xcr0_lo, xcr0_hi;
+  asm("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  const unsigned long long xcr0 = xcr0_lo;
+#  endif
+  if ((xcr0 & 0x6) != 0x6) {
+    return 0;
+  }
+
+  __cpuidex(result, 0x00000007, 0);
+  return (result[1] & ((int)1 << 5)) != 0;
+#else
+  return 0;
+#endif
+}
+
 void BLI_hostname_get(char *buffer, size_t bufsize)
 {
 #ifndef WIN32
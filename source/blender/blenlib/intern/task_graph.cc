@@ -0,0 +1,197 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Task graph, to run tasks in parallel once their dependencies are done.
+ */
+
+#include <atomic>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_task.h"
+
+#ifdef WITH_TBB
+/* Quiet top level deprecation message, unrelated to API usage here. */
+#  define TBB_SUPPRESS_DEPRECATED_MESSAGES 1
+#  include <tbb/tbb.h>
+#endif
+
+/* Task Node
+ *
+ * Runs once the counter of pending dependencies drops to zero. */
+
+struct TaskNode {
+  TaskGraph *task_graph;
+  TaskGraphNodeRunFunction run_func;
+  void *task_data;
+  TaskGraphNodeFreeFunction free_func;
+
+  /* Nodes depending on this one. */
+  std::vector<TaskNode *> successors;
+  /* Number of nodes this one depends on. */
+  int predecessors_len;
+  /* Dependencies that didn't finish yet, while the graph runs. */
+  std::atomic<int> pending;
+
+  TaskNode(TaskGraph *task_graph,
+           TaskGraphNodeRunFunction run_func,
+           void *task_data,
+           TaskGraphNodeFreeFunction free_func)
+      : task_graph(task_graph),
+        run_func(run_func),
+        task_data(task_data),
+        free_func(free_func),
+        predecessors_len(0),
+        pending(0)
+  {
+  }
+
+  ~TaskNode()
+  {
+    if (free_func) {
+      free_func(task_data);
+    }
+  }
+
+  TaskNode(const TaskNode &other) = delete;
+  TaskNode &operator=(const TaskNode &other) = delete;
+
+  MEM_CXX_CLASS_ALLOC_FUNCS("task_graph:TaskNode")
+};
+
+/* Task Graph */
+
+struct TaskGraph {
+  std::vector<TaskNode *> nodes;
+
+#ifdef WITH_TBB
+  tbb::task_group tbb_group;
+#else
+  /* Nodes ready to run. */
+  std::vector<TaskNode *> ready;
+#endif
+
+#ifndef NDEBUG
+  /* Number of nodes run, nodes in a cycle never run. */
+  std::atomic<int> nodes_run_len{0};
+#endif
+
+  ~TaskGraph()
+  {
+    for (TaskNode *node : nodes) {
+      delete node;
+    }
+  }
+
+  MEM_CXX_CLASS_ALLOC_FUNCS("task_graph:TaskGraph")
+};
+
+static void task_node_run(TaskNode *node);
+
+static void task_node_schedule(TaskNode *node)
+{
+#ifdef WITH_TBB
+  node->task_graph->tbb_group.run([node]() { task_node_run(node); });
+#else
+  node->task_graph->ready.push_back(node);
+#endif
+}
+
+/* Run a node and the successors it made ready. The last of those continues on
+ * this thread, avoiding the scheduling overhead along chains of nodes. */
+static void task_node_run(TaskNode *node)
+{
+  while (node) {
+    node->run_func(node->task_data);
+#ifndef NDEBUG
+    node->task_graph->nodes_run_len++;
+#endif
+
+    TaskNode *node_next = nullptr;
+    for (TaskNode *successor : node->successors) {
+      if (successor->pending.fetch_sub(1) == 1) {
+        if (node_next) {
+          task_node_schedule(node_next);
+        }
+        node_next = successor;
+      }
+    }
+    node = node_next;
+  }
+}
+
+/* Public API */
+
+TaskGraph *BLI_task_graph_create(void)
+{
+  return new TaskGraph();
+}
+
+void BLI_task_graph_free(TaskGraph *task_graph)
+{
+  delete task_graph;
+}
+
+void BLI_task_graph_work_and_wait(TaskGraph *task_graph)
+{
+  for (TaskNode *node : task_graph->nodes) {
+    node->pending = node->predecessors_len;
+  }
+#ifndef NDEBUG
+  task_graph->nodes_run_len = 0;
+#endif
+
+  for (TaskNode *node : task_graph->nodes) {
+    if (node->predecessors_len == 0) {
+      task_node_schedule(node);
+    }
+  }
+
+#ifdef WITH_TBB
+  task_graph->tbb_group.wait();
+#else
+  while (!task_graph->ready.empty()) {
+    TaskNode *node = task_graph->ready.back();
+    task_graph->ready.pop_back();
+    task_node_run(node);
+  }
+#endif
+
+  /* Cycles would leave nodes waiting forever. */
+  BLI_assert(task_graph->nodes_run_len == (int)task_graph->nodes.size());
+}
+
+TaskNode *BLI_task_graph_node_create(TaskGraph *task_graph,
+                                     TaskGraphNodeRunFunction run_func,
+                                     void *task_data,
+                                     TaskGraphNodeFreeFunction free_func)
+{
+  TaskNode *task_node = new TaskNode(task_graph, run_func, task_data, free_func);
+  task_graph->nodes.push_back(task_node);
+  return task_node;
+}
+
+void BLI_task_graph_edge_create(TaskNode *from_node, TaskNode *to_node)
+{
+  BLI_assert(from_node->task_graph == to_node->task_graph);
+  BLI_assert(from_node != to_node);
+  from_node->successors.push_back(to_node);
+  to_node->predecessors_len++;
+}
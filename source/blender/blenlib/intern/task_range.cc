@@ -20,7 +20,13 @@
  * Task parallel range functions.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
 #include <stdlib.h>
+#include <unordered_map>
+#include <vector>
 
 #include "MEM_guardedalloc.h"
 
@@ -29,6 +35,8 @@
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
+#include "PIL_time.h"
+
 #include "atomic_ops.h"
 
 #ifdef WITH_TBB
@@ -37,6 +45,185 @@
 #  include <tbb/tbb.h>
 #endif
 
+/* Target duration of the iterations handled at once with adaptive grain size,
+ * long enough for the scheduling overhead to be negligible. */
+#define RANGE_ADAPTIVE_CHUNK_TIME 50e-6
+/* Minimum number of chunks per thread with adaptive grain size,
+ * so work stealing can balance iterations of uneven cost. */
+#define RANGE_ADAPTIVE_CHUNKS_PER_THREAD 4
+/* Minimum number of iterations to split a range over NUMA nodes. */
+#define RANGE_NUMA_MIN_ITERATIONS 16384
+
+/* -------------------------------------------------------------------- */
+/** \name Call Site Statistics
+ *
+ * Call sites are identified by their #TaskParallelRangeSite, given by #BLI_task_parallel_range.
+ * The adaptive grain size only needs the site itself, statistics are only gathered
+ * (under a lock) when enabled.
+ * \{ */
+
+struct RangeStats {
+  const char *name = nullptr;
+  int64_t calls = 0;
+  int64_t calls_threaded = 0;
+  int64_t iterations = 0;
+  int64_t chunks = 0;
+  /** Wall time of all calls. */
+  double time = 0.0;
+  /** Time spent running iterations, summed over all threads. */
+  double time_iter = 0.0;
+};
+
+/* Measurements of a single call, shared by all threads running it. */
+struct RangeTiming {
+  std::atomic<int64_t> chunks{0};
+  std::atomic<int64_t> time_iter_ns{0};
+
+  void add_chunk(const double time_start)
+  {
+    chunks++;
+    time_iter_ns += (int64_t)((PIL_check_seconds_timer() - time_start) * 1e9);
+  }
+};
+
+static std::atomic<bool> range_stats_enabled{false};
+static std::mutex range_stats_mutex;
+static std::unordered_map<const TaskParallelRangeSite *, RangeStats> range_stats;
+
+static double range_site_time_per_iter_get(TaskParallelRangeSite *site)
+{
+  const uint64_t bits = atomic_add_and_fetch_uint64(&site->time_per_iter, 0);
+  double time_per_iter;
+  memcpy(&time_per_iter, &bits, sizeof(time_per_iter));
+  return time_per_iter;
+}
+
+static void range_site_time_per_iter_update(TaskParallelRangeSite *site,
+                                            const double time_per_iter_call)
+{
+  uint64_t bits_old = atomic_add_and_fetch_uint64(&site->time_per_iter, 0);
+  while (true) {
+    double time_per_iter;
+    memcpy(&time_per_iter, &bits_old, sizeof(time_per_iter));
+    /* Favor recent calls, the cost of iterations may depend on the input. */
+    time_per_iter = (time_per_iter == 0.0) ? time_per_iter_call :
+                                             (time_per_iter * 0.75 + time_per_iter_call * 0.25);
+    uint64_t bits_new;
+    memcpy(&bits_new, &time_per_iter, sizeof(bits_new));
+
+    const uint64_t bits_prev = atomic_cas_uint64(&site->time_per_iter, bits_old, bits_new);
+    if (bits_prev == bits_old) {
+      break;
+    }
+    bits_old = bits_prev;
+  }
+}
+
+static void range_stats_add(const TaskParallelRangeSite *site,
+                            const int iterations,
+                            const bool is_threaded,
+                            const RangeTiming &timing,
+                            const double time)
+{
+  std::lock_guard<std::mutex> lock(range_stats_mutex);
+  RangeStats &stats = range_stats[site];
+  stats.name = site->name;
+  stats.calls++;
+  stats.calls_threaded += is_threaded ? 1 : 0;
+  stats.iterations += iterations;
+  stats.chunks += timing.chunks.load();
+  stats.time += time;
+  stats.time_iter += (double)timing.time_iter_ns.load() * 1e-9;
+}
+
+/* Record the measurements of a call, once all its iterations ran. */
+static void range_site_add(TaskParallelRangeSite *site,
+                           const TaskParallelSettings *settings,
+                           const int iterations,
+                           const bool is_threaded,
+                           const RangeTiming &timing,
+                           const bool use_stats,
+                           const double time)
+{
+  if (settings->use_adaptive_grain && iterations > 0) {
+    const double time_iter = (double)timing.time_iter_ns.load() * 1e-9;
+    range_site_time_per_iter_update(site, time_iter / (double)iterations);
+  }
+  if (use_stats) {
+    range_stats_add(site, iterations, is_threaded, timing, time);
+  }
+}
+
+void BLI_task_parallel_range_stats_enable(const bool enable)
+{
+  range_stats_enabled = enable;
+}
+
+void BLI_task_parallel_range_stats_clear(void)
+{
+  std::lock_guard<std::mutex> lock(range_stats_mutex);
+  range_stats.clear();
+}
+
+/**
+ * Print statistics of all call sites, the slowest first.
+ */
+void BLI_task_parallel_range_stats_print(void)
+{
+  std::lock_guard<std::mutex> lock(range_stats_mutex);
+
+  std::vector<const RangeStats *> stats_sorted;
+  for (const auto &item : range_stats) {
+    stats_sorted.push_back(&item.second);
+  }
+  std::sort(stats_sorted.begin(),
+            stats_sorted.end(),
+            [](const RangeStats *a, const RangeStats *b) { return a->time > b->time; });
+
+  printf("Parallel range statistics (%d threads):\n", BLI_task_scheduler_num_threads());
+  printf("%-56s %8s %8s %12s %10s %10s %10s %10s\n",
+         "callback",
+         "calls",
+         "threaded",
+         "iterations",
+         "time (s)",
+         "iter (s)",
+         "iter (ns)",
+         "grain");
+  for (const RangeStats *stats : stats_sorted) {
+    printf("%-56s %8lld %8lld %12lld %10.6f %10.6f %10.1f %10.1f\n",
+           stats->name,
+           (long long)stats->calls,
+           (long long)stats->calls_threaded,
+           (long long)stats->iterations,
+           stats->time,
+           stats->time_iter,
+           stats->iterations ? (stats->time_iter / (double)stats->iterations) * 1e9 : 0.0,
+           stats->chunks ? ((double)stats->iterations / (double)stats->chunks) : 0.0);
+  }
+  fflush(stdout);
+}
+
+/** \} */
+
+/**
+ * \return The number of iterations to handle at once,
+ * aiming at chunks of #RANGE_ADAPTIVE_CHUNK_TIME with enough chunks for work stealing.
+ */
+static int range_adaptive_grain(const double time_per_iter,
+                                const int iterations,
+                                const int threads_num)
+{
+  const int grain_max = std::max(1,
+                                 iterations / (threads_num * RANGE_ADAPTIVE_CHUNKS_PER_THREAD));
+  if (time_per_iter <= 0.0) {
+    /* Not measured yet. */
+    return grain_max;
+  }
+  const double grain = RANGE_ADAPTIVE_CHUNK_TIME / time_per_iter;
+  return (int)std::min((double)grain_max, std::max(1.0, grain));
+}
+
 #ifdef WITH_TBB
 
 /* Functor for running TBB parallel_for and parallel_reduce. */
@@ -44,26 +231,31 @@ struct RangeTask {
   TaskParallelRangeFunc func;
   void *userdata;
   const TaskParallelSettings *settings;
+  /* Optional, measure the time spent in iterations. */
+  RangeTiming *timing;
 
   void *userdata_chunk;
 
   /* Root constructor. */
-  RangeTask(TaskParallelRangeFunc func, void *userdata, const TaskParallelSettings *settings)
-      : func(func), userdata(userdata), settings(settings)
+  RangeTask(TaskParallelRangeFunc func,
+            void *userdata,
+            const TaskParallelSettings *settings,
+            RangeTiming *timing)
+      : func(func), userdata(userdata), settings(settings), timing(timing)
   {
     init_chunk(settings->userdata_chunk);
   }
 
   /* Copy constructor. */
   RangeTask(const RangeTask &other)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func), userdata(other.userdata), settings(other.settings), timing(other.timing)
   {
     init_chunk(settings->userdata_chunk);
   }
 
   /* Splitting constructor for parallel reduce. */
   RangeTask(RangeTask &other, tbb::split)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func), userdata(other.userdata), settings(other.settings), timing(other.timing)
   {
     init_chunk(settings->userdata_chunk);
   }
@@ -89,11 +281,15 @@ struct RangeTask {
 
   void operator()(const tbb::blocked_range<int> &r) const
   {
+    const double time_start = timing ? PIL_check_seconds_timer() : 0.0;
     TaskParallelTLS tls;
     tls.userdata_chunk = userdata_chunk;
     for (int i = r.begin(); i != r.end(); ++i) {
       func(userdata, i, &tls);
     }
+    if (timing) {
+      timing->add_chunk(time_start);
+    }
   }
 
   void join(const RangeTask &other)
@@ -102,33 +298,116 @@ struct RangeTask {
   }
 };
 
+static void range_task_run(RangeTask &task, const int start, const int stop, const int grainsize)
+{
+  const tbb::blocked_range<int> range(start, stop, (size_t)grainsize);
+
+  /* Ranges are never split below the grain size, the auto partitioner
+   * only splits that far on demand, when threads steal work. */
+  if (task.settings->func_reduce) {
+    parallel_reduce(range, task, tbb::auto_partitioner());
+  }
+  else {
+    parallel_for(range, task, tbb::auto_partitioner());
+  }
+}
+
+/* Range split over NUMA nodes, each node gets a task of its own. */
+struct RangeNumaData {
+  std::vector<RangeTask> tasks;
+  int start;
+  int stop;
+  int grainsize;
+};
+
+static void range_numa_node_func(void *__restrict userdata, const int node_index)
+{
+  RangeNumaData *data = (RangeNumaData *)userdata;
+  const int64_t iterations = data->stop - data->start;
+  const int64_t nodes_num = (int64_t)data->tasks.size();
+
+  /* Deterministic, so the same iterations run on the same node every time. */
+  const int start = data->start + (int)(iterations * node_index / nodes_num);
+  const int stop = data->start + (int)(iterations * (node_index + 1) / nodes_num);
+  range_task_run(data->tasks[node_index], start, stop, data->grainsize);
+}
+
+static void range_numa_run(RangeTask &task,
+                           const int start,
+                           const int stop,
+                           const int grainsize,
+                           const int nodes_num)
+{
+  RangeNumaData data;
+  data.start = start;
+  data.stop = stop;
+  data.grainsize = grainsize;
+  data.tasks.reserve((size_t)nodes_num);
+  for (int i = 0; i < nodes_num; i++) {
+    data.tasks.push_back(task);
+  }
+
+  BLI_task_scheduler_numa_run(range_numa_node_func, &data);
+
+  if (task.settings->func_reduce) {
+    for (const RangeTask &node_task : data.tasks) {
+      task.join(node_task);
+    }
+  }
+}
+
 #endif
 
-void BLI_task_parallel_range(const int start,
-                             const int stop,
-                             void *userdata,
-                             TaskParallelRangeFunc func,
-                             const TaskParallelSettings *settings)
+void BLI_task_parallel_range_ex(const int start,
+                                const int stop,
+                                void *userdata,
+                                TaskParallelRangeFunc func,
+                                TaskParallelRangeSite *site,
+                                const TaskParallelSettings *settings)
 {
+  const int iterations = stop - start;
+  bool use_threading = settings->use_threading;
+  int grainsize = MAX2(settings->min_iter_per_thread, 1);
+
+  const bool use_stats = range_stats_enabled.load(std::memory_order_relaxed);
+  const bool use_timing = settings->use_adaptive_grain || use_stats;
+  RangeTiming timing;
+  const double time_start = use_timing ? PIL_check_seconds_timer() : 0.0;
+
+  if (settings->use_adaptive_grain) {
+    const double time_per_iter = range_site_time_per_iter_get(site);
+    grainsize = range_adaptive_grain(time_per_iter, iterations, BLI_task_scheduler_num_threads());
+    if (time_per_iter * (double)iterations < RANGE_ADAPTIVE_CHUNK_TIME * 2.0) {
+      /* Not worth the threading overhead (only known once measured). */
+      use_threading = use_threading && (time_per_iter == 0.0);
+    }
+  }
+
 #ifdef WITH_TBB
   /* Multithreading. */
-  if (settings->use_threading && BLI_task_scheduler_num_threads() > 1) {
-    RangeTask task(func, userdata, settings);
-    const size_t grainsize = MAX2(settings->min_iter_per_thread, 1);
-    const tbb::blocked_range<int> range(start, stop, grainsize);
-
-    if (settings->func_reduce) {
-      parallel_reduce(range, task);
-      if (settings->userdata_chunk) {
-        memcpy(settings->userdata_chunk, task.userdata_chunk, settings->userdata_chunk_size);
-      }
+  if (use_threading && BLI_task_scheduler_num_threads() > 1) {
+    RangeTask task(func, userdata, settings, use_timing ? &timing : NULL);
+
+    const int numa_nodes_num = BLI_task_scheduler_numa_nodes_num();
+    if (numa_nodes_num > 1 && iterations >= RANGE_NUMA_MIN_ITERATIONS) {
+      range_numa_run(task, start, stop, grainsize, numa_nodes_num);
     }
     else {
-      parallel_for(range, task);
+      range_task_run(task, start, stop, grainsize);
+    }
+
+    if (settings->func_reduce && settings->userdata_chunk) {
+      memcpy(settings->userdata_chunk, task.userdata_chunk, settings->userdata_chunk_size);
     }
 
+    if (use_timing) {
+      range_site_add(
+          site, settings, iterations, true, timing, use_stats, PIL_check_seconds_timer() - time_start);
+    }
     return;
   }
+#else
+  UNUSED_VARS(use_threading, grainsize);
 #endif
 
   /* Single threaded. Nothing to reduce as everything is accumulated into the
@@ -141,6 +420,12 @@ void BLI_task_parallel_range(const int start,
   if (settings->func_free != NULL) {
     settings->func_free(userdata, settings->userdata_chunk);
   }
+
+  if (use_timing) {
+    timing.add_chunk(time_start);
+    range_site_add(
+        site, settings, iterations, false, timing, use_stats, PIL_check_seconds_timer() - time_start);
+  }
 }
 
 int BLI_task_parallel_thread_id(const TaskParallelTLS *UNUSED(tls))
@@ -20,17 +20,32 @@
  * Task scheduler initialization.
  */
 
+#include <memory>
+#include <vector>
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
+#include "numaapi.h"
+
 #ifdef WITH_TBB
 /* Quiet top level deprecation message, unrelated to API usage here. */
 #  define TBB_SUPPRESS_DEPRECATED_MESSAGES 1
 #  include <tbb/tbb.h>
 #  if TBB_INTERFACE_VERSION_MAJOR >= 10
 #    define WITH_TBB_GLOBAL_CONTROL
+#    define WITH_TBB_NUMA
+#  endif
+#endif
+
+#ifdef WITH_TBB_NUMA
+#  ifdef _WIN32
+#    include <windows.h>
+#  elif defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
 #  endif
 #endif
 
@@ -41,6 +56,178 @@ static int task_scheduler_num_threads = 1;
 static tbb::global_control *task_scheduler_global_control = nullptr;
 #endif
 
+/* NUMA Nodes
+ *
+ * A task arena per node, worker threads entering it are pinned to the node. */
+
+static bool task_scheduler_use_numa = false;
+
+#ifdef WITH_TBB_NUMA
+/* Number of node arenas the thread is in, ranges aren't split over the nodes again from there. */
+static thread_local int task_scheduler_numa_arena_depth = 0;
+
+/* Affinity of a thread, restored when it leaves a node arena (worker threads are shared by
+ * all arenas, they shouldn't stay pinned to a node for other work). */
+struct ThreadAffinity {
+#  ifdef _WIN32
+  GROUP_AFFINITY affinity;
+#  elif defined(__linux__)
+  cpu_set_t affinity;
+#  endif
+  bool is_valid = false;
+
+  void save()
+  {
+#  ifdef _WIN32
+    is_valid = GetThreadGroupAffinity(GetCurrentThread(), &affinity) != 0;
+#  elif defined(__linux__)
+    is_valid = pthread_getaffinity_np(pthread_self(), sizeof(affinity), &affinity) == 0;
+#  endif
+  }
+
+  void restore()
+  {
+    if (!is_valid) {
+      return;
+    }
+#  ifdef _WIN32
+    SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+#  elif defined(__linux__)
+    pthread_setaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+#  endif
+    is_valid = false;
+  }
+};
+
+static thread_local ThreadAffinity task_scheduler_numa_affinity_orig;
+
+class NumaNodeObserver : public tbb::task_scheduler_observer {
+  int node_;
+
+ public:
+  NumaNodeObserver(tbb::task_arena &arena, const int node)
+      : tbb::task_scheduler_observer(arena), node_(node)
+  {
+    observe(true);
+  }
+
+  ~NumaNodeObserver()
+  {
+    observe(false);
+  }
+
+  void on_scheduler_entry(bool is_worker) override
+  {
+    /* Threads waiting for the arena to finish may run its tasks too,
+     * only pin workers so other threads keep their own affinity. */
+    if (is_worker && task_scheduler_numa_arena_depth == 0) {
+      task_scheduler_numa_affinity_orig.save();
+      numaAPI_RunThreadOnNode(node_);
+    }
+    task_scheduler_numa_arena_depth++;
+  }
+
+  void on_scheduler_exit(bool is_worker) override
+  {
+    task_scheduler_numa_arena_depth--;
+    if (is_worker && task_scheduler_numa_arena_depth == 0) {
+      task_scheduler_numa_affinity_orig.restore();
+    }
+  }
+};
+
+struct NumaNodeArena {
+  tbb::task_arena arena;
+  NumaNodeObserver observer;
+
+  NumaNodeArena(const int node, const int num_threads)
+      : arena(num_threads), observer(arena, node)
+  {
+  }
+
+  MEM_CXX_CLASS_ALLOC_FUNCS("NumaNodeArena")
+};
+
+static std::vector<std::unique_ptr<NumaNodeArena>> task_scheduler_numa_arenas;
+
+static void task_scheduler_numa_init(void)
+{
+  if (numaAPI_Initialize() != NUMAAPI_SUCCESS) {
+    return;
+  }
+  const int num_nodes = numaAPI_GetNumNodes();
+  for (int node = 0; node < num_nodes; node++) {
+    if (!numaAPI_IsNodeAvailable(node)) {
+      continue;
+    }
+    const int num_processors = numaAPI_GetNumNodeProcessors(node);
+    if (num_processors > 0) {
+      const int num_threads = MIN2(num_processors, task_scheduler_num_threads);
+      task_scheduler_numa_arenas.emplace_back(new NumaNodeArena(node, num_threads));
+    }
+  }
+  if (task_scheduler_numa_arenas.size() < 2) {
+    /* Nothing to gain from a single node. */
+    task_scheduler_numa_arenas.clear();
+  }
+}
+#endif
+
+void BLI_task_scheduler_use_numa_set(const bool use_numa)
+{
+  task_scheduler_use_numa = use_numa;
+}
+
+int BLI_task_scheduler_numa_nodes_num(void)
+{
+#ifdef WITH_TBB_NUMA
+  if (task_scheduler_numa_arena_depth != 0) {
+    /* Already running on a node. */
+    return 1;
+  }
+  return MAX2(1, (int)task_scheduler_numa_arenas.size());
+#else
+  return 1;
+#endif
+}
+
+#ifdef WITH_TBB_NUMA
+struct NumaRunTask {
+  TaskNumaNodeFunc func;
+  void *userdata;
+  int node_index;
+
+  void operator()() const
+  {
+    func(userdata, node_index);
+  }
+};
+#endif
+
+void BLI_task_scheduler_numa_run(TaskNumaNodeFunc func, void *userdata)
+{
+#ifdef WITH_TBB_NUMA
+  const int num_nodes = BLI_task_scheduler_numa_nodes_num();
+  if (num_nodes > 1) {
+    /* Task groups are local, this may run from multiple threads at once. */
+    std::unique_ptr<tbb::task_group[]> task_groups(new tbb::task_group[num_nodes]);
+    for (int i = 0; i < num_nodes; i++) {
+      tbb::task_group &task_group = task_groups[i];
+      const NumaRunTask task = {func, userdata, i};
+      task_scheduler_numa_arenas[i]->arena.execute([&]() { task_group.run(task); });
+    }
+    for (int i = 0; i < num_nodes; i++) {
+      tbb::task_group &task_group = task_groups[i];
+      task_scheduler_numa_arenas[i]->arena.execute([&]() { task_group.wait(); });
+    }
+    return;
+  }
+#endif
+  func(userdata, 0);
+}
+
+/* Initialization */
+
 void BLI_task_scheduler_init()
 {
 #ifdef WITH_TBB_GLOBAL_CONTROL
@@ -63,10 +250,19 @@ void BLI_task_scheduler_init()
 #else
   task_scheduler_num_threads = BLI_system_thread_count();
 #endif
+
+#ifdef WITH_TBB_NUMA
+  if (task_scheduler_use_numa && task_scheduler_num_threads > 1) {
+    task_scheduler_numa_init();
+  }
+#endif
 }
 
 void BLI_task_scheduler_exit()
 {
+#ifdef WITH_TBB_NUMA
+  task_scheduler_numa_arenas.clear();
+#endif
 #ifdef WITH_TBB_GLOBAL_CONTROL
   OBJECT_GUARDED_DELETE(task_scheduler_global_control, tbb::global_control);
 #endif
@@ -114,8 +114,13 @@ BlendHandle *BLO_blendhandle_from_memory(const void *mem, int memsize);
 struct LinkNode *BLO_blendhandle_get_datablock_names(BlendHandle *bh,
                                                      int ofblocktype,
                                                      int *tot_names);
+struct LinkNode *BLO_blendhandle_get_datablock_dependencies(BlendHandle *bh,
+                                                            int ofblocktype,
+                                                            const char *name,
+                                                            int *tot_names);
 struct LinkNode *BLO_blendhandle_get_previews(BlendHandle *bh, int ofblocktype, int *tot_prev);
 struct LinkNode *BLO_blendhandle_get_linkable_groups(BlendHandle *bh);
+int BLO_blendhandle_index_lookups(BlendHandle *bh);
 
 void BLO_blendhandle_close(BlendHandle *bh);
 
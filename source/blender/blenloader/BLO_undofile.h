@@ -32,12 +32,17 @@ typedef struct {
   const char *buf;
   /** Size in bytes. */
   unsigned int size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, this chunk is identical to the one at the same position in the previous step
+   * (the buffer is shared with it). Buffers are also shared with any other chunk with the same
+   * contents, they're reference counted, chunks never own their memory. */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
    * Defined when writing the next step (i.e. last undo step has those always false). */
   bool is_identical_future;
+  /** Identifies the contents of #buf, shared by all identical chunks using the same buffer.
+   * Unlike the pointer, it is never reused once the buffer is freed. */
+  uint64_t buf_id;
 } MemFileChunk;
 
 typedef struct MemFile {
@@ -45,6 +50,14 @@ typedef struct MemFile {
   size_t size;
 } MemFile;
 
+/** Memory use of all memfiles. */
+typedef struct MemFileStats {
+  /** Buffers allocated for chunk data, and their total size in bytes. */
+  size_t buffers_len, buffers_size;
+  /** Chunks of all memfiles, and their total size in bytes as if no buffers were shared. */
+  size_t chunks_len, chunks_size;
+} MemFileStats;
+
 typedef struct MemFileUndoData {
   char filename[1024]; /* FILE_MAX */
   MemFile memfile;
@@ -61,6 +74,7 @@ extern void memfile_chunk_add(MemFile *memfile,
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
 extern void BLO_memfile_clear_future(MemFile *memfile);
+extern void BLO_memfile_stats_get(MemFileStats *r_stats);
 
 /* utilities */
 extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
@@ -68,4 +82,18 @@ extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                          struct Scene **r_scene);
 extern bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename);
 
+/* journal, for incremental writing of memfiles */
+
+/** Magic bytes at the start of a journal file, the first 7 are used to detect the file type. */
+#define BLO_MEMFILE_JOURNAL_MAGIC "BLENDJNL"
+
+typedef struct MemFileJournal MemFileJournal;
+
+extern MemFileJournal *BLO_memfile_journal_new(void);
+extern void BLO_memfile_journal_free(MemFileJournal *journal);
+extern bool BLO_memfile_journal_write(MemFileJournal *journal,
+                                      struct MemFile *memfile,
+                                      const char *filename);
+extern void *BLO_memfile_journal_read(int file, size_t *r_size);
+
 #endif /* __BLO_UNDOFILE_H__ */
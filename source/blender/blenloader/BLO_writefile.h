@@ -26,6 +26,7 @@
  */
 
 struct BlendThumbnail;
+struct BlendWriteSnapshot;
 struct Main;
 struct MemFile;
 struct ReportList;
@@ -35,6 +36,14 @@ extern bool BLO_write_file(struct Main *mainvar,
                            int write_flags,
                            struct ReportList *reports,
                            const struct BlendThumbnail *thumb);
+extern struct BlendWriteSnapshot *BLO_write_file_snapshot(struct Main *mainvar,
+                                                          const char *filepath,
+                                                          int write_flags,
+                                                          struct ReportList *reports,
+                                                          const struct BlendThumbnail *thumb);
+extern bool BLO_write_file_snapshot_write(struct BlendWriteSnapshot *snapshot,
+                                          struct ReportList *reports);
+extern void BLO_write_file_snapshot_free(struct BlendWriteSnapshot *snapshot);
 extern bool BLO_write_file_mem(struct Main *mainvar,
                                struct MemFile *compare,
                                struct MemFile *current,
@@ -40,6 +40,7 @@
 #include "DNA_genfile.h"
 #include "DNA_sdna_types.h"
 
+#include "BKE_global.h"
 #include "BKE_idtype.h"
 #include "BKE_main.h"
 
@@ -47,6 +48,8 @@
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
 
+#include "PIL_time.h"
+
 #include "readfile.h"
 
 #include "BLI_sys_types.h"  // needed for intptr_t
@@ -144,6 +147,20 @@ LinkNode *BLO_blendhandle_get_datablock_names(BlendHandle *bh, int ofblocktype,
   BHead *bhead;
   int tot = 0;
 
+  if (fd->index) {
+    fd->index_lookups++;
+    for (int i = 0; i < fd->index->entries_len; i++) {
+      const BlendIndexEntry *entry = &fd->index->entries[i];
+      if (entry->code == ofblocktype) {
+        BLI_linklist_prepend(&names, strdup(entry->name + 2));
+        tot++;
+      }
+    }
+
+    *tot_names = tot;
+    return names;
+  }
+
   for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
     if (bhead->code == ofblocktype) {
       const char *idname = blo_bhead_id_name(fd, bhead);
@@ -160,6 +177,88 @@ LinkNode *BLO_blendhandle_get_datablock_names(BlendHandle *bh, int ofblocktype,
   return names;
 }
 
+/**
+ * Gets the names of the data-blocks directly used by a data-block
+ * (e.g. the mesh and materials of an object), only available from files saved with
+ * #G_FILE_INDEX_DEPS.
+ *
+ * \param bh: The blendhandle to access.
+ * \param ofblocktype: The type of the data-block.
+ * \param name: The name of the data-block (without the ID code).
+ * \param tot_names: The length of the returned list.
+ * \return A BLI_linklist of ID names (including the ID code).
+ * The string links should be freed with malloc.
+ */
+LinkNode *BLO_blendhandle_get_datablock_dependencies(BlendHandle *bh,
+                                                     int ofblocktype,
+                                                     const char *name,
+                                                     int *tot_names)
+{
+  FileData *fd = (FileData *)bh;
+  LinkNode *names = NULL;
+  int tot = 0;
+
+  if (fd->index) {
+    fd->index_lookups++;
+    for (int i = 0; i < fd->index->entries_len; i++) {
+      const BlendIndexEntry *entry = &fd->index->entries[i];
+      if (entry->code == ofblocktype && STREQ(entry->name + 2, name)) {
+        for (int j = 0; j < entry->deps_len; j++) {
+          const int entry_dep_index = fd->index->deps[entry->deps_start + j];
+          BLI_linklist_prepend(&names, strdup(fd->index->entries[entry_dep_index].name));
+          tot++;
+        }
+        break;
+      }
+    }
+  }
+
+  *tot_names = tot;
+  return names;
+}
+
+/**
+ * Read the preview stored at \a offset into \a new_prv,
+ * followed by the blocks of its images, see #BlendIndexEntry.preview_offset.
+ */
+static void blendhandle_preview_read_at(FileData *fd, off64_t offset, PreviewImage *new_prv)
+{
+  const char *rect_names[NUM_ICON_SIZES] = {"PreviewImage Icon Rect", "PreviewImage Image Rect"};
+  BHead *bhead = blo_bhead_read_at(fd, offset, &offset);
+
+  if (bhead == NULL) {
+    return;
+  }
+
+  if (bhead->code == DATA && bhead->SDNAnr == DNA_struct_find_nr(fd->filesdna, "PreviewImage")) {
+    PreviewImage *prv = BLO_library_read_struct(fd, bhead, "PreviewImage");
+    if (prv) {
+      memcpy(new_prv, prv, sizeof(PreviewImage));
+      for (int i = 0; i < NUM_ICON_SIZES; i++) {
+        BHead *bhead_rect = NULL;
+        if (prv->rect[i] && prv->w[i] && prv->h[i]) {
+          bhead_rect = blo_bhead_read_at(fd, offset, &offset);
+        }
+        if (bhead_rect && (prv->w[i] * prv->h[i] * sizeof(uint)) == (size_t)bhead_rect->len) {
+          new_prv->rect[i] = BLO_library_read_struct(fd, bhead_rect, rect_names[i]);
+        }
+        else {
+          /* This should not be needed, but can happen in 'broken' .blend files,
+           * better handle this gracefully than crashing. */
+          new_prv->rect[i] = NULL;
+          new_prv->w[i] = new_prv->h[i] = 0;
+        }
+        if (bhead_rect) {
+          blo_bhead_read_at_free(bhead_rect);
+        }
+      }
+      MEM_freeN(prv);
+    }
+  }
+
+  blo_bhead_read_at_free(bhead);
+}
+
 /**
  * Gets the previews of all the data-blocks in a file of a certain type
  * (e.g. all the scene previews in a file).
@@ -179,6 +278,25 @@ LinkNode *BLO_blendhandle_get_previews(BlendHandle *bh, int ofblocktype, int *to
   PreviewImage *new_prv = NULL;
   int tot = 0;
 
+  if (fd->index) {
+    fd->index_lookups++;
+    for (int i = 0; i < fd->index->entries_len; i++) {
+      const BlendIndexEntry *entry = &fd->index->entries[i];
+      if (entry->code == ofblocktype &&
+          ELEM(GS(entry->name), ID_MA, ID_TE, ID_IM, ID_WO, ID_LA, ID_OB, ID_GR, ID_SCE)) {
+        new_prv = MEM_callocN(sizeof(PreviewImage), "newpreview");
+        BLI_linklist_prepend(&previews, new_prv);
+        tot++;
+        if (entry->preview_offset != 0) {
+          blendhandle_preview_read_at(fd, (off64_t)entry->preview_offset, new_prv);
+        }
+      }
+    }
+
+    *tot_prev = tot;
+    return previews;
+  }
+
   for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
     if (bhead->code == ofblocktype) {
       const char *idname = blo_bhead_id_name(fd, bhead);
@@ -264,6 +382,24 @@ LinkNode *BLO_blendhandle_get_linkable_groups(BlendHandle *bh)
   LinkNode *names = NULL;
   BHead *bhead;
 
+  if (fd->index) {
+    fd->index_lookups++;
+    for (int i = 0; i < fd->index->entries_len; i++) {
+      const int code = fd->index->entries[i].code;
+      if (BKE_idtype_idcode_is_valid(code) && BKE_idtype_idcode_is_linkable(code)) {
+        const char *str = BKE_idtype_idcode_to_name(code);
+
+        if (BLI_gset_add(gathered, (void *)str)) {
+          BLI_linklist_prepend(&names, strdup(str));
+        }
+      }
+    }
+
+    BLI_gset_free(gathered, NULL);
+
+    return names;
+  }
+
   for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
     if (bhead->code == ENDB) {
       break;
@@ -284,6 +420,18 @@ LinkNode *BLO_blendhandle_get_linkable_groups(BlendHandle *bh)
   return names;
 }
 
+/**
+ * The number of queries answered from the index stored in the file, instead of scanning
+ * all its blocks. Zero for files without an index.
+ *
+ * \param bh: The blendhandle to access.
+ */
+int BLO_blendhandle_index_lookups(BlendHandle *bh)
+{
+  FileData *fd = (FileData *)bh;
+  return fd->index_lookups;
+}
+
 /**
  * Close and free a blendhandle. The handle becomes invalid after this call.
  *
@@ -313,11 +461,21 @@ BlendFileData *BLO_read_from_file(const char *filepath,
   BlendFileData *bfd = NULL;
   FileData *fd;
 
+  const bool use_profile = (G.debug & G_DEBUG_IO_PROFILE) != 0;
+  const double time_open = use_profile ? PIL_check_seconds_timer() : 0.0;
+
   fd = blo_filedata_from_file(filepath, reports);
   if (fd) {
     fd->reports = reports;
     fd->skip_flags = skip_flags;
+    if (use_profile) {
+      fd->profile = blo_read_profile_new();
+      blo_read_profile_phase_add(fd, BLO_READ_PHASE_OPEN, time_open);
+    }
     bfd = blo_read_file_internal(fd, filepath);
+    if (use_profile) {
+      blo_read_profile_print(fd, filepath);
+    }
     blo_filedata_free(fd);
   }
 
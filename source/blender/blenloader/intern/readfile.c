@@ -105,6 +105,8 @@
 #include "BLI_linklist.h"
 #include "BLI_math.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BLT_translation.h"
@@ -228,8 +230,9 @@
  * Delay reading blocks we might not use (especially applies to library linking).
  * which keeps large arrays in memory from data-blocks we may not even use.
  *
- * \note This is disabled when using compression,
+ * \note This is disabled when using compression without a seek table,
  * while zlib supports seek it's unusably slow, see: T61880.
+ * Files with a seek table are decompressed per frame, see #BLEN_GZIP_FRAME_SIZE.
  */
 #define USE_BHEAD_READ_ON_DEMAND
 
@@ -270,6 +273,9 @@ typedef struct BHeadN {
   bool has_data;
 #endif
   bool is_memchunk_identical;
+  /** Data read ahead of time by #read_file_data_prefetch, owned by the #BHeadN until
+   * #read_struct hands it over. */
+  void *data_read;
   struct BHead bhead;
 } BHeadN;
 
@@ -322,12 +328,22 @@ typedef struct OldNew {
   int nr;
 } OldNew;
 
+/**
+ * Slot of the hash table, the key is stored along with the index so probing
+ * only touches the slots (a single cache line in most cases).
+ */
+typedef struct OldNewSlot {
+  const void *oldp;
+  /** Index into #OldNewMap.entries, -1 when the slot is empty. */
+  int32_t index;
+} OldNewSlot;
+
 typedef struct OldNewMap {
   /* Array that stores the actual entries. */
   OldNew *entries;
   int nentries;
-  /* Hashmap that stores indices into the `entries` array. */
-  int32_t *map;
+  /* Open addressing hash table (linear probing), storing indices into the `entries` array. */
+  OldNewSlot *slots;
 
   int capacity_exp;
 } OldNewMap;
@@ -336,24 +352,30 @@ typedef struct OldNewMap {
 #define MAP_CAPACITY(onm) (1ll << ((onm)->capacity_exp + 1))
 #define SLOT_MASK(onm) (MAP_CAPACITY(onm) - 1)
 #define DEFAULT_SIZE_EXP 6
-#define PERTURB_SHIFT 5
-
-/* based on the probing algorithm used in Python dicts. */
-#define ITER_SLOTS(onm, KEY, SLOT_NAME, INDEX_NAME) \
-  uint32_t hash = BLI_ghashutil_ptrhash(KEY); \
-  uint32_t mask = SLOT_MASK(onm); \
-  uint perturb = hash; \
-  int SLOT_NAME = mask & hash; \
-  int INDEX_NAME = onm->map[SLOT_NAME]; \
-  for (;; SLOT_NAME = mask & ((5 * SLOT_NAME) + 1 + perturb), \
-          perturb >>= PERTURB_SHIFT, \
-          INDEX_NAME = onm->map[SLOT_NAME])
+
+/* Number of addresses looked up together in #oldnewmap_lookup_batch. */
+#define LOOKUP_BATCH_SIZE 16
+
+/**
+ * Fibonacci hashing, old addresses are aligned (low bits are zero)
+ * and often allocated close together, multiplying spreads them over all slots.
+ */
+BLI_INLINE uint oldnewmap_slot_first(const OldNewMap *onm, const void *ptr)
+{
+  const uint64_t hash = ((uint64_t)(uintptr_t)ptr >> 3) * 0x9E3779B97F4A7C15ull;
+  return (uint)(hash >> (64 - (onm->capacity_exp + 1)));
+}
+
+#define ITER_SLOTS(onm, KEY, SLOT_NAME) \
+  for (uint SLOT_NAME = oldnewmap_slot_first(onm, KEY);; \
+       SLOT_NAME = (SLOT_NAME + 1) & (uint)SLOT_MASK(onm))
 
 static void oldnewmap_insert_index_in_map(OldNewMap *onm, const void *ptr, int index)
 {
-  ITER_SLOTS (onm, ptr, slot, stored_index) {
-    if (stored_index == -1) {
-      onm->map[slot] = index;
+  ITER_SLOTS (onm, ptr, slot) {
+    if (onm->slots[slot].index == -1) {
+      onm->slots[slot].oldp = ptr;
+      onm->slots[slot].index = index;
       break;
     }
   }
@@ -361,51 +383,92 @@ static void oldnewmap_insert_index_in_map(OldNewMap *onm, const void *ptr, int i
 
 static void oldnewmap_insert_or_replace(OldNewMap *onm, OldNew entry)
 {
-  ITER_SLOTS (onm, entry.oldp, slot, index) {
-    if (index == -1) {
+  ITER_SLOTS (onm, entry.oldp, slot) {
+    OldNewSlot *map_slot = &onm->slots[slot];
+    if (map_slot->index == -1) {
       onm->entries[onm->nentries] = entry;
-      onm->map[slot] = onm->nentries;
+      map_slot->oldp = entry.oldp;
+      map_slot->index = onm->nentries;
       onm->nentries++;
       break;
     }
-    else if (onm->entries[index].oldp == entry.oldp) {
-      onm->entries[index] = entry;
+    else if (map_slot->oldp == entry.oldp) {
+      onm->entries[map_slot->index] = entry;
       break;
     }
   }
 }
 
-static OldNew *oldnewmap_lookup_entry(const OldNewMap *onm, const void *addr)
+BLI_INLINE OldNew *oldnewmap_lookup_entry_from_slot(const OldNewMap *onm,
+                                                    const void *addr,
+                                                    uint slot)
 {
-  ITER_SLOTS (onm, addr, slot, index) {
-    if (index >= 0) {
-      OldNew *entry = &onm->entries[index];
-      if (entry->oldp == addr) {
-        return entry;
-      }
+  for (;; slot = (slot + 1) & (uint)SLOT_MASK(onm)) {
+    const OldNewSlot *map_slot = &onm->slots[slot];
+    if (map_slot->oldp == addr && map_slot->index != -1) {
+      return &onm->entries[map_slot->index];
     }
-    else {
+    if (map_slot->index == -1) {
       return NULL;
     }
   }
 }
 
+static OldNew *oldnewmap_lookup_entry(const OldNewMap *onm, const void *addr)
+{
+  return oldnewmap_lookup_entry_from_slot(onm, addr, oldnewmap_slot_first(onm, addr));
+}
+
+/**
+ * Look up many addresses at once, first computing all their slots so their memory
+ * can be fetched in parallel, instead of waiting on each lookup in turn.
+ *
+ * \param r_entries: Filled with the entries for each of \a addrs (NULL when not found).
+ */
+static void oldnewmap_lookup_batch(const OldNewMap *onm,
+                                   const void **addrs,
+                                   OldNew **r_entries,
+                                   const int len)
+{
+  uint slots[LOOKUP_BATCH_SIZE];
+
+  for (int batch_start = 0; batch_start < len; batch_start += LOOKUP_BATCH_SIZE) {
+    const int batch_len = MIN2(len - batch_start, LOOKUP_BATCH_SIZE);
+    for (int i = 0; i < batch_len; i++) {
+      slots[i] = oldnewmap_slot_first(onm, addrs[batch_start + i]);
+#if defined(__GNUC__) || defined(__clang__)
+      __builtin_prefetch(&onm->slots[slots[i]]);
+#endif
+    }
+    for (int i = 0; i < batch_len; i++) {
+      const void *addr = addrs[batch_start + i];
+      r_entries[batch_start + i] = addr ? oldnewmap_lookup_entry_from_slot(onm, addr, slots[i]) :
+                                          NULL;
+    }
+  }
+}
+
 static void oldnewmap_clear_map(OldNewMap *onm)
 {
-  memset(onm->map, 0xFF, MAP_CAPACITY(onm) * sizeof(*onm->map));
+  memset(onm->slots, 0xFF, MAP_CAPACITY(onm) * sizeof(*onm->slots));
 }
 
-static void oldnewmap_increase_size(OldNewMap *onm)
+static void oldnewmap_resize(OldNewMap *onm, int capacity_exp)
 {
-  onm->capacity_exp++;
+  onm->capacity_exp = capacity_exp;
   onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * ENTRIES_CAPACITY(onm));
-  onm->map = MEM_reallocN(onm->map, sizeof(*onm->map) * MAP_CAPACITY(onm));
+  onm->slots = MEM_reallocN(onm->slots, sizeof(*onm->slots) * MAP_CAPACITY(onm));
   oldnewmap_clear_map(onm);
   for (int i = 0; i < onm->nentries; i++) {
     oldnewmap_insert_index_in_map(onm, onm->entries[i].oldp, i);
   }
 }
 
+static void oldnewmap_increase_size(OldNewMap *onm)
+{
+  oldnewmap_resize(onm, onm->capacity_exp + 1);
+}
+
 /* Public OldNewMap API */
 
 static OldNewMap *oldnewmap_new(void)
@@ -415,12 +478,27 @@ static OldNewMap *oldnewmap_new(void)
   onm->capacity_exp = DEFAULT_SIZE_EXP;
   onm->entries = MEM_malloc_arrayN(
       ENTRIES_CAPACITY(onm), sizeof(*onm->entries), "OldNewMap.entries");
-  onm->map = MEM_malloc_arrayN(MAP_CAPACITY(onm), sizeof(*onm->map), "OldNewMap.map");
+  onm->slots = MEM_malloc_arrayN(MAP_CAPACITY(onm), sizeof(*onm->slots), "OldNewMap.slots");
   oldnewmap_clear_map(onm);
 
   return onm;
 }
 
+/**
+ * Ensure \a len entries can be stored without growing the map,
+ * use when the number of entries is known (e.g. from the number of #BHead's).
+ */
+static void oldnewmap_reserve(OldNewMap *onm, int len)
+{
+  int capacity_exp = onm->capacity_exp;
+  while ((1ll << capacity_exp) < len) {
+    capacity_exp++;
+  }
+  if (capacity_exp != onm->capacity_exp) {
+    oldnewmap_resize(onm, capacity_exp);
+  }
+}
+
 static void oldnewmap_insert(OldNewMap *onm, const void *oldaddr, void *newaddr, int nr)
 {
   if (oldaddr == NULL || newaddr == NULL) {
@@ -455,6 +533,35 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, const void *addr, bool inc
   return entry->newp;
 }
 
+/**
+ * Replace all old addresses in \a array by their new address (in place),
+ * same as calling #oldnewmap_lookup_and_inc for each item, but faster for large arrays.
+ */
+static void oldnewmap_lookup_and_inc_array(OldNewMap *onm,
+                                           void **array,
+                                           const int len,
+                                           bool increase_users)
+{
+  OldNew *entries[LOOKUP_BATCH_SIZE];
+
+  for (int batch_start = 0; batch_start < len; batch_start += LOOKUP_BATCH_SIZE) {
+    const int batch_len = MIN2(len - batch_start, LOOKUP_BATCH_SIZE);
+    void **batch = &array[batch_start];
+    oldnewmap_lookup_batch(onm, (const void **)batch, entries, batch_len);
+    for (int i = 0; i < batch_len; i++) {
+      OldNew *entry = entries[i];
+      if (entry == NULL) {
+        batch[i] = NULL;
+        continue;
+      }
+      if (increase_users) {
+        entry->nr++;
+      }
+      batch[i] = entry->newp;
+    }
+  }
+}
+
 /* for libdata, OldNew.nr has ID code, no increment */
 static void *oldnewmap_liblookup(OldNewMap *onm, const void *addr, const void *lib)
 {
@@ -491,7 +598,7 @@ static void oldnewmap_clear(OldNewMap *onm)
 static void oldnewmap_free(OldNewMap *onm)
 {
   MEM_freeN(onm->entries);
-  MEM_freeN(onm->map);
+  MEM_freeN(onm->slots);
   MEM_freeN(onm);
 }
 
@@ -499,7 +606,7 @@ static void oldnewmap_free(OldNewMap *onm)
 #undef MAP_CAPACITY
 #undef SLOT_MASK
 #undef DEFAULT_SIZE_EXP
-#undef PERTURB_SHIFT
+#undef LOOKUP_BATCH_SIZE
 #undef ITER_SLOTS
 
 /** \} */
@@ -781,7 +888,12 @@ static void bh8_from_bh4(BHead *bhead, BHead4 *bhead4)
   }
 }
 
-static BHeadN *get_bhead(FileData *fd)
+/**
+ * Read the block at the current file offset.
+ *
+ * \param use_read_on_demand: Allow delaying reading the data, see #BHEAD_USE_READ_ON_DEMAND.
+ */
+static BHeadN *get_bhead_ex(FileData *fd, const bool use_read_on_demand)
 {
   BHeadN *new_bhead = NULL;
   int readsize;
@@ -860,7 +972,7 @@ static BHeadN *get_bhead(FileData *fd)
         /* pass */
       }
 #ifdef USE_BHEAD_READ_ON_DEMAND
-      else if (fd->seek != NULL && BHEAD_USE_READ_ON_DEMAND(&bhead)) {
+      else if (use_read_on_demand && fd->seek != NULL && BHEAD_USE_READ_ON_DEMAND(&bhead)) {
         /* Delay reading bhead content. */
         new_bhead = MEM_mallocN(sizeof(BHeadN), "new_bhead");
         if (new_bhead) {
@@ -868,6 +980,7 @@ static BHeadN *get_bhead(FileData *fd)
           new_bhead->file_offset = fd->file_offset;
           new_bhead->has_data = false;
           new_bhead->is_memchunk_identical = false;
+          new_bhead->data_read = NULL;
           new_bhead->bhead = bhead;
           off64_t seek_new = fd->seek(fd, bhead.len, SEEK_CUR);
           if (seek_new == -1) {
@@ -891,6 +1004,7 @@ static BHeadN *get_bhead(FileData *fd)
           new_bhead->has_data = true;
 #endif
           new_bhead->is_memchunk_identical = false;
+          new_bhead->data_read = NULL;
           new_bhead->bhead = bhead;
 
           readsize = fd->read(fd, new_bhead + 1, bhead.len, &new_bhead->is_memchunk_identical);
@@ -908,6 +1022,17 @@ static BHeadN *get_bhead(FileData *fd)
     }
   }
 
+#ifndef USE_BHEAD_READ_ON_DEMAND
+  UNUSED_VARS(use_read_on_demand);
+#endif
+
+  return new_bhead;
+}
+
+static BHeadN *get_bhead(FileData *fd)
+{
+  BHeadN *new_bhead = get_bhead_ex(fd, true);
+
   /* We've read a new block. Now add it to the list
    * of blocks.
    */
@@ -972,6 +1097,46 @@ BHead *blo_bhead_next(FileData *fd, BHead *thisblock)
   return bhead;
 }
 
+/**
+ * Read the block at \a offset including its data, without adding it to the list of blocks,
+ * used to access blocks through #FileData.index. Free with #blo_bhead_read_at_free.
+ *
+ * \param r_offset_next: Return the offset of the next block (optional).
+ */
+BHead *blo_bhead_read_at(FileData *fd, off64_t offset, off64_t *r_offset_next)
+{
+  BHeadN *new_bhead = NULL;
+
+  if (fd->seek == NULL) {
+    return NULL;
+  }
+
+  const off64_t offset_backup = fd->file_offset;
+  const bool is_eof_backup = fd->is_eof;
+
+  fd->is_eof = false;
+  if (fd->seek(fd, offset, SEEK_SET) != -1) {
+    new_bhead = get_bhead_ex(fd, false);
+    if (new_bhead && r_offset_next) {
+      *r_offset_next = fd->file_offset;
+    }
+  }
+
+  fd->is_eof = is_eof_backup;
+  if (fd->seek(fd, offset_backup, SEEK_SET) == -1) {
+    fd->is_eof = true;
+  }
+
+  return new_bhead ? &new_bhead->bhead : NULL;
+}
+
+void blo_bhead_read_at_free(BHead *bhead)
+{
+  BHeadN *new_bhead = BHEADN_FROM_BHEAD(bhead);
+  BLI_assert(new_bhead->next == NULL && new_bhead->prev == NULL);
+  MEM_freeN(new_bhead);
+}
+
 #ifdef USE_BHEAD_READ_ON_DEMAND
 static bool blo_bhead_read_data(FileData *fd, BHead *thisblock, void *buf)
 {
@@ -1002,6 +1167,7 @@ static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
   new_bhead_data->file_offset = new_bhead->file_offset;
   new_bhead_data->has_data = true;
   new_bhead_data->is_memchunk_identical = false;
+  new_bhead_data->data_read = NULL;
   if (!blo_bhead_read_data(fd, thisblock, new_bhead_data + 1)) {
     MEM_freeN(new_bhead_data);
     return NULL;
@@ -1056,6 +1222,27 @@ static void decode_blender_header(FileData *fd)
   }
 }
 
+static bool read_file_dna_from_bhead(FileData *fd,
+                                     BHead *bhead,
+                                     const int subversion,
+                                     const char **r_error_message)
+{
+  const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
+
+  fd->filesdna = DNA_sdna_from_data(&bhead[1], bhead->len, do_endian_swap, true, r_error_message);
+  if (fd->filesdna) {
+    blo_do_versions_dna(fd->filesdna, fd->fileversion, subversion);
+    fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
+    /* used to retrieve ID names from (bhead+1) */
+    fd->id_name_offs = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
+
+    return true;
+  }
+  else {
+    return false;
+  }
+}
+
 /**
  * \return Success if the file is read correctly, else set \a r_error_message.
  */
@@ -1081,21 +1268,7 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
       subversion = atoi(num);
     }
     else if (bhead->code == DNA1) {
-      const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
-
-      fd->filesdna = DNA_sdna_from_data(
-          &bhead[1], bhead->len, do_endian_swap, true, r_error_message);
-      if (fd->filesdna) {
-        blo_do_versions_dna(fd->filesdna, fd->fileversion, subversion);
-        fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
-        /* used to retrieve ID names from (bhead+1) */
-        fd->id_name_offs = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
-
-        return true;
-      }
-      else {
-        return false;
-      }
+      return read_file_dna_from_bhead(fd, bhead, subversion, r_error_message);
     }
     else if (bhead->code == ENDB) {
       break;
@@ -1106,6 +1279,138 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
   return false;
 }
 
+static BlendFileIndex *read_file_index_from_bhead(FileData *fd,
+                                                  const BHead *bhead,
+                                                  BlendIndexHeader *r_header)
+{
+  const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
+
+  if (bhead->code != DATA || bhead->len < (int)(sizeof(*r_header) + sizeof(BlendIndexFooter))) {
+    return NULL;
+  }
+
+  const char *data = (const char *)&bhead[1];
+  memcpy(r_header, data, sizeof(*r_header));
+  if (do_endian_swap) {
+    BLI_endian_switch_int32_array(&r_header->version, 4);
+    BLI_endian_switch_uint64(&r_header->dna_offset);
+  }
+
+  if (r_header->version != BLEN_INDEX_VERSION || r_header->entries_len < 0 ||
+      r_header->deps_len < 0 ||
+      (size_t)bhead->len != sizeof(*r_header) +
+                                sizeof(BlendIndexEntry) * (size_t)r_header->entries_len +
+                                sizeof(int) * (size_t)r_header->deps_len +
+                                sizeof(BlendIndexFooter)) {
+    return NULL;
+  }
+
+  const size_t entries_size = sizeof(BlendIndexEntry) * (size_t)r_header->entries_len;
+  const size_t deps_size = sizeof(int) * (size_t)r_header->deps_len;
+  BlendFileIndex *index = MEM_mallocN(sizeof(*index) + entries_size + deps_size, __func__);
+  index->entries_len = r_header->entries_len;
+  index->deps_len = r_header->deps_len;
+  index->entries = (BlendIndexEntry *)&index[1];
+  index->deps = (int *)POINTER_OFFSET(index->entries, entries_size);
+  memcpy(index->entries, data + sizeof(*r_header), entries_size);
+  memcpy(index->deps, data + sizeof(*r_header) + entries_size, deps_size);
+
+  if (do_endian_swap) {
+    for (int i = 0; i < index->entries_len; i++) {
+      BlendIndexEntry *entry = &index->entries[i];
+      BLI_endian_switch_int32_array(&entry->code, 4);
+      BLI_endian_switch_uint64(&entry->offset);
+      BLI_endian_switch_uint64(&entry->preview_offset);
+    }
+    BLI_endian_switch_int32_array(index->deps, index->deps_len);
+  }
+
+  /* Don't trust the file, everything is used without further checks. */
+  bool is_valid = true;
+  for (int i = 0; i < index->entries_len && is_valid; i++) {
+    BlendIndexEntry *entry = &index->entries[i];
+    entry->name[sizeof(entry->name) - 1] = '\0';
+    if (entry->deps_start < 0 || entry->deps_len < 0 ||
+        entry->deps_len > index->deps_len - entry->deps_start) {
+      is_valid = false;
+    }
+  }
+  for (int i = 0; i < index->deps_len && is_valid; i++) {
+    if (index->deps[i] < 0 || index->deps[i] >= index->entries_len) {
+      is_valid = false;
+    }
+  }
+
+  if (!is_valid) {
+    MEM_freeN(index);
+    return NULL;
+  }
+  return index;
+}
+
+/**
+ * Read the index of the file (see #BlendIndexHeader) and the DNA from the offset it stores,
+ * so opening a file doesn't need to walk all of its blocks.
+ *
+ * \return false when the file has no (valid) index, #read_file_dna must be used instead.
+ */
+static bool read_file_index(FileData *fd)
+{
+  if (fd->seek == NULL) {
+    return false;
+  }
+
+  const off64_t offset_backup = fd->file_offset;
+  const size_t bhead_size = (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) ? sizeof(BHead4) :
+                                                                         sizeof(BHead8);
+  BlendIndexFooter footer;
+  const off64_t footer_offset = fd->seek(fd, -(off64_t)(bhead_size + sizeof(footer)), SEEK_END);
+  bool found = false;
+  if ((footer_offset != -1) && (fd->read(fd, &footer, sizeof(footer), NULL) == sizeof(footer)) &&
+      (memcmp(footer.magic, BLEN_INDEX_MAGIC, sizeof(footer.magic)) == 0)) {
+    if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+      BLI_endian_switch_uint64(&footer.offset);
+    }
+    found = (footer.offset >= SIZEOFBLENDERHEADER) &&
+            (footer.offset + bhead_size < (uint64_t)footer_offset);
+  }
+  if (fd->seek(fd, offset_backup, SEEK_SET) == -1) {
+    return false;
+  }
+  if (!found) {
+    return false;
+  }
+
+  BlendIndexHeader header;
+  BlendFileIndex *index = NULL;
+  BHead *bhead = blo_bhead_read_at(fd, (off64_t)footer.offset, NULL);
+  if (bhead) {
+    index = read_file_index_from_bhead(fd, bhead, &header);
+    blo_bhead_read_at_free(bhead);
+  }
+  if (index == NULL) {
+    return false;
+  }
+
+  bool success = false;
+  bhead = blo_bhead_read_at(fd, (off64_t)header.dna_offset, NULL);
+  if (bhead) {
+    const char *error_message = NULL;
+    if (bhead->code == DNA1) {
+      success = read_file_dna_from_bhead(fd, bhead, header.subversion, &error_message);
+    }
+    blo_bhead_read_at_free(bhead);
+  }
+
+  if (success) {
+    fd->index = index;
+  }
+  else {
+    MEM_freeN(index);
+  }
+  return success;
+}
+
 static int *read_file_thumbnail(FileData *fd)
 {
   BHead *bhead;
@@ -1177,6 +1482,69 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+/* Memory-mapped file reading. */
+
+static int fd_read_from_mmap(FileData *filedata,
+                             void *buffer,
+                             uint size,
+                             bool *UNUSED(r_is_memchunck_identical))
+{
+  /* Don't read more bytes than there are available in the file. */
+  const size_t length = BLI_mmap_get_length(filedata->mmap_file);
+  const size_t offset = (size_t)filedata->file_offset;
+  const size_t readsize = (offset < length) ? MIN2((size_t)size, length - offset) : 0;
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, offset, readsize)) {
+    return EOF;
+  }
+  filedata->file_offset += readsize;
+
+  return (int)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  const off64_t length = (off64_t)BLI_mmap_get_length(filedata->mmap_file);
+  switch (whence) {
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      offset += filedata->file_offset;
+      break;
+    case SEEK_END:
+      offset += length;
+      break;
+    default:
+      return -1;
+  }
+  if (offset < 0 || offset > length) {
+    return -1;
+  }
+  filedata->file_offset = offset;
+  return offset;
+}
+
+/**
+ * Data of blocks not read yet, directly from the memory-mapped file (avoids a copy).
+ *
+ * \return NULL when the data isn't available from a mapping,
+ * the caller must check #BLI_mmap_any_io_error after accessing it.
+ */
+static const void *blo_bhead_data_mapped(FileData *fd, BHead *thisblock)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
+  if (fd->mmap_file != NULL && new_bhead->has_data == false &&
+      (size_t)new_bhead->file_offset + (size_t)thisblock->len <=
+          BLI_mmap_get_length(fd->mmap_file)) {
+    return POINTER_OFFSET(BLI_mmap_get_pointer(fd->mmap_file), new_bhead->file_offset);
+  }
+#else
+  UNUSED_VARS(fd, thisblock);
+#endif
+  return NULL;
+}
+
 /* GZip file reading. */
 
 static int fd_read_gzip_from_file(FileData *filedata,
@@ -1196,6 +1564,279 @@ static int fd_read_gzip_from_file(FileData *filedata,
   return (readsize);
 }
 
+/* Framed GZip file reading, see #BLEN_GZIP_FRAME_SIZE. */
+
+typedef struct FileDataGzipFrame {
+  /** Index of the frame stored in #data, -1 when unused. */
+  int frame;
+  char *data;
+  /** Set when decompression failed. */
+  bool error;
+} FileDataGzipFrame;
+
+typedef struct FileDataGzipFrames {
+  int frames_len;
+  /** Compressed & uncompressed offset of each frame (plus one for the end of the data). */
+  int64_t *offset_compressed;
+  int64_t *offset_data;
+
+  /** Decompressed frames, filled in parallel when reading sequentially. */
+  FileDataGzipFrame *cache;
+  int cache_len;
+  /** Cache slot of the frame last read from. */
+  int cache_active;
+
+  /** Serialize file access from decompression tasks. */
+  ThreadMutex file_mutex;
+  int filedes;
+} FileDataGzipFrames;
+
+static uint fd_gzip_uint32_from_le(const uchar bytes[4])
+{
+  return (uint)bytes[0] | ((uint)bytes[1] << 8) | ((uint)bytes[2] << 16) | ((uint)bytes[3] << 24);
+}
+
+/**
+ * Load the seek table of a framed gzip file.
+ * \return NULL when the file has no (valid) seek table.
+ */
+static FileDataGzipFrames *fd_gzip_frames_from_file(int file)
+{
+  uchar footer[BLEN_GZIP_SEEK_TABLE_FOOTER_SIZE + BLEN_GZIP_SEEK_TABLE_TRAILER_SIZE];
+  const off64_t file_len = BLI_lseek(file, 0, SEEK_END);
+  FileDataGzipFrames *gzframes = NULL;
+
+  if ((file_len < (off64_t)(BLEN_GZIP_SEEK_TABLE_HEADER_SIZE + sizeof(footer))) ||
+      (BLI_lseek(file, file_len - (off64_t)sizeof(footer), SEEK_SET) == -1) ||
+      (read(file, footer, sizeof(footer)) != sizeof(footer)) ||
+      (memcmp(footer + 4, BLEN_GZIP_SEEK_TABLE_MAGIC, 4) != 0)) {
+    BLI_lseek(file, 0, SEEK_SET);
+    return NULL;
+  }
+
+  const uint frames_len = fd_gzip_uint32_from_le(footer);
+  const size_t table_len = BLEN_GZIP_SEEK_TABLE_HEADER_SIZE + (size_t)frames_len * 8;
+  if ((frames_len == 0) || (frames_len > BLEN_GZIP_SEEK_TABLE_FRAMES_MAX) ||
+      (file_len < (off64_t)(table_len + sizeof(footer)))) {
+    BLI_lseek(file, 0, SEEK_SET);
+    return NULL;
+  }
+
+  uchar *table = MEM_mallocN(table_len, __func__);
+  const off64_t table_offset = file_len - (off64_t)(table_len + sizeof(footer));
+  if ((BLI_lseek(file, table_offset, SEEK_SET) != -1) &&
+      (read(file, table, table_len) == (int)table_len) &&
+      /* Gzip magic, extra field flag & seek table sub-field ID. */
+      (table[0] == 0x1f && table[1] == 0x8b && (table[3] & 4)) &&
+      (memcmp(&table[12], BLEN_GZIP_SEEK_TABLE_SUBFIELD_ID, 2) == 0)) {
+    gzframes = MEM_callocN(sizeof(*gzframes), __func__);
+    gzframes->frames_len = (int)frames_len;
+    gzframes->offset_compressed = MEM_mallocN(sizeof(int64_t) * (frames_len + 1), __func__);
+    gzframes->offset_data = MEM_mallocN(sizeof(int64_t) * (frames_len + 1), __func__);
+    gzframes->offset_compressed[0] = 0;
+    gzframes->offset_data[0] = 0;
+
+    const uchar *entry = &table[BLEN_GZIP_SEEK_TABLE_HEADER_SIZE];
+    for (uint i = 0; i < frames_len; i++, entry += 8) {
+      const uint len_compressed = fd_gzip_uint32_from_le(entry);
+      const uint len_data = fd_gzip_uint32_from_le(entry + 4);
+      gzframes->offset_compressed[i + 1] = gzframes->offset_compressed[i] + len_compressed;
+      gzframes->offset_data[i + 1] = gzframes->offset_data[i] + len_data;
+      if (len_data > BLEN_GZIP_FRAME_SIZE) {
+        gzframes->offset_compressed[frames_len] = -1;
+        break;
+      }
+    }
+
+    /* Frames must exactly fill the space before the seek table. */
+    if (gzframes->offset_compressed[frames_len] != table_offset) {
+      MEM_freeN(gzframes->offset_compressed);
+      MEM_freeN(gzframes->offset_data);
+      MEM_freeN(gzframes);
+      gzframes = NULL;
+    }
+  }
+  MEM_freeN(table);
+
+  if (gzframes != NULL) {
+    gzframes->cache_len = max_ii(2, BLI_system_thread_count());
+    gzframes->cache = MEM_mallocN(sizeof(*gzframes->cache) * gzframes->cache_len, __func__);
+    for (int i = 0; i < gzframes->cache_len; i++) {
+      gzframes->cache[i].frame = -1;
+      gzframes->cache[i].data = NULL;
+      gzframes->cache[i].error = false;
+    }
+    BLI_mutex_init(&gzframes->file_mutex);
+    gzframes->filedes = file;
+  }
+
+  BLI_lseek(file, 0, SEEK_SET);
+  return gzframes;
+}
+
+static void fd_gzip_frames_free(FileDataGzipFrames *gzframes)
+{
+  for (int i = 0; i < gzframes->cache_len; i++) {
+    MEM_SAFE_FREE(gzframes->cache[i].data);
+  }
+  MEM_freeN(gzframes->cache);
+  MEM_freeN(gzframes->offset_compressed);
+  MEM_freeN(gzframes->offset_data);
+  BLI_mutex_end(&gzframes->file_mutex);
+  MEM_freeN(gzframes);
+}
+
+static void fd_gzip_frame_decompress_task(TaskPool *__restrict pool, void *taskdata)
+{
+  FileDataGzipFrames *gzframes = BLI_task_pool_user_data(pool);
+  FileDataGzipFrame *cache_frame = taskdata;
+  const int frame = cache_frame->frame;
+  const size_t len_compressed = (size_t)(gzframes->offset_compressed[frame + 1] -
+                                         gzframes->offset_compressed[frame]);
+  const size_t len_data = (size_t)(gzframes->offset_data[frame + 1] -
+                                   gzframes->offset_data[frame]);
+
+  cache_frame->error = true;
+  if (cache_frame->data == NULL) {
+    cache_frame->data = MEM_mallocN(BLEN_GZIP_FRAME_SIZE, __func__);
+  }
+
+  char *buf_compressed = MEM_mallocN(len_compressed, __func__);
+  bool read_ok;
+  BLI_mutex_lock(&gzframes->file_mutex);
+  read_ok = (BLI_lseek(gzframes->filedes, gzframes->offset_compressed[frame], SEEK_SET) != -1) &&
+            ((size_t)read(gzframes->filedes, buf_compressed, len_compressed) == len_compressed);
+  BLI_mutex_unlock(&gzframes->file_mutex);
+
+  if (read_ok) {
+    z_stream strm = {NULL};
+    if (inflateInit2(&strm, 16 + MAX_WBITS) == Z_OK) {
+      strm.next_in = (Bytef *)buf_compressed;
+      strm.avail_in = (uInt)len_compressed;
+      strm.next_out = (Bytef *)cache_frame->data;
+      strm.avail_out = BLEN_GZIP_FRAME_SIZE;
+      if ((inflate(&strm, Z_FINISH) == Z_STREAM_END) && (strm.total_out == len_data)) {
+        cache_frame->error = false;
+      }
+      inflateEnd(&strm);
+    }
+  }
+  MEM_freeN(buf_compressed);
+}
+
+/**
+ * Ensure \a frame is decompressed.
+ * When it's not, it's decompressed along with the following frames (in parallel),
+ * since the file is mostly read sequentially.
+ *
+ * \return The cache slot holding the frame or -1 on failure.
+ */
+static int fd_gzip_frames_cache_ensure(FileDataGzipFrames *gzframes, const int frame)
+{
+  FileDataGzipFrame *cache = gzframes->cache;
+  const int cache_active = gzframes->cache_active;
+
+  for (int i = 0; i < gzframes->cache_len; i++) {
+    if (cache[i].frame == frame) {
+      return cache[i].error ? -1 : i;
+    }
+  }
+
+  /* Keep the frame last read from, a block may be re-read right after reading past it. */
+  TaskPool *task_pool = BLI_task_pool_create(gzframes, TASK_PRIORITY_HIGH);
+  int result = -1;
+  int frame_next = frame;
+  for (int i = 0; i < gzframes->cache_len && frame_next < gzframes->frames_len; i++) {
+    if (i == cache_active && cache[i].frame != -1) {
+      continue;
+    }
+    if (frame_next == frame) {
+      result = i;
+    }
+    cache[i].frame = frame_next++;
+    BLI_task_pool_push(task_pool, fd_gzip_frame_decompress_task, &cache[i], false, NULL);
+  }
+  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_pool_free(task_pool);
+
+  return (result != -1 && !cache[result].error) ? result : -1;
+}
+
+static int fd_read_gzip_frames_from_file(FileData *filedata,
+                                         void *buffer,
+                                         uint size,
+                                         bool *UNUSED(r_is_memchunck_identical))
+{
+  FileDataGzipFrames *gzframes = filedata->gzframes;
+  const int64_t *offset_data = gzframes->offset_data;
+  int64_t offset = filedata->file_offset;
+  uint readsize = 0;
+
+  if (offset < 0) {
+    return EOF;
+  }
+
+  /* Find the frame containing the current offset. */
+  int frame = gzframes->cache[gzframes->cache_active].frame;
+  if (frame == -1 || offset < offset_data[frame] || offset >= offset_data[frame + 1]) {
+    int low = 0, high = gzframes->frames_len;
+    while (high - low > 1) {
+      const int mid = (low + high) / 2;
+      if (offset_data[mid] <= offset) {
+        low = mid;
+      }
+      else {
+        high = mid;
+      }
+    }
+    frame = low;
+  }
+
+  while (readsize < size && frame < gzframes->frames_len) {
+    const int cache_index = fd_gzip_frames_cache_ensure(gzframes, frame);
+    if (cache_index == -1) {
+      return EOF;
+    }
+    gzframes->cache_active = cache_index;
+
+    const int64_t frame_offset = offset - offset_data[frame];
+    const uint len = (uint)MIN2((int64_t)(size - readsize),
+                                offset_data[frame + 1] - offset_data[frame] - frame_offset);
+    memcpy(POINTER_OFFSET(buffer, readsize),
+           gzframes->cache[cache_index].data + frame_offset,
+           len);
+    readsize += len;
+    offset += len;
+    frame++;
+  }
+
+  filedata->file_offset = offset;
+  return (int)readsize;
+}
+
+static off64_t fd_seek_gzip_frames_from_file(FileData *filedata, off64_t offset, int whence)
+{
+  const int64_t offset_end = filedata->gzframes->offset_data[filedata->gzframes->frames_len];
+  switch (whence) {
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      offset += filedata->file_offset;
+      break;
+    case SEEK_END:
+      offset += offset_end;
+      break;
+    default:
+      return -1;
+  }
+  if (offset < 0 || offset > offset_end) {
+    return -1;
+  }
+  /* Nothing to do until the next read, frames are decompressed on demand. */
+  filedata->file_offset = offset;
+  return offset;
+}
+
 /* Memory reading. */
 
 static int fd_read_from_memory(FileData *filedata,
@@ -1204,7 +1845,8 @@ static int fd_read_from_memory(FileData *filedata,
                                bool *UNUSED(r_is_memchunck_identical))
 {
   /* don't read more bytes then there are available in the buffer */
-  int readsize = (int)MIN2(size, (uint)(filedata->buffersize - filedata->file_offset));
+  const int readsize = (int)MIN2((size_t)size,
+                                 filedata->buffersize - (size_t)filedata->file_offset);
 
   memcpy(buffer, filedata->buffer + filedata->file_offset, readsize);
   filedata->file_offset += readsize;
@@ -1312,7 +1954,7 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 
   if (fd->flags & FD_FLAGS_FILE_OK) {
     const char *error_message = NULL;
-    if (read_file_dna(fd, &error_message) == false) {
+    if ((read_file_index(fd) == false) && (read_file_dna(fd, &error_message) == false)) {
       BKE_reportf(
           reports, RPT_ERROR, "Failed to read blend file '%s': %s", fd->relabase, error_message);
       blo_filedata_free(fd);
@@ -1337,6 +1979,10 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  FileDataGzipFrames *gzframes = NULL;
+  BLI_mmap_file *mmap_file = NULL;
+  void *buffer = NULL;
+  size_t buffer_size = 0;
 
   char header[7];
 
@@ -1356,8 +2002,16 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   /* Regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+    /* Map the file, so blocks which aren't used are never read. */
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    else {
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
   }
 
   /* Gzip file. */
@@ -1365,8 +2019,13 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   if ((read_fn == NULL) &&
       /* Check header magic. */
       (header[0] == 0x1f && header[1] == 0x8b)) {
-    gzfile = BLI_gzopen(filepath, "rb");
-    if (gzfile == (gzFile)Z_NULL) {
+    /* Files with a seek table support seeking & are decompressed in parallel. */
+    gzframes = fd_gzip_frames_from_file(file);
+    if (gzframes != NULL) {
+      read_fn = fd_read_gzip_frames_from_file;
+      seek_fn = fd_seek_gzip_frames_from_file;
+    }
+    else if ((gzfile = BLI_gzopen(filepath, "rb")) == (gzFile)Z_NULL) {
       BKE_reportf(reports,
                   RPT_WARNING,
                   "Unable to open '%s': %s",
@@ -1382,6 +2041,22 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     }
   }
 
+  /* Journal file, written by incremental auto-save. */
+  if ((read_fn == NULL) && STREQLEN(header, BLO_MEMFILE_JOURNAL_MAGIC, sizeof(header))) {
+    buffer = BLO_memfile_journal_read(file, &buffer_size);
+    if (buffer == NULL) {
+      BKE_reportf(reports,
+                  RPT_WARNING,
+                  "Unable to read '%s': %s",
+                  filepath,
+                  TIP_("invalid or incomplete journal"));
+      return NULL;
+    }
+    read_fn = fd_read_from_memory;
+    /* Caller must close. */
+    file = -1;
+  }
+
   if (read_fn == NULL) {
     BKE_reportf(reports, RPT_WARNING, "Unrecognized file format '%s'", filepath);
     return NULL;
@@ -1391,6 +2066,10 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->gzframes = gzframes;
+  fd->mmap_file = mmap_file;
+  fd->buffer = buffer;
+  fd->buffersize = buffer_size;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1458,15 +2137,22 @@ static int fd_read_gzip_from_memory(FileData *filedata,
   filedata->strm.next_out = (Bytef *)buffer;
   filedata->strm.avail_out = size;
 
-  // Inflate another chunk.
-  err = inflate(&filedata->strm, Z_SYNC_FLUSH);
+  while (filedata->strm.avail_out != 0) {
+    // Inflate another chunk.
+    err = inflate(&filedata->strm, Z_SYNC_FLUSH);
 
-  if (err == Z_STREAM_END) {
-    return 0;
-  }
-  else if (err != Z_OK) {
-    printf("fd_read_gzip_from_memory: zlib error\n");
-    return 0;
+    if (err == Z_STREAM_END) {
+      /* Compressed files may consist of multiple gzip members, see #BLEN_GZIP_FRAME_SIZE. */
+      if (filedata->strm.avail_in >= 2 && filedata->strm.next_in[0] == 0x1f &&
+          filedata->strm.next_in[1] == 0x8b && inflateReset(&filedata->strm) == Z_OK) {
+        continue;
+      }
+      return 0;
+    }
+    else if (err != Z_OK) {
+      printf("fd_read_gzip_from_memory: zlib error\n");
+      return 0;
+    }
   }
 
   filedata->file_offset += size;
@@ -1478,7 +2164,7 @@ static int fd_read_gzip_from_memory_init(FileData *fd)
 {
 
   fd->strm.next_in = (Bytef *)fd->buffer;
-  fd->strm.avail_in = fd->buffersize;
+  fd->strm.avail_in = (uInt)fd->buffersize;
   fd->strm.total_out = 0;
   fd->strm.zalloc = Z_NULL;
   fd->strm.zfree = Z_NULL;
@@ -1553,6 +2239,14 @@ void blo_filedata_free(FileData *fd)
       gzclose(fd->gzfiledes);
     }
 
+    if (fd->gzframes != NULL) {
+      fd_gzip_frames_free(fd->gzframes);
+    }
+
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+
     if (fd->strm.next_in) {
       if (inflateEnd(&fd->strm) != Z_OK) {
         printf("close gzip stream error\n");
@@ -1564,6 +2258,13 @@ void blo_filedata_free(FileData *fd)
       fd->buffer = NULL;
     }
 
+    /* Free data read ahead of time which was never used (from skipped data-blocks). */
+    LISTBASE_FOREACH (BHeadN *, new_bhead, &fd->bhead_list) {
+      if (new_bhead->data_read) {
+        MEM_freeN(new_bhead->data_read);
+      }
+    }
+
     /* Free all BHeadN data blocks */
 #ifndef NDEBUG
     BLI_freelistN(&fd->bhead_list);
@@ -1577,6 +2278,14 @@ void blo_filedata_free(FileData *fd)
     }
 #endif
 
+    if (fd->index) {
+      MEM_freeN(fd->index);
+    }
+
+    if (fd->profile && !(fd->flags & FD_FLAGS_NOT_MY_PROFILE)) {
+      blo_read_profile_free(fd->profile);
+    }
+
     if (fd->filesdna) {
       DNA_sdna_free(fd->filesdna);
     }
@@ -1774,6 +2483,12 @@ static void *newdataadr_no_us(FileData *fd, const void *adr)
   return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
 }
 
+/* only direct databocks, remaps an array of pointers in place */
+static void newdataadr_array(FileData *fd, void **array, const int len)
+{
+  oldnewmap_lookup_and_inc_array(fd->datamap, array, len, true);
+}
+
 /* direct datablocks with global linking */
 static void *newglobadr(FileData *fd, const void *adr)
 {
@@ -2322,6 +3037,14 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
   void *temp = NULL;
 
   if (bh->len) {
+    BHeadN *new_bhead = BHEADN_FROM_BHEAD(bh);
+    if (new_bhead->data_read) {
+      /* Already read, see #read_file_data_prefetch. */
+      temp = new_bhead->data_read;
+      new_bhead->data_read = NULL;
+      return temp;
+    }
+
 #ifdef USE_BHEAD_READ_ON_DEMAND
     BHead *bh_orig = bh;
 #endif
@@ -2341,7 +3064,18 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
     }
 
     if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
-      if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+      const void *data_mapped = NULL;
+      if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL &&
+          (data_mapped = blo_bhead_data_mapped(fd, bh))) {
+        /* Reconstruct directly from the mapped file, without an intermediate copy. */
+        temp = DNA_struct_reconstruct(
+            fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, data_mapped);
+        if (UNLIKELY(BLI_mmap_any_io_error(fd->mmap_file))) {
+          fd->flags &= ~FD_FLAGS_FILE_OK;
+          MEM_SAFE_FREE(temp);
+        }
+      }
+      else if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
 #ifdef USE_BHEAD_READ_ON_DEMAND
         if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
           bh = blo_bhead_read_full(fd, bh);
@@ -4767,8 +5501,6 @@ static void direct_link_partdeflect(PartDeflect *pd)
 
 static void direct_link_particlesettings(FileData *fd, ParticleSettings *part)
 {
-  int a;
-
   part->adt = newdataadr(fd, part->adt);
   part->pd = newdataadr(fd, part->pd);
   part->pd2 = newdataadr(fd, part->pd2);
@@ -4810,9 +5542,7 @@ static void direct_link_particlesettings(FileData *fd, ParticleSettings *part)
       link_list(fd, &state->actions);
     }
   }
-  for (a = 0; a < MAX_MTEX; a++) {
-    part->mtex[a] = newdataadr(fd, part->mtex[a]);
-  }
+  newdataadr_array(fd, (void **)part->mtex, MAX_MTEX);
 
   /* Protect against integer overflow vulnerability. */
   CLAMP(part->trail_count, 1, 100000);
@@ -5061,7 +5791,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
       layer->flag &= ~CD_FLAG_IN_MEMORY;
     }
 
-    layer->flag &= ~CD_FLAG_NOFREE;
+    layer->flag &= ~(CD_FLAG_NOFREE | CD_FLAG_SHARED);
 
     if (CustomData_verify_versions(data, i)) {
       layer->data = newdataadr(fd, layer->data);
@@ -6200,10 +6930,7 @@ static void direct_link_object(FileData *fd, Object *ob)
     sb->keys = newdataadr(fd, sb->keys);
     test_pointer_array(fd, (void **)&sb->keys);
     if (sb->keys) {
-      int a;
-      for (a = 0; a < sb->totkey; a++) {
-        sb->keys[a] = newdataadr(fd, sb->keys[a]);
-      }
+      newdataadr_array(fd, (void **)sb->keys, sb->totkey);
     }
 
     sb->effector_weights = newdataadr(fd, sb->effector_weights);
@@ -8709,12 +9436,10 @@ static void direct_link_moviePlaneTracks(FileData *fd, ListBase *plane_tracks_ba
   link_list(fd, plane_tracks_base);
 
   for (plane_track = plane_tracks_base->first; plane_track; plane_track = plane_track->next) {
-    int i;
-
     plane_track->point_tracks = newdataadr(fd, plane_track->point_tracks);
     test_pointer_array(fd, (void **)&plane_track->point_tracks);
-    for (i = 0; i < plane_track->point_tracksnr; i++) {
-      plane_track->point_tracks[i] = newdataadr(fd, plane_track->point_tracks[i]);
+    if (plane_track->point_tracks) {
+      newdataadr_array(fd, (void **)plane_track->point_tracks, plane_track->point_tracksnr);
     }
 
     plane_track->markers = newdataadr(fd, plane_track->markers);
@@ -9106,7 +9831,6 @@ static void direct_link_linestyle_geometry_modifier(FileData *UNUSED(fd),
 
 static void direct_link_linestyle(FileData *fd, FreestyleLineStyle *linestyle)
 {
-  int a;
   LineStyleModifier *modifier;
 
   linestyle->adt = newdataadr(fd, linestyle->adt);
@@ -9127,9 +9851,7 @@ static void direct_link_linestyle(FileData *fd, FreestyleLineStyle *linestyle)
   for (modifier = linestyle->geometry_modifiers.first; modifier; modifier = modifier->next) {
     direct_link_linestyle_geometry_modifier(fd, modifier);
   }
-  for (a = 0; a < MAX_MTEX; a++) {
-    linestyle->mtex[a] = newdataadr(fd, linestyle->mtex[a]);
-  }
+  newdataadr_array(fd, (void **)linestyle->mtex, MAX_MTEX);
 }
 
 /** \} */
@@ -9519,6 +10241,14 @@ static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *all
 {
   bhead = blo_bhead_next(fd, bhead);
 
+  /* Avoid growing the map one step at a time for data-blocks with a lot of data. */
+  int data_len = 0;
+  for (BHead *bhead_iter = bhead; bhead_iter && bhead_iter->code == DATA;
+       bhead_iter = blo_bhead_next(fd, bhead_iter)) {
+    data_len++;
+  }
+  oldnewmap_reserve(fd->datamap, data_len);
+
   while (bhead && bhead->code == DATA) {
     void *data;
 #if 0
@@ -9542,6 +10272,144 @@ static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *all
   return bhead;
 }
 
+typedef struct ReadDataPrefetchData {
+  FileData *fd;
+  BHead **bheads;
+  const char **allocnames;
+} ReadDataPrefetchData;
+
+static void read_file_data_prefetch_cb(void *__restrict userdata,
+                                       const int i,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ReadDataPrefetchData *data = userdata;
+  FileData *fd = data->fd;
+  BHead *bh = data->bheads[i];
+  BHeadN *new_bhead = BHEADN_FROM_BHEAD(bh);
+  const void *bh_data = new_bhead->has_data ? (const void *)(bh + 1) :
+                                              blo_bhead_data_mapped(fd, bh);
+
+  if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+    new_bhead->data_read = DNA_struct_reconstruct(
+        fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, bh_data);
+  }
+  else {
+    new_bhead->data_read = MEM_mallocN(bh->len, data->allocnames[i]);
+    memcpy(new_bhead->data_read, bh_data, bh->len);
+  }
+}
+
+/* Bytes of data read ahead of #read_libblock at most, to keep the peak memory close to reading
+ * one data-block at a time. */
+#define PREFETCH_WINDOW_SIZE (64 * 1024 * 1024)
+
+/* True when the data following \a bhead is read by #read_libblock, see #blo_read_file_internal. */
+static bool read_file_data_prefetch_code_is_read(const int code)
+{
+  return (BKE_idtype_idcode_is_valid(code) || code == ID_SCRN) && code != ID_LINK_PLACEHOLDER;
+}
+
+/**
+ * Reserve the library map for all IDs, before reading them.
+ * Returns false when data can't be prefetched, see #read_file_data_prefetch.
+ */
+static bool read_file_data_prefetch_init(FileData *fd)
+{
+  int ids_len = 0;
+  for (BHead *bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
+    if (bhead->code == ENDB) {
+      break;
+    }
+    if (bhead->code != DATA) {
+      /* Close enough estimate, other blocks are few. */
+      ids_len++;
+    }
+  }
+
+  /* All IDs get added to the library map, avoid growing it one step at a time. */
+  oldnewmap_reserve(fd->libmap, ids_len);
+
+  /* Rare case, structs would need to be copied to be switched first. */
+  return (fd->flags & FD_FLAGS_SWITCH_ENDIAN) == 0;
+}
+
+/**
+ * Read (and reconstruct) the data of the data-blocks starting at \a bhead_start in parallel,
+ * ahead of #read_libblock, which then only has to link the data (and remains single threaded).
+ * Only data of data-blocks which are read is prefetched, up to #PREFETCH_WINDOW_SIZE bytes.
+ *
+ * This is only done when the data can be accessed from multiple threads,
+ * that is when it's already in memory or memory-mapped.
+ *
+ * \return The block to prefetch the next window from, NULL when done.
+ */
+static BHead *read_file_data_prefetch(FileData *fd, BHead *bhead_start)
+{
+  /* Gather the blocks of whole data-blocks, until the window is full. */
+  BHead **bheads = NULL;
+  const char **allocnames = NULL;
+  int bheads_len = 0, bheads_len_alloc = 0;
+  size_t window_size = 0;
+  const char *allocname = NULL;
+  BHead *bhead = bhead_start;
+  for (; bhead; bhead = blo_bhead_next(fd, bhead)) {
+    if (bhead->code == ENDB) {
+      bhead = NULL;
+      break;
+    }
+    if (bhead->code != DATA) {
+      if (window_size >= PREFETCH_WINDOW_SIZE) {
+        break;
+      }
+      /* Use the same allocation names as #read_libblock, skip data which isn't read. */
+      allocname = read_file_data_prefetch_code_is_read(bhead->code) ? dataname(bhead->code) :
+                                                                      NULL;
+      continue;
+    }
+    if (allocname == NULL || bhead->len == 0 ||
+        fd->compflags[bhead->SDNAnr] == SDNA_CMP_REMOVED) {
+      continue;
+    }
+    if (!BHEADN_FROM_BHEAD(bhead)->has_data && blo_bhead_data_mapped(fd, bhead) == NULL) {
+      continue;
+    }
+    if (bheads_len == bheads_len_alloc) {
+      bheads_len_alloc = MAX2(1024, bheads_len_alloc * 2);
+      bheads = MEM_reallocN(bheads, sizeof(*bheads) * (size_t)bheads_len_alloc);
+      allocnames = MEM_reallocN(allocnames, sizeof(*allocnames) * (size_t)bheads_len_alloc);
+    }
+    bheads[bheads_len] = bhead;
+    allocnames[bheads_len] = allocname;
+    bheads_len++;
+    window_size += (size_t)bhead->len;
+  }
+
+  if (bheads_len == 0) {
+    return bhead;
+  }
+
+  ReadDataPrefetchData data = {
+      .fd = fd,
+      .bheads = bheads,
+      .allocnames = allocnames,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, bheads_len, &data, read_file_data_prefetch_cb, &settings);
+
+  if (fd->mmap_file && BLI_mmap_any_io_error(fd->mmap_file)) {
+    /* Leave it to #read_struct to report the error. */
+    for (int i = 0; i < bheads_len; i++) {
+      MEM_SAFE_FREE(BHEADN_FROM_BHEAD(bheads[i])->data_read);
+    }
+  }
+
+  MEM_freeN(bheads);
+  MEM_freeN(allocnames);
+  return bhead;
+}
+
 /* Verify if the datablock and all associated data is identical. */
 static bool read_libblock_is_identical(FileData *fd, BHead *bhead)
 {
@@ -9806,6 +10674,8 @@ static BHead *read_libblock(FileData *fd,
     }
   }
 
+  const double time_read = blo_read_profile_time(fd);
+
   /* Read libblock struct. */
   ID *id = read_struct(fd, bhead, "lib block");
   if (id == NULL) {
@@ -9859,17 +10729,31 @@ static BHead *read_libblock(FileData *fd,
       }
     }
 
+    const double time_direct_link = blo_read_profile_time(fd);
     direct_link_id(fd, main, id_tag, id, id_old);
+    if (fd->profile) {
+      blo_read_profile_id_add(fd, idcode, (size_t)bhead->len, time_read, time_direct_link);
+    }
     return blo_bhead_next(fd, bhead);
   }
 
   /* Read datablock contents.
    * Use convenient malloc name for debugging and better memory link prints. */
   const char *allocname = dataname(idcode);
+  BHead *bhead_id = bhead;
   bhead = read_data_into_datamap(fd, bhead, allocname);
+  const double time_direct_link = blo_read_profile_time(fd);
   const bool success = direct_link_id(fd, main, id_tag, id, id_old);
   oldnewmap_clear(fd->datamap);
 
+  if (fd->profile) {
+    size_t size = 0;
+    for (BHead *bh = bhead_id; bh && bh != bhead; bh = blo_bhead_next(fd, bh)) {
+      size += (size_t)bh->len;
+    }
+    blo_read_profile_id_add(fd, idcode, size, time_read, time_direct_link);
+  }
+
   if (!success) {
     /* XXX This is probably working OK currently given the very limited scope of that flag.
      * However, it is absolutely **not** handled correctly: it is freeing an ID pointer that has
@@ -10078,6 +10962,8 @@ static void lib_link_all(FileData *fd, Main *bmain)
       continue;
     }
 
+    const double time_lib_link = blo_read_profile_time(fd);
+
     lib_link_id(fd, bmain, id);
 
     /* Note: ID types are processed in reverse order as defined by INDEX_ID_XXX enums in DNA_ID.h.
@@ -10212,6 +11098,10 @@ static void lib_link_all(FileData *fd, Main *bmain)
         break;
     }
 
+    if (fd->profile) {
+      blo_read_profile_id_lib_link_add(fd, GS(id->name), time_lib_link);
+    }
+
     id->tag &= ~LIB_TAG_NEED_LINK;
   }
   FOREACH_MAIN_ID_END;
@@ -10399,7 +11289,25 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  double time_phase = blo_read_profile_time(fd);
+  /* The next block to prefetch data from, this always is a block which isn't #DATA,
+   * those are all visited by the loop below. */
+  BHead *bhead_prefetch = NULL;
+  if ((fd->memfile == NULL) && (fd->skip_flags & BLO_READ_SKIP_DATA) == 0 &&
+      read_file_data_prefetch_init(fd)) {
+    bhead_prefetch = read_file_data_prefetch(fd, bhead);
+  }
+  blo_read_profile_phase_add(fd, BLO_READ_PHASE_PREFETCH, time_phase);
+
+  time_phase = blo_read_profile_time(fd);
   while (bhead) {
+    if (bhead == bhead_prefetch) {
+      const double time_prefetch = blo_read_profile_time(fd);
+      bhead_prefetch = read_file_data_prefetch(fd, bhead);
+      blo_read_profile_phase_add(fd, BLO_READ_PHASE_PREFETCH, time_prefetch);
+      /* Not part of the read phase. */
+      time_phase += blo_read_profile_time(fd) - time_prefetch;
+    }
     switch (bhead->code) {
       case DATA:
       case DNA1:
@@ -10450,7 +11358,10 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  blo_read_profile_phase_add(fd, BLO_READ_PHASE_READ, time_phase);
+
   /* do before read_libraries, but skip undo case */
+  time_phase = blo_read_profile_time(fd);
   if (fd->memfile == NULL) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
       do_versions(fd, NULL, bfd->main);
@@ -10460,13 +11371,18 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
       do_versions_userdef(fd, bfd);
     }
   }
+  blo_read_profile_phase_add(fd, BLO_READ_PHASE_VERSIONING, time_phase);
 
   if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+    time_phase = blo_read_profile_time(fd);
     read_libraries(fd, &mainlist);
 
     blo_join_main(&mainlist);
+    blo_read_profile_phase_add(fd, BLO_READ_PHASE_LIBRARIES, time_phase);
 
+    time_phase = blo_read_profile_time(fd);
     lib_link_all(fd, bfd->main);
+    blo_read_profile_phase_add(fd, BLO_READ_PHASE_LIB_LINK, time_phase);
 
     /* Skip in undo case. */
     if (fd->memfile == NULL) {
@@ -10477,21 +11393,30 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
        * from groups to collections... We could optimize out that first call when we are reading a
        * current version file, but again this is really not a bottle neck currently.
        * So not worth it. */
+      time_phase = blo_read_profile_time(fd);
       BKE_main_id_refcount_recompute(bfd->main, false);
+      blo_read_profile_phase_add(fd, BLO_READ_PHASE_REFCOUNT, time_phase);
 
       /* Yep, second splitting... but this is a very cheap operation, so no big deal. */
+      time_phase = blo_read_profile_time(fd);
       blo_split_main(&mainlist, bfd->main);
       LISTBASE_FOREACH (Main *, mainvar, &mainlist) {
         BLI_assert(mainvar->versionfile != 0);
         do_versions_after_linking(mainvar, fd->reports);
       }
       blo_join_main(&mainlist);
+      blo_read_profile_phase_add(fd, BLO_READ_PHASE_VERSIONING_AFTER_LINKING, time_phase);
 
       /* And we have to compute those user-reference-counts again, as `do_versions_after_linking()`
        * does not always properly handle user counts, and/or that function does not take into
        * account old, deprecated data. */
+      time_phase = blo_read_profile_time(fd);
       BKE_main_id_refcount_recompute(bfd->main, false);
+      blo_read_profile_phase_add(fd, BLO_READ_PHASE_REFCOUNT, time_phase);
+    }
 
+    time_phase = blo_read_profile_time(fd);
+    if (fd->memfile == NULL) {
       /* After all data has been read and versioned, uses LIB_TAG_NEW. */
       ntreeUpdateAllNew(bfd->main);
     }
@@ -10513,6 +11438,7 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     fix_relpaths_library(fd->relabase, bfd->main);
 
     link_global(fd, bfd); /* as last */
+    blo_read_profile_phase_add(fd, BLO_READ_PHASE_FINALIZE, time_phase);
   }
 
   fd->mainlist = NULL; /* Safety, this is local variable, shall not be used afterward. */
@@ -12512,43 +13438,63 @@ static void read_library_clear_weak_links(FileData *basefd, ListBase *mainlist,
   }
 }
 
-static FileData *read_library_file_data(FileData *basefd,
-                                        ListBase *mainlist,
-                                        Main *mainl,
-                                        Main *mainptr)
+/**
+ * Open the file of a library and read its header & DNA.
+ * Doesn't access any shared data, so this can run in parallel for different libraries.
+ */
+static FileData *read_library_file_data_open(Library *lib, ReportList *reports)
 {
-  FileData *fd = mainptr->curlib->filedata;
+  FileData *fd;
 
-  if (fd != NULL) {
-    /* File already open. */
-    return fd;
+  if (lib->packedfile) {
+    /* Read packed file. */
+    PackedFile *pf = lib->packedfile;
+    fd = blo_filedata_from_memory(pf->data, pf->size, reports);
+
+    /* Needed for library_append and read_libraries. */
+    if (fd) {
+      BLI_strncpy(fd->relabase, lib->filepath, sizeof(fd->relabase));
+    }
+  }
+  else {
+    /* Read file on disk. */
+    fd = blo_filedata_from_file(lib->filepath, reports);
   }
 
-  if (mainptr->curlib->packedfile) {
-    /* Read packed file. */
-    PackedFile *pf = mainptr->curlib->packedfile;
+#ifdef USE_GHASH_BHEAD
+  if (fd) {
+    read_file_bhead_idname_map_create(fd);
+  }
+#endif
+
+  return fd;
+}
 
+static void read_library_file_data_report_open(FileData *basefd, Library *lib)
+{
+  if (lib->packedfile) {
     blo_reportf_wrap(basefd->reports,
                      RPT_INFO,
                      TIP_("Read packed library:  '%s', parent '%s'"),
-                     mainptr->curlib->name,
-                     library_parent_filepath(mainptr->curlib));
-    fd = blo_filedata_from_memory(pf->data, pf->size, basefd->reports);
-
-    /* Needed for library_append and read_libraries. */
-    BLI_strncpy(fd->relabase, mainptr->curlib->filepath, sizeof(fd->relabase));
+                     lib->name,
+                     library_parent_filepath(lib));
   }
   else {
-    /* Read file on disk. */
     blo_reportf_wrap(basefd->reports,
                      RPT_INFO,
                      TIP_("Read library:  '%s', '%s', parent '%s'"),
-                     mainptr->curlib->filepath,
-                     mainptr->curlib->name,
-                     library_parent_filepath(mainptr->curlib));
-    fd = blo_filedata_from_file(mainptr->curlib->filepath, basefd->reports);
+                     lib->filepath,
+                     lib->name,
+                     library_parent_filepath(lib));
   }
+}
 
+/**
+ * Attach the file data opened by #read_library_file_data_open to its library.
+ */
+static FileData *read_library_file_data_init(
+    FileData *basefd, ListBase *mainlist, Main *mainl, Main *mainptr, FileData *fd)
+{
   if (fd) {
     /* Share the mainlist, so all libraries are added immediately in a
      * single list. It used to be that all FileData's had their own list,
@@ -12558,6 +13504,11 @@ static FileData *read_library_file_data(FileData *basefd,
 
     fd->reports = basefd->reports;
 
+    if (basefd->profile) {
+      fd->profile = basefd->profile;
+      fd->flags |= FD_FLAGS_NOT_MY_PROFILE;
+    }
+
     if (fd->libmap) {
       oldnewmap_free(fd->libmap);
     }
@@ -12569,9 +13520,6 @@ static FileData *read_library_file_data(FileData *basefd,
 
     /* subversion */
     read_file_version(fd, mainptr);
-#ifdef USE_GHASH_BHEAD
-    read_file_bhead_idname_map_create(fd);
-#endif
   }
   else {
     mainptr->curlib->filedata = NULL;
@@ -12589,6 +13537,96 @@ static FileData *read_library_file_data(FileData *basefd,
   return fd;
 }
 
+static FileData *read_library_file_data(FileData *basefd,
+                                        ListBase *mainlist,
+                                        Main *mainl,
+                                        Main *mainptr)
+{
+  FileData *fd = mainptr->curlib->filedata;
+
+  if (fd != NULL) {
+    /* File already open. */
+    return fd;
+  }
+
+  read_library_file_data_report_open(basefd, mainptr->curlib);
+  fd = read_library_file_data_open(mainptr->curlib, basefd->reports);
+
+  return read_library_file_data_init(basefd, mainlist, mainl, mainptr, fd);
+}
+
+typedef struct LibraryOpenTask {
+  Main *mainptr;
+  FileData *fd;
+  /** Reports of the task, passed on in order once all tasks are done. */
+  ReportList reports;
+} LibraryOpenTask;
+
+static void read_library_file_data_open_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  LibraryOpenTask *task = taskdata;
+  task->fd = read_library_file_data_open(task->mainptr->curlib, &task->reports);
+}
+
+static bool read_library_file_data_needs_open(Main *mainptr, GSet *libraries_opened)
+{
+  return (mainptr->curlib->filedata == NULL) &&
+         !BLI_gset_haskey(libraries_opened, mainptr->curlib) && has_linked_ids_to_read(mainptr);
+}
+
+/**
+ * Open the files of \a mainptr_first and all libraries after it which have linked IDs to read,
+ * in parallel. Opening and parsing a file (header, DNA and block index) is what takes time,
+ * the results are then attached to the libraries in list order, so reading stays deterministic.
+ *
+ * \param libraries_opened: Libraries which were opened (or failed to) already, updated here.
+ */
+static void read_library_file_data_open_all(FileData *basefd,
+                                            ListBase *mainlist,
+                                            Main *mainl,
+                                            Main *mainptr_first,
+                                            GSet *libraries_opened)
+{
+  int tasks_len = 0;
+  for (Main *mainptr = mainptr_first; mainptr; mainptr = mainptr->next) {
+    if (read_library_file_data_needs_open(mainptr, libraries_opened)) {
+      tasks_len++;
+    }
+  }
+
+  if (tasks_len < 2) {
+    read_library_file_data(basefd, mainlist, mainl, mainptr_first);
+    BLI_gset_add(libraries_opened, mainptr_first->curlib);
+    return;
+  }
+
+  LibraryOpenTask *tasks = MEM_calloc_arrayN(tasks_len, sizeof(*tasks), __func__);
+  TaskPool *task_pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+  int i = 0;
+  for (Main *mainptr = mainptr_first; mainptr; mainptr = mainptr->next) {
+    if (read_library_file_data_needs_open(mainptr, libraries_opened)) {
+      LibraryOpenTask *task = &tasks[i++];
+      task->mainptr = mainptr;
+      BKE_reports_init(&task->reports, RPT_STORE);
+      BLI_task_pool_push(task_pool, read_library_file_data_open_task, task, false, NULL);
+    }
+  }
+  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_pool_free(task_pool);
+
+  for (i = 0; i < tasks_len; i++) {
+    LibraryOpenTask *task = &tasks[i];
+    read_library_file_data_report_open(basefd, task->mainptr->curlib);
+    LISTBASE_FOREACH (Report *, report, &task->reports.list) {
+      BKE_report(basefd->reports, report->type, report->message);
+    }
+    BKE_reports_clear(&task->reports);
+    read_library_file_data_init(basefd, mainlist, mainl, task->mainptr, task->fd);
+    BLI_gset_add(libraries_opened, task->mainptr->curlib);
+  }
+  MEM_freeN(tasks);
+}
+
 static void read_libraries(FileData *basefd, ListBase *mainlist)
 {
   Main *mainl = mainlist->first;
@@ -12597,6 +13635,8 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
   /* Expander is now callback function. */
   BLO_main_expander(expand_doit_library);
 
+  GSet *libraries_opened = BLI_gset_ptr_new(__func__);
+
   /* At this point the base blend file has been read, and each library blend
    * encountered so far has a main with placeholders for linked data-blocks.
    *
@@ -12618,8 +13658,12 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 					mainptr->curlib->name);
 #endif
 
-        /* Open file if it has not been done yet. */
-        FileData *fd = read_library_file_data(basefd, mainlist, mainl, mainptr);
+        /* Open file if it has not been done yet, together with the files of all following
+         * libraries which need to be opened too. Missing files are only tried once. */
+        if (read_library_file_data_needs_open(mainptr, libraries_opened)) {
+          read_library_file_data_open_all(basefd, mainlist, mainl, mainptr, libraries_opened);
+        }
+        FileData *fd = mainptr->curlib->filedata;
 
         if (fd) {
           do_it = true;
@@ -12636,6 +13680,8 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
     }
   }
 
+  BLI_gset_free(libraries_opened, NULL);
+
   Main *main_newid = BKE_main_new();
   for (Main *mainptr = mainl->next; mainptr; mainptr = mainptr->next) {
     /* Drop weak links for which no data-block was found. */
@@ -30,6 +30,10 @@
 #include "DNA_windowmanager_types.h" /* for ReportType */
 #include "zlib.h"
 
+struct BLI_mmap_file;
+struct BlendFileIndex;
+struct BlendReadProfile;
+struct FileDataGzipFrames;
 struct GSet;
 struct IDNameLib_Map;
 struct Key;
@@ -50,6 +54,8 @@ enum eFileDataFlag {
   FD_FLAGS_NOT_MY_BUFFER = 1 << 4,
   /* XXX Unused in practice (checked once but never set). */
   FD_FLAGS_NOT_MY_LIBMAP = 1 << 5,
+  /** The profile is owned by the file linking this library. */
+  FD_FLAGS_NOT_MY_PROFILE = 1 << 6,
 };
 
 /* Disallow since it's 32bit on ms-windows. */
@@ -72,7 +78,8 @@ typedef struct FileData {
   ListBase bhead_list;
   enum eFileDataFlag flags;
   bool is_eof;
-  int buffersize;
+  /** Size of #buffer, can be over 2GB for journals read into memory. */
+  size_t buffersize;
   int64_t file_offset;
 
   FileDataReadFn *read;
@@ -80,6 +87,8 @@ typedef struct FileData {
 
   /** Regular file reading. */
   int filedes;
+  /** Memory-mapped regular file, read using #filedes when mapping fails. */
+  struct BLI_mmap_file *mmap_file;
 
   /** Variables needed for reading from memory / stream. */
   const char *buffer;
@@ -91,6 +100,8 @@ typedef struct FileData {
 
   /** Variables needed for reading from file. */
   gzFile gzfiledes;
+  /** Gzip files with a seek table, read using #filedes. */
+  struct FileDataGzipFrames *gzframes;
   /** Gzip stream for memory decompression. */
   z_stream strm;
 
@@ -128,6 +139,14 @@ typedef struct FileData {
   /** See: #USE_GHASH_BHEAD. */
   struct GHash *bhead_idname_hash;
 
+  /** Index of the ID blocks stored in the file (NULL when the file has none). */
+  struct BlendFileIndex *index;
+  /** Number of queries answered from the index, see #BLO_blendhandle_index_lookups. */
+  int index_lookups;
+
+  /** Timing of reading, only set when profiling (see #G_DEBUG_IO_PROFILE). */
+  struct BlendReadProfile *profile;
+
   ListBase *mainlist;
   /** Used for undo. */
   ListBase *old_mainlist;
@@ -138,6 +157,118 @@ typedef struct FileData {
 
 #define SIZEOFBLENDERHEADER 12
 
+/**
+ * Compressed files are written as a sequence of gzip members ("frames"), each holding
+ * #BLEN_GZIP_FRAME_SIZE bytes of uncompressed data (the last one may be smaller),
+ * so they can be compressed and decompressed independently.
+ *
+ * They are followed by an empty gzip member storing a seek table in its extra field:
+ * - header (#BLEN_GZIP_SEEK_TABLE_HEADER_SIZE): gzip header, `XLEN`,
+ *   sub-field ID (#BLEN_GZIP_SEEK_TABLE_SUBFIELD_ID) and length.
+ * - compressed & uncompressed size of each frame (`uint32` pairs, little endian).
+ * - footer (#BLEN_GZIP_SEEK_TABLE_FOOTER_SIZE): number of frames and #BLEN_GZIP_SEEK_TABLE_MAGIC.
+ * - trailer (#BLEN_GZIP_SEEK_TABLE_TRAILER_SIZE): empty deflate block, `CRC32` and `ISIZE`.
+ *
+ * Readers unaware of the seek table read the file as a regular gzip stream.
+ */
+#define BLEN_GZIP_FRAME_SIZE (1 << 21)
+#define BLEN_GZIP_SEEK_TABLE_MAGIC "BLSK"
+#define BLEN_GZIP_SEEK_TABLE_SUBFIELD_ID "BF"
+#define BLEN_GZIP_SEEK_TABLE_HEADER_SIZE 16
+#define BLEN_GZIP_SEEK_TABLE_FOOTER_SIZE 8
+#define BLEN_GZIP_SEEK_TABLE_TRAILER_SIZE 10
+/** Limited by the maximum size of the gzip extra field. */
+#define BLEN_GZIP_SEEK_TABLE_FRAMES_MAX ((0xffff - 4 - BLEN_GZIP_SEEK_TABLE_FOOTER_SIZE) / 8)
+
+/**
+ * Files (not undo steps) store an index of their ID blocks, so their contents can be listed
+ * without walking all blocks of the file. It's written as a #DATA block (ignored by readers
+ * unaware of it) between #DNA1 and #ENDB:
+ * - header (#BlendIndexHeader).
+ * - entries (#BlendIndexEntry), one for each ID block, including libraries & link placeholders.
+ * - dependencies (`int32`), the indices of the entries used by each entry.
+ * - footer (#BlendIndexFooter), found right before #ENDB at the end of the file.
+ *
+ * Values are stored in the byte order of the file, offsets are in the uncompressed data.
+ */
+#define BLEN_INDEX_MAGIC "BLENDIDX"
+#define BLEN_INDEX_VERSION 1
+
+typedef struct BlendIndexHeader {
+  int version;
+  /** File sub-version, needed to version the DNA without reading #GLOB. */
+  int subversion;
+  int entries_len;
+  int deps_len;
+  /** Offset of the #DNA1 block. */
+  uint64_t dna_offset;
+} BlendIndexHeader;
+
+typedef struct BlendIndexEntry {
+  /** #BHead.code of the block. */
+  int code;
+  /** Range of this entry in the dependencies. */
+  int deps_start;
+  int deps_len;
+  int _pad;
+  /** Offset of the ID block. */
+  uint64_t offset;
+  /** Offset of the #PreviewImage block, zero when the ID has no preview. */
+  uint64_t preview_offset;
+  /** #ID.name (including the ID code). */
+  char name[66];
+  char _pad1[6];
+} BlendIndexEntry;
+
+typedef struct BlendIndexFooter {
+  /** Offset of the #DATA block holding the index. */
+  uint64_t offset;
+  char magic[8];
+} BlendIndexFooter;
+
+/** Index read from a file, see #FileData.index. */
+typedef struct BlendFileIndex {
+  int entries_len;
+  int deps_len;
+  BlendIndexEntry *entries;
+  int *deps;
+} BlendFileIndex;
+
+/** Phases of reading a file, see #BlendReadProfile. */
+typedef enum eBlendReadPhase {
+  /** Opening the file, reading the header & DNA. */
+  BLO_READ_PHASE_OPEN = 0,
+  /** Reconstructing data ahead of time, see #read_file_data_prefetch. */
+  BLO_READ_PHASE_PREFETCH,
+  /** Reading the IDs and their data, direct linking. */
+  BLO_READ_PHASE_READ,
+  BLO_READ_PHASE_VERSIONING,
+  /** Reading linked IDs (including reading, versioning & linking of libraries). */
+  BLO_READ_PHASE_LIBRARIES,
+  BLO_READ_PHASE_LIB_LINK,
+  /** Recomputing the ID user counts. */
+  BLO_READ_PHASE_REFCOUNT,
+  BLO_READ_PHASE_VERSIONING_AFTER_LINKING,
+  /** Everything else, updating node trees, overrides, collections... */
+  BLO_READ_PHASE_FINALIZE,
+} eBlendReadPhase;
+#define BLO_READ_PHASE_NUM (BLO_READ_PHASE_FINALIZE + 1)
+
+/* readfile_profile.c */
+struct BlendReadProfile *blo_read_profile_new(void);
+void blo_read_profile_free(struct BlendReadProfile *profile);
+double blo_read_profile_time(const FileData *fd);
+void blo_read_profile_phase_add(FileData *fd,
+                                const eBlendReadPhase phase,
+                                const double time_start);
+void blo_read_profile_id_add(FileData *fd,
+                             const short idcode,
+                             const size_t size,
+                             const double time_start,
+                             const double time_direct_link);
+void blo_read_profile_id_lib_link_add(FileData *fd, const short idcode, const double time_start);
+void blo_read_profile_print(const FileData *fd, const char *filepath);
+
 /***/
 struct Main;
 void blo_join_main(ListBase *mainlist);
@@ -172,6 +303,8 @@ void blo_filedata_free(FileData *fd);
 BHead *blo_bhead_first(FileData *fd);
 BHead *blo_bhead_next(FileData *fd, BHead *thisblock);
 BHead *blo_bhead_prev(FileData *fd, BHead *thisblock);
+BHead *blo_bhead_read_at(FileData *fd, off64_t offset, off64_t *r_offset_next);
+void blo_bhead_read_at_free(BHead *bhead);
 
 const char *blo_bhead_id_name(const FileData *fd, const BHead *bhead);
 
@@ -0,0 +1,179 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Timing of reading a .blend file, per phase and per ID type (see `--debug-io-profile`).
+ * Reports are printed as JSON, so they can be compared & processed by scripts.
+ */
+
+#include <stdio.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_ID.h"
+
+#include "BKE_idtype.h"
+
+#include "BLO_readfile.h"
+
+#include "PIL_time.h"
+
+#include "readfile.h"
+
+typedef struct BlendReadProfileIDType {
+  int count;
+  /** Size of the ID and its data in the file. */
+  size_t size;
+  double time_read;
+  double time_direct_link;
+  double time_lib_link;
+} BlendReadProfileIDType;
+
+typedef struct BlendReadProfile {
+  double time_phase[BLO_READ_PHASE_NUM];
+  BlendReadProfileIDType id_types[INDEX_ID_MAX];
+} BlendReadProfile;
+
+static const char *read_profile_phase_names[BLO_READ_PHASE_NUM] = {
+    [BLO_READ_PHASE_OPEN] = "open",
+    [BLO_READ_PHASE_PREFETCH] = "prefetch",
+    [BLO_READ_PHASE_READ] = "read",
+    [BLO_READ_PHASE_VERSIONING] = "versioning",
+    [BLO_READ_PHASE_LIBRARIES] = "libraries",
+    [BLO_READ_PHASE_LIB_LINK] = "lib_link",
+    [BLO_READ_PHASE_REFCOUNT] = "refcount",
+    [BLO_READ_PHASE_VERSIONING_AFTER_LINKING] = "versioning_after_linking",
+    [BLO_READ_PHASE_FINALIZE] = "finalize",
+};
+
+BlendReadProfile *blo_read_profile_new(void)
+{
+  return MEM_callocN(sizeof(BlendReadProfile), __func__);
+}
+
+void blo_read_profile_free(BlendReadProfile *profile)
+{
+  MEM_freeN(profile);
+}
+
+/**
+ * \return The current time when profiling, to pass to the other profiling functions.
+ */
+double blo_read_profile_time(const FileData *fd)
+{
+  return fd->profile ? PIL_check_seconds_timer() : 0.0;
+}
+
+void blo_read_profile_phase_add(FileData *fd,
+                                const eBlendReadPhase phase,
+                                const double time_start)
+{
+  if (fd->profile) {
+    fd->profile->time_phase[phase] += PIL_check_seconds_timer() - time_start;
+  }
+}
+
+static BlendReadProfileIDType *read_profile_id_type(FileData *fd, const short idcode)
+{
+  const int index = BKE_idtype_idcode_to_index(idcode);
+  if (index < 0 || index >= INDEX_ID_MAX) {
+    return NULL;
+  }
+  return &fd->profile->id_types[index];
+}
+
+/**
+ * Add an ID read from the file.
+ *
+ * \param time_start: When reading the ID started.
+ * \param time_direct_link: When direct linking started (after reading its data).
+ */
+void blo_read_profile_id_add(FileData *fd,
+                             const short idcode,
+                             const size_t size,
+                             const double time_start,
+                             const double time_direct_link)
+{
+  BlendReadProfileIDType *id_type = read_profile_id_type(fd, idcode);
+  if (id_type) {
+    id_type->count++;
+    id_type->size += size;
+    id_type->time_read += time_direct_link - time_start;
+    id_type->time_direct_link += PIL_check_seconds_timer() - time_direct_link;
+  }
+}
+
+void blo_read_profile_id_lib_link_add(FileData *fd, const short idcode, const double time_start)
+{
+  BlendReadProfileIDType *id_type = read_profile_id_type(fd, idcode);
+  if (id_type) {
+    id_type->time_lib_link += PIL_check_seconds_timer() - time_start;
+  }
+}
+
+void blo_read_profile_print(const FileData *fd, const char *filepath)
+{
+  const BlendReadProfile *profile = fd->profile;
+  char filepath_esc[FILE_MAX * 2];
+  BLI_strescape(filepath_esc, filepath, sizeof(filepath_esc));
+
+  double time_total = 0.0;
+  for (int i = 0; i < BLO_READ_PHASE_NUM; i++) {
+    time_total += profile->time_phase[i];
+  }
+
+  printf("{\n");
+  printf("  \"file\": \"%s\",\n", filepath_esc);
+  printf("  \"version\": %d,\n", fd->fileversion);
+  printf("  \"time\": %.6f,\n", time_total);
+
+  printf("  \"phases\": {\n");
+  for (int i = 0; i < BLO_READ_PHASE_NUM; i++) {
+    printf("    \"%s\": %.6f%s\n",
+           read_profile_phase_names[i],
+           profile->time_phase[i],
+           (i + 1 < BLO_READ_PHASE_NUM) ? "," : "");
+  }
+  printf("  },\n");
+
+  printf("  \"id_types\": {");
+  bool is_first = true;
+  for (int i = 0; i < INDEX_ID_MAX; i++) {
+    const BlendReadProfileIDType *id_type = &profile->id_types[i];
+    if (id_type->count == 0 && id_type->time_lib_link == 0.0) {
+      continue;
+    }
+    printf("%s\n", is_first ? "" : ",");
+    printf("    \"%s\": {\"count\": %d, \"size\": %zu, "
+           "\"read\": %.6f, \"direct_link\": %.6f, \"lib_link\": %.6f}",
+           BKE_idtype_idcode_to_name(BKE_idtype_idcode_from_index(i)),
+           id_type->count,
+           id_type->size,
+           id_type->time_read,
+           id_type->time_direct_link,
+           id_type->time_lib_link);
+    is_first = false;
+  }
+  printf("\n  }\n");
+  printf("}\n");
+  fflush(stdout);
+}
@@ -38,9 +38,13 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
@@ -52,15 +56,128 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* -------------------------------------------------------------------- */
+/** \name Shared Chunk Buffers
+ *
+ * Chunk buffers are looked up by their contents, so chunks with the same data share a
+ * single buffer across all memfiles, regardless of their position in the file.
+ * Buffers are reference counted, memfiles can be freed in any order.
+ * \{ */
+
+/** Header of a chunk buffer, the data follows it in the same allocation. */
+typedef struct MemFileSharedBuffer {
+  /** Number of #MemFileChunk using this buffer. */
+  uint users;
+  uint size;
+  uint hash;
+  uint64_t buf_id;
+  /** Points to the data after the header, or to the data to look up for keys. */
+  const char *data;
+} MemFileSharedBuffer;
+
+/** All buffers in use by memfiles, only accessed from the main thread. */
+static GSet *memfile_buffers = NULL;
+static MemFileStats memfile_stats = {0};
+
+/* Last value used for #MemFileChunk.buf_id. */
+static uint64_t memfile_chunk_buf_id_last = 0;
+
+static uint memfile_buffer_hash(const void *key)
+{
+  return ((const MemFileSharedBuffer *)key)->hash;
+}
+
+static bool memfile_buffer_cmp(const void *a, const void *b)
+{
+  const MemFileSharedBuffer *buffer_a = a, *buffer_b = b;
+  return !((buffer_a->hash == buffer_b->hash) && (buffer_a->size == buffer_b->size) &&
+           (memcmp(buffer_a->data, buffer_b->data, buffer_a->size) == 0));
+}
+
+BLI_INLINE MemFileSharedBuffer *memfile_buffer_from_chunk(const MemFileChunk *chunk)
+{
+  return ((MemFileSharedBuffer *)chunk->buf) - 1;
+}
+
+static void memfile_buffer_use(MemFileChunk *chunk, MemFileSharedBuffer *buffer)
+{
+  buffer->users++;
+  chunk->buf = buffer->data;
+  chunk->buf_id = buffer->buf_id;
+  memfile_stats.chunks_len++;
+  memfile_stats.chunks_size += chunk->size;
+}
+
+static MemFileSharedBuffer *memfile_buffer_ensure(const char *buf, uint size, bool *r_is_new)
+{
+  if (memfile_buffers == NULL) {
+    memfile_buffers = BLI_gset_new(memfile_buffer_hash, memfile_buffer_cmp, __func__);
+  }
+
+  const MemFileSharedBuffer key = {
+      .size = size,
+      .hash = BLI_hash_mm2((const uchar *)buf, size, 0),
+      .data = buf,
+  };
+  MemFileSharedBuffer *buffer = BLI_gset_lookup(memfile_buffers, &key);
+  *r_is_new = (buffer == NULL);
+  if (buffer != NULL) {
+    return buffer;
+  }
+
+  buffer = MEM_mallocN(sizeof(*buffer) + size, "Chunk buffer");
+  *buffer = key;
+  buffer->users = 0;
+  buffer->buf_id = atomic_add_and_fetch_uint64(&memfile_chunk_buf_id_last, 1);
+  buffer->data = (const char *)(buffer + 1);
+  memcpy(buffer + 1, buf, size);
+  BLI_gset_insert(memfile_buffers, buffer);
+
+  memfile_stats.buffers_len++;
+  memfile_stats.buffers_size += size;
+  return buffer;
+}
+
+static void memfile_buffer_release(MemFileChunk *chunk)
+{
+  MemFileSharedBuffer *buffer = memfile_buffer_from_chunk(chunk);
+  BLI_assert(buffer->users > 0);
+
+  memfile_stats.chunks_len--;
+  memfile_stats.chunks_size -= chunk->size;
+
+  if (--buffer->users != 0) {
+    return;
+  }
+
+  BLI_gset_remove(memfile_buffers, buffer, NULL);
+  memfile_stats.buffers_len--;
+  memfile_stats.buffers_size -= buffer->size;
+  MEM_freeN(buffer);
+
+  if (BLI_gset_len(memfile_buffers) == 0) {
+    BLI_gset_free(memfile_buffers, NULL);
+    memfile_buffers = NULL;
+  }
+}
+
+/**
+ * Memory used by all memfiles, see #MemFileStats.
+ */
+void BLO_memfile_stats_get(MemFileStats *r_stats)
+{
+  *r_stats = memfile_stats;
+}
+
+/** \} */
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_buffer_release(chunk);
     MEM_freeN(chunk);
   }
   memfile->size = 0;
@@ -70,23 +187,10 @@ void BLO_memfile_free(MemFile *memfile)
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  MemFileChunk *fc, *sc;
-
-  fc = first->chunks.first;
-  sc = second->chunks.first;
-  while (fc || sc) {
-    if (fc && sc) {
-      if (sc->is_identical) {
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-    }
-    if (fc) {
-      fc = fc->next;
-    }
-    if (sc) {
-      sc = sc->next;
-    }
+  /* Buffers are reference counted, there is no ownership to pass on, only the chunks which were
+   * identical to 'first' aren't identical to the step before anymore. */
+  LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
+    sc->is_identical = false;
   }
 
   BLO_memfile_free(first);
@@ -117,7 +221,7 @@ void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChun
     MemFileChunk *compchunk = *compchunk_step;
     if (compchunk->size == curchunk->size) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
+        memfile_buffer_use(curchunk, memfile_buffer_from_chunk(compchunk));
         curchunk->is_identical = true;
         compchunk->is_identical_future = true;
       }
@@ -125,12 +229,13 @@ void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChun
     *compchunk_step = compchunk->next;
   }
 
-  /* not equal... */
+  /* not equal, share any buffer with the same contents (from data which moved for e.g.)... */
   if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+    bool is_new;
+    memfile_buffer_use(curchunk, memfile_buffer_ensure(buf, size, &is_new));
+    if (is_new) {
+      memfile->size += size;
+    }
   }
 }
 
@@ -210,3 +315,289 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
   }
   return true;
 }
+
+/* -------------------------------------------------------------------- */
+/** \name Journal
+ *
+ * Incremental writing of memfiles, used for auto-save.
+ *
+ * Chunk data is only ever appended to the journal file, chunks that are still
+ * identical (same #MemFileChunk.buf_id) to the ones written by the previous step
+ * are referenced instead of written again. A step ends with a table listing the
+ * chunks of the memfile, the header at the start of the file is updated last to
+ * point to this table, so a crash while writing leaves the previous step intact.
+ *
+ * The journal is rewritten from scratch once more than half of the file is taken
+ * by chunks which aren't used anymore. The file is synced before and after updating
+ * the header.
+ *
+ * Journal files are temporary, values are stored with the native byte order.
+ * \{ */
+
+typedef struct MemFileJournalHeader {
+  char magic[8];
+  /** Location of the #MemFileJournalChunk table of the last complete step. */
+  uint64_t table_offset;
+  uint64_t table_len;
+} MemFileJournalHeader;
+
+typedef struct MemFileJournalChunk {
+  uint64_t buf_id;
+  uint64_t offset;
+  uint64_t size;
+} MemFileJournalChunk;
+
+struct MemFileJournal {
+  /** File the journal was last written to, empty when the next write must be a full one. */
+  char filename[1024]; /* FILE_MAX */
+  /** Size of the file, new data is appended here. */
+  uint64_t file_size;
+  /** Size of the chunks referenced by the last step. */
+  uint64_t live_size;
+
+  /** Chunks of the last step, and a lookup by #MemFileJournalChunk.buf_id. */
+  MemFileJournalChunk *chunks;
+  GHash *chunks_hash;
+};
+
+static void memfile_journal_header_init(MemFileJournalHeader *header,
+                                        const uint64_t table_offset,
+                                        const uint64_t table_len)
+{
+  memcpy(header->magic, BLO_MEMFILE_JOURNAL_MAGIC, sizeof(header->magic));
+  header->table_offset = table_offset;
+  header->table_len = table_len;
+}
+
+static uint memfile_journal_buf_id_hash(const void *key)
+{
+  const uint64_t buf_id = *(const uint64_t *)key;
+  return BLI_ghashutil_uinthash((uint)(buf_id ^ (buf_id >> 32)));
+}
+
+static bool memfile_journal_buf_id_cmp(const void *a, const void *b)
+{
+  return (*(const uint64_t *)a != *(const uint64_t *)b);
+}
+
+MemFileJournal *BLO_memfile_journal_new(void)
+{
+  return MEM_callocN(sizeof(MemFileJournal), __func__);
+}
+
+static void memfile_journal_reset(MemFileJournal *journal)
+{
+  if (journal->chunks_hash) {
+    BLI_ghash_free(journal->chunks_hash, NULL, NULL);
+    journal->chunks_hash = NULL;
+  }
+  MEM_SAFE_FREE(journal->chunks);
+  journal->filename[0] = '\0';
+  journal->file_size = 0;
+  journal->live_size = 0;
+}
+
+void BLO_memfile_journal_free(MemFileJournal *journal)
+{
+  memfile_journal_reset(journal);
+  MEM_freeN(journal);
+}
+
+static bool memfile_journal_write_data(int file, const void *buf, size_t size)
+{
+  return ((size_t)write(file, buf, size) == size);
+}
+
+/* Make sure the data written so far is on disk, before writing what refers to it. */
+static bool memfile_journal_sync(int file)
+{
+#ifdef _WIN32
+  return (_commit(file) == 0);
+#else
+  return (fsync(file) == 0);
+#endif
+}
+
+static bool memfile_journal_read_data(int file, void *buf, size_t size)
+{
+  return ((size_t)read(file, buf, size) == size);
+}
+
+static bool memfile_journal_write_step(MemFileJournal *journal,
+                                       MemFile *memfile,
+                                       int file,
+                                       const bool is_full)
+{
+  const uint chunks_len = (uint)BLI_listbase_count(&memfile->chunks);
+  MemFileJournalChunk *chunks = MEM_malloc_arrayN(chunks_len, sizeof(*chunks), __func__);
+  uint64_t file_size = is_full ? sizeof(MemFileJournalHeader) : journal->file_size;
+  uint64_t live_size = 0;
+  bool ok = true;
+
+  if (is_full) {
+    MemFileJournalHeader header;
+    memfile_journal_header_init(&header, 0, 0);
+    ok = memfile_journal_write_data(file, &header, sizeof(header));
+  }
+  else {
+    ok = (BLI_lseek(file, (int64_t)file_size, SEEK_SET) != -1);
+  }
+
+  /* Append the chunks which changed since the last step. */
+  uint i = 0;
+  for (MemFileChunk *chunk = memfile->chunks.first; ok && chunk; chunk = chunk->next, i++) {
+    const MemFileJournalChunk *chunk_prev = is_full ? NULL :
+                                                      BLI_ghash_lookup(journal->chunks_hash,
+                                                                       &chunk->buf_id);
+    chunks[i].buf_id = chunk->buf_id;
+    chunks[i].size = chunk->size;
+    if (chunk_prev != NULL && chunk_prev->size == chunk->size) {
+      chunks[i].offset = chunk_prev->offset;
+    }
+    else {
+      ok = memfile_journal_write_data(file, chunk->buf, chunk->size);
+      chunks[i].offset = file_size;
+      file_size += chunk->size;
+    }
+    live_size += chunk->size;
+  }
+
+  /* Write the table, then make the header point to it. The header must not reach the disk
+   * before the data it points to, or a crash could leave it pointing to unwritten data. */
+  MemFileJournalHeader header;
+  memfile_journal_header_init(&header, file_size, chunks_len);
+  ok = ok && memfile_journal_write_data(file, chunks, sizeof(*chunks) * chunks_len);
+  ok = ok && memfile_journal_sync(file);
+  ok = ok && (BLI_lseek(file, 0, SEEK_SET) != -1);
+  ok = ok && memfile_journal_write_data(file, &header, sizeof(header));
+  ok = ok && memfile_journal_sync(file);
+
+  if (!ok) {
+    MEM_freeN(chunks);
+    return false;
+  }
+
+  memfile_journal_reset(journal);
+  journal->file_size = file_size + sizeof(*chunks) * chunks_len;
+  journal->live_size = live_size;
+  journal->chunks = chunks;
+  journal->chunks_hash = BLI_ghash_new_ex(
+      memfile_journal_buf_id_hash, memfile_journal_buf_id_cmp, __func__, chunks_len);
+  for (i = 0; i < chunks_len; i++) {
+    BLI_ghash_insert(journal->chunks_hash, &chunks[i].buf_id, &chunks[i]);
+  }
+  return true;
+}
+
+/**
+ * Saves the memfile into a journal file, only writing the chunks which changed since the
+ * last time \a journal was written.
+ *
+ * \return success.
+ */
+bool BLO_memfile_journal_write(MemFileJournal *journal, MemFile *memfile, const char *filename)
+{
+  /* Append when the file is still the one written last time, and not mostly unused chunks. */
+  const bool is_full = !STREQ(journal->filename, filename) ||
+                       (BLI_file_size(filename) != journal->file_size) ||
+                       (journal->file_size - journal->live_size > journal->live_size);
+  char filename_write[FILE_MAX + 1];
+  int file, oflags = O_BINARY | O_WRONLY;
+
+  if (is_full) {
+    /* Write to a temporary file, the previous journal stays valid until it's replaced. */
+    BLI_snprintf(filename_write, sizeof(filename_write), "%s@", filename);
+    oflags |= O_CREAT | O_TRUNC;
+  }
+  else {
+    BLI_strncpy(filename_write, filename, sizeof(filename_write));
+  }
+#ifdef O_NOFOLLOW
+  /* Same as #BLO_memfile_write_file. */
+  oflags |= O_NOFOLLOW;
+#endif
+
+  file = BLI_open(filename_write, oflags, 0666);
+  if (file == -1) {
+    fprintf(stderr,
+            "Unable to save '%s': %s\n",
+            filename_write,
+            errno ? strerror(errno) : "Unknown error opening file");
+    memfile_journal_reset(journal);
+    return false;
+  }
+
+  const bool ok = memfile_journal_write_step(journal, memfile, file, is_full);
+  close(file);
+
+  if (!ok) {
+    fprintf(stderr,
+            "Unable to save '%s': %s\n",
+            filename_write,
+            errno ? strerror(errno) : "Unknown error writing file");
+    memfile_journal_reset(journal);
+    if (is_full) {
+      BLI_delete(filename_write, false, false);
+    }
+    return false;
+  }
+
+  if (is_full && BLI_rename(filename_write, filename) != 0) {
+    fprintf(stderr, "Unable to save '%s': cannot rename '%s'\n", filename, filename_write);
+    memfile_journal_reset(journal);
+    return false;
+  }
+
+  BLI_strncpy(journal->filename, filename, sizeof(journal->filename));
+  return true;
+}
+
+/**
+ * Reconstructs the memfile of the last complete step of a journal file
+ * as one contiguous buffer, in the same format as a regular .blend file.
+ *
+ * \return The buffer, or NULL when \a file isn't a valid journal.
+ */
+void *BLO_memfile_journal_read(int file, size_t *r_size)
+{
+  const uint64_t file_size = (uint64_t)BLI_file_descriptor_size(file);
+  MemFileJournalHeader header;
+  MemFileJournalChunk *chunks = NULL;
+  char *buf = NULL;
+  uint64_t size = 0;
+
+  if ((BLI_lseek(file, 0, SEEK_SET) == -1) ||
+      !memfile_journal_read_data(file, &header, sizeof(header)) ||
+      !STREQLEN(header.magic, BLO_MEMFILE_JOURNAL_MAGIC, sizeof(header.magic)) ||
+      (header.table_len > (file_size / sizeof(*chunks))) ||
+      (header.table_offset > file_size - header.table_len * sizeof(*chunks))) {
+    return NULL;
+  }
+
+  chunks = MEM_malloc_arrayN((size_t)header.table_len, sizeof(*chunks), __func__);
+  bool ok = (BLI_lseek(file, (int64_t)header.table_offset, SEEK_SET) != -1) &&
+            memfile_journal_read_data(file, chunks, sizeof(*chunks) * header.table_len);
+  for (uint64_t i = 0; ok && i < header.table_len; i++) {
+    ok = (chunks[i].offset <= file_size) && (chunks[i].size <= file_size - chunks[i].offset);
+    size += chunks[i].size;
+  }
+
+  if (ok) {
+    buf = MEM_mallocN((size_t)size, __func__);
+    uint64_t offset = 0;
+    for (uint64_t i = 0; ok && i < header.table_len; i++) {
+      ok = (BLI_lseek(file, (int64_t)chunks[i].offset, SEEK_SET) != -1) &&
+           memfile_journal_read_data(file, buf + offset, (size_t)chunks[i].size);
+      offset += chunks[i].size;
+    }
+    if (!ok) {
+      MEM_SAFE_FREE(buf);
+    }
+  }
+
+  MEM_freeN(chunks);
+  *r_size = (size_t)size;
+  return buf;
+}
+
+/** \} */
@@ -147,7 +147,9 @@
 
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 #include "MEM_guardedalloc.h"  // MEM_freeN
 
 #include "BKE_action.h"
@@ -163,6 +165,7 @@
 #include "BKE_idtype.h"
 #include "BKE_layer.h"
 #include "BKE_lib_override.h"
+#include "BKE_lib_query.h"
 #include "BKE_main.h"
 #include "BKE_modifier.h"
 #include "BKE_node.h"
@@ -206,6 +209,7 @@
 typedef enum {
   WW_WRAP_NONE = 1,
   WW_WRAP_ZLIB,
+  WW_WRAP_MEMFILE,
 } eWriteWrapType;
 
 typedef struct WriteWrap WriteWrap;
@@ -221,7 +225,8 @@ struct WriteWrap {
   /* internal */
   union {
     int file_handle;
-    gzFile gz_handle;
+    struct WriteWrapZlib *zlib_handle;
+    struct MemFile *memfile;
   } _user_data;
 };
 
@@ -252,17 +257,194 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
-#define FILE_HANDLE(ww) (ww)->_user_data.gz_handle
+/* zlib
+ *
+ * Data is split into frames of #BLEN_GZIP_FRAME_SIZE bytes which are compressed independently
+ * (each one a complete gzip member) by the task scheduler, then written out in order.
+ * A seek table is appended so readers can decompress individual frames on demand,
+ * see #BLEN_GZIP_SEEK_TABLE_MAGIC. The result is still a valid (multi-member) gzip stream. */
+
+typedef struct WriteWrapZlibFrame {
+  char *buf_in;
+  size_t buf_in_len;
+  char *buf_out;
+  size_t buf_out_len;
+} WriteWrapZlibFrame;
+
+typedef struct WriteWrapZlib {
+  int file_handle;
+  TaskPool *task_pool;
+
+  /** Frames being compressed, written out (in order) once #frames_len reaches #frames_max. */
+  WriteWrapZlibFrame *frames;
+  int frames_len;
+  int frames_max;
+
+  /** Seek table, two values (compressed & uncompressed size) for each frame written. */
+  uint *seek_table;
+  int seek_table_len;
+  int seek_table_alloc;
+
+  /** Set when compression or writing fails, ignores all further writes. */
+  bool error;
+} WriteWrapZlib;
+
+#define ZLIB_HANDLE(ww) (ww)->_user_data.zlib_handle
+
+static void ww_zlib_frame_compress_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  WriteWrapZlibFrame *frame = taskdata;
+  z_stream strm = {NULL};
+
+  frame->buf_out = NULL;
+  frame->buf_out_len = 0;
+
+  /* Level 1 matches the "wb1" mode previously used with #BLI_gzopen. */
+  if (deflateInit2(&strm, 1, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return;
+  }
+
+  const size_t buf_out_alloc = deflateBound(&strm, (uLong)frame->buf_in_len);
+  frame->buf_out = MEM_mallocN(buf_out_alloc, __func__);
+
+  strm.next_in = (Bytef *)frame->buf_in;
+  strm.avail_in = (uInt)frame->buf_in_len;
+  strm.next_out = (Bytef *)frame->buf_out;
+  strm.avail_out = (uInt)buf_out_alloc;
+
+  if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+    frame->buf_out_len = buf_out_alloc - strm.avail_out;
+  }
+  deflateEnd(&strm);
+}
+
+static void ww_zlib_seek_table_append(WriteWrapZlib *zlib, uint compressed_len, uint data_len)
+{
+  if (zlib->seek_table_len == zlib->seek_table_alloc) {
+    zlib->seek_table_alloc = zlib->seek_table_alloc ? zlib->seek_table_alloc * 2 : 256;
+    zlib->seek_table = MEM_reallocN(zlib->seek_table,
+                                    sizeof(*zlib->seek_table) * 2 * zlib->seek_table_alloc);
+  }
+  zlib->seek_table[zlib->seek_table_len * 2 + 0] = compressed_len;
+  zlib->seek_table[zlib->seek_table_len * 2 + 1] = data_len;
+  zlib->seek_table_len++;
+}
+
+/**
+ * Wait for all pending frames to be compressed and write them in order.
+ */
+static void ww_zlib_frames_write(WriteWrapZlib *zlib)
+{
+  if (zlib->frames_len == 0) {
+    return;
+  }
+
+  BLI_task_pool_work_and_wait(zlib->task_pool);
+
+  for (int i = 0; i < zlib->frames_len; i++) {
+    WriteWrapZlibFrame *frame = &zlib->frames[i];
+    if (!zlib->error) {
+      if ((frame->buf_out_len == 0) ||
+          ((size_t)write(zlib->file_handle, frame->buf_out, frame->buf_out_len) !=
+           frame->buf_out_len)) {
+        zlib->error = true;
+      }
+      else {
+        ww_zlib_seek_table_append(zlib, (uint)frame->buf_out_len, (uint)frame->buf_in_len);
+      }
+    }
+    MEM_SAFE_FREE(frame->buf_out);
+    frame->buf_in_len = 0;
+  }
+  zlib->frames_len = 0;
+}
+
+static void ww_zlib_frame_push(WriteWrapZlib *zlib)
+{
+  WriteWrapZlibFrame *frame = &zlib->frames[zlib->frames_len];
+  BLI_task_pool_push(zlib->task_pool, ww_zlib_frame_compress_task, frame, false, NULL);
+  zlib->frames_len++;
+
+  if (zlib->frames_len == zlib->frames_max) {
+    ww_zlib_frames_write(zlib);
+  }
+}
+
+static void ww_uint32_to_le(uint value, uchar r_bytes[4])
+{
+  r_bytes[0] = (uchar)(value);
+  r_bytes[1] = (uchar)(value >> 8);
+  r_bytes[2] = (uchar)(value >> 16);
+  r_bytes[3] = (uchar)(value >> 24);
+}
+
+/**
+ * Write the seek table as an empty gzip member, storing the table in its "extra" field.
+ */
+static bool ww_zlib_seek_table_write(WriteWrapZlib *zlib)
+{
+  if (zlib->seek_table_len > BLEN_GZIP_SEEK_TABLE_FRAMES_MAX) {
+    /* Too many frames to index, the file can still be read as a regular gzip stream. */
+    return true;
+  }
+
+  const uint payload_len = (uint)zlib->seek_table_len * 8 + BLEN_GZIP_SEEK_TABLE_FOOTER_SIZE;
+  const size_t member_len = BLEN_GZIP_SEEK_TABLE_HEADER_SIZE + payload_len +
+                            BLEN_GZIP_SEEK_TABLE_TRAILER_SIZE;
+  uchar *member = MEM_callocN(member_len, __func__);
+  uchar *p = member;
+
+  /* Gzip header (ID1, ID2, CM=deflate, FLG=FEXTRA, MTIME, XFL, OS=unknown). */
+  *p++ = 0x1f;
+  *p++ = 0x8b;
+  *p++ = 8;
+  *p++ = 4;
+  p += 5;
+  *p++ = 0xff;
+  /* XLEN, then a single sub-field. */
+  *p++ = (uchar)((payload_len + 4) & 0xff);
+  *p++ = (uchar)((payload_len + 4) >> 8);
+  *p++ = BLEN_GZIP_SEEK_TABLE_SUBFIELD_ID[0];
+  *p++ = BLEN_GZIP_SEEK_TABLE_SUBFIELD_ID[1];
+  *p++ = (uchar)(payload_len & 0xff);
+  *p++ = (uchar)(payload_len >> 8);
+
+  for (int i = 0; i < zlib->seek_table_len * 2; i++, p += 4) {
+    ww_uint32_to_le(zlib->seek_table[i], p);
+  }
+  ww_uint32_to_le((uint)zlib->seek_table_len, p);
+  p += 4;
+  memcpy(p, BLEN_GZIP_SEEK_TABLE_MAGIC, 4);
+  p += 4;
+
+  /* Empty final deflate block, CRC32 & ISIZE are zero. */
+  *p++ = 0x03;
+  *p++ = 0x00;
+  p += 8;
+  BLI_assert(p == member + member_len);
+
+  const bool ok = ((size_t)write(zlib->file_handle, member, member_len) == member_len);
+  MEM_freeN(member);
+  return ok;
+}
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-  gzFile file;
+  int file;
 
-  file = BLI_gzopen(filepath, "wb1");
+  file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
 
-  if (file != Z_NULL) {
-    FILE_HANDLE(ww) = file;
+  if (file != -1) {
+    WriteWrapZlib *zlib = MEM_callocN(sizeof(*zlib), __func__);
+    zlib->file_handle = file;
+    zlib->task_pool = BLI_task_pool_create(zlib, TASK_PRIORITY_HIGH);
+    /* Enough frames to keep all threads busy, while limiting memory use. */
+    zlib->frames_max = MAX2(2, BLI_task_scheduler_num_threads() * 2);
+    zlib->frames = MEM_callocN(sizeof(*zlib->frames) * zlib->frames_max, __func__);
+    for (int i = 0; i < zlib->frames_max; i++) {
+      zlib->frames[i].buf_in = MEM_mallocN(BLEN_GZIP_FRAME_SIZE, __func__);
+    }
+    ZLIB_HANDLE(ww) = zlib;
     return true;
   }
   else {
@@ -271,13 +453,80 @@ static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-  return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+  WriteWrapZlib *zlib = ZLIB_HANDLE(ww);
+
+  if (zlib->frames[zlib->frames_len].buf_in_len != 0) {
+    ww_zlib_frame_push(zlib);
+  }
+  ww_zlib_frames_write(zlib);
+
+  bool ok = !zlib->error && ww_zlib_seek_table_write(zlib);
+  if (close(zlib->file_handle) == -1) {
+    ok = false;
+  }
+
+  BLI_task_pool_free(zlib->task_pool);
+  for (int i = 0; i < zlib->frames_max; i++) {
+    MEM_freeN(zlib->frames[i].buf_in);
+  }
+  MEM_freeN(zlib->frames);
+  MEM_SAFE_FREE(zlib->seek_table);
+  MEM_freeN(zlib);
+  ZLIB_HANDLE(ww) = NULL;
+
+  return ok;
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-  return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+  WriteWrapZlib *zlib = ZLIB_HANDLE(ww);
+  size_t buf_written = 0;
+
+  while (buf_written < buf_len && !zlib->error) {
+    WriteWrapZlibFrame *frame = &zlib->frames[zlib->frames_len];
+    const size_t len = MIN2(buf_len - buf_written, BLEN_GZIP_FRAME_SIZE - frame->buf_in_len);
+
+    memcpy(frame->buf_in + frame->buf_in_len, buf + buf_written, len);
+    frame->buf_in_len += len;
+    buf_written += len;
+
+    if (frame->buf_in_len == BLEN_GZIP_FRAME_SIZE) {
+      ww_zlib_frame_push(zlib);
+    }
+  }
+
+  return zlib->error ? 0 : buf_written;
 }
-#undef FILE_HANDLE
+#undef ZLIB_HANDLE
+
+/* memfile
+ *
+ * Keeps the file in memory, to be written to disk later (see #BLO_write_file_snapshot).
+ * Each chunk owns a copy of its data, the buffers are not shared with undo chunks
+ * (they would rarely match since writing isn't flushed per ID). */
+
+#define MEMFILE_HANDLE(ww) (ww)->_user_data.memfile
+
+static bool ww_open_memfile(WriteWrap *UNUSED(ww), const char *UNUSED(filepath))
+{
+  return true;
+}
+static bool ww_close_memfile(WriteWrap *UNUSED(ww))
+{
+  return true;
+}
+static size_t ww_write_memfile(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  MemFile *memfile = MEMFILE_HANDLE(ww);
+  MemFileChunk *chunk = MEM_mallocN(sizeof(*chunk) + buf_len, __func__);
+  memset(chunk, 0, sizeof(*chunk));
+  memcpy(chunk + 1, buf, buf_len);
+  chunk->buf = (const char *)(chunk + 1);
+  chunk->size = (uint)buf_len;
+  BLI_addtail(&memfile->chunks, chunk);
+  memfile->size += buf_len;
+  return buf_len;
+}
+#undef MEMFILE_HANDLE
 
 /* --- end compression types --- */
 
@@ -293,6 +542,13 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
       r_ww->use_buf = false;
       break;
     }
+    case WW_WRAP_MEMFILE: {
+      r_ww->open = ww_open_memfile;
+      r_ww->close = ww_close_memfile;
+      r_ww->write = ww_write_memfile;
+      r_ww->use_buf = true;
+      break;
+    }
     default: {
       r_ww->open = ww_open_none;
       r_ww->close = ww_close_none;
@@ -322,6 +578,9 @@ typedef struct {
   size_t write_len;
 #endif
 
+  /** Offset of the next byte written (before compression), used for #WriteData.index. */
+  uint64_t offset;
+
   /** Set on unlikely case of an error (ignores further file writing).  */
   bool error;
 
@@ -341,6 +600,23 @@ typedef struct {
    * Will be NULL for UNDO.
    */
   WriteWrap *ww;
+
+  /** Index of the ID blocks written, see #BlendIndexHeader (not used for undo). */
+  struct {
+    bool use;
+    /** Store the dependencies of the entries too (#G_FILE_INDEX_DEPS). */
+    bool use_deps;
+    BlendIndexEntry *entries;
+    /** The address of the ID of each entry, to resolve the dependencies. */
+    const void **entries_id;
+    int entries_len, entries_len_alloc;
+    /** Used ID addresses, converted into entry indices when writing the index. */
+    const void **deps;
+    int deps_len, deps_len_alloc;
+    /** The dependencies already added for the last entry. */
+    GSet *deps_entry;
+    uint64_t dna_offset;
+  } index;
 } WriteData;
 
 static WriteData *writedata_new(WriteWrap *ww)
@@ -384,6 +660,12 @@ static void writedata_free(WriteData *wd)
   if (wd->buf) {
     MEM_freeN(wd->buf);
   }
+  MEM_SAFE_FREE(wd->index.entries);
+  MEM_SAFE_FREE(wd->index.entries_id);
+  MEM_SAFE_FREE(wd->index.deps);
+  if (wd->index.deps_entry) {
+    BLI_gset_free(wd->index.deps_entry, NULL);
+  }
   MEM_freeN(wd);
 }
 
@@ -425,6 +707,8 @@ static void mywrite(WriteData *wd, const void *adr, int len)
   wd->write_len += len;
 #endif
 
+  wd->offset += (uint64_t)len;
+
   if (wd->buf == NULL) {
     writedata_do_write(wd, adr, len);
   }
@@ -501,6 +785,99 @@ static bool mywrite_end(WriteData *wd)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name File Index
+ *
+ * Collect the ID blocks while writing, see #BlendIndexHeader.
+ * \{ */
+
+static bool write_index_code_is_id(const int filecode)
+{
+  /* Block codes such as #DATA use four characters, ID codes two. */
+  if (filecode & ~0xffff) {
+    return false;
+  }
+  return BKE_idtype_idcode_is_valid((short)filecode) ||
+         ELEM(filecode, ID_LINK_PLACEHOLDER, ID_SCRN);
+}
+
+static void write_index_entry_add(WriteData *wd, const int filecode, const void *adr, const ID *id)
+{
+  if (wd->index.entries_len == wd->index.entries_len_alloc) {
+    wd->index.entries_len_alloc = MAX2(256, wd->index.entries_len_alloc * 2);
+    wd->index.entries = MEM_reallocN(wd->index.entries,
+                                     sizeof(*wd->index.entries) * wd->index.entries_len_alloc);
+    wd->index.entries_id = MEM_reallocN(
+        wd->index.entries_id, sizeof(*wd->index.entries_id) * wd->index.entries_len_alloc);
+  }
+
+  BlendIndexEntry *entry = &wd->index.entries[wd->index.entries_len];
+  memset(entry, 0, sizeof(*entry));
+  entry->code = filecode;
+  entry->offset = wd->offset;
+  entry->deps_start = wd->index.deps_len;
+  BLI_strncpy(entry->name, id->name, sizeof(entry->name));
+
+  wd->index.entries_id[wd->index.entries_len++] = adr;
+}
+
+static void write_index_preview_set(WriteData *wd, const void *id_address)
+{
+  if (!wd->index.use || id_address == NULL) {
+    return;
+  }
+  /* Previews are written with the ID owning them, its entry is the last one or close to it. */
+  for (int i = wd->index.entries_len - 1; i >= 0; i--) {
+    if (wd->index.entries_id[i] == id_address) {
+      wd->index.entries[i].preview_offset = wd->offset;
+      break;
+    }
+  }
+}
+
+static int write_index_deps_cb(LibraryIDLinkCallbackData *cb_data)
+{
+  WriteData *wd = cb_data->user_data;
+  const ID *id = *cb_data->id_pointer;
+
+  if (id == NULL || (cb_data->cb_flag & IDWALK_CB_LOOPBACK)) {
+    return IDWALK_RET_NOP;
+  }
+
+  if (!BLI_gset_add(wd->index.deps_entry, (void *)id)) {
+    return IDWALK_RET_NOP;
+  }
+
+  if (wd->index.deps_len == wd->index.deps_len_alloc) {
+    wd->index.deps_len_alloc = MAX2(256, wd->index.deps_len_alloc * 2);
+    wd->index.deps = MEM_reallocN(wd->index.deps,
+                                  sizeof(*wd->index.deps) * wd->index.deps_len_alloc);
+  }
+  wd->index.deps[wd->index.deps_len++] = id;
+
+  return IDWALK_RET_NOP;
+}
+
+/**
+ * Store the IDs used by \a id, which must have been the last ID block written.
+ */
+static void write_index_deps_add(WriteData *wd, Main *bmain, ID *id)
+{
+  BlendIndexEntry *entry = &wd->index.entries[wd->index.entries_len - 1];
+  BLI_assert(wd->index.entries_id[wd->index.entries_len - 1] == id);
+
+  if (wd->index.deps_entry == NULL) {
+    wd->index.deps_entry = BLI_gset_ptr_new(__func__);
+  }
+
+  BKE_library_foreach_ID_link(bmain, id, write_index_deps_cb, wd, IDWALK_READONLY);
+  entry->deps_len = wd->index.deps_len - entry->deps_start;
+
+  BLI_gset_clear(wd->index.deps_entry, NULL);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Generic DNA File Writing
  * \{ */
@@ -531,6 +908,10 @@ static void writestruct_at_address_nr(
     return;
   }
 
+  if (wd->index.use && write_index_code_is_id(filecode)) {
+    write_index_entry_add(wd, filecode, adr, data);
+  }
+
   mywrite(wd, &bh, sizeof(BHead));
   mywrite(wd, data, bh.len);
 }
@@ -737,7 +1118,11 @@ static void write_iddata(WriteData *wd, ID *id)
   }
 }
 
-static void write_previews(WriteData *wd, const PreviewImage *prv_orig)
+/**
+ * \param id_address: The address of the ID owning the preview,
+ * NULL for embedded IDs which aren't in the file index.
+ */
+static void write_previews(WriteData *wd, const void *id_address, const PreviewImage *prv_orig)
 {
   /* Note we write previews also for undo steps. It takes up some memory,
    * but not doing so would causes all previews to be re-rendered after
@@ -751,6 +1136,7 @@ static void write_previews(WriteData *wd, const PreviewImage *prv_orig)
       prv.h[1] = 0;
       prv.rect[1] = NULL;
     }
+    write_index_preview_set(wd, id_address);
     writestruct_at_address(wd, DATA, PreviewImage, 1, prv_orig, &prv);
     if (prv.rect[0]) {
       writedata(wd, DATA, prv.w[0] * prv.h[0] * sizeof(uint), prv.rect[0]);
@@ -1969,7 +2355,7 @@ static void write_object(WriteData *wd, Object *ob, const void *id_address)
     writelist(wd, DATA, LinkData, &ob->pc_ids);
     writelist(wd, DATA, LodLevel, &ob->lodlevels);
 
-    write_previews(wd, ob->preview);
+    write_previews(wd, id_address, ob->preview);
   }
 }
 
@@ -2329,7 +2715,7 @@ static void write_image(WriteData *wd, Image *ima, const void *id_address)
       }
     }
 
-    write_previews(wd, ima->preview);
+    write_previews(wd, id_address, ima->preview);
 
     LISTBASE_FOREACH (ImageView *, iv, &ima->views) {
       writestruct(wd, DATA, ImageView, 1, iv);
@@ -2366,7 +2752,7 @@ static void write_texture(WriteData *wd, Tex *tex, const void *id_address)
       write_nodetree_nolib(wd, tex->nodetree);
     }
 
-    write_previews(wd, tex->preview);
+    write_previews(wd, id_address, tex->preview);
   }
 }
 
@@ -2391,7 +2777,7 @@ static void write_material(WriteData *wd, Material *ma, const void *id_address)
       write_nodetree_nolib(wd, ma->nodetree);
     }
 
-    write_previews(wd, ma->preview);
+    write_previews(wd, id_address, ma->preview);
 
     /* grease pencil settings */
     if (ma->gp_style) {
@@ -2420,7 +2806,7 @@ static void write_world(WriteData *wd, World *wrld, const void *id_address)
       write_nodetree_nolib(wd, wrld->nodetree);
     }
 
-    write_previews(wd, wrld->preview);
+    write_previews(wd, id_address, wrld->preview);
   }
 }
 
@@ -2445,14 +2831,14 @@ static void write_light(WriteData *wd, Light *la, const void *id_address)
       write_nodetree_nolib(wd, la->nodetree);
     }
 
-    write_previews(wd, la->preview);
+    write_previews(wd, id_address, la->preview);
   }
 }
 
-static void write_collection_nolib(WriteData *wd, Collection *collection)
+static void write_collection_nolib(WriteData *wd, Collection *collection, const void *id_address)
 {
   /* Shared function for collection data-blocks and scene master collection. */
-  write_previews(wd, collection->preview);
+  write_previews(wd, id_address, collection->preview);
 
   LISTBASE_FOREACH (CollectionObject *, cob, &collection->gobject) {
     writestruct(wd, DATA, CollectionObject, 1, cob);
@@ -2476,7 +2862,7 @@ static void write_collection(WriteData *wd, Collection *collection, const void *
     writestruct_at_address(wd, ID_GR, Collection, 1, id_address, collection);
     write_iddata(wd, &collection->id);
 
-    write_collection_nolib(wd, collection);
+    write_collection_nolib(wd, collection, id_address);
   }
 }
 
@@ -2795,7 +3181,7 @@ static void write_scene(WriteData *wd, Scene *sce, const void *id_address)
     write_pointcaches(wd, &(sce->rigidbody_world->shared->ptcaches));
   }
 
-  write_previews(wd, sce->preview);
+  write_previews(wd, id_address, sce->preview);
   write_curvemapping_curves(wd, &sce->r.mblur_shutter_curve);
 
   LISTBASE_FOREACH (ViewLayer *, view_layer, &sce->view_layers) {
@@ -2804,7 +3190,7 @@ static void write_scene(WriteData *wd, Scene *sce, const void *id_address)
 
   if (sce->master_collection) {
     writestruct(wd, DATA, Collection, 1, sce->master_collection);
-    write_collection_nolib(wd, sce->master_collection);
+    write_collection_nolib(wd, sce->master_collection, NULL);
   }
 
   /* Eevee Lightcache */
@@ -3145,7 +3531,7 @@ static void write_screen(WriteData *wd, bScreen *screen, const void *id_address)
     writestruct_at_address(wd, ID_SCRN, bScreen, 1, id_address, screen);
     write_iddata(wd, &screen->id);
 
-    write_previews(wd, screen->preview);
+    write_previews(wd, id_address, screen->preview);
 
     /* direct data */
     write_area_map(wd, AREAMAP_FROM_SCREEN(screen));
@@ -4043,6 +4429,61 @@ static void write_thumb(WriteData *wd, const BlendThumbnail *thumb)
  * \{ */
 
 /* if MemFile * there's filesave to memory */
+/**
+ * Write the index of the ID blocks collected while writing, see #BlendIndexHeader.
+ * Dependencies on IDs which were not written are dropped.
+ */
+static void write_index(WriteData *wd)
+{
+  GHash *entries_index = BLI_ghash_ptr_new_ex(__func__, (uint)wd->index.entries_len);
+  for (int i = 0; i < wd->index.entries_len; i++) {
+    void **val_p;
+    if (!BLI_ghash_ensure_p(entries_index, (void *)wd->index.entries_id[i], &val_p)) {
+      *val_p = POINTER_FROM_INT(i);
+    }
+  }
+
+  const size_t entries_size = sizeof(BlendIndexEntry) * (size_t)wd->index.entries_len;
+  const size_t len = sizeof(BlendIndexHeader) + entries_size +
+                     sizeof(int) * (size_t)wd->index.deps_len + sizeof(BlendIndexFooter);
+  char *data = MEM_mallocN(len, __func__);
+
+  BlendIndexHeader *header = (BlendIndexHeader *)data;
+  BlendIndexEntry *entries = (BlendIndexEntry *)&header[1];
+  int *deps = (int *)POINTER_OFFSET(entries, entries_size);
+  int deps_len = 0;
+
+  memcpy(entries, wd->index.entries, entries_size);
+  for (int i = 0; i < wd->index.entries_len; i++) {
+    BlendIndexEntry *entry = &entries[i];
+    const int deps_start = deps_len;
+    for (int j = 0; j < entry->deps_len; j++) {
+      void **val_p = BLI_ghash_lookup_p(entries_index, wd->index.deps[entry->deps_start + j]);
+      if (val_p) {
+        deps[deps_len++] = POINTER_AS_INT(*val_p);
+      }
+    }
+    entry->deps_start = deps_start;
+    entry->deps_len = deps_len - deps_start;
+  }
+  BLI_ghash_free(entries_index, NULL, NULL);
+
+  header->version = BLEN_INDEX_VERSION;
+  header->subversion = BLENDER_SUBVERSION;
+  header->entries_len = wd->index.entries_len;
+  header->deps_len = deps_len;
+  header->dna_offset = wd->index.dna_offset;
+
+  /* Unresolved dependencies leave a gap, move the footer after the used ones. */
+  const size_t len_used = len - sizeof(int) * (size_t)(wd->index.deps_len - deps_len);
+  BlendIndexFooter *footer = (BlendIndexFooter *)&deps[deps_len];
+  footer->offset = wd->offset;
+  memcpy(footer->magic, BLEN_INDEX_MAGIC, sizeof(footer->magic));
+
+  writedata(wd, DATA, (int)len_used, data);
+  MEM_freeN(data);
+}
+
 static bool write_file_handle(Main *mainvar,
                               WriteWrap *ww,
                               MemFile *compare,
@@ -4058,6 +4499,8 @@ static bool write_file_handle(Main *mainvar,
   blo_split_main(&mainlist, mainvar);
 
   wd = mywrite_begin(ww, compare, current);
+  wd->index.use = !wd->use_memfile;
+  wd->index.use_deps = wd->index.use && (write_flags & G_FILE_INDEX_DEPS);
 
   sprintf(buf,
           "BLENDER%c%c%.3d",
@@ -4139,6 +4582,8 @@ static bool write_file_handle(Main *mainvar,
 
         ((ID *)id_buffer)->tag = 0;
 
+        const int index_entries_len = wd->index.entries_len;
+
         switch ((ID_Type)GS(id->name)) {
           case ID_WM:
             write_windowmanager(wd, (wmWindowManager *)id_buffer, id);
@@ -4267,6 +4712,10 @@ static bool write_file_handle(Main *mainvar,
             break;
         }
 
+        if (wd->index.use_deps && wd->index.entries_len != index_entries_len) {
+          write_index_deps_add(wd, bmain, id);
+        }
+
         if (do_override) {
           BKE_lib_override_library_operations_store_end(override_storage, id);
         }
@@ -4305,8 +4754,13 @@ static bool write_file_handle(Main *mainvar,
    *
    * Note that we *borrow* the pointer to 'DNAstr',
    * so writing each time uses the same address and doesn't cause unnecessary undo overhead. */
+  wd->index.dna_offset = wd->offset;
   writedata(wd, DNA1, wd->sdna->data_len, wd->sdna->data);
 
+  if (wd->index.use) {
+    write_index(wd);
+  }
+
   /* end of file */
   memset(&bhead, 0, sizeof(BHead));
   bhead.code = ENDB;
@@ -4366,46 +4820,20 @@ static bool do_history(const char *name, ReportList *reports)
  * \{ */
 
 /**
+ * Write \a mainvar using \a ww, remapping relative paths for \a filepath when requested.
+ *
  * \return Success.
  */
-bool BLO_write_file(Main *mainvar,
-                    const char *filepath,
-                    int write_flags,
-                    ReportList *reports,
-                    const BlendThumbnail *thumb)
+static bool write_file_main(Main *mainvar,
+                            WriteWrap *ww,
+                            const char *filepath,
+                            int write_flags,
+                            const BlendThumbnail *thumb)
 {
-  char tempname[FILE_MAX + 1];
-  eWriteWrapType ww_type;
-  WriteWrap ww;
-
   /* path backup/restore */
   void *path_list_backup = NULL;
   const int path_list_flag = (BKE_BPATH_TRAVERSE_SKIP_LIBRARY | BKE_BPATH_TRAVERSE_SKIP_MULTIFILE);
 
-  if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
-    BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
-    BLO_main_validate_libraries(mainvar, reports);
-    BLO_main_validate_shapekeys(mainvar, reports);
-  }
-
-  /* open temporary file, so we preserve the original in case we crash */
-  BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
-
-  if (write_flags & G_FILE_COMPRESS) {
-    ww_type = WW_WRAP_ZLIB;
-  }
-  else {
-    ww_type = WW_WRAP_NONE;
-  }
-
-  ww_handle_init(ww_type, &ww);
-
-  if (ww.open(&ww, tempname) == false) {
-    BKE_reportf(
-        reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
-    return 0;
-  }
-
   /* Remapping of relative paths to new file location. */
   if (write_flags & G_FILE_RELATIVE_REMAP) {
     char dir_src[FILE_MAX];
@@ -4439,34 +4867,93 @@ bool BLO_write_file(Main *mainvar,
   }
 
   /* actual file writing */
-  const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
-
-  ww.close(&ww);
+  const bool err = write_file_handle(mainvar, ww, NULL, NULL, write_flags, thumb);
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
     BKE_bpath_list_free(path_list_backup);
   }
 
-  if (err) {
-    BKE_report(reports, RPT_ERROR, strerror(errno));
-    remove(tempname);
-
-    return 0;
-  }
+  return !err;
+}
 
+/**
+ * Replace \a filepath by the temporary file it was written to, keeping file history.
+ *
+ * \return Success.
+ */
+static bool write_file_finalize(const char *tempname,
+                                const char *filepath,
+                                int write_flags,
+                                ReportList *reports)
+{
   /* file save to temporary file was successful */
   /* now do reverse file history (move .blend1 -> .blend2, .blend -> .blend1) */
   if (write_flags & G_FILE_HISTORY) {
     const bool err_hist = do_history(filepath, reports);
     if (err_hist) {
       BKE_report(reports, RPT_ERROR, "Version backup failed (file saved with @)");
-      return 0;
+      return false;
     }
   }
 
   if (BLI_rename(tempname, filepath) != 0) {
     BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * \return Success.
+ */
+bool BLO_write_file(Main *mainvar,
+                    const char *filepath,
+                    int write_flags,
+                    ReportList *reports,
+                    const BlendThumbnail *thumb)
+{
+  char tempname[FILE_MAX + 1];
+  eWriteWrapType ww_type;
+  WriteWrap ww;
+
+  if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
+    BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
+    BLO_main_validate_libraries(mainvar, reports);
+    BLO_main_validate_shapekeys(mainvar, reports);
+  }
+
+  /* open temporary file, so we preserve the original in case we crash */
+  BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
+
+  if (write_flags & G_FILE_COMPRESS) {
+    ww_type = WW_WRAP_ZLIB;
+  }
+  else {
+    ww_type = WW_WRAP_NONE;
+  }
+
+  ww_handle_init(ww_type, &ww);
+
+  if (ww.open(&ww, tempname) == false) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
+    return 0;
+  }
+
+  const bool ok = write_file_main(mainvar, &ww, filepath, write_flags, thumb);
+
+  ww.close(&ww);
+
+  if (!ok) {
+    BKE_report(reports, RPT_ERROR, strerror(errno));
+    remove(tempname);
+
+    return 0;
+  }
+
+  if (!write_file_finalize(tempname, filepath, write_flags, reports)) {
     return 0;
   }
 
@@ -4478,9 +4965,105 @@ bool BLO_write_file(Main *mainvar,
   return 1;
 }
 
+/** A file serialized in memory, to be written to disk later. */
+typedef struct BlendWriteSnapshot {
+  char filepath[FILE_MAX];
+  int write_flags;
+  /** Chunks are allocated together with their data, see #ww_write_memfile. */
+  MemFile memfile;
+} BlendWriteSnapshot;
+
+/**
+ * Serialize \a mainvar as it would be saved to \a filepath, without writing anything to disk.
+ * This is the part of saving that needs access to \a mainvar,
+ * #BLO_write_file_snapshot_write can then run in a background thread.
+ *
+ * \return The snapshot, or NULL on failure.
+ */
+BlendWriteSnapshot *BLO_write_file_snapshot(Main *mainvar,
+                                            const char *filepath,
+                                            int write_flags,
+                                            ReportList *reports,
+                                            const BlendThumbnail *thumb)
+{
+  BlendWriteSnapshot *snapshot = MEM_callocN(sizeof(*snapshot), __func__);
+  WriteWrap ww;
+
+  if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
+    BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
+    BLO_main_validate_libraries(mainvar, reports);
+    BLO_main_validate_shapekeys(mainvar, reports);
+  }
+
+  BLI_strncpy(snapshot->filepath, filepath, sizeof(snapshot->filepath));
+  snapshot->write_flags = write_flags;
+
+  ww_handle_init(WW_WRAP_MEMFILE, &ww);
+  ww._user_data.memfile = &snapshot->memfile;
+
+  if (!write_file_main(mainvar, &ww, filepath, write_flags, thumb)) {
+    BKE_report(reports, RPT_ERROR, "Cannot serialize file for saving");
+    BLO_write_file_snapshot_free(snapshot);
+    return NULL;
+  }
+
+  return snapshot;
+}
+
 /**
+ * Write a snapshot to disk, compressing it when requested. Doesn't access any Blender data,
+ * so this is safe to call from any thread.
+ *
  * \return Success.
  */
+bool BLO_write_file_snapshot_write(BlendWriteSnapshot *snapshot, ReportList *reports)
+{
+  char tempname[FILE_MAX + 1];
+  WriteWrap ww;
+
+  /* open temporary file, so we preserve the original in case we crash */
+  BLI_snprintf(tempname, sizeof(tempname), "%s@", snapshot->filepath);
+
+  ww_handle_init((snapshot->write_flags & G_FILE_COMPRESS) ? WW_WRAP_ZLIB : WW_WRAP_NONE, &ww);
+
+  if (ww.open(&ww, tempname) == false) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
+    return false;
+  }
+
+  bool ok = true;
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &snapshot->memfile.chunks) {
+    if (ww.write(&ww, chunk->buf, chunk->size) != chunk->size) {
+      ok = false;
+      break;
+    }
+  }
+
+  if (!ww.close(&ww)) {
+    ok = false;
+  }
+
+  if (!ok) {
+    BKE_report(reports, RPT_ERROR, strerror(errno));
+    remove(tempname);
+
+    return false;
+  }
+
+  return write_file_finalize(tempname, snapshot->filepath, snapshot->write_flags, reports);
+}
+
+/**
+ * Free a snapshot, chunks own their data so this is safe to call from any thread.
+ */
+void BLO_write_file_snapshot_free(BlendWriteSnapshot *snapshot)
+{
+  /* Not #BLO_memfile_free, the chunks aren't in the shared undo buffers. */
+  BLI_freelistN(&snapshot->memfile.chunks);
+  MEM_freeN(snapshot);
+}
+
 bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int write_flags)
 {
   write_flags &= ~G_FILE_USERPREFS;
@@ -93,6 +93,12 @@ void DEG_graph_relations_update(struct Depsgraph *graph,
 /* Tag all relations in the database for update.*/
 void DEG_relations_tag_update(struct Main *bmain);
 
+/* Tag relations for update after a change which only affects relations of the given ID, such as
+ * changing its parent or adding it to the database. Graphs which are not tagged for a full update
+ * then only rebuild relations of the tagged IDs and their neighbors.
+ * IDs which are to be deleted are to be tagged before they are freed. */
+void DEG_relations_tag_update_id(struct Main *bmain, struct ID *id);
+
 /* Add Dependencies  ----------------------------- */
 
 /* Handle for components to define their dependencies from callbacks.
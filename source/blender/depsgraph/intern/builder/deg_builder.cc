@@ -201,43 +201,158 @@ void deg_graph_build_flush_visibility(Depsgraph *graph)
   BLI_stack_free(stack);
 }
 
+void deg_graph_build_flush_visibility_incremental(const Set<IDNode *> &built_id_nodes,
+                                                  const Vector<Relation *> &new_relations,
+                                                  Set<IDNode *> *r_id_nodes)
+{
+  /* Components of the built IDs got their visibility reset, the other ones keep it. Same as eval
+   * flags, visibility is only accumulated by the incremental build. */
+  Vector<ComponentNode *> stack;
+  auto flush_to_component = [&](ComponentNode *comp_node) {
+    if (!comp_node->affects_directly_visible) {
+      comp_node->affects_directly_visible = true;
+      stack.append(comp_node);
+      r_id_nodes->add(comp_node->owner);
+    }
+  };
+  for (IDNode *id_node : built_id_nodes) {
+    for (ComponentNode *comp_node : id_node->components.values()) {
+      comp_node->affects_directly_visible |= id_node->is_directly_visible;
+      for (OperationNode *op_node : comp_node->operations) {
+        for (Relation *rel : op_node->outlinks) {
+          if (rel->to->type == NodeType::OPERATION) {
+            OperationNode *op_to = (OperationNode *)rel->to;
+            comp_node->affects_directly_visible |= op_to->owner->affects_directly_visible;
+          }
+        }
+      }
+      if (comp_node->affects_directly_visible) {
+        stack.append(comp_node);
+      }
+    }
+  }
+  for (Relation *rel : new_relations) {
+    if (rel->from->type == NodeType::OPERATION && rel->to->type == NodeType::OPERATION) {
+      OperationNode *op_from = (OperationNode *)rel->from;
+      OperationNode *op_to = (OperationNode *)rel->to;
+      if (op_to->owner->affects_directly_visible) {
+        flush_to_component(op_from->owner);
+      }
+    }
+  }
+  while (!stack.is_empty()) {
+    ComponentNode *comp_node = stack.pop_last();
+    for (OperationNode *op_node : comp_node->operations) {
+      for (Relation *rel : op_node->inlinks) {
+        if (rel->from->type == NodeType::OPERATION) {
+          flush_to_component(((OperationNode *)rel->from)->owner);
+        }
+      }
+    }
+  }
+}
+
+/* Re-tag ID for update if it was tagged before the relations update tag. */
+void deg_graph_build_tag_id_node(Main *bmain, Depsgraph *graph, IDNode *id_node)
+{
+  ID *id_orig = id_node->id_orig;
+  int flag = 0;
+  /* Tag rebuild if special evaluation flags changed. */
+  if (id_node->eval_flags != id_node->previous_eval_flags) {
+    flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
+  }
+  /* Tag rebuild if the custom data mask changed. */
+  if (id_node->customdata_masks != id_node->previous_customdata_masks) {
+    flag |= ID_RECALC_GEOMETRY;
+  }
+  if (!deg_copy_on_write_is_expanded(id_node->id_cow)) {
+    flag |= ID_RECALC_COPY_ON_WRITE;
+    /* This means ID is being added to the dependency graph first
+     * time, which is similar to "ob-visible-change" */
+    if (GS(id_orig->name) == ID_OB) {
+      flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
+    }
+  }
+  /* Restore recalc flags from original ID, which could possibly contain recalc flags set by
+   * an operator and then were carried on by the undo system. */
+  flag |= id_orig->recalc;
+  if (flag != 0) {
+    graph_id_tag_update(bmain, graph, id_node->id_orig, flag, DEG_UPDATE_SOURCE_RELATIONS);
+  }
+}
+
 }  // namespace
 
+static void add_operation_owner(Node *node, Set<IDNode *> *r_id_nodes)
+{
+  if (node->type == NodeType::OPERATION) {
+    r_id_nodes->add(static_cast<OperationNode *>(node)->owner->owner);
+  }
+}
+
+void deg_graph_remove_node_relations(Node *node, Set<IDNode *> *r_id_nodes)
+{
+  while (!node->inlinks.is_empty()) {
+    Relation *rel = node->inlinks.last();
+    add_operation_owner(rel->from, r_id_nodes);
+    rel->unlink();
+    OBJECT_GUARDED_DELETE(rel, Relation);
+  }
+  while (!node->outlinks.is_empty()) {
+    Relation *rel = node->outlinks.last();
+    add_operation_owner(rel->to, r_id_nodes);
+    rel->unlink();
+    OBJECT_GUARDED_DELETE(rel, Relation);
+  }
+}
+
 void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
 {
   /* Make sure dependencies of visible ID datablocks are visible. */
   deg_graph_build_flush_visibility(graph);
   deg_graph_remove_unused_noops(graph);
 
-  /* Re-tag IDs for update if it was tagged before the relations
-   * update tag. */
   for (IDNode *id_node : graph->id_nodes) {
-    ID *id_orig = id_node->id_orig;
     id_node->finalize_build(graph);
-    int flag = 0;
-    /* Tag rebuild if special evaluation flags changed. */
-    if (id_node->eval_flags != id_node->previous_eval_flags) {
-      flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
-    }
-    /* Tag rebuild if the custom data mask changed. */
-    if (id_node->customdata_masks != id_node->previous_customdata_masks) {
-      flag |= ID_RECALC_GEOMETRY;
-    }
-    if (!deg_copy_on_write_is_expanded(id_node->id_cow)) {
-      flag |= ID_RECALC_COPY_ON_WRITE;
-      /* This means ID is being added to the dependency graph first
-       * time, which is similar to "ob-visible-change" */
-      if (GS(id_orig->name) == ID_OB) {
-        flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
-      }
-    }
-    /* Restore recalc flags from original ID, which could possibly contain recalc flags set by
-     * an operator and then were carried on by the undo system. */
-    flag |= id_orig->recalc;
-    if (flag != 0) {
-      graph_id_tag_update(bmain, graph, id_node->id_orig, flag, DEG_UPDATE_SOURCE_RELATIONS);
+    deg_graph_build_tag_id_node(bmain, graph, id_node);
+  }
+}
+
+void deg_graph_build_finalize_incremental(Main *bmain,
+                                          Depsgraph *graph,
+                                          const Set<IDNode *> &built_id_nodes,
+                                          const Set<IDNode *> &relations_id_nodes,
+                                          const Vector<Relation *> &new_relations,
+                                          Set<IDNode *> *r_updated_id_nodes)
+{
+  /* Components of the other IDs are finalized already. */
+  for (IDNode *id_node : built_id_nodes) {
+    id_node->finalize_build(graph);
+    r_updated_id_nodes->add(id_node);
+  }
+  for (IDNode *id_node : relations_id_nodes) {
+    r_updated_id_nodes->add(id_node);
+  }
+  deg_graph_build_flush_visibility_incremental(built_id_nodes, new_relations, r_updated_id_nodes);
+  /* No-op operations only become unused ones when they lose relations to other operations, or
+   * when relations to them are added while they are unused. */
+  Set<IDNode *> noop_id_nodes;
+  for (IDNode *id_node : relations_id_nodes) {
+    noop_id_nodes.add(id_node);
+  }
+  for (Relation *rel : new_relations) {
+    if (rel->to->type == NodeType::OPERATION) {
+      noop_id_nodes.add(((OperationNode *)rel->to)->owner->owner);
     }
   }
+  deg_graph_remove_unused_noops(graph, noop_id_nodes);
+  for (IDNode *id_node : *r_updated_id_nodes) {
+    id_node->visible_components_mask = id_node->get_visible_components_mask();
+    deg_graph_build_tag_id_node(bmain, graph, id_node);
+    /* Kept IDs are not re-opened by the next build, compare against this one from now on. */
+    id_node->previous_eval_flags = id_node->eval_flags;
+    id_node->previous_customdata_masks = id_node->customdata_masks;
+  }
 }
 
 }  // namespace DEG
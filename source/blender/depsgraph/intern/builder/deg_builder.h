@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include "intern/depsgraph_type.h"
+
 struct Base;
 struct ID;
 struct Main;
@@ -33,6 +35,9 @@ namespace DEG {
 
 struct Depsgraph;
 class DepsgraphBuilderCache;
+struct IDNode;
+struct Node;
+struct Relation;
 
 class DepsgraphBuilder {
  public:
@@ -58,4 +63,19 @@ bool deg_check_id_in_depsgraph(const Depsgraph *graph, ID *id_orig);
 bool deg_check_base_in_depsgraph(const Depsgraph *graph, Base *base);
 void deg_graph_build_finalize(Main *bmain, Depsgraph *graph);
 
+/* Finalize incremental build, see DepsgraphNodeBuilder::begin_build_incremental(). Only nodes of
+ * the built IDs, IDs which relations were built and IDs which became visible are updated, those
+ * are added to r_updated_id_nodes. */
+void deg_graph_build_finalize_incremental(Main *bmain,
+                                          Depsgraph *graph,
+                                          const Set<IDNode *> &built_id_nodes,
+                                          const Set<IDNode *> &relations_id_nodes,
+                                          const Vector<Relation *> &new_relations,
+                                          Set<IDNode *> *r_updated_id_nodes);
+
+/* Remove and free all relations of the node. ID nodes of operations on the other side of the
+ * removed relations are added to the given set, used by incremental builds to find IDs which
+ * relations are to be built again. */
+void deg_graph_remove_node_relations(Node *node, Set<IDNode *> *r_id_nodes);
+
 }  // namespace DEG
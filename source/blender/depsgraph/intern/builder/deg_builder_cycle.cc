@@ -232,6 +232,70 @@ void deg_graph_detect_cycles(Depsgraph *graph)
   while (schedule_non_checked_node(&state)) {
     solve_cycles(&state);
   }
+  graph->has_cyclic_relations = (state.num_cycles != 0);
+}
+
+void deg_graph_detect_cycles_incremental(Depsgraph *graph, const Vector<Relation *> &relations)
+{
+  if (graph->has_cyclic_relations) {
+    deg_graph_detect_cycles(graph);
+    return;
+  }
+  /* The graph had no cycles, so any cycle goes through one of the relations and only consists of
+   * operations which are reachable from them. */
+  Set<OperationNode *> reachable_nodes;
+  Vector<OperationNode *> stack;
+  for (Relation *rel : relations) {
+    if (rel->from->type == NodeType::OPERATION && rel->to->type == NodeType::OPERATION) {
+      OperationNode *to = (OperationNode *)rel->to;
+      if (reachable_nodes.add(to)) {
+        stack.append(to);
+      }
+    }
+  }
+  while (!stack.is_empty()) {
+    OperationNode *node = stack.pop_last();
+    for (Relation *rel : node->outlinks) {
+      if (rel->to->type == NodeType::OPERATION) {
+        OperationNode *to = (OperationNode *)rel->to;
+        if (reachable_nodes.add(to)) {
+          stack.append(to);
+        }
+      }
+    }
+  }
+  /* Sort the reachable operations topologically, which is only possible without cycles. */
+  Map<OperationNode *, int> num_pending_inlinks;
+  for (OperationNode *node : reachable_nodes) {
+    int num_inlinks = 0;
+    for (Relation *rel : node->inlinks) {
+      if (rel->from->type == NodeType::OPERATION &&
+          reachable_nodes.contains((OperationNode *)rel->from)) {
+        num_inlinks++;
+      }
+    }
+    num_pending_inlinks.add_new(node, num_inlinks);
+    if (num_inlinks == 0) {
+      stack.append(node);
+    }
+  }
+  int num_sorted_nodes = 0;
+  while (!stack.is_empty()) {
+    OperationNode *node = stack.pop_last();
+    num_sorted_nodes++;
+    for (Relation *rel : node->outlinks) {
+      if (rel->to->type != NodeType::OPERATION) {
+        continue;
+      }
+      int *num_inlinks = num_pending_inlinks.lookup_ptr((OperationNode *)rel->to);
+      if (--(*num_inlinks) == 0) {
+        stack.append((OperationNode *)rel->to);
+      }
+    }
+  }
+  if (num_sorted_nodes != reachable_nodes.size()) {
+    deg_graph_detect_cycles(graph);
+  }
 }
 
 }  // namespace DEG
@@ -23,11 +23,18 @@
 
 #pragma once
 
+#include "intern/depsgraph_type.h"
+
 namespace DEG {
 
 struct Depsgraph;
+struct Relation;
 
 /* Detect and solve dependency cycles. */
 void deg_graph_detect_cycles(Depsgraph *graph);
 
+/* Same as above, for a graph which only got the given relations added since cycles were
+ * detected last time. Only the part of the graph which is reachable from them is checked. */
+void deg_graph_detect_cycles_incremental(Depsgraph *graph, const Vector<Relation *> &relations);
+
 }  // namespace DEG
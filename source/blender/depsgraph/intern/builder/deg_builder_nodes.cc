@@ -119,6 +119,25 @@
 
 namespace DEG {
 
+namespace {
+
+/* Tags of nodes used by the incremental build, see begin_build_incremental(). */
+enum {
+  /* Node was built by the current build. For ID nodes: builder of the ID did run. */
+  NODE_INCREMENTAL_BUILT = (1 << 0),
+  /* ID node which builder runs again, nodes of the other IDs are kept as they are. */
+  NODE_INCREMENTAL_DIRTY = (1 << 1),
+  /* ID node which is used by the current state of the graph. */
+  NODE_INCREMENTAL_REACHED = (1 << 2),
+};
+
+bool is_id_node_kept(const IDNode *id_node)
+{
+  return (id_node->custom_flags & NODE_INCREMENTAL_DIRTY) == 0;
+}
+
+}  // namespace
+
 /* ************ */
 /* Node Builder */
 
@@ -132,7 +151,11 @@ DepsgraphNodeBuilder::DepsgraphNodeBuilder(Main *bmain,
       view_layer_(nullptr),
       view_layer_index_(-1),
       collection_(nullptr),
-      is_parent_collection_visible_(true)
+      is_parent_collection_visible_(true),
+      is_incremental_build_(false),
+      changed_id_nodes_(nullptr),
+      neighbor_id_nodes_(nullptr),
+      built_id_nodes_(nullptr)
 {
 }
 
@@ -147,8 +170,87 @@ DepsgraphNodeBuilder::~DepsgraphNodeBuilder()
   }
 }
 
+DepsgraphNodeBuilder::StackEntry::StackEntry(DepsgraphNodeBuilder *builder, ID *id)
+    : builder_(builder)
+{
+  IDNode *id_node = builder->add_id_node(id);
+  if (builder->is_incremental_build_) {
+    id_node->custom_flags |= NODE_INCREMENTAL_BUILT;
+  }
+  builder->builder_stack_.append(id_node);
+}
+
+DepsgraphNodeBuilder::StackEntry::~StackEntry()
+{
+  builder_->builder_stack_.remove_last();
+}
+
+void DepsgraphNodeBuilder::tag_id_node_used(IDNode *id_node)
+{
+  if (!builder_stack_.is_empty()) {
+    id_node->add_builder_user(builder_stack_.last());
+  }
+}
+
+IDNode *DepsgraphNodeBuilder::reach_id_node(ID *id)
+{
+  IDNode *id_node = graph_->find_id_node(id);
+  if (id_node == nullptr || (id_node->custom_flags & NODE_INCREMENTAL_REACHED)) {
+    return id_node;
+  }
+  /* The ID was freed and a new one was allocated at the same address. Only the users of freed
+   * IDs are tagged for relations update, so the node is only reached through those. */
+  if (id->session_uuid != id_node->id_orig_session_uuid) {
+    Vector<IDNode *> removed_id_nodes;
+    removed_id_nodes.append(id_node);
+    remove_id_nodes(removed_id_nodes);
+    return nullptr;
+  }
+  id_node->custom_flags |= NODE_INCREMENTAL_REACHED;
+  reached_id_nodes_.append(id_node);
+  return id_node;
+}
+
+bool DepsgraphNodeBuilder::check_is_built(ID *id, int tag)
+{
+  IDNode *id_node = nullptr;
+  if (is_incremental_build_) {
+    id_node = reach_id_node(id);
+    if (id_node != nullptr && is_id_node_kept(id_node)) {
+      tag_id_node_used(id_node);
+      return true;
+    }
+  }
+  if (!built_map_.checkIsBuilt(id, tag)) {
+    return false;
+  }
+  if (id_node == nullptr) {
+    id_node = graph_->find_id_node(id);
+  }
+  if (id_node != nullptr) {
+    tag_id_node_used(id_node);
+  }
+  return true;
+}
+
+bool DepsgraphNodeBuilder::check_is_built_and_tag(ID *id, int tag)
+{
+  if (check_is_built(id, tag)) {
+    return true;
+  }
+  built_map_.tagBuild(id, tag);
+  return false;
+}
+
 IDNode *DepsgraphNodeBuilder::add_id_node(ID *id)
 {
+  if (is_incremental_build_) {
+    IDNode *id_node = reach_id_node(id);
+    if (id_node != nullptr) {
+      tag_id_node_used(id_node);
+      return id_node;
+    }
+  }
   IDNode *id_node = nullptr;
   ID *id_cow = nullptr;
   IDComponentsMask previously_visible_components_mask = 0;
@@ -178,7 +280,15 @@ IDNode *DepsgraphNodeBuilder::add_id_node(ID *id)
         "",
         -1);
     graph_->operations.push_back(op_cow);
+    if (is_incremental_build_) {
+      id_node->custom_flags = NODE_INCREMENTAL_DIRTY | NODE_INCREMENTAL_REACHED;
+      comp_cow->custom_flags = NODE_INCREMENTAL_BUILT;
+      op_cow->custom_flags = NODE_INCREMENTAL_BUILT;
+      changed_id_nodes_->add(id_node);
+      built_id_nodes_->add(id_node);
+    }
   }
+  tag_id_node_used(id_node);
   return id_node;
 }
 
@@ -197,6 +307,19 @@ ComponentNode *DepsgraphNodeBuilder::add_component_node(ID *id,
                                                         const char *comp_name)
 {
   IDNode *id_node = add_id_node(id);
+  if (!builder_stack_.is_empty()) {
+    id_node->add_builder_shared_id_node(builder_stack_.last());
+  }
+  if (is_incremental_build_) {
+    ComponentNode *comp_node = id_node->find_component(comp_type, comp_name);
+    if (comp_node == nullptr) {
+      comp_node = id_node->add_component(comp_type, comp_name);
+      changed_id_nodes_->add(id_node);
+      built_id_nodes_->add(id_node);
+    }
+    comp_node->custom_flags = NODE_INCREMENTAL_BUILT;
+    return comp_node;
+  }
   ComponentNode *comp_node = id_node->add_component(comp_type, comp_name);
   comp_node->owner = id_node;
   return comp_node;
@@ -210,8 +333,27 @@ OperationNode *DepsgraphNodeBuilder::add_operation_node(ComponentNode *comp_node
 {
   OperationNode *op_node = comp_node->find_operation(opcode, name, name_tag);
   if (op_node == nullptr) {
+    if (comp_node->operations_map == nullptr) {
+      /* Component of an ID kept from the previous build. */
+      comp_node->reopen_operations_map();
+      built_id_nodes_->add(comp_node->owner);
+    }
     op_node = comp_node->add_operation(op, opcode, name, name_tag);
     graph_->operations.push_back(op_node);
+    if (is_incremental_build_) {
+      op_node->custom_flags = NODE_INCREMENTAL_BUILT;
+      changed_id_nodes_->add(comp_node->owner);
+    }
+  }
+  else if (is_incremental_build_ && is_id_node_kept(comp_node->owner)) {
+    /* Operation of a kept ID which is added by the builder of another ID. */
+    op_node->evaluate = op;
+  }
+  else if (is_incremental_build_ && (op_node->custom_flags & NODE_INCREMENTAL_BUILT) == 0) {
+    /* Operation is kept from the previous build, bind it to the current state. */
+    op_node->evaluate = op;
+    op_node->flag &= ~OperationFlag::DEPSOP_FLAG_PINNED;
+    op_node->custom_flags = NODE_INCREMENTAL_BUILT;
   }
   else {
     fprintf(stderr,
@@ -278,7 +420,13 @@ OperationNode *DepsgraphNodeBuilder::find_operation_node(ID *id,
                                                          int name_tag)
 {
   ComponentNode *comp_node = add_component_node(id, comp_type, comp_name);
-  return comp_node->find_operation(opcode, name, name_tag);
+  OperationNode *op_node = comp_node->find_operation(opcode, name, name_tag);
+  if (is_incremental_build_ && op_node != nullptr && !is_id_node_kept(comp_node->owner) &&
+      (op_node->custom_flags & NODE_INCREMENTAL_BUILT) == 0) {
+    /* Operation is kept from the previous build, but was not built yet. */
+    return nullptr;
+  }
+  return op_node;
 }
 
 OperationNode *DepsgraphNodeBuilder::find_operation_node(
@@ -376,6 +524,244 @@ void DepsgraphNodeBuilder::end_build()
   }
 }
 
+void DepsgraphNodeBuilder::begin_build_incremental(Set<IDNode *> *changed_id_nodes,
+                                                   Set<IDNode *> *neighbor_id_nodes,
+                                                   Set<IDNode *> *built_id_nodes)
+{
+  is_incremental_build_ = true;
+  changed_id_nodes_ = changed_id_nodes;
+  neighbor_id_nodes_ = neighbor_id_nodes;
+  built_id_nodes_ = built_id_nodes;
+  /* Builders of the IDs tagged for relations update run again. So do builders of scenes and
+   * collections, which are cheap and through which new IDs are reached. Builders which add
+   * components to the same IDs run together, see IDNode::builder_shared_id_nodes.
+   *
+   * The tagged IDs might be freed already, their nodes are found without de-referencing them. */
+  Vector<IDNode *> dirty_id_nodes;
+  for (IDNode *id_node : graph_->id_nodes) {
+    id_node->custom_flags = 0;
+    if (id_node->id_type == ID_OB) {
+      /* Bases are assigned by the view layer builder, which always runs. */
+      id_node->linked_state = DEG_ID_LINKED_INDIRECTLY;
+      id_node->has_base = false;
+    }
+    if (ELEM(id_node->id_type, ID_SCE, ID_GR) ||
+        graph_->relations_update_ids.contains(id_node->id_orig)) {
+      id_node->custom_flags = NODE_INCREMENTAL_DIRTY;
+      dirty_id_nodes.append(id_node);
+    }
+  }
+  for (int i = 0; i < dirty_id_nodes.size(); i++) {
+    IDNode *dirty_id_node = dirty_id_nodes[i];
+    for (IDNode *id_node : dirty_id_node->builder_shared_id_nodes) {
+      if (is_id_node_kept(id_node)) {
+        id_node->custom_flags = NODE_INCREMENTAL_DIRTY;
+        dirty_id_nodes.append(id_node);
+      }
+    }
+  }
+  /* Bring nodes of the IDs which builders run again to the state they had during the build. */
+  for (IDNode *id_node : dirty_id_nodes) {
+    id_node->reopen_build();
+    id_node->clear_builder_used_id_nodes();
+    built_id_nodes_->add(id_node);
+    for (ComponentNode *comp_node : id_node->components.values()) {
+      comp_node->custom_flags = 0;
+      for (OperationNode *op_node : comp_node->operations_map->values()) {
+        op_node->custom_flags = 0;
+      }
+    }
+  }
+}
+
+void DepsgraphNodeBuilder::build_incremental_id(IDNode *id_node)
+{
+  /* Visibility is only accumulated by incremental builds, use the one of the previous build. */
+  const bool is_visible = id_node->is_directly_visible;
+  switch (id_node->id_type) {
+    case ID_OB:
+      build_object(-1, (Object *)id_node->id_orig, DEG_ID_LINKED_INDIRECTLY, is_visible);
+      break;
+    case ID_GR: {
+      const bool is_current_parent_collection_visible = is_parent_collection_visible_;
+      is_parent_collection_visible_ = is_visible;
+      build_collection(nullptr, (Collection *)id_node->id_orig);
+      is_parent_collection_visible_ = is_current_parent_collection_visible;
+      break;
+    }
+    default:
+      build_id(id_node->id_orig);
+      break;
+  }
+}
+
+void DepsgraphNodeBuilder::end_build_incremental()
+{
+  /* Builders of the kept IDs did not run, IDs they use are reached through the builder links of
+   * the previous build. Builders of such IDs which are to run again and did not run yet are run
+   * here, until no more IDs get reached. */
+  int num_expanded_id_nodes = 0;
+  while (num_expanded_id_nodes < reached_id_nodes_.size()) {
+    Vector<IDNode *> unbuilt_id_nodes;
+    while (num_expanded_id_nodes < reached_id_nodes_.size()) {
+      IDNode *id_node = reached_id_nodes_[num_expanded_id_nodes++];
+      if (!is_id_node_kept(id_node)) {
+        continue;
+      }
+      for (IDNode *id_node_used : id_node->builder_used_id_nodes) {
+        if ((id_node_used->custom_flags & NODE_INCREMENTAL_REACHED) == 0) {
+          id_node_used->custom_flags |= NODE_INCREMENTAL_REACHED;
+          reached_id_nodes_.append(id_node_used);
+        }
+        if (!is_id_node_kept(id_node_used) &&
+            (id_node_used->custom_flags & NODE_INCREMENTAL_BUILT) == 0) {
+          unbuilt_id_nodes.append(id_node_used);
+        }
+      }
+    }
+    for (IDNode *id_node : unbuilt_id_nodes) {
+      if ((id_node->custom_flags & NODE_INCREMENTAL_BUILT) == 0) {
+        build_incremental_id(id_node);
+      }
+    }
+  }
+  /* Remove nodes which were not built again. */
+  Vector<IDNode *> removed_id_nodes;
+  Set<OperationNode *> removed_operations;
+  Vector<ComponentNode *> removed_components;
+  for (IDNode *id_node : graph_->id_nodes) {
+    if ((id_node->custom_flags & NODE_INCREMENTAL_REACHED) == 0) {
+      removed_id_nodes.append(id_node);
+      continue;
+    }
+    if (is_id_node_kept(id_node)) {
+      /* Kept objects which are no longer in the view layer lose their base flags. */
+      if (id_node->id_type == ID_OB && !id_node->has_base) {
+        ComponentNode *comp_node = id_node->find_component(NodeType::OBJECT_FROM_LAYER);
+        OperationNode *op_node = (comp_node != nullptr) ?
+                                     comp_node->find_operation(OperationCode::OBJECT_BASE_FLAGS) :
+                                     nullptr;
+        if (op_node != nullptr) {
+          removed_operations.add(op_node);
+        }
+      }
+      continue;
+    }
+    for (ComponentNode *comp_node : id_node->components.values()) {
+      if (comp_node->type == NodeType::COPY_ON_WRITE) {
+        continue;
+      }
+      const bool is_component_built = (comp_node->custom_flags & NODE_INCREMENTAL_BUILT) != 0;
+      for (OperationNode *op_node : comp_node->operations_map->values()) {
+        if (!is_component_built || (op_node->custom_flags & NODE_INCREMENTAL_BUILT) == 0) {
+          removed_operations.add(op_node);
+        }
+      }
+      if (!is_component_built) {
+        removed_components.append(comp_node);
+      }
+    }
+  }
+  remove_operations(removed_operations);
+  for (OperationNode *op_node : removed_operations) {
+    ComponentNode *comp_node = op_node->owner;
+    IDNode *id_node = comp_node->owner;
+    changed_id_nodes_->add(id_node);
+    if (is_id_node_kept(id_node)) {
+      if (comp_node->operations_map == nullptr) {
+        comp_node->reopen_operations_map();
+        built_id_nodes_->add(id_node);
+      }
+      comp_node->remove_operation(op_node);
+      if (comp_node->operations_map->is_empty()) {
+        removed_components.append(comp_node);
+      }
+    }
+    else if (comp_node->custom_flags & NODE_INCREMENTAL_BUILT) {
+      comp_node->remove_operation(op_node);
+    }
+  }
+  for (ComponentNode *comp_node : removed_components) {
+    comp_node->owner->remove_component(comp_node);
+  }
+  remove_id_nodes(removed_id_nodes);
+}
+
+void DepsgraphNodeBuilder::remove_operations(const Set<OperationNode *> &operations)
+{
+  if (operations.is_empty()) {
+    return;
+  }
+  for (OperationNode *op_node : operations) {
+    deg_graph_remove_node_relations(op_node, neighbor_id_nodes_);
+    if (graph_->entry_tags.contains(op_node)) {
+      graph_->entry_tags.remove(op_node);
+    }
+  }
+  graph_->operations.erase(std::remove_if(graph_->operations.begin(),
+                                          graph_->operations.end(),
+                                          [&](OperationNode *op_node) {
+                                            return operations.contains(op_node);
+                                          }),
+                           graph_->operations.end());
+}
+
+void DepsgraphNodeBuilder::remove_id_nodes(const Vector<IDNode *> &id_nodes)
+{
+  if (id_nodes.is_empty()) {
+    return;
+  }
+  Set<OperationNode *> removed_operations;
+  Vector<OperationNode *> operations;
+  for (IDNode *id_node : id_nodes) {
+    for (ComponentNode *comp_node : id_node->components.values()) {
+      comp_node->get_operations(operations);
+    }
+  }
+  for (OperationNode *op_node : operations) {
+    removed_operations.add(op_node);
+  }
+  remove_operations(removed_operations);
+  Set<IDNode *> removed_id_nodes;
+  for (IDNode *id_node : id_nodes) {
+    removed_id_nodes.add(id_node);
+    graph_->id_hash.remove(id_node->id_orig);
+    id_node->clear_builder_links();
+    if (neighbor_id_nodes_->contains(id_node)) {
+      neighbor_id_nodes_->remove(id_node);
+    }
+    if (changed_id_nodes_->contains(id_node)) {
+      changed_id_nodes_->remove(id_node);
+    }
+    if (built_id_nodes_->contains(id_node)) {
+      built_id_nodes_->remove(id_node);
+    }
+  }
+  graph_->id_nodes.erase(std::remove_if(graph_->id_nodes.begin(),
+                                        graph_->id_nodes.end(),
+                                        [&](IDNode *id_node) {
+                                          return removed_id_nodes.contains(id_node);
+                                        }),
+                         graph_->id_nodes.end());
+  /* Free copy-on-write datablocks in the same order as Depsgraph::clear_id_nodes() does, the
+   * original IDs might be freed already. */
+  for (const bool free_particle_settings : {false, true}) {
+    for (IDNode *id_node : id_nodes) {
+      if ((id_node->id_type == ID_PA) != free_particle_settings) {
+        continue;
+      }
+      if (id_node->id_cow != id_node->id_orig && id_node->id_cow != nullptr) {
+        deg_free_copy_on_write_datablock(id_node->id_cow);
+        MEM_freeN(id_node->id_cow);
+      }
+      id_node->id_cow = nullptr;
+    }
+  }
+  for (IDNode *id_node : id_nodes) {
+    OBJECT_GUARDED_DELETE(id_node, IDNode);
+  }
+}
+
 void DepsgraphNodeBuilder::build_id(ID *id)
 {
   if (id == nullptr) {
@@ -471,6 +857,12 @@ void DepsgraphNodeBuilder::build_id(ID *id)
     case ID_SIM:
       build_simulation((Simulation *)id);
       break;
+    case ID_GD:
+      build_gpencil((bGPdata *)id);
+      break;
+    case ID_PA:
+      build_particle_settings((ParticleSettings *)id);
+      break;
     default:
       fprintf(stderr, "Unhandled ID %s\n", id->name);
       BLI_assert(!"Should never happen");
@@ -497,8 +889,8 @@ void DepsgraphNodeBuilder::build_collection(LayerCollection *from_layer_collecti
                                                                   COLLECTION_RESTRICT_RENDER;
   const bool is_collection_restricted = (collection->flag & restrict_flag);
   const bool is_collection_visible = !is_collection_restricted && is_parent_collection_visible_;
-  IDNode *id_node;
-  if (built_map_.checkIsBuiltAndTag(collection)) {
+  IDNode *id_node = nullptr;
+  if (check_is_built_and_tag(collection)) {
     id_node = find_id_node(&collection->id);
     if (is_collection_visible && id_node->is_directly_visible == false &&
         id_node->is_collection_fully_expanded == true) {
@@ -514,7 +906,8 @@ void DepsgraphNodeBuilder::build_collection(LayerCollection *from_layer_collecti
       return;
     }
   }
-  else {
+  StackEntry stack_entry(this, &collection->id);
+  if (id_node == nullptr) {
     /* Collection itself. */
     id_node = add_id_node(&collection->id);
     id_node->is_directly_visible = is_collection_visible;
@@ -554,7 +947,7 @@ void DepsgraphNodeBuilder::build_object(int base_index,
   if (object->proxy != nullptr) {
     object->proxy->proxy_from = object;
   }
-  const bool has_object = built_map_.checkIsBuiltAndTag(object);
+  const bool has_object = check_is_built_and_tag(object);
 
   /* When there is already object in the dependency graph accumulate visibility an linked state
    * flags. Only do it on the object itself (apart from very special cases) and leave dealing with
@@ -578,6 +971,7 @@ void DepsgraphNodeBuilder::build_object(int base_index,
   }
 
   /* Create ID node for object and begin init. */
+  StackEntry stack_entry(this, &object->id);
   IDNode *id_node = add_id_node(&object->id);
   Object *object_cow = get_cow_datablock(object);
   id_node->linked_state = linked_state;
@@ -667,6 +1061,8 @@ void DepsgraphNodeBuilder::build_object_flags(int base_index,
   if (base_index == -1) {
     return;
   }
+  /* Base flags are built by the view layer builder, but belong to the object. */
+  StackEntry stack_entry(this, &object->id);
   Scene *scene_cow = get_cow_datablock(scene_);
   Object *object_cow = get_cow_datablock(object);
   const bool is_from_set = (linked_state == DEG_ID_LINKED_VIA_SET);
@@ -751,7 +1147,7 @@ void DepsgraphNodeBuilder::build_object_data(Object *object, bool is_object_visi
       break;
     default: {
       ID *obdata = (ID *)object->data;
-      if (!built_map_.checkIsBuilt(obdata)) {
+      if (!check_is_built(obdata)) {
         build_animdata(obdata);
       }
       break;
@@ -944,9 +1340,10 @@ void DepsgraphNodeBuilder::build_animation_images(ID *id)
 
 void DepsgraphNodeBuilder::build_action(bAction *action)
 {
-  if (built_map_.checkIsBuiltAndTag(action)) {
+  if (check_is_built_and_tag(action)) {
     return;
   }
+  StackEntry stack_entry(this, &action->id);
   build_idproperties(action->id.properties);
   add_operation_node(&action->id, NodeType::ANIMATION, OperationCode::ANIMATION_EVAL);
 }
@@ -1042,9 +1439,10 @@ void DepsgraphNodeBuilder::build_dimensions(Object *object)
 /* Recursively build graph for world */
 void DepsgraphNodeBuilder::build_world(World *world)
 {
-  if (built_map_.checkIsBuiltAndTag(world)) {
+  if (check_is_built_and_tag(world)) {
     return;
   }
+  StackEntry stack_entry(this, &world->id);
   /* World itself. */
   add_id_node(&world->id);
   World *world_cow = get_cow_datablock(world);
@@ -1199,9 +1597,10 @@ void DepsgraphNodeBuilder::build_particle_systems(Object *object, bool is_object
 
 void DepsgraphNodeBuilder::build_particle_settings(ParticleSettings *particle_settings)
 {
-  if (built_map_.checkIsBuiltAndTag(particle_settings)) {
+  if (check_is_built_and_tag(particle_settings)) {
     return;
   }
+  StackEntry stack_entry(this, &particle_settings->id);
   /* Make sure we've got proper copied ID pointer. */
   add_id_node(&particle_settings->id);
   ParticleSettings *particle_settings_cow = get_cow_datablock(particle_settings);
@@ -1233,9 +1632,10 @@ void DepsgraphNodeBuilder::build_particle_settings(ParticleSettings *particle_se
 /* Shapekeys */
 void DepsgraphNodeBuilder::build_shapekeys(Key *key)
 {
-  if (built_map_.checkIsBuiltAndTag(key)) {
+  if (check_is_built_and_tag(key)) {
     return;
   }
+  StackEntry stack_entry(this, &key->id);
   build_idproperties(key->id.properties);
   build_animdata(&key->id);
   build_parameters(&key->id);
@@ -1284,9 +1684,10 @@ void DepsgraphNodeBuilder::build_object_data_geometry(Object *object, bool is_ob
 
 void DepsgraphNodeBuilder::build_object_data_geometry_datablock(ID *obdata, bool is_object_visible)
 {
-  if (built_map_.checkIsBuiltAndTag(obdata)) {
+  if (check_is_built_and_tag(obdata)) {
     return;
   }
+  StackEntry stack_entry(this, obdata);
   OperationNode *op_node;
   /* Make sure we've got an ID node before requesting CoW pointer. */
   (void)add_id_node((ID *)obdata);
@@ -1394,9 +1795,10 @@ void DepsgraphNodeBuilder::build_object_data_geometry_datablock(ID *obdata, bool
 
 void DepsgraphNodeBuilder::build_armature(bArmature *armature)
 {
-  if (built_map_.checkIsBuiltAndTag(armature)) {
+  if (check_is_built_and_tag(armature)) {
     return;
   }
+  StackEntry stack_entry(this, &armature->id);
   build_idproperties(armature->id.properties);
   build_animdata(&armature->id);
   build_parameters(&armature->id);
@@ -1415,9 +1817,10 @@ void DepsgraphNodeBuilder::build_armature_bones(ListBase *bones)
 
 void DepsgraphNodeBuilder::build_camera(Camera *camera)
 {
-  if (built_map_.checkIsBuiltAndTag(camera)) {
+  if (check_is_built_and_tag(camera)) {
     return;
   }
+  StackEntry stack_entry(this, &camera->id);
   build_idproperties(camera->id.properties);
   build_animdata(&camera->id);
   build_parameters(&camera->id);
@@ -1428,9 +1831,10 @@ void DepsgraphNodeBuilder::build_camera(Camera *camera)
 
 void DepsgraphNodeBuilder::build_light(Light *lamp)
 {
-  if (built_map_.checkIsBuiltAndTag(lamp)) {
+  if (check_is_built_and_tag(lamp)) {
     return;
   }
+  StackEntry stack_entry(this, &lamp->id);
   build_idproperties(lamp->id.properties);
   build_animdata(&lamp->id);
   build_parameters(&lamp->id);
@@ -1443,9 +1847,10 @@ void DepsgraphNodeBuilder::build_nodetree(bNodeTree *ntree)
   if (ntree == nullptr) {
     return;
   }
-  if (built_map_.checkIsBuiltAndTag(ntree)) {
+  if (check_is_built_and_tag(ntree)) {
     return;
   }
+  StackEntry stack_entry(this, &ntree->id);
   /* nodetree itself */
   add_id_node(&ntree->id);
   bNodeTree *ntree_cow = get_cow_datablock(ntree);
@@ -1533,9 +1938,10 @@ void DepsgraphNodeBuilder::build_nodetree(bNodeTree *ntree)
 /* Recursively build graph for material */
 void DepsgraphNodeBuilder::build_material(Material *material)
 {
-  if (built_map_.checkIsBuiltAndTag(material)) {
+  if (check_is_built_and_tag(material)) {
     return;
   }
+  StackEntry stack_entry(this, &material->id);
   /* Material itself. */
   add_id_node(&material->id);
   Material *material_cow = get_cow_datablock(material);
@@ -1565,9 +1971,10 @@ void DepsgraphNodeBuilder::build_materials(Material **materials, int num_materia
 /* Recursively build graph for texture */
 void DepsgraphNodeBuilder::build_texture(Tex *texture)
 {
-  if (built_map_.checkIsBuiltAndTag(texture)) {
+  if (check_is_built_and_tag(texture)) {
     return;
   }
+  StackEntry stack_entry(this, &texture->id);
   /* Texture itself. */
   build_idproperties(texture->id.properties);
   build_animdata(&texture->id);
@@ -1586,9 +1993,10 @@ void DepsgraphNodeBuilder::build_texture(Tex *texture)
 
 void DepsgraphNodeBuilder::build_image(Image *image)
 {
-  if (built_map_.checkIsBuiltAndTag(image)) {
+  if (check_is_built_and_tag(image)) {
     return;
   }
+  StackEntry stack_entry(this, &image->id);
   build_parameters(&image->id);
   build_idproperties(image->id.properties);
   add_operation_node(
@@ -1597,9 +2005,10 @@ void DepsgraphNodeBuilder::build_image(Image *image)
 
 void DepsgraphNodeBuilder::build_gpencil(bGPdata *gpd)
 {
-  if (built_map_.checkIsBuiltAndTag(gpd)) {
+  if (check_is_built_and_tag(gpd)) {
     return;
   }
+  StackEntry stack_entry(this, &gpd->id);
   ID *gpd_id = &gpd->id;
 
   /* TODO(sergey): what about multiple users of same datablock? This should
@@ -1613,9 +2022,10 @@ void DepsgraphNodeBuilder::build_gpencil(bGPdata *gpd)
 
 void DepsgraphNodeBuilder::build_cachefile(CacheFile *cache_file)
 {
-  if (built_map_.checkIsBuiltAndTag(cache_file)) {
+  if (check_is_built_and_tag(cache_file)) {
     return;
   }
+  StackEntry stack_entry(this, &cache_file->id);
   ID *cache_file_id = &cache_file->id;
   add_id_node(cache_file_id);
   CacheFile *cache_file_cow = get_cow_datablock(cache_file);
@@ -1632,9 +2042,10 @@ void DepsgraphNodeBuilder::build_cachefile(CacheFile *cache_file)
 
 void DepsgraphNodeBuilder::build_mask(Mask *mask)
 {
-  if (built_map_.checkIsBuiltAndTag(mask)) {
+  if (check_is_built_and_tag(mask)) {
     return;
   }
+  StackEntry stack_entry(this, &mask->id);
   ID *mask_id = &mask->id;
   Mask *mask_cow = (Mask *)ensure_cow_id(mask_id);
   build_idproperties(mask->id.properties);
@@ -1668,9 +2079,10 @@ void DepsgraphNodeBuilder::build_mask(Mask *mask)
 
 void DepsgraphNodeBuilder::build_freestyle_linestyle(FreestyleLineStyle *linestyle)
 {
-  if (built_map_.checkIsBuiltAndTag(linestyle)) {
+  if (check_is_built_and_tag(linestyle)) {
     return;
   }
+  StackEntry stack_entry(this, &linestyle->id);
 
   ID *linestyle_id = &linestyle->id;
   build_parameters(linestyle_id);
@@ -1681,9 +2093,10 @@ void DepsgraphNodeBuilder::build_freestyle_linestyle(FreestyleLineStyle *linesty
 
 void DepsgraphNodeBuilder::build_movieclip(MovieClip *clip)
 {
-  if (built_map_.checkIsBuiltAndTag(clip)) {
+  if (check_is_built_and_tag(clip)) {
     return;
   }
+  StackEntry stack_entry(this, &clip->id);
   ID *clip_id = &clip->id;
   MovieClip *clip_cow = (MovieClip *)ensure_cow_id(clip_id);
   build_idproperties(clip_id->properties);
@@ -1704,9 +2117,10 @@ void DepsgraphNodeBuilder::build_movieclip(MovieClip *clip)
 
 void DepsgraphNodeBuilder::build_lightprobe(LightProbe *probe)
 {
-  if (built_map_.checkIsBuiltAndTag(probe)) {
+  if (check_is_built_and_tag(probe)) {
     return;
   }
+  StackEntry stack_entry(this, &probe->id);
   /* Placeholder so we can add relations and tag ID node for update. */
   add_operation_node(&probe->id, NodeType::PARAMETERS, OperationCode::LIGHT_PROBE_EVAL);
   build_idproperties(probe->id.properties);
@@ -1716,9 +2130,10 @@ void DepsgraphNodeBuilder::build_lightprobe(LightProbe *probe)
 
 void DepsgraphNodeBuilder::build_speaker(Speaker *speaker)
 {
-  if (built_map_.checkIsBuiltAndTag(speaker)) {
+  if (check_is_built_and_tag(speaker)) {
     return;
   }
+  StackEntry stack_entry(this, &speaker->id);
   /* Placeholder so we can add relations and tag ID node for update. */
   add_operation_node(&speaker->id, NodeType::AUDIO, OperationCode::SPEAKER_EVAL);
   build_idproperties(speaker->id.properties);
@@ -1731,9 +2146,10 @@ void DepsgraphNodeBuilder::build_speaker(Speaker *speaker)
 
 void DepsgraphNodeBuilder::build_sound(bSound *sound)
 {
-  if (built_map_.checkIsBuiltAndTag(sound)) {
+  if (check_is_built_and_tag(sound)) {
     return;
   }
+  StackEntry stack_entry(this, &sound->id);
   add_id_node(&sound->id);
   bSound *sound_cow = get_cow_datablock(sound);
   add_operation_node(&sound->id,
@@ -1747,9 +2163,10 @@ void DepsgraphNodeBuilder::build_sound(bSound *sound)
 
 void DepsgraphNodeBuilder::build_simulation(Simulation *simulation)
 {
-  if (built_map_.checkIsBuiltAndTag(simulation)) {
+  if (check_is_built_and_tag(simulation)) {
     return;
   }
+  StackEntry stack_entry(this, &simulation->id);
   add_id_node(&simulation->id);
   build_animdata(&simulation->id);
   build_parameters(&simulation->id);
@@ -1790,9 +2207,10 @@ void DepsgraphNodeBuilder::build_scene_sequencer(Scene *scene)
 
 void DepsgraphNodeBuilder::build_scene_audio(Scene *scene)
 {
-  if (built_map_.checkIsBuiltAndTag(scene, BuilderMap::TAG_SCENE_AUDIO)) {
+  if (check_is_built_and_tag(scene, BuilderMap::TAG_SCENE_AUDIO)) {
     return;
   }
+  StackEntry stack_entry(this, &scene->id);
 
   add_operation_node(&scene->id, NodeType::AUDIO, OperationCode::SOUND_EVAL);
 
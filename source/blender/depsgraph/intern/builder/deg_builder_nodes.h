@@ -99,6 +99,19 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   virtual void begin_build();
   virtual void end_build();
 
+  /* Incremental build: builders of the IDs tagged for relations update run again and re-use
+   * nodes of the existing graph, nodes of the other IDs are kept as they are. Nodes which are no
+   * longer used are removed by end_build_incremental().
+   *
+   * ID nodes which got operations or components added or removed are added to changed_id_nodes,
+   * ID nodes which lost relations to removed nodes are added to neighbor_id_nodes. Relations of
+   * those are to be built again by the relations builder. ID nodes which builders did run or
+   * which got components opened are added to built_id_nodes, those are to be finalized. */
+  virtual void begin_build_incremental(Set<IDNode *> *changed_id_nodes,
+                                       Set<IDNode *> *neighbor_id_nodes,
+                                       Set<IDNode *> *built_id_nodes);
+  virtual void end_build_incremental();
+
   IDNode *add_id_node(ID *id);
   IDNode *find_id_node(ID *id);
   TimeSourceNode *add_time_source();
@@ -148,6 +161,21 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   OperationNode *find_operation_node(
       ID *id, NodeType comp_type, OperationCode opcode, const char *name = "", int name_tag = -1);
 
+  /* Wrappers around the built map which keep track of IDs used by the builders, see
+   * IDNode::builder_users. IDs which are kept by an incremental build count as built. */
+  bool check_is_built(ID *id, int tag = BuilderMap::TAG_COMPLETE);
+  bool check_is_built_and_tag(ID *id, int tag = BuilderMap::TAG_COMPLETE);
+
+  template<typename T> bool check_is_built(T *datablock, int tag = BuilderMap::TAG_COMPLETE)
+  {
+    return check_is_built(&datablock->id, tag);
+  }
+  template<typename T>
+  bool check_is_built_and_tag(T *datablock, int tag = BuilderMap::TAG_COMPLETE)
+  {
+    return check_is_built_and_tag(&datablock->id, tag);
+  }
+
   virtual void build_id(ID *id);
 
   virtual void build_idproperties(IDProperty *id_property);
@@ -253,6 +281,29 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   };
   vector<SavedEntryTag> saved_entry_tags_;
 
+  /* Keeps the ID on top of the stack of IDs which builders are running for as long as the entry
+   * exists. Builders of IDs create one before building anything. */
+  class StackEntry {
+   public:
+    StackEntry(DepsgraphNodeBuilder *builder, ID *id);
+    ~StackEntry();
+
+   private:
+    DepsgraphNodeBuilder *builder_;
+  };
+
+  /* Record that the ID is used by the builder on top of the stack. */
+  void tag_id_node_used(IDNode *id_node);
+
+  /* Find node kept from the previous build, tagging it as reached by the incremental build. */
+  IDNode *reach_id_node(ID *id);
+  /* Run builder of the ID which is only reached through builders which were not run again. */
+  void build_incremental_id(IDNode *id_node);
+
+  /* Remove ID nodes and operations, together with their relations. */
+  void remove_operations(const Set<OperationNode *> &operations);
+  void remove_id_nodes(const Vector<IDNode *> &id_nodes);
+
   struct BuilderWalkUserData {
     DepsgraphNodeBuilder *builder;
     /* Denotes whether object the walk is invoked from is visible. */
@@ -285,6 +336,16 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   /* Set of IDs which were already build. Makes it easier to keep track of
    * what was already built and what was not. */
   BuilderMap built_map_;
+
+  /* Nodes of IDs which builders are currently running, the innermost one is the last. */
+  Vector<IDNode *> builder_stack_;
+
+  /* State of the incremental build, see begin_build_incremental(). */
+  bool is_incremental_build_;
+  Set<IDNode *> *changed_id_nodes_;
+  Set<IDNode *> *neighbor_id_nodes_;
+  Set<IDNode *> *built_id_nodes_;
+  Vector<IDNode *> reached_id_nodes_;
 };
 
 }  // namespace DEG
@@ -53,9 +53,10 @@ void DepsgraphNodeBuilder::build_scene_render(Scene *scene, ViewLayer *view_laye
 
 void DepsgraphNodeBuilder::build_scene_parameters(Scene *scene)
 {
-  if (built_map_.checkIsBuiltAndTag(scene, BuilderMap::TAG_PARAMETERS)) {
+  if (check_is_built_and_tag(scene, BuilderMap::TAG_PARAMETERS)) {
     return;
   }
+  StackEntry stack_entry(this, &scene->id);
   build_parameters(&scene->id);
   build_idproperties(scene->id.properties);
   add_operation_node(&scene->id, NodeType::PARAMETERS, OperationCode::SCENE_EVAL);
@@ -74,9 +75,10 @@ void DepsgraphNodeBuilder::build_scene_parameters(Scene *scene)
 
 void DepsgraphNodeBuilder::build_scene_compositor(Scene *scene)
 {
-  if (built_map_.checkIsBuiltAndTag(scene, BuilderMap::TAG_SCENE_COMPOSITOR)) {
+  if (check_is_built_and_tag(scene, BuilderMap::TAG_SCENE_COMPOSITOR)) {
     return;
   }
+  StackEntry stack_entry(this, &scene->id);
   if (scene->nodetree == nullptr) {
     return;
   }
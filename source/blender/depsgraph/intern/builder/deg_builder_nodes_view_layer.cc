@@ -91,6 +91,7 @@ void DepsgraphNodeBuilder::build_view_layer(Scene *scene,
    * only one view layer in there. */
   view_layer_index_ = 0;
   /* Scene ID block. */
+  StackEntry stack_entry(this, &scene->id);
   IDNode *id_node = add_id_node(&scene->id);
   id_node->linked_state = linked_state;
   /* Time source. */
@@ -81,6 +81,7 @@
 #include "BKE_image.h"
 #include "BKE_key.h"
 #include "BKE_layer.h"
+#include "BKE_lib_query.h"
 #include "BKE_material.h"
 #include "BKE_mball.h"
 #include "BKE_modifier.h"
@@ -242,7 +243,10 @@ bool object_have_geometry_component(const Object *object)
 DepsgraphRelationBuilder::DepsgraphRelationBuilder(Main *bmain,
                                                    Depsgraph *graph,
                                                    DepsgraphBuilderCache *cache)
-    : DepsgraphBuilder(bmain, graph, cache), scene_(nullptr), rna_node_query_(graph, this)
+    : DepsgraphBuilder(bmain, graph, cache),
+      scene_(nullptr),
+      rna_node_query_(graph, this),
+      is_incremental_build_(false)
 {
 }
 
@@ -349,7 +353,7 @@ Relation *DepsgraphRelationBuilder::add_time_relation(TimeSourceNode *timesrc,
                                                       int flags)
 {
   if (timesrc && node_to) {
-    return graph_->add_new_relation(timesrc, node_to, description, flags);
+    return add_new_relation(timesrc, node_to, description, flags);
   }
   else {
     DEG_DEBUG_PRINTF((::Depsgraph *)graph_,
@@ -370,7 +374,7 @@ Relation *DepsgraphRelationBuilder::add_operation_relation(OperationNode *node_f
                                                            int flags)
 {
   if (node_from && node_to) {
-    return graph_->add_new_relation(node_from, node_to, description, flags);
+    return add_new_relation(node_from, node_to, description, flags);
   }
   else {
     DEG_DEBUG_PRINTF((::Depsgraph *)graph_,
@@ -385,6 +389,25 @@ Relation *DepsgraphRelationBuilder::add_operation_relation(OperationNode *node_f
   return nullptr;
 }
 
+Relation *DepsgraphRelationBuilder::add_new_relation(Node *node_from,
+                                                     Node *node_to,
+                                                     const char *description,
+                                                     int flags)
+{
+  if (!is_incremental_build_) {
+    return graph_->add_new_relation(node_from, node_to, description, flags);
+  }
+  /* Relations built by the previous build are kept, don't add them twice. */
+  Relation *rel = graph_->check_nodes_connected(node_from, node_to, description);
+  if (rel != nullptr) {
+    rel->flag |= flags;
+    return rel;
+  }
+  rel = graph_->add_new_relation(node_from, node_to, description, flags);
+  new_relations_.append(rel);
+  return rel;
+}
+
 void DepsgraphRelationBuilder::add_particle_collision_relations(const OperationKey &key,
                                                                 Object *object,
                                                                 Collection *collection,
@@ -477,6 +500,128 @@ void DepsgraphRelationBuilder::begin_build()
 {
 }
 
+/* Incremental build relies on relations being built by the builder of one of the IDs they
+ * connect. Relations of the changed IDs are removed and built again, relations of their
+ * neighbors are built again without removing the existing ones first, so they only get the
+ * relations to the changed IDs back.
+ *
+ * Special evaluation flags and custom data masks are only accumulated, so they might have more
+ * bits set than a full build would have. */
+void DepsgraphRelationBuilder::begin_build_incremental(const Set<IDNode *> &changed_id_nodes,
+                                                       const Set<IDNode *> &neighbor_id_nodes)
+{
+  is_incremental_build_ = true;
+  /* Cycles of the previous build are detected again for the whole graph, otherwise only the new
+   * relations are checked, see deg_graph_build_finalize_incremental(). */
+  if (graph_->has_cyclic_relations) {
+    for (OperationNode *op_node : graph_->operations) {
+      for (Relation *rel : op_node->inlinks) {
+        rel->flag &= ~RELATION_FLAG_CYCLIC;
+      }
+    }
+  }
+  for (IDNode *id_node : neighbor_id_nodes) {
+    incremental_id_nodes_.add(id_node);
+  }
+  for (IDNode *id_node : changed_id_nodes) {
+    incremental_id_nodes_.add(id_node);
+    Vector<OperationNode *> operations;
+    for (ComponentNode *comp_node : id_node->components.values()) {
+      comp_node->get_operations(operations);
+    }
+    for (OperationNode *op_node : operations) {
+      deg_graph_remove_node_relations(op_node, &incremental_id_nodes_);
+    }
+  }
+  add_incremental_id_users(changed_id_nodes);
+  /* Builders of the other IDs are skipped. */
+  for (IDNode *id_node : graph_->id_nodes) {
+    if (!incremental_id_nodes_.contains(id_node)) {
+      built_map_.tagBuild(id_node->id_orig);
+    }
+  }
+}
+
+void DepsgraphRelationBuilder::end_build_incremental()
+{
+  /* Build IDs which are not reachable without going through builders of the skipped IDs. */
+  for (IDNode *id_node : incremental_id_nodes_) {
+    build_id(id_node->id_orig);
+  }
+  /* Incoming relations of unused no-op operations are removed when finalizing the build. When
+   * such an operation gets used again, relations of its ID are to be built again. */
+  int num_checked_relations = 0;
+  while (true) {
+    Vector<IDNode *> id_nodes;
+    for (; num_checked_relations < new_relations_.size(); num_checked_relations++) {
+      Relation *rel = new_relations_[num_checked_relations];
+      if (rel->from->type != NodeType::OPERATION) {
+        continue;
+      }
+      OperationNode *op_from = static_cast<OperationNode *>(rel->from);
+      IDNode *id_node = op_from->owner->owner;
+      if (op_from->is_noop() && !incremental_id_nodes_.contains(id_node)) {
+        incremental_id_nodes_.add(id_node);
+        id_nodes.append(id_node);
+      }
+    }
+    if (id_nodes.is_empty()) {
+      break;
+    }
+    Set<IDNode *> round_id_nodes;
+    for (IDNode *id_node : id_nodes) {
+      round_id_nodes.add(id_node);
+    }
+    built_map_ = BuilderMap();
+    for (IDNode *id_node : graph_->id_nodes) {
+      if (!round_id_nodes.contains(id_node)) {
+        built_map_.tagBuild(id_node->id_orig);
+      }
+    }
+    for (IDNode *id_node : id_nodes) {
+      build_id(id_node->id_orig);
+    }
+  }
+  for (IDNode *id_node : incremental_id_nodes_) {
+    build_copy_on_write_relations(id_node);
+    build_driver_relations(id_node);
+  }
+}
+
+const Set<IDNode *> &DepsgraphRelationBuilder::get_incremental_id_nodes() const
+{
+  return incremental_id_nodes_;
+}
+
+const Vector<Relation *> &DepsgraphRelationBuilder::get_new_relations() const
+{
+  return new_relations_;
+}
+
+void DepsgraphRelationBuilder::add_incremental_id_users(const Set<IDNode *> &changed_id_nodes)
+{
+  /* Builders of IDs which use the changed ones might build relations to them, even when there
+   * were none before (like for an object which got added to a collection instanced by another
+   * object). Users of collections are followed further, objects build relations to the contents
+   * of the collections they instance. Users are known from the nodes builder, which follows the
+   * same ID pointers. */
+  Vector<IDNode *> queue;
+  Set<IDNode *> visited;
+  for (IDNode *id_node : changed_id_nodes) {
+    queue.append(id_node);
+    visited.add(id_node);
+  }
+  while (!queue.is_empty()) {
+    IDNode *id_node = queue.pop_last();
+    for (IDNode *id_node_user : id_node->builder_users) {
+      incremental_id_nodes_.add(id_node_user);
+      if (id_node_user->id_type == ID_GR && visited.add(id_node_user)) {
+        queue.append(id_node_user);
+      }
+    }
+  }
+}
+
 void DepsgraphRelationBuilder::build_id(ID *id)
 {
   if (id == nullptr) {
@@ -558,6 +703,12 @@ void DepsgraphRelationBuilder::build_id(ID *id)
     case ID_SIM:
       build_simulation((Simulation *)id);
       break;
+    case ID_GD:
+      build_gpencil((bGPdata *)id);
+      break;
+    case ID_PA:
+      build_particle_settings((ParticleSettings *)id);
+      break;
     default:
       fprintf(stderr, "Unhandled ID %s\n", id->name);
       BLI_assert(!"Should never happen");
@@ -1311,7 +1462,7 @@ void DepsgraphRelationBuilder::build_animdata_curves_targets(ID *id,
       add_relation(adt_key, pose_init_key, "Animation -> Prop", RELATION_CHECK_BEFORE_ADD);
       continue;
     }
-    graph_->add_new_relation(
+    add_operation_relation(
         operation_from, operation_to, "Animation -> Prop", RELATION_CHECK_BEFORE_ADD);
     /* It is possible that animation is writing to a nested ID data-block,
      * need to make sure animation is evaluated after target ID is copied. */
@@ -2734,17 +2885,18 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
      * copy of ID. */
     OperationNode *op_entry = comp_node->get_entry_operation();
     if (op_entry != nullptr) {
-      Relation *rel = graph_->add_new_relation(op_cow, op_entry, "CoW Dependency");
-      rel->flag |= rel_flag;
+      add_operation_relation(op_cow, op_entry, "CoW Dependency", rel_flag);
     }
-    /* All dangling operations should also be executed after copy-on-write. */
-    for (OperationNode *op_node : comp_node->operations_map->values()) {
+    /* All dangling operations should also be executed after copy-on-write. Components of IDs
+     * which nodes are kept by an incremental build are finalized already. */
+    Vector<OperationNode *> operations;
+    comp_node->get_operations(operations);
+    for (OperationNode *op_node : operations) {
       if (op_node == op_entry) {
         continue;
       }
       if (op_node->inlinks.is_empty()) {
-        Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
-        rel->flag |= rel_flag;
+        add_operation_relation(op_cow, op_node, "CoW Dependency", rel_flag);
       }
       else {
         bool has_same_comp_dependency = false;
@@ -2759,8 +2911,7 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
           }
         }
         if (!has_same_comp_dependency) {
-          Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
-          rel->flag |= rel_flag;
+          add_operation_relation(op_cow, op_node, "CoW Dependency", rel_flag);
         }
       }
     }
@@ -163,6 +163,15 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   void begin_build();
 
+  /* Rebuild relations of the changed IDs and their neighbors only, keeping relations between the
+   * other IDs from the previous build. Nodes are expected to be built already. */
+  void begin_build_incremental(const Set<IDNode *> &changed_id_nodes,
+                               const Set<IDNode *> &neighbor_id_nodes);
+  void end_build_incremental();
+  /* IDs which relations were built by the incremental build, and the relations it added. */
+  const Set<IDNode *> &get_incremental_id_nodes() const;
+  const Vector<Relation *> &get_new_relations() const;
+
   template<typename KeyFrom, typename KeyTo>
   Relation *add_relation(const KeyFrom &key_from,
                          const KeyTo &key_to,
@@ -333,6 +342,12 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
                                    OperationNode *node_to,
                                    const char *description,
                                    int flags = 0);
+  Relation *add_new_relation(Node *node_from,
+                             Node *node_to,
+                             const char *description,
+                             int flags = 0);
+
+  void add_incremental_id_users(const Set<IDNode *> &changed_id_nodes);
 
   template<typename KeyType>
   DepsNodeHandle create_node_handle(const KeyType &key, const char *default_name = "");
@@ -369,6 +384,11 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   BuilderMap built_map_;
   RNANodeQuery rna_node_query_;
+
+  /* IDs which relations are built by the incremental build, and relations it added. */
+  bool is_incremental_build_;
+  Set<IDNode *> incremental_id_nodes_;
+  Vector<Relation *> new_relations_;
 };
 
 struct DepsNodeHandle {
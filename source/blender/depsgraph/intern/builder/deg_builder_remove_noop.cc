@@ -26,6 +26,8 @@
 #include "MEM_guardedalloc.h"
 
 #include "intern/node/deg_node.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
 #include "intern/node/deg_node_operation.h"
 
 #include "intern/debug/deg_debug.h"
@@ -46,16 +48,9 @@ static inline bool is_unused_noop(OperationNode *op_node)
   return op_node->is_noop() && op_node->outlinks.is_empty();
 }
 
-void deg_graph_remove_unused_noops(Depsgraph *graph)
+static void remove_unused_noops(Depsgraph *graph, deque<OperationNode *> &queue)
 {
   int num_removed_relations = 0;
-  deque<OperationNode *> queue;
-
-  for (OperationNode *node : graph->operations) {
-    if (is_unused_noop(node)) {
-      queue.push_back(node);
-    }
-  }
 
   while (!queue.empty()) {
     OperationNode *to_remove = queue.front();
@@ -84,4 +79,34 @@ void deg_graph_remove_unused_noops(Depsgraph *graph)
       (::Depsgraph *)graph, BUILD, "Removed %d relations to no-op nodes\n", num_removed_relations);
 }
 
+void deg_graph_remove_unused_noops(Depsgraph *graph)
+{
+  deque<OperationNode *> queue;
+
+  for (OperationNode *node : graph->operations) {
+    if (is_unused_noop(node)) {
+      queue.push_back(node);
+    }
+  }
+
+  remove_unused_noops(graph, queue);
+}
+
+void deg_graph_remove_unused_noops(Depsgraph *graph, const Set<IDNode *> &id_nodes)
+{
+  deque<OperationNode *> queue;
+
+  for (IDNode *id_node : id_nodes) {
+    for (ComponentNode *comp_node : id_node->components.values()) {
+      for (OperationNode *node : comp_node->operations) {
+        if (is_unused_noop(node)) {
+          queue.push_back(node);
+        }
+      }
+    }
+  }
+
+  remove_unused_noops(graph, queue);
+}
+
 }  // namespace DEG
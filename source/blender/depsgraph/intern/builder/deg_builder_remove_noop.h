@@ -23,11 +23,18 @@
 
 #pragma once
 
+#include "intern/depsgraph_type.h"
+
 namespace DEG {
 
 struct Depsgraph;
+struct IDNode;
 
 /* Remove all no-op nodes that have zero outgoing relations. */
 void deg_graph_remove_unused_noops(Depsgraph *graph);
 
+/* Same as above, only starting from operations of the given IDs. Used by incremental builds,
+ * relations of the other IDs did not change. */
+void deg_graph_remove_unused_noops(Depsgraph *graph, const Set<IDNode *> &id_nodes);
+
 }  // namespace DEG
@@ -108,6 +108,15 @@ struct Depsgraph {
   /* Indicates whether relations needs to be updated. */
   bool need_update;
 
+  /* IDs tagged for a relations update which is local to them, used to only rebuild part of the
+   * relations when the graph is not tagged for a full update.
+   * NOTE: The IDs might be freed already, never de-reference them. */
+  Set<const ID *> relations_update_ids;
+
+  /* Indicates whether relations were marked cyclic by the last build. Incremental builds only
+   * check new relations for cycles when there were none. */
+  bool has_cyclic_relations;
+
   /* Indicates which ID types were updated. */
   char id_type_updated[MAX_LIBARRAY];
 
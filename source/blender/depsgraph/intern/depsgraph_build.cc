@@ -58,6 +58,7 @@
 
 #include "intern/depsgraph_registry.h"
 #include "intern/depsgraph_relation.h"
+#include "intern/depsgraph_tag.h"
 #include "intern/depsgraph_type.h"
 
 /* ****************** */
@@ -220,6 +221,29 @@ static void graph_build_finalize_common(DEG::Depsgraph *deg_graph, Main *bmain)
 #endif
   /* Relations are up to date. */
   deg_graph->need_update = false;
+  deg_graph->relations_update_ids.clear();
+}
+
+/* Same as above, only updating the parts of the graph which were touched by the incremental
+ * build. */
+static void graph_build_finalize_incremental(DEG::Depsgraph *deg_graph,
+                                             Main *bmain,
+                                             const DEG::Set<DEG::IDNode *> &built_id_nodes,
+                                             const DEG::DepsgraphRelationBuilder &relation_builder)
+{
+  const DEG::Vector<DEG::Relation *> &new_relations = relation_builder.get_new_relations();
+  DEG::deg_graph_detect_cycles_incremental(deg_graph, new_relations);
+  deg_graph->scene_cow = (Scene *)deg_graph->get_cow_id(&deg_graph->scene->id);
+  DEG::Set<DEG::IDNode *> updated_id_nodes;
+  DEG::deg_graph_build_finalize_incremental(bmain,
+                                            deg_graph,
+                                            built_id_nodes,
+                                            relation_builder.get_incremental_id_nodes(),
+                                            new_relations,
+                                            &updated_id_nodes);
+  DEG::graph_id_nodes_on_visible_update(bmain, deg_graph, updated_id_nodes);
+  deg_graph->need_update = false;
+  deg_graph->relations_update_ids.clear();
 }
 
 /* Build depsgraph for the given scene layer, and dump results in given graph container. */
@@ -467,11 +491,8 @@ void DEG_graph_build_from_ids(Depsgraph *graph,
   }
 }
 
-/* Tag graph relations for update. */
-void DEG_graph_tag_relations_update(Depsgraph *graph)
+static void graph_tag_relations_update(DEG::Depsgraph *deg_graph)
 {
-  DEG_DEBUG_PRINTF(graph, TAG, "%s: Tagging relations for update.\n", __func__);
-  DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   deg_graph->need_update = true;
   /* NOTE: When relations are updated, it's quite possible that
    * we've got new bases in the scene. This means, we need to
@@ -485,6 +506,82 @@ void DEG_graph_tag_relations_update(Depsgraph *graph)
   }
 }
 
+/* Tag graph relations for update. */
+void DEG_graph_tag_relations_update(Depsgraph *graph)
+{
+  DEG_DEBUG_PRINTF(graph, TAG, "%s: Tagging relations for update.\n", __func__);
+  DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
+  /* All relations are to be built again. */
+  deg_graph->relations_update_ids.clear();
+  graph_tag_relations_update(deg_graph);
+}
+
+static bool graph_relations_update_is_incremental_possible(DEG::Depsgraph *deg_graph)
+{
+  /* Relations are never reduced when building incrementally. */
+  if (G.debug_value == 799) {
+    return false;
+  }
+  if (deg_graph->is_render_pipeline_depsgraph) {
+    return false;
+  }
+  /* Cached colliders and effectors are created for the whole graph. */
+  for (int i = 0; i < DEG_PHYSICS_RELATIONS_NUM; i++) {
+    if (deg_graph->physics_relations[i] != nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Update nodes of the whole graph and relations of the IDs which were tagged with
+ * DEG_relations_tag_update_id() and their neighbors. */
+static void graph_relations_update_incremental(DEG::Depsgraph *deg_graph,
+                                               Main *bmain,
+                                               Scene *scene,
+                                               ViewLayer *view_layer)
+{
+  double start_time = 0.0;
+  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
+    start_time = PIL_check_seconds_timer();
+  }
+  DEG::DepsgraphBuilderCache builder_cache;
+  DEG::Set<DEG::IDNode *> changed_id_nodes;
+  DEG::Set<DEG::IDNode *> neighbor_id_nodes;
+  DEG::Set<DEG::IDNode *> built_id_nodes;
+  /* Nodes are re-used from the previous build, unused ones are removed. */
+  DEG::DepsgraphNodeBuilder node_builder(bmain, deg_graph, &builder_cache);
+  node_builder.begin_build_incremental(&changed_id_nodes, &neighbor_id_nodes, &built_id_nodes);
+  node_builder.build_view_layer(scene, view_layer, DEG::DEG_ID_LINKED_DIRECTLY);
+  node_builder.end_build_incremental();
+  for (DEG::IDNode *id_node : deg_graph->id_nodes) {
+    if (!deg_graph->relations_update_ids.contains(id_node->id_orig)) {
+      continue;
+    }
+    /* The scene has relations to everything in it, removing them would rebuild all relations.
+     * It is tagged when its bases change, which is handled by the nodes builder already, so only
+     * its missing relations are added. */
+    if (id_node->id_orig == &scene->id) {
+      neighbor_id_nodes.add(id_node);
+    }
+    else {
+      changed_id_nodes.add(id_node);
+    }
+  }
+  /* Relations of the changed IDs and their neighbors are built again. */
+  DEG::DepsgraphRelationBuilder relation_builder(bmain, deg_graph, &builder_cache);
+  relation_builder.begin_build();
+  relation_builder.begin_build_incremental(changed_id_nodes, neighbor_id_nodes);
+  relation_builder.build_view_layer(scene, view_layer, DEG::DEG_ID_LINKED_DIRECTLY);
+  relation_builder.end_build_incremental();
+  graph_build_finalize_incremental(deg_graph, bmain, built_id_nodes, relation_builder);
+  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
+    printf("Depsgraph relations of %d IDs updated in %f seconds.\n",
+           (int)changed_id_nodes.size(),
+           PIL_check_seconds_timer() - start_time);
+  }
+}
+
 /* Create or update relations in the specified graph. */
 void DEG_graph_relations_update(Depsgraph *graph, Main *bmain, Scene *scene, ViewLayer *view_layer)
 {
@@ -493,7 +590,22 @@ void DEG_graph_relations_update(Depsgraph *graph, Main *bmain, Scene *scene, Vie
     /* Graph is up to date, nothing to do. */
     return;
   }
-  DEG_graph_build_from_view_layer(graph, bmain, scene, view_layer);
+  if (deg_graph->relations_update_ids.is_empty() ||
+      !graph_relations_update_is_incremental_possible(deg_graph)) {
+    DEG_graph_build_from_view_layer(graph, bmain, scene, view_layer);
+    return;
+  }
+  graph_relations_update_incremental(deg_graph, bmain, scene, view_layer);
+  if (G.debug & G_DEBUG_DEPSGRAPH_VERIFY) {
+    Depsgraph *full_graph = DEG_graph_new(bmain, scene, view_layer, deg_graph->mode);
+    DEG_graph_build_from_view_layer(full_graph, bmain, scene, view_layer);
+    const bool is_valid = DEG_debug_compare(graph, full_graph);
+    DEG_graph_free(full_graph);
+    if (!is_valid) {
+      fprintf(stderr, "Incremental depsgraph relations update differs from a full rebuild.\n");
+      DEG_graph_build_from_view_layer(graph, bmain, scene, view_layer);
+    }
+  }
 }
 
 /* Tag all relations for update. */
@@ -504,3 +616,16 @@ void DEG_relations_tag_update(Main *bmain)
     DEG_graph_tag_relations_update(reinterpret_cast<Depsgraph *>(depsgraph));
   }
 }
+
+/* Tag relations of the given ID for update. */
+void DEG_relations_tag_update_id(Main *bmain, ID *id)
+{
+  DEG_GLOBAL_DEBUG_PRINTF(TAG, "%s: Tagging relations of %s for update.\n", __func__, id->name);
+  for (DEG::Depsgraph *depsgraph : DEG::get_all_registered_graphs(bmain)) {
+    /* Graph which is already tagged for a full update stays so. */
+    if (!depsgraph->need_update || !depsgraph->relations_update_ids.is_empty()) {
+      depsgraph->relations_update_ids.add(id);
+    }
+    graph_tag_relations_update(depsgraph);
+  }
+}
@@ -23,6 +23,7 @@
  * Implementation of tools for debugging the depsgraph
  */
 
+#include "BLI_string.h"
 #include "BLI_utildefines.h"
 
 #include "DNA_scene_types.h"
@@ -40,6 +41,7 @@
 #include "intern/depsgraph_type.h"
 #include "intern/node/deg_node_component.h"
 #include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
 #include "intern/node/deg_node_time.h"
 
 void DEG_debug_flags_set(Depsgraph *depsgraph, int flags)
@@ -66,22 +68,76 @@ const char *DEG_debug_name_get(struct Depsgraph *depsgraph)
   return deg_graph->debug.name.c_str();
 }
 
+namespace DEG {
+namespace {
+
+string debug_compare_node_key(const Node *node)
+{
+  if (node->type != NodeType::OPERATION) {
+    return node->identifier();
+  }
+  const OperationNode *op_node = static_cast<const OperationNode *>(node);
+  char id_ptr[24];
+  BLI_snprintf(id_ptr, sizeof(id_ptr), "%p", op_node->owner->owner->id_orig);
+  return string(id_ptr) + "/" + to_string(static_cast<int>(op_node->owner->type)) + "/" +
+         op_node->full_identifier() + "/" + to_string(op_node->name_tag);
+}
+
+/* Keys of ID nodes and their state, operations and relations of the graph. */
+Set<string> debug_compare_graph_keys(const Depsgraph *graph)
+{
+  Set<string> keys;
+  for (const IDNode *id_node : graph->id_nodes) {
+    char id_ptr[24];
+    BLI_snprintf(id_ptr, sizeof(id_ptr), "%p", id_node->id_orig);
+    keys.add(string("ID ") + id_ptr + " " + id_node->name +
+             " linked_state: " + to_string(static_cast<int>(id_node->linked_state)) +
+             " is_directly_visible: " + to_string(id_node->is_directly_visible) +
+             " has_base: " + to_string(id_node->has_base) +
+             " is_collection_fully_expanded: " +
+             to_string(id_node->is_collection_fully_expanded));
+  }
+  for (const OperationNode *op_node : graph->operations) {
+    keys.add("Operation " + debug_compare_node_key(op_node));
+    for (const Relation *rel : op_node->inlinks) {
+      keys.add("Relation " + debug_compare_node_key(rel->from) + " -> " +
+               debug_compare_node_key(rel->to) + " (" + rel->name + ")");
+    }
+  }
+  return keys;
+}
+
+int debug_compare_print_missing(const Set<string> &keys,
+                                const Set<string> &other_keys,
+                                const char *graph_name)
+{
+  int num_missing = 0;
+  for (const string &key : keys) {
+    if (!other_keys.contains(key)) {
+      fprintf(stderr, "  Missing in %s: %s\n", graph_name, key.c_str());
+      num_missing++;
+    }
+  }
+  return num_missing;
+}
+
+}  // namespace
+}  // namespace DEG
+
+/* Compare nodes and relations of two graphs, ignoring evaluation state, relation flags and
+ * duplicate relations. Differences are printed. */
 bool DEG_debug_compare(const struct Depsgraph *graph1, const struct Depsgraph *graph2)
 {
   BLI_assert(graph1 != nullptr);
   BLI_assert(graph2 != nullptr);
   const DEG::Depsgraph *deg_graph1 = reinterpret_cast<const DEG::Depsgraph *>(graph1);
   const DEG::Depsgraph *deg_graph2 = reinterpret_cast<const DEG::Depsgraph *>(graph2);
-  if (deg_graph1->operations.size() != deg_graph2->operations.size()) {
-    return false;
-  }
-  /* TODO(sergey): Currently we only do real stupid check,
-   * which is fast but which isn't 100% reliable.
-   *
-   * Would be cool to make it more robust, but it's good enough
-   * for now. Also, proper graph check is actually NP-complex
-   * problem. */
-  return true;
+  const DEG::Set<DEG::string> keys1 = DEG::debug_compare_graph_keys(deg_graph1);
+  const DEG::Set<DEG::string> keys2 = DEG::debug_compare_graph_keys(deg_graph2);
+  int num_missing = 0;
+  num_missing += DEG::debug_compare_print_missing(keys1, keys2, "second graph");
+  num_missing += DEG::debug_compare_print_missing(keys2, keys1, "first graph");
+  return num_missing == 0;
 }
 
 bool DEG_debug_graph_relations_validate(Depsgraph *graph,
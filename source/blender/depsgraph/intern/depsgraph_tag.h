@@ -29,6 +29,7 @@ struct Main;
 namespace DEG {
 
 struct Depsgraph;
+struct IDNode;
 
 /* Get type of a node which corresponds to a ID_RECALC_GEOMETRY tag.  */
 NodeType geometry_tag_to_component(const ID *id);
@@ -40,4 +41,10 @@ void id_tag_update(Main *bmain, ID *id, int flag, eUpdateSource update_source);
 void graph_id_tag_update(
     Main *bmain, Depsgraph *graph, ID *id, int flag, eUpdateSource update_source);
 
+/* Same as DEG_graph_on_visible_update(), for the given ID nodes only. Used by incremental
+ * builds, visibility of the other IDs did not change. */
+void graph_id_nodes_on_visible_update(Main *bmain,
+                                      Depsgraph *graph,
+                                      const Set<IDNode *> &id_nodes);
+
 }  // namespace DEG
@@ -277,7 +277,7 @@ struct ValidateData {
 
 /* Similar to generic BKE_id_copy() but does not require main and assumes pointer
  * is already allocated. */
-bool id_copy_inplace_no_main(const ID *id, ID *newid)
+bool id_copy_inplace_no_main(const ID *id, ID *newid, const int extra_flag = 0)
 {
   const ID *id_for_copy = id;
 
@@ -287,7 +287,10 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
 #endif
 
   bool result = BKE_id_copy_ex(
-      nullptr, (ID *)id_for_copy, &newid, (LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE));
+      nullptr,
+      (ID *)id_for_copy,
+      &newid,
+      (LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE | extra_flag));
 
 #ifdef NESTED_ID_NASTY_WORKAROUND
   if (result) {
@@ -321,6 +324,26 @@ bool scene_copy_inplace_no_main(const Scene *scene, Scene *new_scene)
   return result;
 }
 
+/* Whether the copy of the mesh can share geometry arrays with the original.
+ *
+ * Only done for the active dependency graph: it is evaluated in sync with the edits of the
+ * original data, while render dependency graphs are expected to keep their own copy of the
+ * geometry. Animation is evaluated in-place on the copy, so animated meshes are not shared.
+ * Sculpt and paint modes write to the original geometry in place while the copy is used, the
+ * original is treated as read-only otherwise. */
+bool mesh_copy_can_share_geometry(const Depsgraph *depsgraph, const Mesh *mesh)
+{
+  if (!depsgraph->is_active || BKE_animdata_id_is_animated(&mesh->id)) {
+    return false;
+  }
+  const Object *object_active = OBACT(depsgraph->view_layer);
+  if (object_active != nullptr && object_active->data == mesh &&
+      (object_active->mode & OB_MODE_ALL_PAINT)) {
+    return false;
+  }
+  return true;
+}
+
 /* For the given scene get view layer which corresponds to an original for the
  * scene's evaluated one. This depends on how the scene is pulled into the
  * dependency  graph. */
@@ -860,8 +883,6 @@ ID *deg_expand_copy_on_write_datablock(const Depsgraph *depsgraph,
   }
   // BLI_assert(check_datablock_expanded(id_cow) == false);
   /* Copy data from original ID to a copied version. */
-  /* TODO(sergey): Avoid doing full ID copy somehow, make Mesh to reference
-   * original geometry arrays for until those are modified. */
   /* TODO(sergey): We do some trickery with temp bmain and extra ID pointer
    * just to be able to use existing API. Ideally we need to replace this with
    * in-place copy from existing datablock to a prepared memory.
@@ -885,8 +906,11 @@ ID *deg_expand_copy_on_write_datablock(const Depsgraph *depsgraph,
       break;
     }
     case ID_ME: {
-      /* TODO(sergey): Ideally we want to handle meshes in a special
-       * manner here to avoid initial copy of all the geometry arrays. */
+      /* Share the geometry arrays with the original until either side modifies them, so
+       * updates of large meshes don't copy all of their geometry. */
+      if (mesh_copy_can_share_geometry(depsgraph, (const Mesh *)id_orig)) {
+        done = id_copy_inplace_no_main(id_orig, id_cow, LIB_ID_COPY_CD_SHARE);
+      }
       break;
     }
     default:
@@ -167,9 +167,11 @@ OperationNode *ComponentNode::add_operation(const DepsEvalOperationCb &op,
   if (!op_node) {
     DepsNodeFactory *factory = type_get_factory(NodeType::OPERATION);
     op_node = (OperationNode *)factory->create_node(this->owner->id_orig, "", name);
+    op_node->name = name;
 
-    /* register opnode in this component's operation set */
-    OperationIDKey key(opcode, name, name_tag);
+    /* register opnode in this component's operation set, the key uses the name stored in the
+     * node so it stays valid when the node is kept by an incremental build */
+    OperationIDKey key(opcode, op_node->name.c_str(), name_tag);
     operations_map->add(key, op_node);
 
     /* set backlink */
@@ -187,12 +189,37 @@ OperationNode *ComponentNode::add_operation(const DepsEvalOperationCb &op,
   /* attach extra data */
   op_node->evaluate = op;
   op_node->opcode = opcode;
-  op_node->name = name;
   op_node->name_tag = name_tag;
 
   return op_node;
 }
 
+void ComponentNode::remove_operation(OperationNode *op_node)
+{
+  BLI_assert(op_node->inlinks.is_empty() && op_node->outlinks.is_empty());
+  OperationIDKey key(op_node->opcode, op_node->name.c_str(), op_node->name_tag);
+  operations_map->remove(key);
+  if (entry_operation == op_node) {
+    entry_operation = nullptr;
+  }
+  if (exit_operation == op_node) {
+    exit_operation = nullptr;
+  }
+  OBJECT_GUARDED_DELETE(op_node, OperationNode);
+}
+
+void ComponentNode::get_operations(Vector<OperationNode *> &r_operations) const
+{
+  if (operations_map != nullptr) {
+    for (OperationNode *op_node : operations_map->values()) {
+      r_operations.append(op_node);
+    }
+  }
+  for (OperationNode *op_node : operations) {
+    r_operations.append(op_node);
+  }
+}
+
 void ComponentNode::set_entry_operation(OperationNode *op_node)
 {
   BLI_assert(entry_operation == nullptr);
@@ -280,6 +307,10 @@ OperationNode *ComponentNode::get_exit_operation()
 
 void ComponentNode::finalize_build(Depsgraph * /*graph*/)
 {
+  /* Components which incremental builds did not open are finalized already. */
+  if (operations_map == nullptr) {
+    return;
+  }
   operations.reserve(operations_map->size());
   for (OperationNode *op_node : operations_map->values()) {
     operations.push_back(op_node);
@@ -288,6 +319,31 @@ void ComponentNode::finalize_build(Depsgraph * /*graph*/)
   operations_map = nullptr;
 }
 
+void ComponentNode::reopen_build()
+{
+  reopen_operations_map();
+  entry_operation = nullptr;
+  exit_operation = nullptr;
+  affects_directly_visible = false;
+}
+
+void ComponentNode::reopen_operations_map()
+{
+  BLI_assert(operations_map == nullptr);
+  /* Entry and exit of a component with a single operation are only cached, they are to be
+   * looked up again once operations are added. */
+  if (operations.size() == 1) {
+    entry_operation = nullptr;
+    exit_operation = nullptr;
+  }
+  operations_map = new Map<ComponentNode::OperationIDKey, OperationNode *>();
+  for (OperationNode *op_node : operations) {
+    OperationIDKey key(op_node->opcode, op_node->name.c_str(), op_node->name_tag);
+    operations_map->add_new(key, op_node);
+  }
+  operations.clear();
+}
+
 /* Bone Component ========================================= */
 
 /* Initialize 'bone component' node - from pointer data given */
@@ -95,6 +95,12 @@ struct ComponentNode : public Node {
                                const char *name,
                                int name_tag);
 
+  /* Remove and free the operation, it is expected to have no relations. */
+  void remove_operation(OperationNode *op_node);
+
+  /* Append all operations of the component, both before and after the build is finalized. */
+  void get_operations(Vector<OperationNode *> &r_operations) const;
+
   /* Entry/exit operations management.
    *
    * Use those instead of direct set since this will perform sanity checks. */
@@ -109,6 +115,12 @@ struct ComponentNode : public Node {
   virtual OperationNode *get_exit_operation() override;
 
   void finalize_build(Depsgraph *graph);
+  /* Bring back the operations map, so the component can be built again by an incremental
+   * build. */
+  void reopen_build();
+  /* Only bring back the operations map, keeping the state of the component. Used to add
+   * operations to a component of an ID which builder is not run again. */
+  void reopen_operations_map();
 
   IDNode *owner;
 
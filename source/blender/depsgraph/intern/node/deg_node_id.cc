@@ -73,6 +73,7 @@ void IDNode::init(const ID *id, const char *UNUSED(subdata))
   /* Store ID-pointer. */
   id_type = GS(id->name);
   id_orig = (ID *)id;
+  id_orig_session_uuid = id->session_uuid;
   eval_flags = 0;
   previous_eval_flags = 0;
   customdata_masks = DEGCustomDataMeshMasks();
@@ -163,14 +164,27 @@ ComponentNode *IDNode::add_component(NodeType type, const char *name)
     DepsNodeFactory *factory = type_get_factory(type);
     comp_node = (ComponentNode *)factory->create_node(this->id_orig, "", name);
 
-    /* Register. */
-    ComponentIDKey key(type, name);
+    /* Register. The key points to the name stored in the node, so it stays valid when the
+     * caller's name is freed and the node is kept by an incremental build. */
+    ComponentIDKey key(type, (name[0] == '\0') ? "" : comp_node->name.c_str());
     components.add_new(key, comp_node);
     comp_node->owner = this;
   }
   return comp_node;
 }
 
+void IDNode::remove_component(ComponentNode *comp_node)
+{
+  for (const ComponentIDKey &key : components.keys()) {
+    if (components.lookup(key) == comp_node) {
+      const ComponentIDKey key_copy = key;
+      components.remove(key_copy);
+      break;
+    }
+  }
+  OBJECT_GUARDED_DELETE(comp_node, ComponentNode);
+}
+
 void IDNode::tag_update(Depsgraph *graph, eUpdateSource source)
 {
   for (ComponentNode *comp_node : components.values()) {
@@ -192,6 +206,60 @@ void IDNode::finalize_build(Depsgraph *graph)
   visible_components_mask = get_visible_components_mask();
 }
 
+void IDNode::reopen_build()
+{
+  linked_state = DEG_ID_LINKED_INDIRECTLY;
+  is_collection_fully_expanded = false;
+  has_base = false;
+  /* Evaluation flags and masks are only accumulated, builders of other IDs might have added
+   * them and are not necessarily run again. */
+  previous_eval_flags = eval_flags;
+  previous_customdata_masks = customdata_masks;
+  previously_visible_components_mask = visible_components_mask;
+  for (ComponentNode *comp_node : components.values()) {
+    comp_node->reopen_build();
+  }
+}
+
+void IDNode::add_builder_user(IDNode *id_node_user)
+{
+  if (id_node_user == this) {
+    return;
+  }
+  builder_users.add(id_node_user);
+  id_node_user->builder_used_id_nodes.add(this);
+}
+
+void IDNode::add_builder_shared_id_node(IDNode *id_node)
+{
+  if (id_node == this) {
+    return;
+  }
+  builder_shared_id_nodes.add(id_node);
+  id_node->builder_shared_id_nodes.add(this);
+}
+
+void IDNode::clear_builder_used_id_nodes()
+{
+  for (IDNode *id_node : builder_used_id_nodes) {
+    id_node->builder_users.remove(this);
+  }
+  builder_used_id_nodes.clear();
+  for (IDNode *id_node : builder_shared_id_nodes) {
+    id_node->builder_shared_id_nodes.remove(this);
+  }
+  builder_shared_id_nodes.clear();
+}
+
+void IDNode::clear_builder_links()
+{
+  clear_builder_used_id_nodes();
+  for (IDNode *id_node : builder_users) {
+    id_node->builder_used_id_nodes.remove(this);
+  }
+  builder_users.clear();
+}
+
 IDComponentsMask IDNode::get_visible_components_mask() const
 {
   IDComponentsMask result = 0;
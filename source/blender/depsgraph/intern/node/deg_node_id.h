@@ -65,10 +65,21 @@ struct IDNode : public Node {
 
   ComponentNode *find_component(NodeType type, const char *name = "") const;
   ComponentNode *add_component(NodeType type, const char *name = "");
+  /* Remove and free the component, its operations are expected to have no relations. */
+  void remove_component(ComponentNode *comp_node);
 
   virtual void tag_update(Depsgraph *graph, eUpdateSource source) override;
 
   void finalize_build(Depsgraph *graph);
+  /* Prepare the node of an already built graph to be built again by an incremental build. */
+  void reopen_build();
+
+  /* Links to other ID nodes made by builders, see builder_users. */
+  void add_builder_user(IDNode *id_node_user);
+  void add_builder_shared_id_node(IDNode *id_node);
+  /* Forget IDs reached by the builder of this ID, which is about to run again. */
+  void clear_builder_used_id_nodes();
+  void clear_builder_links();
 
   IDComponentsMask get_visible_components_mask() const;
 
@@ -80,6 +91,10 @@ struct IDNode : public Node {
   ID *id_orig;
   ID *id_cow;
 
+  /* Session UUID of the original ID at the time the node was created. Allows to detect nodes of
+   * freed IDs when their memory got re-used by a new ID, without de-referencing id_orig. */
+  unsigned int id_orig_session_uuid;
+
   /* Hash to make it faster to look up components. */
   Map<ComponentIDKey, ComponentNode *> components;
 
@@ -111,6 +126,15 @@ struct IDNode : public Node {
   IDComponentsMask visible_components_mask;
   IDComponentsMask previously_visible_components_mask;
 
+  /* IDs which builders reached this ID, and IDs reached by the builder of this ID. Kept between
+   * builds, so incremental builds know which IDs are still used when the builders of their users
+   * are not run again, and which builders might build relations to a changed ID. */
+  Set<IDNode *> builder_users;
+  Set<IDNode *> builder_used_id_nodes;
+  /* IDs which builders added components to this ID, or to which the builder of this ID added
+   * components. Incremental builds run the builders of both IDs again together. */
+  Set<IDNode *> builder_shared_id_nodes;
+
   DEG_DEPSNODE_DECLARE;
 };
 
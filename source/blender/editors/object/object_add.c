@@ -501,7 +501,7 @@ Object *ED_object_add_type(bContext *C,
    * use DEG_id_tag_update here perhaps.
    */
   DEG_id_type_tag(bmain, ID_OB);
-  DEG_relations_tag_update(bmain);
+  DEG_relations_tag_update_id(bmain, &ob->id);
   if (ob->data != NULL) {
     DEG_id_tag_update_ex(bmain, (ID *)ob->data, ID_RECALC_EDITORS);
   }
@@ -1618,12 +1618,14 @@ static int object_delete_exec(bContext *C, wmOperator *op)
         if (gpl->parent != NULL) {
           if (gpl->parent == ob) {
             gpl->parent = NULL;
+            DEG_relations_tag_update_id(bmain, &gpd->id);
           }
         }
       }
     }
 
     /* remove from current scene only */
+    DEG_relations_tag_update_id(bmain, &ob->id);
     ED_object_base_free_and_unlink(bmain, scene, ob);
     changed_count += 1;
 
@@ -1662,8 +1664,6 @@ static int object_delete_exec(bContext *C, wmOperator *op)
     if (scene->id.tag & LIB_TAG_DOIT) {
       scene->id.tag &= ~LIB_TAG_DOIT;
 
-      DEG_relations_tag_update(bmain);
-
       DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
       WM_event_add_notifier(C, NC_SCENE | ND_OB_ACTIVE, scene);
       WM_event_add_notifier(C, NC_SCENE | ND_LAYER_CONTENT, scene);
@@ -608,10 +608,10 @@ static int parent_clear_exec(bContext *C, wmOperator *op)
 
   CTX_DATA_BEGIN (C, Object *, ob, selected_editable_objects) {
     ED_object_parent_clear(ob, type);
+    DEG_relations_tag_update_id(bmain, &ob->id);
   }
   CTX_DATA_END;
 
-  DEG_relations_tag_update(bmain);
   WM_event_add_notifier(C, NC_OBJECT | ND_TRANSFORM, NULL);
   WM_event_add_notifier(C, NC_OBJECT | ND_PARENT, NULL);
   return OPERATOR_FINISHED;
@@ -1017,7 +1017,13 @@ static int parent_set_exec(bContext *C, wmOperator *op)
     return OPERATOR_CANCELLED;
   }
 
-  DEG_relations_tag_update(bmain);
+  /* Only relations of the parent and its new children change. Tagging is done after all the
+   * objects are parented, ED_object_parent_set() evaluates the depsgraph. */
+  CTX_DATA_BEGIN (C, Object *, ob, selected_editable_objects) {
+    DEG_relations_tag_update_id(bmain, &ob->id);
+  }
+  CTX_DATA_END;
+  DEG_relations_tag_update_id(bmain, &par->id);
   WM_event_add_notifier(C, NC_OBJECT | ND_TRANSFORM, NULL);
   WM_event_add_notifier(C, NC_OBJECT | ND_PARENT, NULL);
 
@@ -167,6 +167,35 @@ void imb_tile_cache_tile_free(ImBuf *ibuf, int tx, int ty)
   BLI_mutex_unlock(&GLOBAL_CACHE.mutex);
 }
 
+/* Memory budget callback, unload tiles not used by any thread. */
+static size_t imb_tile_cache_budget_free(size_t size, void *UNUSED(user_data))
+{
+  ImGlobalTile *gtile, *gtile_prev;
+  size_t freed = 0;
+
+  /* The allocating thread may be loading a tile. */
+  if (!BLI_mutex_trylock(&GLOBAL_CACHE.mutex)) {
+    return 0;
+  }
+
+  for (gtile = GLOBAL_CACHE.tiles.last; gtile && freed < size; gtile = gtile_prev) {
+    gtile_prev = gtile->prev;
+
+    if (gtile->refcount == 0 && gtile->loading == 0) {
+      freed += sizeof(unsigned int) * gtile->ibuf->tilex * gtile->ibuf->tiley;
+
+      imb_global_cache_tile_unload(gtile);
+      BLI_ghash_remove(GLOBAL_CACHE.tilehash, gtile, NULL, NULL);
+      BLI_remlink(&GLOBAL_CACHE.tiles, gtile);
+      BLI_addtail(&GLOBAL_CACHE.unused, gtile);
+    }
+  }
+
+  BLI_mutex_unlock(&GLOBAL_CACHE.mutex);
+
+  return freed;
+}
+
 /******************************* Init/Exit ***********************************/
 
 static void imb_thread_cache_init(ImThreadTileCache *cache)
@@ -209,6 +238,8 @@ void imb_tile_cache_exit(void)
   ImGlobalTile *gtile;
   int a;
 
+  MEM_remove_budget_callback(imb_tile_cache_budget_free, NULL);
+
   if (GLOBAL_CACHE.initialized) {
     for (gtile = GLOBAL_CACHE.tiles.first; gtile; gtile = gtile->next) {
       imb_global_cache_tile_unload(gtile);
@@ -263,6 +294,8 @@ void IMB_tile_cache_params(int totthread, int maxmem)
   }
 
   BLI_mutex_init(&GLOBAL_CACHE.mutex);
+
+  MEM_add_budget_callback(imb_tile_cache_budget_free, NULL);
 }
 
 /***************************** Global Cache **********************************/
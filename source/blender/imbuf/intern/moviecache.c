@@ -245,17 +245,34 @@ static bool get_item_destroyable(void *item_v)
   return true;
 }
 
+/* Memory budget callback, called from any thread while it allocates. */
+static size_t moviecache_budget_free(size_t size, void *UNUSED(user_data))
+{
+  size_t freed = 0;
+
+  /* The allocating thread may be putting an item in the cache. */
+  if (BLI_mutex_trylock(&limitor_lock)) {
+    freed = MEM_CacheLimiter_free_memory(limitor, size);
+    BLI_mutex_unlock(&limitor_lock);
+  }
+
+  return freed;
+}
+
 void IMB_moviecache_init(void)
 {
   limitor = new_MEM_CacheLimiter(IMB_moviecache_destructor, get_item_size);
 
   MEM_CacheLimiter_ItemPriority_Func_set(limitor, get_item_priority);
   MEM_CacheLimiter_ItemDestroyable_Func_set(limitor, get_item_destroyable);
+
+  MEM_add_budget_callback(moviecache_budget_free, NULL);
 }
 
 void IMB_moviecache_destruct(void)
 {
   if (limitor) {
+    MEM_remove_budget_callback(moviecache_budget_free, NULL);
     delete_MEM_CacheLimiter(limitor);
   }
 }
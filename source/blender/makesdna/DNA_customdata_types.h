@@ -232,6 +232,8 @@ enum {
   CD_FLAG_EXTERNAL = (1 << 3),
   /* Indicates external data is read into memory */
   CD_FLAG_IN_MEMORY = (1 << 4),
+  /* Indicates the data may be used by other layers too (runtime only) */
+  CD_FLAG_SHARED = (1 << 5),
 };
 
 /* Limits */
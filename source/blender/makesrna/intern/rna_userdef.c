@@ -5932,6 +5932,13 @@ static void rna_def_userdef_filepaths(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Compress File", "Enable file compression when saving .blend files");
 
+  prop = RNA_def_property(srna, "use_save_background", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", USER_SAVE_BACKGROUND);
+  RNA_def_property_ui_text(prop,
+                           "Save in Background",
+                           "Write .blend files to disk in the background when saving from the "
+                           "interface, so editing can continue while the file is written");
+
   prop = RNA_def_property(srna, "use_load_ui", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_negative_sdna(prop, NULL, "flag", USER_FILENOUI);
   RNA_def_property_ui_text(prop, "Load UI", "Load user interface setup when loading .blend files");
@@ -6033,6 +6040,14 @@ static void rna_def_userdef_filepaths(BlenderRNA *brna)
                            "uses process ID (sculpt & edit-mode data won't be saved!)");
   RNA_def_property_update(prop, 0, "rna_userdef_autosave_update");
 
+  prop = RNA_def_property(srna, "use_auto_save_incremental", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", USER_AUTOSAVE_INCREMENTAL);
+  RNA_def_property_ui_text(prop,
+                           "Incremental Auto Save",
+                           "Only write data changed since the previous automatic save, "
+                           "the temporary file can only be opened by Blender "
+                           "(requires Global Undo)");
+
   prop = RNA_def_property(srna, "auto_save_time", PROP_INT, PROP_NONE);
   RNA_def_property_int_sdna(prop, NULL, "savetime");
   RNA_def_property_range(prop, 1, 60);
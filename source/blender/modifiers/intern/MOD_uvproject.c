@@ -207,9 +207,7 @@ static Mesh *uvprojectModifier_do(UVProjectModifierData *umd,
   coords = BKE_mesh_vert_coords_alloc(mesh, &numVerts);
 
   /* convert coords to world space */
-  for (i = 0, co = coords; i < numVerts; i++, co++) {
-    mul_m4_v3(ob->obmat, *co);
-  }
+  mul_v3_m4v3_array(coords, ob->obmat, (const float(*)[3])coords, numVerts);
 
   /* if only one projector, project coords to UVs */
   if (num_projectors == 1 && projectors[0].uci == NULL) {
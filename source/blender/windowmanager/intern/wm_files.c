@@ -411,7 +411,8 @@ static int wm_read_exotic(const char *name)
     else {
       len = gzread(gzfile, header, sizeof(header));
       gzclose(gzfile);
-      if (len == sizeof(header) && STREQLEN(header, "BLENDER", 7)) {
+      if (len == sizeof(header) && (STREQLEN(header, "BLENDER", 7) ||
+                                    STREQLEN(header, BLO_MEMFILE_JOURNAL_MAGIC, 7))) {
         retval = BKE_READ_EXOTIC_OK_BLEND;
       }
       else {
@@ -1331,10 +1332,135 @@ bool write_crash_blend(void)
   }
 }
 
+/* Saving in the background.
+ *
+ * The file is serialized on the main thread (see #BLO_write_file_snapshot),
+ * compression, writing to disk and replacing the old file are done by a job. */
+
+typedef struct WMFileWriteJob {
+  struct BlendWriteSnapshot *snapshot;
+  char filepath[FILE_MAX];
+  /** Thumbnail to store once the file is written (owned by the job). */
+  ImBuf *ibuf_thumb;
+  bool do_history;
+
+  bool success;
+  /** Reports of the job thread, passed on to the window-manager when the job ends. */
+  ReportList reports;
+} WMFileWriteJob;
+
+static void wm_file_write_job_startjob(void *customdata,
+                                       short *UNUSED(stop),
+                                       short *UNUSED(do_update),
+                                       float *UNUSED(progress))
+{
+  WMFileWriteJob *wj = customdata;
+
+  /* Stop requests are ignored, stopping the job waits for the file to be complete. */
+  wj->success = BLO_write_file_snapshot_write(wj->snapshot, &wj->reports);
+}
+
+static void wm_file_write_job_endjob(void *customdata)
+{
+  WMFileWriteJob *wj = customdata;
+  Main *bmain = G_MAIN;
+
+  LISTBASE_FOREACH (Report *, report, &wj->reports.list) {
+    WM_report(report->type, report->message);
+  }
+
+  if (wj->success) {
+    /* prevent background mode scripts from clobbering history */
+    if (wj->do_history) {
+      wm_history_file_update();
+    }
+
+    BKE_callback_exec_null(bmain, BKE_CB_EVT_SAVE_POST);
+
+    /* run this function after because the file cant be written before the blend is */
+    if (wj->ibuf_thumb) {
+      IMB_thumb_delete(wj->filepath, THB_FAIL); /* without this a failed thumb overrides */
+      wj->ibuf_thumb = IMB_thumb_create(wj->filepath, THB_LARGE, THB_SOURCE_BLEND, wj->ibuf_thumb);
+    }
+
+    WM_reportf(RPT_INFO, "Saved \"%s\"", BLI_path_basename(wj->filepath));
+  }
+  else {
+    /* The file was already considered saved when the job started. */
+    wmWindowManager *wm = bmain->wm.first;
+    if (wm != NULL) {
+      wm->file_saved = 0;
+    }
+    WM_main_add_notifier(NC_WM | ND_DATACHANGED, NULL);
+  }
+}
+
+static void wm_file_write_job_free(void *customdata)
+{
+  WMFileWriteJob *wj = customdata;
+
+  BLO_write_file_snapshot_free(wj->snapshot);
+  if (wj->ibuf_thumb) {
+    IMB_freeImBuf(wj->ibuf_thumb);
+  }
+  BKE_reports_clear(&wj->reports);
+  MEM_freeN(wj);
+}
+
 /**
+ * Start writing a snapshot of the current file in the background.
+ * Takes ownership of \a ibuf_thumb.
+ *
+ * \return false when the file couldn't be serialized, nothing was started then.
+ */
+static bool wm_file_write_background(bContext *C,
+                                     const char *filepath,
+                                     int fileflags,
+                                     ReportList *reports,
+                                     const BlendThumbnail *thumb,
+                                     ImBuf *ibuf_thumb,
+                                     const bool do_history)
+{
+  wmWindowManager *wm = CTX_wm_manager(C);
+
+  /* Let a previous save finish first, files must be written in order. */
+  WM_jobs_kill_type(wm, wm, WM_JOB_TYPE_FILE_WRITE);
+
+  struct BlendWriteSnapshot *snapshot = BLO_write_file_snapshot(
+      CTX_data_main(C), filepath, fileflags, reports, thumb);
+  if (snapshot == NULL) {
+    if (ibuf_thumb) {
+      IMB_freeImBuf(ibuf_thumb);
+    }
+    return false;
+  }
+
+  WMFileWriteJob *wj = MEM_callocN(sizeof(*wj), __func__);
+  wj->snapshot = snapshot;
+  BLI_strncpy(wj->filepath, filepath, sizeof(wj->filepath));
+  wj->ibuf_thumb = ibuf_thumb;
+  wj->do_history = do_history;
+  BKE_reports_init(&wj->reports, RPT_STORE);
+
+  wmJob *wm_job = WM_jobs_get(wm, CTX_wm_window(C), wm, "Saving", 0, WM_JOB_TYPE_FILE_WRITE);
+  WM_jobs_customdata_set(wm_job, wj, wm_file_write_job_free);
+  WM_jobs_timer(wm_job, 0.1, 0, 0);
+  WM_jobs_callbacks(wm_job, wm_file_write_job_startjob, NULL, NULL, wm_file_write_job_endjob);
+  WM_jobs_start(wm, wm_job);
+
+  return true;
+}
+
+/**
+ * \param use_background: Write the file from a job, see #wm_file_write_background.
+ *
  * \see #wm_homefile_write_exec wraps #BLO_write_file in a similar way.
  */
-static bool wm_file_write(bContext *C, const char *filepath, int fileflags, ReportList *reports)
+static bool wm_file_write(bContext *C,
+                          const char *filepath,
+                          int fileflags,
+                          const bool use_background,
+                          ReportList *reports)
 {
   Main *bmain = CTX_data_main(C);
   Library *li;
@@ -1411,8 +1537,25 @@ static bool wm_file_write(bContext *C, const char *filepath, int fileflags, Repo
   /* XXX temp solution to solve bug, real fix coming (ton) */
   bmain->recovered = 0;
 
-  if (BLO_write_file(CTX_data_main(C), filepath, fileflags, reports, thumb)) {
-    const bool do_history = (G.background == false) && (CTX_wm_manager(C)->op_undo_depth == 0);
+  const bool do_history = (G.background == false) && (CTX_wm_manager(C)->op_undo_depth == 0);
+
+  if (use_background) {
+    /* The job reports & runs the post-save handlers once the file is written. */
+    if (wm_file_write_background(C, filepath, fileflags, reports, thumb, ibuf_thumb, do_history)) {
+      if (!(fileflags & G_FILE_SAVE_COPY)) {
+        G.relbase_valid = 1;
+        BLI_strncpy(bmain->name, filepath, sizeof(bmain->name)); /* is guaranteed current file */
+
+        G.save_over = 1; /* disable untitled.blend convention */
+      }
+
+      SET_FLAG_FROM_TEST(G.fileflags, fileflags & G_FILE_COMPRESS, G_FILE_COMPRESS);
+
+      ok = true;
+    }
+    ibuf_thumb = NULL;
+  }
+  else if (BLO_write_file(CTX_data_main(C), filepath, fileflags, reports, thumb)) {
 
     if (!(fileflags & G_FILE_SAVE_COPY)) {
       G.relbase_valid = 1;
@@ -1461,6 +1604,17 @@ static bool wm_file_write(bContext *C, const char *filepath, int fileflags, Repo
 /** \name Auto-Save API
  * \{ */
 
+/** Chunks written by the last incremental auto-save, see #USER_AUTOSAVE_INCREMENTAL. */
+static MemFileJournal *wm_autosave_journal = NULL;
+
+static void wm_autosave_journal_free(void)
+{
+  if (wm_autosave_journal) {
+    BLO_memfile_journal_free(wm_autosave_journal);
+    wm_autosave_journal = NULL;
+  }
+}
+
 void wm_autosave_location(char *filepath)
 {
   const int pid = abs(getpid());
@@ -1534,13 +1688,24 @@ void wm_autosave_timer(Main *bmain, wmWindowManager *wm, wmTimer *UNUSED(wt))
     /* fast save of last undobuffer, now with UI */
     struct MemFile *memfile = ED_undosys_stack_memfile_get_active(wm->undo_stack);
     if (memfile) {
-      BLO_memfile_write_file(memfile, filepath);
+      if (U.flag & USER_AUTOSAVE_INCREMENTAL) {
+        /* Only write the parts of the undo buffer changed since the last auto-save. */
+        if (wm_autosave_journal == NULL) {
+          wm_autosave_journal = BLO_memfile_journal_new();
+        }
+        BLO_memfile_journal_write(wm_autosave_journal, memfile, filepath);
+      }
+      else {
+        wm_autosave_journal_free();
+        BLO_memfile_write_file(memfile, filepath);
+      }
     }
   }
   else {
     /* Save as regular blend file. */
     int fileflags = G.fileflags & ~(G_FILE_COMPRESS | G_FILE_HISTORY);
 
+    wm_autosave_journal_free();
     ED_editors_flush_edits(bmain);
 
     /* Error reporting into console */
@@ -1563,6 +1728,7 @@ void wm_autosave_delete(void)
   char filename[FILE_MAX];
 
   wm_autosave_location(filename);
+  wm_autosave_journal_free();
 
   if (BLI_exists(filename)) {
     char str[FILE_MAX];
@@ -2619,12 +2785,19 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
   /* set compression flag */
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "compress"), G_FILE_COMPRESS);
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "relative_remap"), G_FILE_RELATIVE_REMAP);
+  SET_FLAG_FROM_TEST(
+      fileflags, RNA_boolean_get(op->ptr, "index_dependencies"), G_FILE_INDEX_DEPS);
   SET_FLAG_FROM_TEST(
       fileflags,
       (RNA_struct_property_is_set(op->ptr, "copy") && RNA_boolean_get(op->ptr, "copy")),
       G_FILE_SAVE_COPY);
 
-  const bool ok = wm_file_write(C, path, fileflags, op->reports);
+  const bool use_exit = !is_save_as && RNA_boolean_get(op->ptr, "exit");
+  /* Scripts expect the file to be written when the operator returns. */
+  const bool use_background = (U.flag & USER_SAVE_BACKGROUND) && (op->flag & OP_IS_INVOKE) &&
+                              !G.background && !use_exit;
+
+  const bool ok = wm_file_write(C, path, fileflags, use_background, op->reports);
 
   if ((op->flag & OP_IS_INVOKE) == 0) {
     /* OP_IS_INVOKE is set when the operator is called from the GUI.
@@ -2639,7 +2812,7 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
 
   WM_event_add_notifier(C, NC_WM | ND_FILESAVE, NULL);
 
-  if (!is_save_as && RNA_boolean_get(op->ptr, "exit")) {
+  if (use_exit) {
     wm_exit_schedule_delayed(C);
   }
 
@@ -2687,6 +2860,11 @@ void WM_OT_save_as_mainfile(wmOperatorType *ot)
                   true,
                   "Remap Relative",
                   "Remap relative paths when saving to a different directory");
+  RNA_def_boolean(ot->srna,
+                  "index_dependencies",
+                  false,
+                  "Index Dependencies",
+                  "Store the data-blocks used by each data-block, for browsing and linking");
   prop = RNA_def_boolean(
       ot->srna,
       "copy",
@@ -2757,6 +2935,11 @@ void WM_OT_save_mainfile(wmOperatorType *ot)
                   false,
                   "Remap Relative",
                   "Remap relative paths when saving to a different directory");
+  RNA_def_boolean(ot->srna,
+                  "index_dependencies",
+                  false,
+                  "Index Dependencies",
+                  "Store the data-blocks used by each data-block, for browsing and linking");
 
   prop = RNA_def_boolean(ot->srna, "exit", false, "Exit", "Exit Blender after saving");
   RNA_def_property_flag(prop, PROP_HIDDEN | PROP_SKIP_SAVE);
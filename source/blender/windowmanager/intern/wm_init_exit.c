@@ -648,6 +648,10 @@ void WM_exit_ex(bContext *C, const bool do_python)
 
   DNA_sdna_current_free();
 
+  if (G.debug & G_DEBUG_TASK_STATS) {
+    BLI_task_parallel_range_stats_print();
+  }
+
   BLI_threadapi_exit();
   BLI_task_scheduler_exit();
 
@@ -3336,6 +3336,9 @@ static void WM_OT_redraw_timer(wmOperatorType *ot)
 static int memory_statistics_exec(bContext *UNUSED(C), wmOperator *UNUSED(op))
 {
   MEM_printmemlist_stats();
+  if (MEM_profile_is_enabled()) {
+    MEM_profile_print(stdout);
+  }
   return OPERATOR_FINISHED;
 }
 
@@ -3343,7 +3346,8 @@ static void WM_OT_memory_statistics(wmOperatorType *ot)
 {
   ot->name = "Memory Statistics";
   ot->idname = "WM_OT_memory_statistics";
-  ot->description = "Print memory statistics to the console";
+  ot->description =
+      "Print memory statistics to the console (including the memory profile when enabled)";
 
   ot->exec = memory_statistics_exec;
 }
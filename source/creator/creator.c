@@ -277,20 +277,28 @@ int main(int argc,
 
   /* NOTE: Special exception for guarded allocator type switch:
    *       we need to perform switch from lock-free to fully
-   *       guarded allocator before any allocation happened.
+   *       guarded (or thread cached) allocator before any allocation happened.
    */
   {
     int i;
+    bool use_cached_allocator = false;
     for (i = 0; i < argc; i++) {
       if (STR_ELEM(argv[i], "-d", "--debug", "--debug-memory", "--debug-all")) {
         printf("Switching to fully guarded memory allocator.\n");
         MEM_use_guarded_allocator();
+        use_cached_allocator = false;
         break;
       }
+      else if (STREQ(argv[i], "--enable-cached-memory")) {
+        use_cached_allocator = true;
+      }
       else if (STREQ(argv[i], "--")) {
         break;
       }
     }
+    if (use_cached_allocator) {
+      MEM_use_cached_allocator();
+    }
   }
 
 #ifdef BUILD_DATE
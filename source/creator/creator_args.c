@@ -40,6 +40,7 @@
 #  include "BLI_string.h"
 #  include "BLI_string_utf8.h"
 #  include "BLI_system.h"
+#  include "BLI_task.h"
 #  include "BLI_threads.h"
 #  include "BLI_utildefines.h"
 
@@ -527,6 +528,8 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--render-output");
   BLI_argsPrintArgDoc(ba, "--engine");
   BLI_argsPrintArgDoc(ba, "--threads");
+  BLI_argsPrintArgDoc(ba, "--memory-budget");
+  BLI_argsPrintArgDoc(ba, "--threads-numa");
 
   printf("\n");
   printf("Format Options:\n");
@@ -589,6 +592,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--debug-cycles");
 #  endif
   BLI_argsPrintArgDoc(ba, "--debug-memory");
+  BLI_argsPrintArgDoc(ba, "--profile-memory");
   BLI_argsPrintArgDoc(ba, "--debug-jobs");
   BLI_argsPrintArgDoc(ba, "--debug-python");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph");
@@ -598,6 +602,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-time");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-pretty");
+  BLI_argsPrintArgDoc(ba, "--debug-depsgraph-verify");
   BLI_argsPrintArgDoc(ba, "--debug-gpu");
   BLI_argsPrintArgDoc(ba, "--debug-gpumem");
   BLI_argsPrintArgDoc(ba, "--debug-gpu-shaders");
@@ -609,6 +614,8 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 #  endif
   BLI_argsPrintArgDoc(ba, "--debug-all");
   BLI_argsPrintArgDoc(ba, "--debug-io");
+  BLI_argsPrintArgDoc(ba, "--debug-io-profile");
+  BLI_argsPrintArgDoc(ba, "--debug-task-stats");
 
   printf("\n");
   BLI_argsPrintArgDoc(ba, "--debug-fpe");
@@ -621,6 +628,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--factory-startup");
   BLI_argsPrintArgDoc(ba, "--disable-library-override");
   BLI_argsPrintArgDoc(ba, "--enable-event-simulate");
+  BLI_argsPrintArgDoc(ba, "--enable-cached-memory");
   printf("\n");
   BLI_argsPrintArgDoc(ba, "--env-system-datafiles");
   BLI_argsPrintArgDoc(ba, "--env-system-scripts");
@@ -753,6 +761,18 @@ static int arg_handle_abort_handler_disable(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_cached_memory_enable_doc[] =
+    "\n\t"
+    "Use a memory allocator with per-thread caches, faster for allocation heavy tasks.\n"
+    "\tIgnored when using the fully guarded memory allocator for debugging.";
+static int arg_handle_cached_memory_enable(int UNUSED(argc),
+                                           const char **UNUSED(argv),
+                                           void *UNUSED(data))
+{
+  /* Handled on startup, before any allocation (see 'main'). */
+  return 0;
+}
+
 static const char arg_handle_background_mode_set_doc[] =
     "\n\t"
     "Run in background (often used for UI-less rendering).";
@@ -981,9 +1001,15 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_no_threads[] =
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_pretty[] =
     "\n\t"
     "Enable colors for dependency graph debug messages.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_verify[] =
+    "\n\t"
+    "Verify incremental dependency graph relations updates against a full rebuild.";
 static const char arg_handle_debug_mode_generic_set_doc_gpumem[] =
     "\n\t"
     "Enable GPU memory stats in status bar.";
+static const char arg_handle_debug_mode_generic_set_doc_io_profile[] =
+    "\n\t"
+    "Print a timing report (JSON) of each phase and ID type after reading a .blend file.";
 
 static int arg_handle_debug_mode_generic_set(int UNUSED(argc),
                                              const char **UNUSED(argv),
@@ -1004,6 +1030,18 @@ static int arg_handle_debug_mode_io(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_debug_mode_task_stats_doc[] =
+    "\n\t"
+    "Print statistics of each threaded loop (calls, iterations & timing) on exit.";
+static int arg_handle_debug_mode_task_stats(int UNUSED(argc),
+                                            const char **UNUSED(argv),
+                                            void *UNUSED(data))
+{
+  G.debug |= G_DEBUG_TASK_STATS;
+  BLI_task_parallel_range_stats_enable(true);
+  return 0;
+}
+
 static const char arg_handle_debug_mode_all_doc[] =
     "\n\t"
     "Enable all debug messages.";
@@ -1059,6 +1097,31 @@ static int arg_handle_debug_mode_memory_set(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_profile_memory_set_doc[] =
+    "<kilobytes>\n"
+    "\tEnable the sampling memory profiler, printing memory use per allocation tag on exit.\n"
+    "\tOne allocation is sampled every <kilobytes> on average (512 is a reasonable default).";
+static int arg_handle_profile_memory_set(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--profile-memory";
+  if (argc > 1) {
+    const char *err_msg = NULL;
+    int value;
+    if (!parse_int_clamp(argv[1], NULL, 1, INT_MAX / 1024, &value, &err_msg)) {
+      printf("\nError: %s '%s %s'.\n", err_msg, arg_id, argv[1]);
+      return 1;
+    }
+
+    MEM_profile_start((size_t)value * 1024, MEM_PROFILE_PRINT_AT_EXIT);
+
+    return 1;
+  }
+  else {
+    printf("\nError: you must specify the sample interval for the memory profiler.\n");
+    return 0;
+  }
+}
+
 static const char arg_handle_debug_value_set_doc[] =
     "<value>\n"
     "\tSet debug value of <value> on startup.";
@@ -1492,6 +1555,44 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   }
 }
 
+static const char arg_handle_threads_numa_set_doc[] =
+    "\n\tSpread large threaded operations over NUMA nodes, pinning threads to their node\n"
+    "\t(for systems with multiple CPU sockets).";
+static int arg_handle_threads_numa_set(int UNUSED(argc),
+                                       const char **UNUSED(argv),
+                                       void *UNUSED(data))
+{
+  BLI_task_scheduler_use_numa_set(true);
+  return 0;
+}
+
+static const char arg_handle_memory_budget_set_doc[] =
+    "<soft> <hard>\n"
+    "\tLimit the memory used, in megabytes (0 for no limit).\n"
+    "\tAbove <soft> caches are freed to make room, going over <hard> stops with an error.";
+static int arg_handle_memory_budget_set(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--memory-budget";
+  int params[2], i;
+
+  if (argc < 3) {
+    printf("\nError: you must specify the soft and hard limits '%s'.\n", arg_id);
+    return 0;
+  }
+
+  for (i = 0; i < 2; i++) {
+    const char *err_msg = NULL;
+    if (!parse_int_clamp(argv[i + 1], NULL, 0, INT_MAX, &params[i], &err_msg)) {
+      printf("\nError: %s '%s %s'.\n", err_msg, arg_id, argv[i + 1]);
+      return 2;
+    }
+  }
+
+  MEM_set_memory_budget((size_t)params[0] * 1024 * 1024, (size_t)params[1] * 1024 * 1024);
+
+  return 2;
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet logging verbosity level for debug messages which supports it.";
@@ -2056,6 +2157,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 1, NULL, "--disable-crash-handler", CB(arg_handle_crash_handler_disable), NULL);
   BLI_argsAdd(ba, 1, NULL, "--disable-abort-handler", CB(arg_handle_abort_handler_disable), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--enable-cached-memory", CB(arg_handle_cached_memory_enable), NULL);
 
   BLI_argsAdd(ba, 1, "-b", "--background", CB(arg_handle_background_mode_set), NULL);
 
@@ -2127,6 +2229,13 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_argsAdd(ba, 1, NULL, "--debug-all", CB(arg_handle_debug_mode_all), NULL);
 
   BLI_argsAdd(ba, 1, NULL, "--debug-io", CB(arg_handle_debug_mode_io), NULL);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-io-profile",
+              CB_EX(arg_handle_debug_mode_generic_set, io_profile),
+              (void *)G_DEBUG_IO_PROFILE);
+  BLI_argsAdd(ba, 1, NULL, "--debug-task-stats", CB(arg_handle_debug_mode_task_stats), NULL);
 
   BLI_argsAdd(ba, 1, NULL, "--debug-fpe", CB(arg_handle_debug_fpe_set), NULL);
 
@@ -2137,6 +2246,7 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_argsAdd(ba, 1, NULL, "--debug-cycles", CB(arg_handle_debug_mode_cycles), NULL);
 #  endif
   BLI_argsAdd(ba, 1, NULL, "--debug-memory", CB(arg_handle_debug_mode_memory_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--profile-memory", CB(arg_handle_profile_memory_set), NULL);
 
   BLI_argsAdd(ba, 1, NULL, "--debug-value", CB(arg_handle_debug_value_set), NULL);
   BLI_argsAdd(ba,
@@ -2193,6 +2303,12 @@ void main_args_setup(bContext *C, bArgs *ba)
               "--debug-depsgraph-pretty",
               CB_EX(arg_handle_debug_mode_generic_set, depsgraph_pretty),
               (void *)G_DEBUG_DEPSGRAPH_PRETTY);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-depsgraph-verify",
+              CB_EX(arg_handle_debug_mode_generic_set, depsgraph_verify),
+              (void *)G_DEBUG_DEPSGRAPH_VERIFY);
   BLI_argsAdd(ba,
               1,
               NULL,
@@ -2264,6 +2380,8 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
   BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--memory-budget", CB(arg_handle_memory_budget_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--threads-numa", CB(arg_handle_threads_numa_set), NULL);
   BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #  undef CB
@@ -0,0 +1,158 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "DNA_customdata_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+}
+
+#define TOTELEM 16
+
+static void customdata_init(CustomData *data)
+{
+  CustomData_reset(data);
+  MVert *mvert = (MVert *)CustomData_add_layer(data, CD_MVERT, CD_CALLOC, NULL, TOTELEM);
+  mvert[0].co[0] = 1.0f;
+  CustomData_add_layer(data, CD_MDEFORMVERT, CD_CALLOC, NULL, TOTELEM);
+}
+
+TEST(customdata, ShareLayers)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  CustomData data_a, data_b;
+  customdata_init(&data_a);
+  CustomData_copy(&data_a, &data_b, CD_MASK_MVERT | CD_MASK_MDEFORMVERT, CD_SHARE, TOTELEM);
+
+  /* Simple layers are shared, layers with copy callbacks are duplicated. */
+  EXPECT_EQ(CustomData_get_layer(&data_a, CD_MVERT), CustomData_get_layer(&data_b, CD_MVERT));
+  EXPECT_NE(CustomData_get_layer(&data_a, CD_MDEFORMVERT),
+            CustomData_get_layer(&data_b, CD_MDEFORMVERT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&data_a, CD_MVERT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&data_b, CD_MVERT));
+  EXPECT_FALSE(CustomData_is_referenced_layer(&data_b, CD_MDEFORMVERT));
+
+  /* The data outlives the layer it was shared from. */
+  CustomData_free(&data_a, TOTELEM);
+  MVert *mvert = (MVert *)CustomData_get_layer(&data_b, CD_MVERT);
+  EXPECT_EQ(1.0f, mvert[0].co[0]);
+
+  /* The last user owns the data. */
+  EXPECT_EQ(mvert, CustomData_duplicate_referenced_layer(&data_b, CD_MVERT, TOTELEM));
+  EXPECT_FALSE(CustomData_is_referenced_layer(&data_b, CD_MVERT));
+
+  CustomData_free(&data_b, TOTELEM);
+  EXPECT_EQ(mem_in_use, MEM_get_memory_in_use());
+}
+
+TEST(customdata, UnshareLayers)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  CustomData data_a, data_b, data_c;
+  customdata_init(&data_a);
+  CustomData_copy(&data_a, &data_b, CD_MASK_MVERT, CD_SHARE, TOTELEM);
+  CustomData_copy(&data_b, &data_c, CD_MASK_MVERT, CD_SHARE, TOTELEM);
+  MVert *mvert_a = (MVert *)CustomData_get_layer(&data_a, CD_MVERT);
+  EXPECT_EQ(mvert_a, CustomData_get_layer(&data_c, CD_MVERT));
+
+  /* Writing to a shared layer requires a copy, others still share the data. */
+  MVert *mvert_b = (MVert *)CustomData_duplicate_referenced_layer(&data_b, CD_MVERT, TOTELEM);
+  EXPECT_NE(mvert_a, mvert_b);
+  mvert_b[0].co[0] = 2.0f;
+  EXPECT_EQ(1.0f, mvert_a[0].co[0]);
+  EXPECT_TRUE(CustomData_is_referenced_layer(&data_c, CD_MVERT));
+
+  /* Reallocation un-shares too. */
+  CustomData_realloc(&data_c, TOTELEM * 2);
+  EXPECT_NE(mvert_a, CustomData_get_layer(&data_c, CD_MVERT));
+  EXPECT_FALSE(CustomData_is_referenced_layer(&data_c, CD_MVERT));
+  EXPECT_EQ(1.0f, mvert_a[0].co[0]);
+
+  CustomData_free(&data_a, TOTELEM);
+  CustomData_free(&data_b, TOTELEM);
+  CustomData_free(&data_c, TOTELEM * 2);
+  EXPECT_EQ(mem_in_use, MEM_get_memory_in_use());
+}
+
+TEST(customdata, ShareMeshWriteOriginal)
+{
+  BKE_idtype_init();
+  const size_t mem_in_use = MEM_get_memory_in_use();
+
+  /* A quad in the XY plane. */
+  Mesh *mesh = BKE_mesh_new_nomain(4, 4, 0, 4, 1);
+  const float cos[4][2] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+  for (int i = 0; i < 4; i++) {
+    mesh->mvert[i].co[0] = cos[i][0];
+    mesh->mvert[i].co[1] = cos[i][1];
+    mesh->medge[i].v1 = i;
+    mesh->medge[i].v2 = (i + 1) % 4;
+    mesh->mloop[i].v = i;
+    mesh->mloop[i].e = i;
+  }
+  mesh->mpoly[0].totloop = 4;
+
+  /* Same copy as done by the copy-on-write update of the active dependency graph. */
+  Mesh *mesh_cow = NULL;
+  BKE_id_copy_ex(
+      NULL, &mesh->id, (ID **)&mesh_cow, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE);
+  const MVert *mvert_cow = mesh_cow->mvert;
+  const MLoop *mloop_cow = mesh_cow->mloop;
+  EXPECT_EQ(mesh->mvert, mvert_cow);
+  EXPECT_EQ(mesh->mloop, mloop_cow);
+
+  /* Writing vertex normals gives the original its own vertices. */
+  BKE_mesh_calc_normals(mesh);
+  EXPECT_NE(mvert_cow, mesh->mvert);
+  EXPECT_EQ(mvert_cow, mesh_cow->mvert);
+  EXPECT_NE(0, mesh->mvert[0].no[2]);
+  EXPECT_EQ(0, mvert_cow[0].no[2]);
+
+  /* Writing in place like sculpt mode requires un-sharing the remaining layers first. */
+  EXPECT_TRUE(BKE_mesh_ensure_unshared_customdata(mesh));
+  EXPECT_FALSE(BKE_mesh_ensure_unshared_customdata(mesh));
+  EXPECT_NE(mloop_cow, mesh->mloop);
+  mesh->mloop[0].v = 3;
+  mesh->mvert[0].co[0] = 2.0f;
+  EXPECT_EQ(0, mloop_cow[0].v);
+  EXPECT_EQ(0.0f, mvert_cow[0].co[0]);
+
+  /* Assigning new data to a shared layer releases the previous data. */
+  Mesh *mesh_cow_b = NULL;
+  BKE_id_copy_ex(
+      NULL, &mesh_cow->id, (ID **)&mesh_cow_b, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE);
+  EXPECT_EQ(mesh_cow->medge, mesh_cow_b->medge);
+  MEdge *medge = (MEdge *)MEM_dupallocN(mesh_cow_b->medge);
+  CustomData_set_layer(&mesh_cow_b->edata, CD_MEDGE, medge);
+  mesh_cow_b->medge = medge;
+  EXPECT_FALSE(CustomData_is_referenced_layer(&mesh_cow_b->edata, CD_MEDGE));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&mesh_cow->edata, CD_MEDGE));
+
+  BKE_id_free(NULL, mesh);
+  BKE_id_free(NULL, mesh_cow);
+  BKE_id_free(NULL, mesh_cow_b);
+  EXPECT_EQ(mem_in_use, MEM_get_memory_in_use());
+}
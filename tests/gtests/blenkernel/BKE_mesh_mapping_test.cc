@@ -0,0 +1,97 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_meshdata_types.h"
+
+#include "BKE_mesh_mapping.h"
+}
+
+#include <vector>
+
+/* Enough loops for the multi-threaded version. */
+#define TOTPOLY 40000
+#define TOTVERT 5000
+
+/* The users of each vertex are expected in poly order, as the single threaded version
+ * adds them (regardless of the order of the loops). */
+static void mesh_vert_poly_map_test(const bool do_loops)
+{
+  BLI_threadapi_init();
+
+  /* Quads using loops in reverse order of the polys, with some unused loops between them. */
+  const int totloop = TOTPOLY * 5;
+  std::vector<MPoly> mpoly(TOTPOLY);
+  std::vector<MLoop> mloop(totloop);
+  uint seed = 1;
+  for (int i = 0; i < TOTPOLY; i++) {
+    mpoly[i].loopstart = (TOTPOLY - 1 - i) * 5;
+    mpoly[i].totloop = 4;
+    for (int j = 0; j < 4; j++) {
+      seed = seed * 1103515245 + 12345;
+      mloop[mpoly[i].loopstart + j].v = (seed >> 8) % TOTVERT;
+    }
+  }
+
+  std::vector<std::vector<int>> expected(TOTVERT);
+  for (int i = 0; i < TOTPOLY; i++) {
+    for (int j = 0; j < 4; j++) {
+      const int loop = mpoly[i].loopstart + j;
+      expected[mloop[loop].v].push_back(do_loops ? loop : i);
+    }
+  }
+
+  MeshElemMap *map;
+  int *mem;
+  if (do_loops) {
+    BKE_mesh_vert_loop_map_create(
+        &map, &mem, mpoly.data(), mloop.data(), TOTVERT, TOTPOLY, totloop);
+  }
+  else {
+    BKE_mesh_vert_poly_map_create(
+        &map, &mem, mpoly.data(), mloop.data(), TOTVERT, TOTPOLY, totloop);
+  }
+
+  for (int v = 0; v < TOTVERT; v++) {
+    ASSERT_EQ((int)expected[v].size(), map[v].count);
+    for (int i = 0; i < map[v].count; i++) {
+      EXPECT_EQ(expected[v][i], map[v].indices[i]);
+    }
+  }
+
+  MEM_freeN(map);
+  MEM_freeN(mem);
+
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_mapping, VertPolyMapOrder)
+{
+  mesh_vert_poly_map_test(false);
+}
+
+TEST(mesh_mapping, VertLoopMapOrder)
+{
+  mesh_vert_poly_map_test(true);
+}
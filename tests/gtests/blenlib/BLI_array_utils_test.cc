@@ -2,6 +2,8 @@
 
 #include "testing/testing.h"
 
+#include <vector>
+
 extern "C" {
 #include "BLI_array_utils.h"
 #include "BLI_utildefines.h"
@@ -191,3 +193,35 @@ TEST(array_utils, BinaryOrInt4Mix)
   BINARY_OR_TEST(data_cmp, data_a, data_b, data_combine, ARRAY_SIZE(data_cmp));
 }
 #undef BINARY_OR_TEST
+
+/* BLI_array_scan_exclusive_int */
+TEST(array_utils, ScanExclusiveEmpty)
+{
+  EXPECT_EQ(0, BLI_array_scan_exclusive_int(NULL, 0));
+}
+
+TEST(array_utils, ScanExclusiveSmall)
+{
+  int data[] = {3, 0, 2, 5, 1};
+  const int expect[] = {0, 3, 3, 5, 10};
+  EXPECT_EQ(11, BLI_array_scan_exclusive_int(data, ARRAY_SIZE(data)));
+  EXPECT_EQ_ARRAY(expect, data, ARRAY_SIZE(data));
+}
+
+TEST(array_utils, ScanExclusiveLarge)
+{
+  /* Large enough to be split into multiple chunks. */
+  const int len = 100003;
+  std::vector<int> data(len);
+  for (int i = 0; i < len; i++) {
+    data[i] = i % 7;
+  }
+  const std::vector<int> counts = data;
+  const int total = BLI_array_scan_exclusive_int(data.data(), len);
+  int sum = 0;
+  for (int i = 0; i < len; i++) {
+    EXPECT_EQ(sum, data[i]);
+    sum += counts[i];
+  }
+  EXPECT_EQ(sum, total);
+}
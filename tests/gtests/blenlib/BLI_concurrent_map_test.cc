@@ -0,0 +1,140 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_concurrent_map.hh"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_ghash_concurrent.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+}
+
+using BLI::ConcurrentMap;
+using IntIntMap = ConcurrentMap<int, int>;
+
+#define ITEMS_NUM 100000
+
+TEST(concurrent_map, AddContains)
+{
+  IntIntMap map;
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_TRUE(map.add(1, 10));
+  EXPECT_TRUE(map.add(2, 20));
+  EXPECT_FALSE(map.add(1, 30));
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_TRUE(map.contains(1));
+  EXPECT_FALSE(map.contains(3));
+  EXPECT_EQ(map.lookup_default(1, -1), 10);
+  EXPECT_EQ(map.lookup_default(3, -1), -1);
+}
+
+TEST(concurrent_map, AddOverrideRemove)
+{
+  IntIntMap map;
+  map.add(1, 10);
+  EXPECT_FALSE(map.add_override(1, 30));
+  EXPECT_EQ(map.lookup_default(1, -1), 30);
+  EXPECT_TRUE(map.remove(1));
+  EXPECT_FALSE(map.remove(1));
+  EXPECT_TRUE(map.is_empty());
+}
+
+TEST(concurrent_map, LookupOrAdd)
+{
+  IntIntMap map;
+  const int value_a = map.lookup_or_add(5, []() { return 50; });
+  const int value_b = map.lookup_or_add(5, []() { return 60; });
+  EXPECT_EQ(value_a, 50);
+  EXPECT_EQ(value_b, 50);
+  EXPECT_EQ(map.size(), 1);
+}
+
+TEST(concurrent_map, ForeachItem)
+{
+  IntIntMap map;
+  for (int i = 0; i < 1000; i++) {
+    map.add(i, i * 2);
+  }
+  int sum_keys = 0, sum_values = 0;
+  map.foreach_item([&](int key, int value) {
+    sum_keys += key;
+    sum_values += value;
+  });
+  EXPECT_EQ(sum_keys, 999 * 1000 / 2);
+  EXPECT_EQ(sum_values, 999 * 1000);
+}
+
+static void concurrent_map_add_func(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  IntIntMap *map = (IntIntMap *)userdata;
+  /* Every key is added twice, with a counter to check only one add succeeds. */
+  const int key = index / 2;
+  map->add_or_modify(
+      key, [&](int *value) { *value = 1; }, [&](int *value) { (*value)++; });
+  EXPECT_TRUE(map->contains(key));
+}
+
+TEST(concurrent_map, AddConcurrent)
+{
+  IntIntMap map;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, ITEMS_NUM * 2, &map, concurrent_map_add_func, &settings);
+
+  EXPECT_EQ(map.size(), ITEMS_NUM);
+  for (int i = 0; i < ITEMS_NUM; i++) {
+    EXPECT_EQ(map.lookup_default(i, 0), 2);
+  }
+}
+
+/* C API. */
+
+static void concurrent_ghash_add_func(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentGHash *cgh = (ConcurrentGHash *)userdata;
+  const int key = index / 2;
+  void *val;
+  BLI_ghash_concurrent_ensure(cgh, POINTER_FROM_INT(key), POINTER_FROM_INT(index), &val);
+  /* Either this value or the one of the other index with the same key. */
+  EXPECT_EQ(POINTER_AS_INT(val) / 2, key);
+}
+
+static void concurrent_ghash_foreach_func(void *key, void *val, void *userdata)
+{
+  EXPECT_EQ(POINTER_AS_INT(val) / 2, POINTER_AS_INT(key));
+  (*(int *)userdata)++;
+}
+
+TEST(concurrent_ghash, AddConcurrent)
+{
+  ConcurrentGHash *cgh = BLI_ghash_concurrent_new(
+      BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(1, ITEMS_NUM * 2, cgh, concurrent_ghash_add_func, &settings);
+
+  EXPECT_EQ(BLI_ghash_concurrent_len(cgh), ITEMS_NUM);
+  EXPECT_TRUE(BLI_ghash_concurrent_haskey(cgh, POINTER_FROM_INT(ITEMS_NUM - 1)));
+  EXPECT_FALSE(BLI_ghash_concurrent_haskey(cgh, POINTER_FROM_INT(ITEMS_NUM)));
+  EXPECT_EQ(BLI_ghash_concurrent_lookup(cgh, POINTER_FROM_INT(ITEMS_NUM)), nullptr);
+  EXPECT_FALSE(BLI_ghash_concurrent_add(cgh, POINTER_FROM_INT(1), POINTER_FROM_INT(0)));
+
+  int items_num = 0;
+  BLI_ghash_concurrent_foreach(cgh, concurrent_ghash_foreach_func, &items_num);
+  EXPECT_EQ(items_num, ITEMS_NUM);
+
+  EXPECT_TRUE(BLI_ghash_concurrent_remove(cgh, POINTER_FROM_INT(1), NULL, NULL));
+  EXPECT_FALSE(BLI_ghash_concurrent_remove(cgh, POINTER_FROM_INT(1), NULL, NULL));
+  EXPECT_EQ(BLI_ghash_concurrent_len(cgh), ITEMS_NUM - 1);
+
+  BLI_ghash_concurrent_free(cgh, NULL, NULL);
+}
@@ -3,14 +3,19 @@
 #include "BLI_ressource_strings.h"
 #include "testing/testing.h"
 
+#include "BLI_concurrent_map.hh"
+
 #define GHASH_INTERNAL_API
 
 #include "MEM_guardedalloc.h"
 
 extern "C" {
 #include "BLI_ghash.h"
+#include "BLI_ghash_concurrent.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 #include "PIL_time_utildefines.h"
 }
@@ -661,3 +666,137 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
   multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+/* Concurrent: uniform integers inserted & looked up from multiple threads,
+ * comparing a #GHash behind a global lock with sharded maps. */
+
+struct ConcurrentTestData {
+  GHash *ghash;
+  SpinLock *ghash_lock;
+  ConcurrentGHash *cghash;
+  BLI::ConcurrentMap<uint, uint> *map;
+};
+
+static void concurrent_ghash_locked_insert_func(void *__restrict userdata,
+                                                const int index,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentTestData *data = (ConcurrentTestData *)userdata;
+  BLI_spin_lock(data->ghash_lock);
+  BLI_ghash_insert(data->ghash, POINTER_FROM_INT(index), POINTER_FROM_INT(index));
+  BLI_spin_unlock(data->ghash_lock);
+}
+
+static void concurrent_ghash_locked_lookup_func(void *__restrict userdata,
+                                                const int index,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentTestData *data = (ConcurrentTestData *)userdata;
+  BLI_spin_lock(data->ghash_lock);
+  void *v = BLI_ghash_lookup(data->ghash, POINTER_FROM_INT(index));
+  BLI_spin_unlock(data->ghash_lock);
+  EXPECT_EQ(POINTER_AS_INT(v), index);
+}
+
+static void concurrent_ghash_insert_func(void *__restrict userdata,
+                                         const int index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentTestData *data = (ConcurrentTestData *)userdata;
+  BLI_ghash_concurrent_add(data->cghash, POINTER_FROM_INT(index), POINTER_FROM_INT(index));
+}
+
+static void concurrent_ghash_lookup_func(void *__restrict userdata,
+                                         const int index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentTestData *data = (ConcurrentTestData *)userdata;
+  void *v = BLI_ghash_concurrent_lookup(data->cghash, POINTER_FROM_INT(index));
+  EXPECT_EQ(POINTER_AS_INT(v), index);
+}
+
+static void concurrent_map_insert_func(void *__restrict userdata,
+                                       const int index,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentTestData *data = (ConcurrentTestData *)userdata;
+  data->map->add((uint)index, (uint)index);
+}
+
+static void concurrent_map_lookup_func(void *__restrict userdata,
+                                       const int index,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentTestData *data = (ConcurrentTestData *)userdata;
+  EXPECT_EQ(data->map->lookup_default((uint)index, 0), (uint)index);
+}
+
+static void concurrent_tests_run(const char *id,
+                                 ConcurrentTestData *data,
+                                 const int nbr,
+                                 TaskParallelRangeFunc insert_func,
+                                 TaskParallelRangeFunc lookup_func)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+
+  {
+    TIMEIT_START(concurrent_insert);
+    BLI_task_parallel_range(0, nbr, data, insert_func, &settings);
+    TIMEIT_END(concurrent_insert);
+  }
+
+  {
+    TIMEIT_START(concurrent_lookup);
+    BLI_task_parallel_range(0, nbr, data, lookup_func, &settings);
+    TIMEIT_END(concurrent_lookup);
+  }
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+static void concurrent_tests(const int nbr)
+{
+  char id[64];
+  ConcurrentTestData data = {NULL};
+
+  data.ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+  data.ghash_lock = (SpinLock *)MEM_mallocN(sizeof(*data.ghash_lock), __func__);
+  BLI_spin_init(data.ghash_lock);
+  BLI_snprintf(id, sizeof(id), "Concurrent IntGHash - GHash with lock - %d", nbr);
+  concurrent_tests_run(id,
+                       &data,
+                       nbr,
+                       concurrent_ghash_locked_insert_func,
+                       concurrent_ghash_locked_lookup_func);
+  EXPECT_EQ(BLI_ghash_len(data.ghash), nbr);
+  BLI_spin_end(data.ghash_lock);
+  MEM_freeN((void *)data.ghash_lock);
+  BLI_ghash_free(data.ghash, NULL, NULL);
+
+  data.cghash = BLI_ghash_concurrent_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+  BLI_snprintf(id, sizeof(id), "Concurrent IntGHash - ConcurrentGHash - %d", nbr);
+  concurrent_tests_run(id, &data, nbr, concurrent_ghash_insert_func, concurrent_ghash_lookup_func);
+  EXPECT_EQ(BLI_ghash_concurrent_len(data.cghash), nbr);
+  BLI_ghash_concurrent_free(data.cghash, NULL, NULL);
+
+  data.map = new BLI::ConcurrentMap<uint, uint>();
+  BLI_snprintf(id, sizeof(id), "Concurrent IntGHash - ConcurrentMap - %d", nbr);
+  concurrent_tests_run(id, &data, nbr, concurrent_map_insert_func, concurrent_map_lookup_func);
+  EXPECT_EQ(data.map->size(), nbr);
+  delete data.map;
+}
+
+TEST(ghash, ConcurrentInt100000)
+{
+  concurrent_tests(100000);
+}
+
+#ifdef GHASH_RUN_BIG
+TEST(ghash, ConcurrentInt10000000)
+{
+  concurrent_tests(10000000);
+}
+#endif
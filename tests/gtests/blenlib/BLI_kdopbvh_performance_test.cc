@@ -0,0 +1,97 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_kdopbvh.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "stubs/bf_intern_eigen_stubs.h"
+
+#define NUM_RUN_AVERAGED 5
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/**
+ * Insert small random triangles, similar to the BVH of a dense mesh.
+ */
+static BVHTree *bvhtree_random_tris_new(RNG *rng, const int tris_len, const int tree_type)
+{
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0f, (char)tree_type, 6);
+  for (int i = 0; i < tris_len; i++) {
+    float co[3][3];
+    BLI_rng_get_float_unit_v3(rng, co[0]);
+    for (int j = 1; j < 3; j++) {
+      BLI_rng_get_float_unit_v3(rng, co[j]);
+      madd_v3_v3fl(co[j], co[0], 1000.0f);
+      mul_v3_fl(co[j], 1.0f / 1000.0f);
+    }
+    BLI_bvhtree_insert(tree, i, co[0], 3);
+  }
+  return tree;
+}
+
+static void bvhtree_balance_test(const int tris_len, const int tree_type)
+{
+  RNG *rng = BLI_rng_new(tris_len);
+
+  printf("\n========== STARTING %s (%d triangles, tree type %d) ==========\n",
+         __func__,
+         tris_len,
+         tree_type);
+
+  /* Only time the balancing, not the insertion of the triangles. */
+  TIMEIT_BLOCK_INIT(bvhtree_balance);
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    BVHTree *tree = bvhtree_random_tris_new(rng, tris_len, tree_type);
+
+    TIMEIT_BLOCK_START(bvhtree_balance);
+    BLI_bvhtree_balance(tree);
+    TIMEIT_BLOCK_END(bvhtree_balance);
+
+    EXPECT_EQ(tris_len, BLI_bvhtree_get_len(tree));
+    BLI_bvhtree_free(tree);
+  }
+  TIMEIT_BLOCK_STATS(bvhtree_balance);
+  printf("average (%d runs): %f\n",
+         NUM_RUN_AVERAGED,
+         _timeit_var_bvhtree_balance / NUM_RUN_AVERAGED);
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+
+  BLI_rng_free(rng);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(kdopbvh, BalanceTris_100000)
+{
+  BLI_threadapi_init();
+  bvhtree_balance_test(100000, 2);
+  BLI_threadapi_exit();
+}
+
+TEST(kdopbvh, BalanceTris_1000000)
+{
+  BLI_threadapi_init();
+  bvhtree_balance_test(1000000, 2);
+  bvhtree_balance_test(1000000, 4);
+  BLI_threadapi_exit();
+}
+
+TEST(kdopbvh, BalanceTris_4000000)
+{
+  BLI_threadapi_init();
+  bvhtree_balance_test(4000000, 4);
+  BLI_threadapi_exit();
+}
@@ -123,6 +123,11 @@ TEST(kdopbvh, FindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12);
 }
+/* Large enough for the top levels of the tree to be built threaded. */
+TEST(kdopbvh, FindNearest_50000)
+{
+  find_nearest_points_test(50000, 1.0, 100000, 123);
+}
 
 TEST(kdopbvh, OptimalFindNearest_1)
 {
@@ -136,3 +141,133 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+static void find_nearest_batch_test(int points_len, float scale, int round, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 8);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * points_len,
+                                                         __func__);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, round, scale);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(co[i], 3, rng, round, scale);
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+  }
+
+  BLI_bvhtree_find_nearest_batch(tree, co, points_len, nearest, NULL, NULL, 0);
+
+  for (int i = 0; i < points_len; i++) {
+    BVHTreeNearest nearest_single;
+    nearest_single.index = -1;
+    nearest_single.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, co[i], &nearest_single, NULL, NULL);
+
+    EXPECT_EQ(nearest_single.index, nearest[i].index);
+    EXPECT_FLOAT_EQ(nearest_single.dist_sq, nearest[i].dist_sq);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(nearest);
+}
+
+TEST(kdopbvh, FindNearestBatch_1)
+{
+  find_nearest_batch_test(1, 1.0, 1000, 1234);
+}
+TEST(kdopbvh, FindNearestBatch_5000)
+{
+  find_nearest_batch_test(5000, 1.0, 1000, 12);
+}
+
+/**
+ * Cast rays along the Z axis (with some jitter in the direction) from below the points,
+ * comparing batched results with single ray casts.
+ *
+ * \param axis_aligned: Cast exactly along the Z axis, starting below the points
+ * (so the ray origins are on the bounds of the nodes).
+ */
+static void ray_cast_batch_test(
+    int points_len, int rays_len, float radius, bool axis_aligned, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 8);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  float(*dir)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * rays_len, __func__);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  for (int i = 0; i < rays_len; i++) {
+    if (axis_aligned) {
+      copy_v2_v2(co[i], points[i % points_len]);
+      zero_v2(dir[i]);
+    }
+    else {
+      rng_v3_round(co[i], 2, rng, 1000, 1.0f);
+      rng_v3_round(dir[i], 2, rng, 1000, 0.1f);
+    }
+    co[i][2] = -2.0f;
+    dir[i][2] = 1.0f;
+    normalize_v3(dir[i]);
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+
+  BLI_bvhtree_ray_cast_batch(tree, co, dir, rays_len, radius, hits, NULL, NULL, 0);
+
+  int hits_num = 0;
+  for (int i = 0; i < rays_len; i++) {
+    BVHTreeRayHit hit_single;
+    hit_single.index = -1;
+    hit_single.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast_ex(tree, co[i], dir[i], radius, &hit_single, NULL, NULL, 0);
+
+    EXPECT_EQ(hit_single.index == -1, hits[i].index == -1);
+    if (hit_single.index != -1) {
+      EXPECT_NEAR(hit_single.dist, hits[i].dist, 1e-5f);
+      hits_num++;
+    }
+  }
+  /* Ensure the test isn't trivially passing. */
+  EXPECT_GT(hits_num, 0);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(dir);
+  MEM_freeN(hits);
+}
+
+TEST(kdopbvh, RayCastBatch_1)
+{
+  ray_cast_batch_test(1, 1, 2.0f, false, 1234);
+}
+TEST(kdopbvh, RayCastBatch_5000)
+{
+  ray_cast_batch_test(5000, 5003, 0.05f, false, 12);
+}
+TEST(kdopbvh, RayCastBatchAxisAligned_5000)
+{
+  ray_cast_batch_test(5000, 5003, 0.0f, true, 12);
+  ray_cast_batch_test(5000, 5003, 0.05f, true, 12);
+}
@@ -0,0 +1,111 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_kdtree.h"
+#include "BLI_math_base.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 5
+
+typedef enum eKDTreeTestMethod {
+  KDTREE_TEST_BALANCE,
+  KDTREE_TEST_FIND_NEAREST,
+  KDTREE_TEST_FIND_NEAREST_BATCH,
+  KDTREE_TEST_CALC_DUPLICATES,
+} eKDTreeTestMethod;
+
+/* Points on a grid with about one in four being a duplicate, as for merge by distance. */
+static void kdtree_test(const char *id, const eKDTreeTestMethod method, const int len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  RNG *rng = BLI_rng_new(len);
+  float(*points)[3] = (float(*)[3])MEM_malloc_arrayN(len, sizeof(*points), __func__);
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_malloc_arrayN(
+      len, sizeof(*nearest), __func__);
+  int *duplicates = (int *)MEM_malloc_arrayN(len, sizeof(*duplicates), __func__);
+  const int steps = (int)(cbrtf((float)len) * 1.5f);
+
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    KDTree_3d *tree = BLI_kdtree_3d_new((uint)len);
+    for (int i = 0; i < len; i++) {
+      for (int j = 0; j < 3; j++) {
+        points[i][j] = (float)(BLI_rng_get_int(rng) % steps);
+      }
+      BLI_kdtree_3d_insert(tree, i, points[i]);
+      duplicates[i] = -1;
+    }
+
+    double init_time = PIL_check_seconds_timer();
+    BLI_kdtree_3d_balance(tree);
+    if (method != KDTREE_TEST_BALANCE) {
+      init_time = PIL_check_seconds_timer();
+    }
+    switch (method) {
+      case KDTREE_TEST_BALANCE:
+        break;
+      case KDTREE_TEST_FIND_NEAREST:
+        for (int i = 0; i < len; i++) {
+          BLI_kdtree_3d_find_nearest(tree, points[i], &nearest[i]);
+        }
+        break;
+      case KDTREE_TEST_FIND_NEAREST_BATCH:
+        BLI_kdtree_3d_find_nearest_batch(tree, points, len, nearest);
+        break;
+      case KDTREE_TEST_CALC_DUPLICATES:
+        BLI_kdtree_3d_calc_duplicates_fast(tree, 0.5f, true, duplicates);
+        break;
+    }
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+    BLI_kdtree_3d_free(tree);
+  }
+
+  printf("\t%d threads: done in %fs on average over %d runs\n",
+         BLI_task_scheduler_num_threads(),
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_freeN(points);
+  MEM_freeN(nearest);
+  MEM_freeN(duplicates);
+  BLI_rng_free(rng);
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdtree, Balance1M)
+{
+  kdtree_test("Balance - 1M points", KDTREE_TEST_BALANCE, 1000000);
+}
+
+TEST(kdtree, FindNearest100K)
+{
+  kdtree_test("Find Nearest - 100K points", KDTREE_TEST_FIND_NEAREST, 100000);
+}
+
+TEST(kdtree, FindNearestBatch100K)
+{
+  kdtree_test("Find Nearest Batch - 100K points", KDTREE_TEST_FIND_NEAREST_BATCH, 100000);
+}
+
+TEST(kdtree, CalcDuplicatesFast1M)
+{
+  kdtree_test("Calc Duplicates Fast - 1M points", KDTREE_TEST_CALC_DUPLICATES, 1000000);
+}
@@ -0,0 +1,230 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+}
+
+/* Large enough for the balancing & duplicate search to run in parallel. */
+#define POINTS_LEN 40000
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/**
+ * Random points on a coarse grid, so many of them are duplicates.
+ */
+static float (*points_grid_random_new(const int points_len, const int steps))[3]
+{
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(*points) * points_len, __func__);
+  RNG *rng = BLI_rng_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    for (int j = 0; j < 3; j++) {
+      points[i][j] = (float)(BLI_rng_get_int(rng) % steps);
+    }
+  }
+  BLI_rng_free(rng);
+  return points;
+}
+
+static KDTree_3d *kdtree_from_points(const float (*points)[3], const int points_len)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new((uint)points_len);
+  for (int i = 0; i < points_len; i++) {
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(kdtree, Empty)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(0);
+  BLI_kdtree_3d_balance(tree);
+
+  const float co[1][3] = {{0.0f, 0.0f, 0.0f}};
+  KDTreeNearest_3d nearest;
+  BLI_kdtree_3d_find_nearest_batch(tree, co, 1, &nearest);
+  EXPECT_EQ(-1, nearest.index);
+
+  BLI_kdtree_3d_free(tree);
+}
+
+TEST(kdtree, BalanceFindNearest)
+{
+  float(*points)[3] = points_grid_random_new(POINTS_LEN, 1000);
+  KDTree_3d *tree = kdtree_from_points(points, POINTS_LEN);
+
+  /* Every point must be found at its own position. */
+  for (int i = 0; i < POINTS_LEN; i++) {
+    KDTreeNearest_3d nearest;
+    ASSERT_NE(-1, BLI_kdtree_3d_find_nearest(tree, points[i], &nearest));
+    EXPECT_EQ(0.0f, nearest.dist);
+    EXPECT_V3_NEAR(points[i], points[nearest.index], 0.0f);
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+}
+
+TEST(kdtree, FindNearestBatch)
+{
+  float(*points)[3] = points_grid_random_new(POINTS_LEN, 100);
+  KDTree_3d *tree = kdtree_from_points(points, POINTS_LEN);
+
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(sizeof(*nearest) * POINTS_LEN,
+                                                               __func__);
+  BLI_kdtree_3d_find_nearest_batch(tree, points, POINTS_LEN, nearest);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    KDTreeNearest_3d nearest_single;
+    EXPECT_EQ(BLI_kdtree_3d_find_nearest(tree, points[i], &nearest_single), nearest[i].index);
+    EXPECT_EQ(nearest_single.dist, nearest[i].dist);
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest);
+  MEM_freeN(points);
+}
+
+TEST(kdtree, FindNearestNBatch)
+{
+  const uint nearest_len_capacity = 8;
+  float(*points)[3] = points_grid_random_new(POINTS_LEN, 100);
+  KDTree_3d *tree = kdtree_from_points(points, POINTS_LEN);
+
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest) * POINTS_LEN * nearest_len_capacity, __func__);
+  int *nearest_len = (int *)MEM_mallocN(sizeof(*nearest_len) * POINTS_LEN, __func__);
+  BLI_kdtree_3d_find_nearest_n_batch(
+      tree, points, POINTS_LEN, nearest, nearest_len_capacity, nearest_len);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    KDTreeNearest_3d nearest_single[nearest_len_capacity];
+    const int len = BLI_kdtree_3d_find_nearest_n(
+        tree, points[i], nearest_single, nearest_len_capacity);
+    ASSERT_EQ(len, nearest_len[i]);
+    for (int j = 0; j < len; j++) {
+      EXPECT_EQ(nearest_single[j].dist, nearest[i * nearest_len_capacity + j].dist);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest_len);
+  MEM_freeN(nearest);
+  MEM_freeN(points);
+}
+
+TEST(kdtree, RangeSearchBatch)
+{
+  const float range = 2.0f;
+  float(*points)[3] = points_grid_random_new(POINTS_LEN, 100);
+  KDTree_3d *tree = kdtree_from_points(points, POINTS_LEN);
+
+  KDTreeNearest_3d **nearest = (KDTreeNearest_3d **)MEM_mallocN(sizeof(*nearest) * POINTS_LEN,
+                                                                __func__);
+  int *nearest_len = (int *)MEM_mallocN(sizeof(*nearest_len) * POINTS_LEN, __func__);
+  BLI_kdtree_3d_range_search_batch(tree, points, POINTS_LEN, range, nearest, nearest_len);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    KDTreeNearest_3d *nearest_single = NULL;
+    const int len = BLI_kdtree_3d_range_search(tree, points[i], &nearest_single, range);
+    ASSERT_EQ(len, nearest_len[i]);
+    for (int j = 0; j < len; j++) {
+      EXPECT_EQ(nearest_single[j].dist, nearest[i][j].dist);
+    }
+    if (nearest_single) {
+      MEM_freeN(nearest_single);
+    }
+    if (nearest[i]) {
+      MEM_freeN(nearest[i]);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest_len);
+  MEM_freeN(nearest);
+  MEM_freeN(points);
+}
+
+/**
+ * Compare with duplicates calculated from range searches, in index order.
+ * The coarse grid results in clusters of more duplicates than are stored per search.
+ */
+static void calc_duplicates_fast_test(const int steps)
+{
+  const float range = 0.5f;
+  float(*points)[3] = points_grid_random_new(POINTS_LEN, steps);
+  KDTree_3d *tree = kdtree_from_points(points, POINTS_LEN);
+
+  int *duplicates = (int *)MEM_mallocN(sizeof(*duplicates) * POINTS_LEN, __func__);
+  int *duplicates_expect = (int *)MEM_mallocN(sizeof(*duplicates) * POINTS_LEN, __func__);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    /* Some points are only used as targets. */
+    duplicates[i] = duplicates_expect[i] = (i % 7 == 0) ? i : -1;
+  }
+
+  int found_expect = 0;
+  for (int i = 0; i < POINTS_LEN; i++) {
+    if (!ELEM(duplicates_expect[i], -1, i)) {
+      continue;
+    }
+    KDTreeNearest_3d *nearest = NULL;
+    const int nearest_len = BLI_kdtree_3d_range_search(tree, points[i], &nearest, range);
+    bool found = false;
+    for (int j = 0; j < nearest_len; j++) {
+      const int index = nearest[j].index;
+      if (index != i && duplicates_expect[index] == -1) {
+        duplicates_expect[index] = i;
+        found_expect++;
+        found = true;
+      }
+    }
+    if (found) {
+      duplicates_expect[i] = i;
+    }
+    if (nearest) {
+      MEM_freeN(nearest);
+    }
+  }
+
+  const int found = BLI_kdtree_3d_calc_duplicates_fast(tree, range, true, duplicates);
+  EXPECT_EQ(found_expect, found);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    EXPECT_EQ(duplicates_expect[i], duplicates[i]);
+  }
+
+  /* Using the tree order, the duplicates differ but must still be valid. */
+  for (int i = 0; i < POINTS_LEN; i++) {
+    duplicates[i] = -1;
+  }
+  BLI_kdtree_3d_calc_duplicates_fast(tree, range, false, duplicates);
+  for (int i = 0; i < POINTS_LEN; i++) {
+    const int target = duplicates[i];
+    if (target != -1 && target != i) {
+      EXPECT_EQ(target, duplicates[target]);
+      EXPECT_V3_NEAR(points[i], points[target], 0.0f);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(duplicates_expect);
+  MEM_freeN(duplicates);
+  MEM_freeN(points);
+}
+
+TEST(kdtree, CalcDuplicatesFast)
+{
+  calc_duplicates_fast_test(100);
+}
+
+TEST(kdtree, CalcDuplicatesFastClusters)
+{
+  calc_duplicates_fast_test(10);
+}
@@ -0,0 +1,145 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 20
+
+enum eBulkKernel {
+  BULK_MUL_V3_M4V3,
+  BULK_NORMALIZE_V3,
+  BULK_INTERP_V3,
+  BULK_MINMAX_V3,
+};
+
+static const char *bulk_kernel_names[] = {
+    "mul_v3_m4v3_array",
+    "normalize_v3_array",
+    "interp_v3_v3v3_array",
+    "minmax_v3v3_v3_array",
+};
+
+static void bulk_kernel_run(const eBulkKernel kernel,
+                            float (*r)[3],
+                            const float (*a)[3],
+                            const float (*b)[3],
+                            const int len)
+{
+  float mat[4][4];
+  float min[3], max[3];
+  switch (kernel) {
+    case BULK_MUL_V3_M4V3:
+      scale_m4_fl(mat, 2.0f);
+      copy_v3_fl(mat[3], 1.0f);
+      mul_v3_m4v3_array(r, mat, a, len);
+      break;
+    case BULK_NORMALIZE_V3:
+      memcpy(r, a, sizeof(*r) * (size_t)len);
+      normalize_v3_array(r, len);
+      break;
+    case BULK_INTERP_V3:
+      interp_v3_v3v3_array(r, a, b, 0.5f, len);
+      break;
+    case BULK_MINMAX_V3:
+      INIT_MINMAX(min, max);
+      minmax_v3v3_v3_array(min, max, a, len);
+      copy_v3_v3(r[0], min);
+      break;
+  }
+}
+
+/* Time a kernel with each instruction set supported by the CPU. */
+static void bulk_kernel_test(const eBulkKernel kernel, const int len)
+{
+  printf("\n========== STARTING %s (%s, %d vectors) ==========\n",
+         __func__,
+         bulk_kernel_names[kernel],
+         len);
+
+  RNG *rng = BLI_rng_new(len);
+  float(*a)[3] = (float(*)[3])MEM_mallocN(sizeof(*a) * (size_t)len, __func__);
+  float(*b)[3] = (float(*)[3])MEM_mallocN(sizeof(*b) * (size_t)len, __func__);
+  float(*r)[3] = (float(*)[3])MEM_mallocN(sizeof(*r) * (size_t)len, __func__);
+  for (int i = 0; i < len; i++) {
+    BLI_rng_get_float_unit_v3(rng, a[i]);
+    BLI_rng_get_float_unit_v3(rng, b[i]);
+  }
+
+  const eMathBulkISA isa_orig = BLI_math_bulk_isa_get();
+  double time_scalar = 0.0;
+  for (int isa = MATH_BULK_ISA_SCALAR; isa <= (int)isa_orig; isa++) {
+    BLI_math_bulk_isa_set((eMathBulkISA)isa);
+    /* Warm up caches. */
+    bulk_kernel_run(kernel, r, a, b, len);
+
+    const double time_start = PIL_check_seconds_timer();
+    for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+      bulk_kernel_run(kernel, r, a, b, len);
+    }
+    const double time = (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED;
+    if (isa == MATH_BULK_ISA_SCALAR) {
+      time_scalar = time;
+    }
+    printf("%s: %.3fms (%.2fx)\n",
+           BLI_math_bulk_isa_name((eMathBulkISA)isa),
+           time * 1000.0,
+           time_scalar / time);
+  }
+  BLI_math_bulk_isa_set(isa_orig);
+
+  MEM_freeN(a);
+  MEM_freeN(b);
+  MEM_freeN(r);
+  BLI_rng_free(rng);
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(math_bulk, MulV3M4V3_10k)
+{
+  bulk_kernel_test(BULK_MUL_V3_M4V3, 10000);
+}
+
+TEST(math_bulk, MulV3M4V3_1M)
+{
+  bulk_kernel_test(BULK_MUL_V3_M4V3, 1000000);
+}
+
+TEST(math_bulk, NormalizeV3_10k)
+{
+  bulk_kernel_test(BULK_NORMALIZE_V3, 10000);
+}
+
+TEST(math_bulk, NormalizeV3_1M)
+{
+  bulk_kernel_test(BULK_NORMALIZE_V3, 1000000);
+}
+
+TEST(math_bulk, InterpV3_10k)
+{
+  bulk_kernel_test(BULK_INTERP_V3, 10000);
+}
+
+TEST(math_bulk, InterpV3_1M)
+{
+  bulk_kernel_test(BULK_INTERP_V3, 1000000);
+}
+
+TEST(math_bulk, MinMaxV3_10k)
+{
+  bulk_kernel_test(BULK_MINMAX_V3, 10000);
+}
+
+TEST(math_bulk, MinMaxV3_1M)
+{
+  bulk_kernel_test(BULK_MINMAX_V3, 1000000);
+}
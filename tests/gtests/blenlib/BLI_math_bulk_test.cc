@@ -0,0 +1,154 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+}
+
+/* Lengths not multiple of the SIMD width, to test the remainders as well. */
+static const int bulk_test_lens[] = {0, 1, 2, 3, 7, 8, 9, 17, 1001};
+
+static float (*bulk_random_v3_array(RNG *rng, const int len))[3]
+{
+  float(*vecs)[3] = (float(*)[3])MEM_mallocN(sizeof(*vecs) * max_ii(len, 1), __func__);
+  for (int i = 0; i < len; i++) {
+    BLI_rng_get_float_unit_v3(rng, vecs[i]);
+    mul_v3_fl(vecs[i], 10.0f * BLI_rng_get_float(rng));
+  }
+  return vecs;
+}
+
+/* Run the test for every instruction set supported by the CPU. */
+class MathBulkTest : public testing::Test {
+ protected:
+  eMathBulkISA isa_orig;
+
+  void SetUp() override
+  {
+    isa_orig = BLI_math_bulk_isa_get();
+  }
+
+  void TearDown() override
+  {
+    BLI_math_bulk_isa_set(isa_orig);
+  }
+
+  template<typename Fn> void foreach_isa(Fn fn)
+  {
+    for (int isa = MATH_BULK_ISA_SCALAR; isa <= (int)isa_orig; isa++) {
+      BLI_math_bulk_isa_set((eMathBulkISA)isa);
+      SCOPED_TRACE(BLI_math_bulk_isa_name((eMathBulkISA)isa));
+      for (const int len : bulk_test_lens) {
+        SCOPED_TRACE(len);
+        fn(len);
+      }
+    }
+  }
+};
+
+TEST_F(MathBulkTest, MulV3M4V3)
+{
+  RNG *rng = BLI_rng_new(1);
+  const float loc[3] = {1.0f, -2.0f, 3.0f}, eul[3] = {0.3f, 0.5f, -0.7f};
+  const float size[3] = {2.0f, 1.0f, 0.5f};
+  float mat[4][4];
+  loc_eul_size_to_mat4(mat, loc, eul, size);
+  foreach_isa([&](const int len) {
+    float(*vecs)[3] = bulk_random_v3_array(rng, len);
+    float(*result)[3] = bulk_random_v3_array(rng, len);
+    mul_v3_m4v3_array(result, mat, vecs, len);
+    for (int i = 0; i < len; i++) {
+      float expect[3];
+      mul_v3_m4v3(expect, mat, vecs[i]);
+      EXPECT_V3_NEAR(expect, result[i], 1e-5f);
+    }
+    /* In place. */
+    mul_v3_m4v3_array(vecs, mat, vecs, len);
+    for (int i = 0; i < len; i++) {
+      EXPECT_V3_NEAR(result[i], vecs[i], 1e-5f);
+    }
+    MEM_freeN(vecs);
+    MEM_freeN(result);
+  });
+  BLI_rng_free(rng);
+}
+
+TEST_F(MathBulkTest, NormalizeV3)
+{
+  RNG *rng = BLI_rng_new(2);
+  foreach_isa([&](const int len) {
+    float(*vecs)[3] = bulk_random_v3_array(rng, len);
+    if (len > 2) {
+      zero_v3(vecs[len / 2]);
+      copy_v3_fl(vecs[len - 1], 1e-20f);
+    }
+    float(*expect)[3] = (float(*)[3])MEM_dupallocN(vecs);
+    for (int i = 0; i < len; i++) {
+      normalize_v3(expect[i]);
+    }
+    normalize_v3_array(vecs, len);
+    for (int i = 0; i < len; i++) {
+      EXPECT_V3_NEAR(expect[i], vecs[i], 1e-6f);
+    }
+    MEM_freeN(vecs);
+    MEM_freeN(expect);
+  });
+  BLI_rng_free(rng);
+}
+
+TEST_F(MathBulkTest, InterpV3V3V3)
+{
+  RNG *rng = BLI_rng_new(3);
+  foreach_isa([&](const int len) {
+    float(*a)[3] = bulk_random_v3_array(rng, len);
+    float(*b)[3] = bulk_random_v3_array(rng, len);
+    float(*result)[3] = bulk_random_v3_array(rng, len);
+    interp_v3_v3v3_array(result, a, b, 0.3f, len);
+    for (int i = 0; i < len; i++) {
+      float expect[3];
+      interp_v3_v3v3(expect, a[i], b[i], 0.3f);
+      EXPECT_V3_NEAR(expect, result[i], 1e-6f);
+    }
+    MEM_freeN(a);
+    MEM_freeN(b);
+    MEM_freeN(result);
+  });
+  BLI_rng_free(rng);
+}
+
+TEST_F(MathBulkTest, MinMaxV3)
+{
+  RNG *rng = BLI_rng_new(4);
+  foreach_isa([&](const int len) {
+    float(*vecs)[3] = bulk_random_v3_array(rng, len);
+    float expect_min[3], expect_max[3], min[3], max[3];
+    INIT_MINMAX(expect_min, expect_max);
+    for (int i = 0; i < len; i++) {
+      minmax_v3v3_v3(expect_min, expect_max, vecs[i]);
+    }
+    INIT_MINMAX(min, max);
+    minmax_v3v3_v3_array(min, max, vecs, len);
+    EXPECT_EQ_ARRAY(expect_min, min, 3);
+    EXPECT_EQ_ARRAY(expect_max, max, 3);
+
+    /* Existing bounds are extended, not replaced. */
+    const float min_init[3] = {-100.0f, 0.0f, 0.0f}, max_init[3] = {0.0f, 100.0f, 0.0f};
+    copy_v3_v3(min, min_init);
+    copy_v3_v3(max, max_init);
+    minmax_v3v3_v3_array(min, max, vecs, len);
+    copy_v3_v3(expect_min, min_init);
+    copy_v3_v3(expect_max, max_init);
+    for (int i = 0; i < len; i++) {
+      minmax_v3v3_v3(expect_min, expect_max, vecs[i]);
+    }
+    EXPECT_EQ_ARRAY(expect_min, min, 3);
+    EXPECT_EQ_ARRAY(expect_max, max, 3);
+    MEM_freeN(vecs);
+  });
+  BLI_rng_free(rng);
+}
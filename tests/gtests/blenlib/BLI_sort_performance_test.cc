@@ -0,0 +1,169 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_array_utils.h"
+#include "BLI_rand.h"
+#include "BLI_sort.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 5
+
+typedef enum eSortTestMethod {
+  SORT_TEST_QSORT,
+  SORT_TEST_PARALLEL_MERGE,
+  SORT_TEST_RADIX,
+} eSortTestMethod;
+
+typedef struct SortTestItem {
+  uint key;
+  int value;
+} SortTestItem;
+
+static int sort_test_item_cmp(const void *a, const void *b, void *UNUSED(ctx))
+{
+  const uint a_key = ((const SortTestItem *)a)->key, b_key = ((const SortTestItem *)b)->key;
+  return (a_key > b_key) - (a_key < b_key);
+}
+
+/* Sort keys with indices as values, as done to build mapping tables. */
+static void sort_test(const char *id, const eSortTestMethod method, const int len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  RNG *rng = BLI_rng_new(len);
+  SortTestItem *items = (SortTestItem *)MEM_malloc_arrayN(len, sizeof(*items), __func__);
+  uint *keys = (uint *)MEM_malloc_arrayN(len, sizeof(*keys), __func__);
+  int *values = (int *)MEM_malloc_arrayN(len, sizeof(*values), __func__);
+
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    for (int i = 0; i < len; i++) {
+      items[i].key = keys[i] = BLI_rng_get_uint(rng);
+      items[i].value = values[i] = i;
+    }
+
+    const double init_time = PIL_check_seconds_timer();
+    switch (method) {
+      case SORT_TEST_QSORT:
+        BLI_qsort_r(items, (size_t)len, sizeof(*items), sort_test_item_cmp, NULL);
+        break;
+      case SORT_TEST_PARALLEL_MERGE:
+        BLI_sort_parallel_r(items, (size_t)len, sizeof(*items), sort_test_item_cmp, NULL);
+        break;
+      case SORT_TEST_RADIX:
+        BLI_sort_radix_uint(keys, values, len);
+        break;
+    }
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+
+  printf("\t%d threads: done in %fs on average over %d runs\n",
+         BLI_task_scheduler_num_threads(),
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_freeN(items);
+  MEM_freeN(keys);
+  MEM_freeN(values);
+  BLI_rng_free(rng);
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(sort, QSort1M)
+{
+  sort_test("QSort - 1M items", SORT_TEST_QSORT, 1000000);
+}
+
+TEST(sort, ParallelMerge1M)
+{
+  sort_test("Parallel merge sort - 1M items", SORT_TEST_PARALLEL_MERGE, 1000000);
+}
+
+TEST(sort, Radix1M)
+{
+  sort_test("Radix sort - 1M items", SORT_TEST_RADIX, 1000000);
+}
+
+TEST(sort, QSort10M)
+{
+  sort_test("QSort - 10M items", SORT_TEST_QSORT, 10000000);
+}
+
+TEST(sort, ParallelMerge10M)
+{
+  sort_test("Parallel merge sort - 10M items", SORT_TEST_PARALLEL_MERGE, 10000000);
+}
+
+TEST(sort, Radix10M)
+{
+  sort_test("Radix sort - 10M items", SORT_TEST_RADIX, 10000000);
+}
+
+static void scan_test(const char *id, const bool use_parallel, const int len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  int *data = (int *)MEM_malloc_arrayN(len, sizeof(*data), __func__);
+
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    for (int i = 0; i < len; i++) {
+      data[i] = i & 7;
+    }
+
+    const double init_time = PIL_check_seconds_timer();
+    if (use_parallel) {
+      BLI_array_scan_exclusive_int(data, len);
+    }
+    else {
+      int sum = 0;
+      for (int i = 0; i < len; i++) {
+        const int value = data[i];
+        data[i] = sum;
+        sum += value;
+      }
+    }
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+
+  printf("\t%d threads: done in %fs on average over %d runs\n",
+         BLI_task_scheduler_num_threads(),
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_freeN(data);
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(sort, ScanSerial10M)
+{
+  scan_test("Scan - Single threaded - 10M items", false, 10000000);
+}
+
+TEST(sort, ScanParallel10M)
+{
+  scan_test("Scan - Parallel - 10M items", true, 10000000);
+}
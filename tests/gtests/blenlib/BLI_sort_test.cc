@@ -0,0 +1,124 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include <vector>
+
+extern "C" {
+#include "BLI_rand.h"
+#include "BLI_sort.h"
+#include "BLI_utildefines.h"
+}
+
+/* Lengths below and above the size of a chunk, to test sorting on one and multiple threads. */
+static const int sort_test_lens[] = {0, 1, 2, 100, 4097, 100003};
+
+/* Compare against a stable sort of the keys, values are the original index of the keys. */
+template<typename T>
+static void radix_sort_test(std::vector<T> keys, void (*sort_fn)(T *, int *, const int))
+{
+  const int len = (int)keys.size();
+  std::vector<int> values(len);
+  std::vector<int> expect_values(len);
+  for (int i = 0; i < len; i++) {
+    values[i] = expect_values[i] = i;
+  }
+  std::stable_sort(expect_values.begin(), expect_values.end(), [&](int a, int b) {
+    return keys[a] < keys[b];
+  });
+  std::vector<T> expect_keys(len);
+  for (int i = 0; i < len; i++) {
+    expect_keys[i] = keys[expect_values[i]];
+  }
+
+  sort_fn(keys.data(), values.data(), len);
+  EXPECT_EQ(expect_keys, keys);
+  EXPECT_EQ(expect_values, values);
+
+  /* Values are optional. */
+  sort_fn(keys.data(), NULL, len);
+  EXPECT_EQ(expect_keys, keys);
+}
+
+TEST(sort, RadixUInt)
+{
+  RNG *rng = BLI_rng_new(1);
+  for (const int len : sort_test_lens) {
+    std::vector<uint> keys(len);
+    for (int i = 0; i < len; i++) {
+      keys[i] = BLI_rng_get_uint(rng);
+    }
+    radix_sort_test(keys, BLI_sort_radix_uint);
+
+    /* Many equal keys (tests stability) and keys with equal high digits. */
+    for (int i = 0; i < len; i++) {
+      keys[i] = BLI_rng_get_uint(rng) % 37;
+    }
+    radix_sort_test(keys, BLI_sort_radix_uint);
+  }
+  BLI_rng_free(rng);
+}
+
+TEST(sort, RadixInt)
+{
+  RNG *rng = BLI_rng_new(2);
+  for (const int len : sort_test_lens) {
+    std::vector<int> keys(len);
+    for (int i = 0; i < len; i++) {
+      keys[i] = BLI_rng_get_int(rng) - (INT_MAX / 2);
+    }
+    if (len > 2) {
+      keys[0] = INT_MIN;
+      keys[1] = INT_MAX;
+      keys[2] = -1;
+    }
+    radix_sort_test(keys, BLI_sort_radix_int);
+  }
+  BLI_rng_free(rng);
+}
+
+TEST(sort, RadixFloat)
+{
+  RNG *rng = BLI_rng_new(3);
+  for (const int len : sort_test_lens) {
+    std::vector<float> keys(len);
+    for (int i = 0; i < len; i++) {
+      keys[i] = (BLI_rng_get_float(rng) - 0.5f) * 1000.0f;
+    }
+    if (len > 4) {
+      keys[0] = -FLT_MAX;
+      keys[1] = FLT_MAX;
+      keys[2] = 0.0f;
+      keys[3] = -1e-30f;
+    }
+    radix_sort_test(keys, BLI_sort_radix_float);
+  }
+  BLI_rng_free(rng);
+}
+
+static int sort_cmp_int(const void *a, const void *b, void *UNUSED(ctx))
+{
+  const int a_val = *(const int *)a, b_val = *(const int *)b;
+  return (a_val > b_val) - (a_val < b_val);
+}
+
+TEST(sort, ParallelMerge)
+{
+  RNG *rng = BLI_rng_new(4);
+  for (const int len : sort_test_lens) {
+    std::vector<int> data(len);
+    for (int i = 0; i < len; i++) {
+      data[i] = BLI_rng_get_int(rng) % 1000;
+    }
+    std::vector<int> expect = data;
+    std::sort(expect.begin(), expect.end());
+    if (len > 0) {
+      BLI_sort_parallel_r(data.data(), (size_t)len, sizeof(int), sort_cmp_int, NULL);
+    }
+    EXPECT_EQ(expect, data);
+  }
+  BLI_rng_free(rng);
+}
@@ -0,0 +1,201 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "atomic_ops.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_task.h"
+};
+
+struct TaskData {
+  int value;
+  int store;
+};
+
+static void TaskData_increase_value(void *taskdata)
+{
+  TaskData *data = (TaskData *)taskdata;
+  data->value += 1;
+}
+static void TaskData_decrease_value(void *taskdata)
+{
+  TaskData *data = (TaskData *)taskdata;
+  data->value -= 1;
+}
+static void TaskData_multiply_by_two_value(void *taskdata)
+{
+  TaskData *data = (TaskData *)taskdata;
+  data->value *= 2;
+}
+static void TaskData_multiply_by_two_store(void *taskdata)
+{
+  TaskData *data = (TaskData *)taskdata;
+  data->store *= 2;
+}
+static void TaskData_store_value(void *taskdata)
+{
+  TaskData *data = (TaskData *)taskdata;
+  data->store = data->value;
+}
+static void TaskData_square_value(void *taskdata)
+{
+  TaskData *data = (TaskData *)taskdata;
+  data->value *= data->value;
+}
+
+/* Sequential Test for using `BLI_task_graph` */
+TEST(task, GraphSequential)
+{
+  TaskData data = {0};
+  TaskGraph *graph = BLI_task_graph_create();
+
+  /* 0 => 1 => 0 => 1 => 2 => 4 */
+  TaskNode *node_a = BLI_task_graph_node_create(graph, TaskData_increase_value, &data, nullptr);
+  TaskNode *node_b = BLI_task_graph_node_create(graph, TaskData_increase_value, &data, nullptr);
+  TaskNode *node_c = BLI_task_graph_node_create(graph, TaskData_decrease_value, &data, nullptr);
+  TaskNode *node_d = BLI_task_graph_node_create(
+      graph, TaskData_multiply_by_two_value, &data, nullptr);
+  TaskNode *node_e = BLI_task_graph_node_create(graph, TaskData_square_value, &data, nullptr);
+  /* Created out of order, edges define the order of execution. */
+  BLI_task_graph_edge_create(node_a, node_c);
+  BLI_task_graph_edge_create(node_c, node_b);
+  BLI_task_graph_edge_create(node_b, node_d);
+  BLI_task_graph_edge_create(node_d, node_e);
+
+  BLI_task_graph_work_and_wait(graph);
+  EXPECT_EQ(4, data.value);
+
+  BLI_task_graph_free(graph);
+}
+
+/* A graph can run multiple times. */
+TEST(task, GraphRunTwice)
+{
+  TaskData data = {0};
+  TaskGraph *graph = BLI_task_graph_create();
+
+  TaskNode *node_a = BLI_task_graph_node_create(graph, TaskData_increase_value, &data, nullptr);
+  TaskNode *node_b = BLI_task_graph_node_create(
+      graph, TaskData_multiply_by_two_value, &data, nullptr);
+  BLI_task_graph_edge_create(node_a, node_b);
+
+  /* (0 + 1) * 2 => 2, (2 + 1) * 2 => 6 */
+  BLI_task_graph_work_and_wait(graph);
+  EXPECT_EQ(2, data.value);
+  BLI_task_graph_work_and_wait(graph);
+  EXPECT_EQ(6, data.value);
+
+  BLI_task_graph_free(graph);
+}
+
+/* Independent branches joined into one node. */
+TEST(task, GraphDiamond)
+{
+  TaskData data_a = {1};
+  TaskData data_b = {2};
+  TaskGraph *graph = BLI_task_graph_create();
+
+  /* Both branches store their value, then double it, before the join reads the stores. */
+  TaskNode *node_a = BLI_task_graph_node_create(graph, TaskData_store_value, &data_a, nullptr);
+  TaskNode *node_b = BLI_task_graph_node_create(graph, TaskData_store_value, &data_b, nullptr);
+  TaskNode *node_a2 = BLI_task_graph_node_create(
+      graph, TaskData_multiply_by_two_store, &data_a, nullptr);
+  TaskNode *node_b2 = BLI_task_graph_node_create(
+      graph, TaskData_multiply_by_two_store, &data_b, nullptr);
+  BLI_task_graph_edge_create(node_a, node_a2);
+  BLI_task_graph_edge_create(node_b, node_b2);
+
+  TaskData data_join = {0};
+  struct JoinData {
+    TaskData *inputs[2];
+    TaskData *output;
+  } join = {{&data_a, &data_b}, &data_join};
+  TaskNode *node_join = BLI_task_graph_node_create(
+      graph,
+      [](void *taskdata) {
+        JoinData *join = (JoinData *)taskdata;
+        join->output->value = join->inputs[0]->store + join->inputs[1]->store;
+      },
+      &join,
+      nullptr);
+  BLI_task_graph_edge_create(node_a2, node_join);
+  BLI_task_graph_edge_create(node_b2, node_join);
+
+  BLI_task_graph_work_and_wait(graph);
+  EXPECT_EQ(6, data_join.value);
+
+  BLI_task_graph_free(graph);
+}
+
+/* Many nodes depending on one, joined into a single node. */
+#define FAN_NODES_NUM 1000
+
+static void task_fan_out_func(void *taskdata)
+{
+  atomic_add_and_fetch_int32((int32_t *)taskdata, 1);
+}
+
+TEST(task, GraphFanOutFanIn)
+{
+  int32_t counter = 0;
+  int32_t counter_at_join = -1;
+  TaskGraph *graph = BLI_task_graph_create();
+
+  TaskNode *node_root = BLI_task_graph_node_create(graph, task_fan_out_func, &counter, nullptr);
+  struct JoinData {
+    int32_t *counter;
+    int32_t *r_counter;
+  } join = {&counter, &counter_at_join};
+  TaskNode *node_join = BLI_task_graph_node_create(
+      graph,
+      [](void *taskdata) {
+        JoinData *join = (JoinData *)taskdata;
+        *join->r_counter = *join->counter;
+      },
+      &join,
+      nullptr);
+
+  for (int i = 0; i < FAN_NODES_NUM; i++) {
+    TaskNode *node = BLI_task_graph_node_create(graph, task_fan_out_func, &counter, nullptr);
+    BLI_task_graph_edge_create(node_root, node);
+    BLI_task_graph_edge_create(node, node_join);
+  }
+
+  BLI_task_graph_work_and_wait(graph);
+  EXPECT_EQ(FAN_NODES_NUM + 1, counter);
+  EXPECT_EQ(FAN_NODES_NUM + 1, counter_at_join);
+
+  BLI_task_graph_free(graph);
+}
+
+/* Task data is freed with the graph. */
+static int task_data_free_len = 0;
+
+static void TaskData_free(void *taskdata)
+{
+  MEM_freeN(taskdata);
+  task_data_free_len++;
+}
+
+TEST(task, GraphFreeTaskData)
+{
+  TaskGraph *graph = BLI_task_graph_create();
+
+  TaskData *data = (TaskData *)MEM_callocN(sizeof(*data), __func__);
+  TaskNode *node_a = BLI_task_graph_node_create(
+      graph, TaskData_increase_value, data, TaskData_free);
+  TaskNode *node_b = BLI_task_graph_node_create(graph, TaskData_store_value, data, nullptr);
+  BLI_task_graph_edge_create(node_a, node_b);
+
+  BLI_task_graph_work_and_wait(graph);
+  EXPECT_EQ(1, data->store);
+  EXPECT_EQ(0, task_data_free_len);
+
+  BLI_task_graph_free(graph);
+  EXPECT_EQ(1, task_data_free_len);
+}
@@ -210,3 +210,187 @@ TEST(task, ListBaseIter100k)
 {
   task_listbase_test("ListBase parallel iteration - Threaded - 100000 items", 100000, true);
 }
+
+/* *** Task graph, layers of nodes depending on nodes of the previous layer. *** */
+
+#define TASK_GRAPH_EDGES_PER_NODE 4
+
+struct TaskGraphNodeData {
+  uint index;
+  uint value;
+};
+
+static void task_graph_heavy_func(void *taskdata)
+{
+  TaskGraphNodeData *data = (TaskGraphNodeData *)taskdata;
+
+  /* 'Random' number of iterations. */
+  const uint num = gen_pseudo_random_number(data->index);
+
+  for (uint i = 0; i < num; i++) {
+    data->value += (i % 2) ? -data->index : data->index;
+  }
+}
+
+static void task_graph_test(const char *id, const int layers_num, const int nodes_per_layer)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  const int nodes_num = layers_num * nodes_per_layer;
+  TaskGraphNodeData *nodes_data = (TaskGraphNodeData *)MEM_calloc_arrayN(
+      nodes_num, sizeof(*nodes_data), __func__);
+  TaskNode **nodes = (TaskNode **)MEM_malloc_arrayN(nodes_num, sizeof(*nodes), __func__);
+
+  TaskGraph *graph = BLI_task_graph_create();
+  for (int i = 0; i < nodes_num; i++) {
+    nodes_data[i].index = (uint)i;
+    nodes[i] = BLI_task_graph_node_create(graph, task_graph_heavy_func, &nodes_data[i], NULL);
+    if (i >= nodes_per_layer) {
+      const int layer_prev_start = (i / nodes_per_layer - 1) * nodes_per_layer;
+      for (int j = 0; j < TASK_GRAPH_EDGES_PER_NODE; j++) {
+        const uint offset = gen_pseudo_random_number((uint)(i * TASK_GRAPH_EDGES_PER_NODE + j));
+        BLI_task_graph_edge_create(nodes[layer_prev_start + (int)(offset % nodes_per_layer)],
+                                   nodes[i]);
+      }
+    }
+  }
+
+  /* Nodes are created in an order which respects all dependencies. */
+  double timing_serial = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    const double init_time = PIL_check_seconds_timer();
+    for (int j = 0; j < nodes_num; j++) {
+      task_graph_heavy_func(&nodes_data[j]);
+    }
+    timing_serial += PIL_check_seconds_timer() - init_time;
+  }
+
+  double timing_graph = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    const double init_time = PIL_check_seconds_timer();
+    BLI_task_graph_work_and_wait(graph);
+    timing_graph += PIL_check_seconds_timer() - init_time;
+  }
+
+  /* Each run adds zero or the index of the node (for an odd number of iterations). */
+  for (int i = 0; i < nodes_num; i++) {
+    const uint num = gen_pseudo_random_number((uint)i);
+    EXPECT_EQ((num % 2) ? (uint)i * 2 * NUM_RUN_AVERAGED : 0, nodes_data[i].value);
+  }
+
+  printf("\t%d nodes, serial: done in %fs on average over %d runs\n",
+         nodes_num,
+         timing_serial / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+  printf("\t%d nodes, graph: done in %fs on average over %d runs\n",
+         nodes_num,
+         timing_graph / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BLI_task_graph_free(graph);
+  MEM_freeN(nodes);
+  MEM_freeN(nodes_data);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(task, GraphWide1k)
+{
+  task_graph_test("Task graph - 10 layers of 100 nodes", 10, 100);
+}
+
+TEST(task, GraphDeep1k)
+{
+  task_graph_test("Task graph - 100 layers of 10 nodes", 100, 10);
+}
+
+TEST(task, GraphWide10k)
+{
+  task_graph_test("Task graph - 10 layers of 1000 nodes", 10, 1000);
+}
+
+/* *** NUMA, ranges processing memory first touched on their own node, or on another node. *** */
+
+#define NUMA_ITEMS_NUM (1 << 24)
+
+struct NumaTestData {
+  float *items;
+  int items_num;
+  int offset;
+};
+
+static void task_numa_init_func(void *__restrict userdata,
+                                const int index,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  NumaTestData *data = (NumaTestData *)userdata;
+  data->items[index] = (float)index;
+}
+
+static void task_numa_update_func(void *__restrict userdata,
+                                  const int index,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  NumaTestData *data = (NumaTestData *)userdata;
+  /* With an offset of half the items, two nodes each process the memory of the other. */
+  const int i = (index + data->offset) % data->items_num;
+  data->items[i] = data->items[i] * 0.5f + 1.0f;
+}
+
+static void task_numa_test(const char *id, const bool use_numa)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_use_numa_set(use_numa);
+  BLI_task_scheduler_init();
+  printf("\t%d NUMA nodes\n", BLI_task_scheduler_numa_nodes_num());
+
+  NumaTestData data;
+  data.items_num = NUMA_ITEMS_NUM;
+  data.items = (float *)MEM_malloc_arrayN(data.items_num, sizeof(*data.items), __func__);
+  data.offset = 0;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+
+  /* First touch, places memory on the node of the threads initializing it. */
+  BLI_task_parallel_range(0, data.items_num, &data, task_numa_init_func, &settings);
+
+  const struct {
+    const char *name;
+    int offset;
+  } cases[2] = {{"Local memory", 0}, {"Remote memory", NUMA_ITEMS_NUM / 2}};
+  for (int c = 0; c < 2; c++) {
+    data.offset = cases[c].offset;
+
+    double averaged_timing = 0.0;
+    for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+      const double init_time = PIL_check_seconds_timer();
+      BLI_task_parallel_range(0, data.items_num, &data, task_numa_update_func, &settings);
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+    }
+
+    printf("\t%s: done in %fs on average over %d runs\n",
+           cases[c].name,
+           averaged_timing / NUM_RUN_AVERAGED,
+           NUM_RUN_AVERAGED);
+  }
+
+  MEM_freeN(data.items);
+  BLI_task_scheduler_exit();
+  BLI_task_scheduler_use_numa_set(false);
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(task, NumaDefaultScheduler)
+{
+  task_numa_test("NUMA - Default scheduler - 16M items", false);
+}
+
+TEST(task, NumaNodeArenas)
+{
+  task_numa_test("NUMA - Arena per node - 16M items", true);
+}
@@ -13,6 +13,8 @@ extern "C" {
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+
+#include "PIL_time.h"
 };
 
 #define NUM_ITEMS 10000
@@ -67,6 +69,69 @@ TEST(task, RangeIter)
   BLI_threadapi_exit();
 }
 
+/* Iterations of a known minimum cost. */
+static void task_range_iter_slow_func(void *userdata,
+                                      int index,
+                                      const TaskParallelTLS *__restrict tls)
+{
+  const double time_start = PIL_check_seconds_timer();
+  while (PIL_check_seconds_timer() - time_start < 1e-6) {
+    /* pass */
+  }
+  task_range_iter_func(userdata, index, tls);
+}
+
+static double task_range_site_time_per_iter(const TaskParallelRangeSite *site)
+{
+  double time_per_iter;
+  memcpy(&time_per_iter, &site->time_per_iter, sizeof(time_per_iter));
+  return time_per_iter;
+}
+
+TEST(task, RangeIterAdaptive)
+{
+  int data[NUM_ITEMS] = {0};
+
+  BLI_threadapi_init();
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_adaptive_grain = true;
+  settings.func_reduce = task_range_iter_reduce_func;
+
+  /* Call sites using the same callback are still measured separately. */
+  TaskParallelRangeSite site = {"task_range_iter_slow_func", 0};
+  TaskParallelRangeSite site_other = {"task_range_iter_slow_func", 0};
+
+  /* The first call measures the cost of iterations, following calls use it for the grain size. */
+  for (int run = 0; run < 3; run++) {
+    int sum = 0;
+    settings.userdata_chunk = &sum;
+    settings.userdata_chunk_size = sizeof(sum);
+
+    BLI_task_parallel_range_ex(0, NUM_ITEMS, data, task_range_iter_slow_func, &site, &settings);
+
+    int expected_sum = 0;
+    for (int i = 0; i < NUM_ITEMS; i++) {
+      EXPECT_EQ(data[i], i);
+      expected_sum += i;
+    }
+    EXPECT_EQ(sum, expected_sum);
+
+    const double time_per_iter = task_range_site_time_per_iter(&site);
+    EXPECT_GE(time_per_iter, 1e-6);
+    EXPECT_LT(time_per_iter, 1e-3);
+    EXPECT_EQ(0.0, task_range_site_time_per_iter(&site_other));
+  }
+
+  int sum = 0;
+  settings.userdata_chunk = &sum;
+  BLI_task_parallel_range_ex(0, 100, data, task_range_iter_slow_func, &site_other, &settings);
+  EXPECT_GE(task_range_site_time_per_iter(&site_other), 1e-6);
+
+  BLI_threadapi_exit();
+}
+
 /* *** Parallel iterations over mempool items. *** */
 
 static void task_mempool_iter_func(void *userdata, MempoolIterData *item)
@@ -136,6 +201,108 @@ TEST(task, MempoolIter)
   BLI_threadapi_exit();
 }
 
+/* *** Parallel allocation from a concurrent mempool. *** */
+
+typedef struct MempoolConcurrentData {
+  BLI_mempool *mempool;
+  int **data;
+  bool do_free;
+} MempoolConcurrentData;
+
+static BLI_mempool_thread *task_mempool_thread_ensure(BLI_mempool *mempool,
+                                                      const TaskParallelTLS *__restrict tls)
+{
+  BLI_mempool_thread **cache_p = (BLI_mempool_thread **)tls->userdata_chunk;
+  if (*cache_p == NULL) {
+    *cache_p = BLI_mempool_thread_begin(mempool);
+  }
+  return *cache_p;
+}
+
+static void task_mempool_concurrent_func(void *userdata,
+                                         int index,
+                                         const TaskParallelTLS *__restrict tls)
+{
+  MempoolConcurrentData *data = (MempoolConcurrentData *)userdata;
+  BLI_mempool_thread *cache = task_mempool_thread_ensure(data->mempool, tls);
+
+  if (data->do_free) {
+    if (data->data[index] != NULL) {
+      BLI_mempool_thread_free(cache, data->data[index]);
+      data->data[index] = NULL;
+    }
+    return;
+  }
+
+  data->data[index] = (int *)BLI_mempool_thread_alloc(cache);
+  *data->data[index] = index;
+  /* Free some items right away, so they are reused by following allocations. */
+  if ((index % 3) == 0) {
+    BLI_mempool_thread_free(cache, data->data[index]);
+    data->data[index] = NULL;
+  }
+}
+
+static void task_mempool_concurrent_free_func(const void *__restrict UNUSED(userdata),
+                                              void *__restrict userdata_chunk)
+{
+  BLI_mempool_thread **cache_p = (BLI_mempool_thread **)userdata_chunk;
+  if (*cache_p != NULL) {
+    BLI_mempool_thread_end(*cache_p);
+    *cache_p = NULL;
+  }
+}
+
+TEST(task, MempoolConcurrentAlloc)
+{
+  int *data[NUM_ITEMS];
+  BLI_threadapi_init();
+  BLI_mempool *mempool = BLI_mempool_create(
+      sizeof(*data[0]), 0, 32, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_CONCURRENT);
+
+  MempoolConcurrentData userdata = {mempool, data, false};
+  BLI_mempool_thread *cache = NULL;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  settings.userdata_chunk = &cache;
+  settings.userdata_chunk_size = sizeof(cache);
+  settings.func_free = task_mempool_concurrent_free_func;
+
+  BLI_task_parallel_range(0, NUM_ITEMS, &userdata, task_mempool_concurrent_func, &settings);
+
+  int num_items = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (data[i] != NULL) {
+      EXPECT_EQ(*data[i], i);
+      num_items++;
+    }
+  }
+  EXPECT_EQ(BLI_mempool_len(mempool), num_items);
+
+  /* Iterating sees every allocated item exactly once. */
+  BLI_mempool_iter iter;
+  BLI_mempool_iternew(mempool, &iter);
+  int num_items_iter = 0;
+  for (int *item = (int *)BLI_mempool_iterstep(&iter); item;
+       item = (int *)BLI_mempool_iterstep(&iter)) {
+    EXPECT_EQ(data[*item], item);
+    num_items_iter++;
+  }
+  EXPECT_EQ(num_items_iter, num_items);
+  EXPECT_NE(BLI_mempool_findelem(mempool, (uint)num_items - 1), (void *)NULL);
+  EXPECT_EQ(BLI_mempool_findelem(mempool, (uint)num_items), (void *)NULL);
+
+  /* Free from threads (possibly other than the allocating ones). */
+  userdata.do_free = true;
+  BLI_task_parallel_range(0, NUM_ITEMS, &userdata, task_mempool_concurrent_func, &settings);
+  EXPECT_EQ(BLI_mempool_len(mempool), 0);
+
+  BLI_mempool_destroy(mempool);
+  BLI_threadapi_exit();
+}
+
 /* *** Parallel iterations over double-linked list items. *** */
 
 static void task_listbase_iter_func(void *userdata,
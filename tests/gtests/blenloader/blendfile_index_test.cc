@@ -0,0 +1,177 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_fileops.h"
+#include "BLI_linklist.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+#include "BKE_icons.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+#include "BKE_text.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+}
+
+class BlendfileIndexTest : public BlendfileLoadingBaseTest {
+ protected:
+  char filepath[FILE_MAX];
+  BlendHandle *bh = nullptr;
+
+  void SetUp() override
+  {
+    write_and_open(G_FILE_INDEX_DEPS);
+  }
+
+  void write_and_open(const int write_flags, void (*add_data)(Main *bmain) = nullptr)
+  {
+    BKE_tempdir_init(NULL);
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_base(), "index.blend");
+
+    Main *bmain = BKE_main_new();
+    BKE_text_add(bmain, "TextA");
+    BKE_text_add(bmain, "TextB");
+    Object *ob = BKE_object_add_only_object(bmain, OB_MESH, "Object");
+    /* Objects are only written when used (normally by a collection). */
+    id_us_plus(&ob->id);
+    ob->data = BKE_mesh_add(bmain, "Mesh");
+    if (add_data) {
+      add_data(bmain);
+    }
+
+    EXPECT_TRUE(BLO_write_file(bmain, filepath, write_flags, NULL, NULL));
+    BKE_main_free(bmain);
+
+    bh = BLO_blendhandle_from_file(filepath, NULL);
+    ASSERT_NE(nullptr, bh);
+  }
+
+  void TearDown() override
+  {
+    if (bh) {
+      BLO_blendhandle_close(bh);
+    }
+    BLI_delete(filepath, false, false);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+};
+
+static bool linklist_has_string(LinkNode *list, const char *str)
+{
+  for (LinkNode *link = list; link; link = link->next) {
+    if (STREQ((const char *)link->link, str)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST_F(BlendfileIndexTest, DatablockNames)
+{
+  int tot_names;
+  LinkNode *names = BLO_blendhandle_get_datablock_names(bh, ID_TXT, &tot_names);
+  EXPECT_EQ(2, tot_names);
+  EXPECT_TRUE(linklist_has_string(names, "TextA"));
+  EXPECT_TRUE(linklist_has_string(names, "TextB"));
+  BLI_linklist_free(names, free);
+  /* Answered from the index, not by scanning the file. */
+  EXPECT_EQ(1, BLO_blendhandle_index_lookups(bh));
+}
+
+TEST_F(BlendfileIndexTest, LinkableGroups)
+{
+  LinkNode *names = BLO_blendhandle_get_linkable_groups(bh);
+  EXPECT_TRUE(linklist_has_string(names, "Text"));
+  EXPECT_TRUE(linklist_has_string(names, "Object"));
+  EXPECT_TRUE(linklist_has_string(names, "Mesh"));
+  EXPECT_FALSE(linklist_has_string(names, "Material"));
+  BLI_linklist_free(names, free);
+  EXPECT_EQ(1, BLO_blendhandle_index_lookups(bh));
+}
+
+TEST_F(BlendfileIndexTest, DatablockDependencies)
+{
+  int tot_names;
+  LinkNode *names = BLO_blendhandle_get_datablock_dependencies(bh, ID_OB, "Object", &tot_names);
+  EXPECT_EQ(1, tot_names);
+  EXPECT_TRUE(linklist_has_string(names, "MEMesh"));
+  BLI_linklist_free(names, free);
+
+  names = BLO_blendhandle_get_datablock_dependencies(bh, ID_TXT, "TextA", &tot_names);
+  EXPECT_EQ(0, tot_names);
+  EXPECT_EQ(nullptr, names);
+  EXPECT_EQ(2, BLO_blendhandle_index_lookups(bh));
+}
+
+TEST_F(BlendfileIndexTest, DatablockDependenciesNotRequested)
+{
+  BLO_blendhandle_close(bh);
+  bh = nullptr;
+  write_and_open(0);
+
+  int tot_names;
+  LinkNode *names = BLO_blendhandle_get_datablock_dependencies(bh, ID_OB, "Object", &tot_names);
+  EXPECT_EQ(0, tot_names);
+  EXPECT_EQ(nullptr, names);
+}
+
+static PreviewImage *preview_create(const int size)
+{
+  PreviewImage *prv = BKE_previewimg_create();
+  prv->w[0] = prv->h[0] = size;
+  prv->rect[0] = static_cast<uint *>(MEM_callocN(sizeof(uint) * size * size, __func__));
+  return prv;
+}
+
+static void add_scene_with_previews(Main *bmain)
+{
+  Scene *scene = BKE_scene_add(bmain, "Scene");
+  scene->preview = preview_create(2);
+  /* Written after the preview of the scene, without an index entry of its own. */
+  scene->master_collection->preview = preview_create(4);
+}
+
+TEST_F(BlendfileIndexTest, ScenePreview)
+{
+  BLO_blendhandle_close(bh);
+  bh = nullptr;
+  write_and_open(0, add_scene_with_previews);
+
+  int tot_prev;
+  LinkNode *previews = BLO_blendhandle_get_previews(bh, ID_SCE, &tot_prev);
+  EXPECT_EQ(1, BLO_blendhandle_index_lookups(bh));
+  ASSERT_EQ(1, tot_prev);
+  PreviewImage *prv = static_cast<PreviewImage *>(previews->link);
+  EXPECT_EQ(2, prv->w[0]);
+  EXPECT_EQ(2, prv->h[0]);
+  EXPECT_NE(nullptr, prv->rect[0]);
+  BLI_linklist_free(previews, BKE_previewimg_freefunc);
+}
+
+TEST_F(BlendfileIndexTest, ReadFile)
+{
+  /* The file is opened using the index, make sure reading all blocks still works after that. */
+  bfile = BLO_read_from_file(filepath, BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfile);
+  EXPECT_EQ(2, BLI_listbase_count(&bfile->main->texts));
+  Object *ob = static_cast<Object *>(bfile->main->objects.first);
+  ASSERT_NE(nullptr, ob);
+  ASSERT_NE(nullptr, ob->data);
+  EXPECT_STREQ("MEMesh", static_cast<ID *>(ob->data)->name);
+}
@@ -0,0 +1,79 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_dynstr.h"
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_text_types.h"
+
+#include "BKE_appdir.h"
+#include "BKE_main.h"
+#include "BKE_text.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+/* Lines of text written into the test file, each one results in two DATA blocks (the #TextLine
+ * and its string) that have to be remapped through the #OldNewMap when reading. */
+#define TEXT_LINES_NUM 500000
+
+class BlendfileRemapPerformanceTest : public BlendfileLoadingBaseTest {
+ protected:
+  char filepath[FILE_MAX];
+
+  void SetUp() override
+  {
+    BKE_tempdir_init(NULL);
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_base(), "remap_performance.blend");
+  }
+
+  void TearDown() override
+  {
+    BLI_delete(filepath, false, false);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  void write_text_blendfile(const int lines_num)
+  {
+    Main *bmain = BKE_main_new();
+    Text *text = BKE_text_add(bmain, "Text");
+
+    DynStr *dynstr = BLI_dynstr_new();
+    for (int i = 0; i < lines_num; i++) {
+      BLI_dynstr_appendf(dynstr, "line %d\n", i);
+    }
+    char *str = BLI_dynstr_get_cstring(dynstr);
+    BLI_dynstr_free(dynstr);
+    BKE_text_write(text, str);
+    MEM_freeN(str);
+
+    EXPECT_TRUE(BLO_write_file(bmain, filepath, 0, NULL, NULL));
+    BKE_main_free(bmain);
+  }
+};
+
+TEST_F(BlendfileRemapPerformanceTest, TextLines)
+{
+  write_text_blendfile(TEXT_LINES_NUM);
+
+  TIMEIT_START(blendfile_read_text_lines);
+  bfile = BLO_read_from_file(filepath, BLO_READ_SKIP_NONE, NULL);
+  TIMEIT_END(blendfile_read_text_lines);
+
+  ASSERT_NE(nullptr, bfile);
+  Text *text = static_cast<Text *>(bfile->main->texts.first);
+  ASSERT_NE(nullptr, text);
+  /* The buffer ends with a newline, which adds an empty trailing line. */
+  EXPECT_EQ(TEXT_LINES_NUM + 1, BLI_listbase_count(&text->lines));
+  EXPECT_STREQ("line 0", static_cast<TextLine *>(text->lines.first)->line);
+}
@@ -0,0 +1,90 @@
+/* Apache License, Version 2.0 */
+
+#include "depsgraph_test_base.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_collection.h"
+#include "BKE_global.h"
+#include "BKE_object.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+}
+
+/* Objects in the scene, parented in chains of PARENT_CHAIN_LEN objects. */
+#define OBJECTS_NUM 20000
+#define PARENT_CHAIN_LEN 10
+
+/* Compares incremental relations updates with full rebuilds of a big scene. Timings are printed
+ * by --debug-depsgraph-time. */
+class DepsgraphIncrementalPerformanceTest : public DepsgraphTest {
+ protected:
+  Object *objects[OBJECTS_NUM];
+
+  void SetUp() override
+  {
+    DepsgraphTest::SetUp();
+    /* Objects are added to a collection which is linked to the scene afterwards, so the view
+     * layer is synced once instead of for every object. */
+    Collection *collection = BKE_collection_add(bmain, nullptr, "Objects");
+    for (int i = 0; i < OBJECTS_NUM; i++) {
+      objects[i] = BKE_object_add_only_object(bmain, OB_EMPTY, "Object");
+      BKE_collection_object_add(bmain, collection, objects[i]);
+      if (i % PARENT_CHAIN_LEN != 0) {
+        objects[i]->parent = objects[i - 1];
+      }
+    }
+    BKE_collection_child_add(bmain, scene->master_collection, collection);
+    G.debug |= G_DEBUG_DEPSGRAPH_TIME;
+    printf("Full build:\n");
+    depsgraph_create();
+  }
+
+  void TearDown() override
+  {
+    G.debug &= ~G_DEBUG_DEPSGRAPH_TIME;
+    DepsgraphTest::TearDown();
+  }
+
+  /* Build a new depsgraph, to compare with the updated one. */
+  void relations_build_full()
+  {
+    printf("Full build:\n");
+    depsgraph_free();
+    depsgraph_create();
+  }
+
+  void relations_update_incremental()
+  {
+    printf("Incremental update:\n");
+    DEG_graph_relations_update(depsgraph, bmain, scene, view_layer);
+  }
+};
+
+TEST_F(DepsgraphIncrementalPerformanceTest, Parent)
+{
+  for (int i = 0; i < 3; i++) {
+    Object *object = objects[OBJECTS_NUM / 2 + i];
+    object->parent = (object->parent == nullptr) ? objects[0] : nullptr;
+    DEG_relations_tag_update_id(bmain, &object->id);
+    relations_update_incremental();
+  }
+  relations_build_full();
+}
+
+TEST_F(DepsgraphIncrementalPerformanceTest, AddObject)
+{
+  for (int i = 0; i < 3; i++) {
+    Object *object = object_add("Added");
+    object->parent = objects[i];
+    DEG_relations_tag_update_id(bmain, &object->id);
+    relations_update_incremental();
+  }
+  relations_build_full();
+}
@@ -0,0 +1,117 @@
+/* Apache License, Version 2.0 */
+
+#include "depsgraph_test_base.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_collection.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_debug.h"
+}
+
+#define OBJECTS_NUM 8
+
+class DepsgraphIncrementalTest : public DepsgraphTest {
+ protected:
+  Object *objects[OBJECTS_NUM];
+
+  void SetUp() override
+  {
+    DepsgraphTest::SetUp();
+    for (int i = 0; i < OBJECTS_NUM; i++) {
+      objects[i] = object_add("Object");
+    }
+    depsgraph_create();
+  }
+
+  /* Update relations of the tagged IDs and compare the result with a full build. */
+  void expect_relations_update_matches_full_build()
+  {
+    DEG_graph_relations_update(depsgraph, bmain, scene, view_layer);
+    Depsgraph *full_depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(full_depsgraph, bmain, scene, view_layer);
+    EXPECT_TRUE(DEG_debug_compare(depsgraph, full_depsgraph));
+    EXPECT_TRUE(DEG_debug_consistency_check(depsgraph));
+    DEG_graph_free(full_depsgraph);
+  }
+};
+
+TEST_F(DepsgraphIncrementalTest, Parent)
+{
+  objects[1]->parent = objects[0];
+  objects[2]->parent = objects[1];
+  DEG_relations_tag_update_id(bmain, &objects[1]->id);
+  DEG_relations_tag_update_id(bmain, &objects[2]->id);
+  expect_relations_update_matches_full_build();
+
+  objects[2]->parent = nullptr;
+  DEG_relations_tag_update_id(bmain, &objects[2]->id);
+  expect_relations_update_matches_full_build();
+}
+
+TEST_F(DepsgraphIncrementalTest, ParentOutsideViewLayer)
+{
+  /* Parent is not in the view layer, it is only reached through the builder of its child. */
+  Object *parent = BKE_object_add_only_object(bmain, OB_EMPTY, "Parent");
+  objects[0]->parent = parent;
+  DEG_relations_tag_update_id(bmain, &objects[0]->id);
+  expect_relations_update_matches_full_build();
+
+  /* Child is kept, the parent is built again. */
+  DEG_relations_tag_update_id(bmain, &parent->id);
+  expect_relations_update_matches_full_build();
+
+  /* Both are kept. */
+  DEG_relations_tag_update_id(bmain, &objects[1]->id);
+  expect_relations_update_matches_full_build();
+
+  objects[0]->parent = nullptr;
+  DEG_relations_tag_update_id(bmain, &objects[0]->id);
+  expect_relations_update_matches_full_build();
+}
+
+TEST_F(DepsgraphIncrementalTest, AddAndDelete)
+{
+  Object *object = object_add("Added");
+  object->parent = objects[0];
+  DEG_relations_tag_update_id(bmain, &object->id);
+  expect_relations_update_matches_full_build();
+
+  /* Tagged before it is freed, another object might be allocated at the same address. */
+  object->parent = nullptr;
+  DEG_relations_tag_update_id(bmain, &object->id);
+  DEG_relations_tag_update_id(bmain, &objects[0]->id);
+  BKE_scene_collections_object_remove(bmain, scene, objects[0], true);
+  Object *object_new = object_add("New");
+  DEG_relations_tag_update_id(bmain, &object_new->id);
+  expect_relations_update_matches_full_build();
+}
+
+TEST_F(DepsgraphIncrementalTest, CollectionInstance)
+{
+  Collection *collection = BKE_collection_add(bmain, nullptr, "Instanced");
+  objects[0]->instance_collection = collection;
+  objects[0]->transflag |= OB_DUPLICOLLECTION;
+  id_us_plus(&collection->id);
+  DEG_relations_tag_update_id(bmain, &objects[0]->id);
+  expect_relations_update_matches_full_build();
+
+  /* Instancer gets relations to the objects added to the instanced collection. */
+  Object *object = BKE_object_add_only_object(bmain, OB_EMPTY, "Instanced");
+  BKE_collection_object_add(bmain, collection, object);
+  DEG_relations_tag_update_id(bmain, &object->id);
+  expect_relations_update_matches_full_build();
+}
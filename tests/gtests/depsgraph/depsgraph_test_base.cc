@@ -0,0 +1,133 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "depsgraph_test_base.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_blender.h"
+#include "BKE_global.h"
+#include "BKE_idtype.h"
+#include "BKE_image.h"
+#include "BKE_main.h"
+#include "BKE_modifier.h"
+#include "BKE_node.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_threads.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+
+#include "DNA_genfile.h" /* for DNA_sdna_current_init() */
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "IMB_imbuf.h"
+
+#include "RNA_define.h"
+}
+
+DepsgraphTest::~DepsgraphTest()
+{
+}
+
+void DepsgraphTest::SetUpTestCase()
+{
+  testing::Test::SetUpTestCase();
+
+  /* Same initialization as BlendfileLoadingBaseTest, without the window manager which is only
+   * needed for loading blend files. */
+  BLI_threadapi_init();
+
+  DNA_sdna_current_init();
+  BKE_blender_globals_init();
+
+  BKE_idtype_init();
+  IMB_init();
+  BKE_images_init();
+  BKE_modifier_init();
+  DEG_register_node_types();
+  RNA_init();
+  init_nodesystem();
+
+  G.background = true;
+  G.factory_startup = true;
+}
+
+void DepsgraphTest::TearDownTestCase()
+{
+  BKE_blender_free();
+  RNA_exit();
+
+  DEG_free_node_types();
+  DNA_sdna_current_free();
+  BLI_threadapi_exit();
+
+  BKE_blender_atexit();
+
+  if (MEM_get_memory_blocks_in_use() != 0) {
+    size_t mem_in_use = MEM_get_memory_in_use();
+    printf("Error: Not freed memory blocks: %u, total unfreed memory %f MB\n",
+           MEM_get_memory_blocks_in_use(),
+           (double)mem_in_use / 1024 / 1024);
+    MEM_printmemlist();
+  }
+
+  BKE_tempdir_session_purge();
+
+  testing::Test::TearDownTestCase();
+}
+
+void DepsgraphTest::SetUp()
+{
+  bmain = BKE_main_new();
+  scene = BKE_scene_add(bmain, "Scene");
+  view_layer = static_cast<ViewLayer *>(scene->view_layers.first);
+}
+
+void DepsgraphTest::TearDown()
+{
+  depsgraph_free();
+  BKE_main_free(bmain);
+  bmain = nullptr;
+
+  testing::Test::TearDown();
+}
+
+Object *DepsgraphTest::object_add(const char *name)
+{
+  return BKE_object_add(bmain, scene, view_layer, OB_EMPTY, name);
+}
+
+void DepsgraphTest::depsgraph_create()
+{
+  depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+  DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+}
+
+void DepsgraphTest::depsgraph_free()
+{
+  if (depsgraph == nullptr) {
+    return;
+  }
+  DEG_graph_free(depsgraph);
+  depsgraph = nullptr;
+}
@@ -0,0 +1,60 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#ifndef __DEPSGRAPH_TEST_BASE_H__
+#define __DEPSGRAPH_TEST_BASE_H__
+
+#include "testing/testing.h"
+
+struct Depsgraph;
+struct Main;
+struct Object;
+struct Scene;
+struct ViewLayer;
+
+/* Test with an empty scene and a dependency graph of its view layer, which is built on demand.
+ * Does not load any blend file. */
+class DepsgraphTest : public testing::Test {
+ protected:
+  struct Main *bmain = nullptr;
+  struct Scene *scene = nullptr;
+  struct ViewLayer *view_layer = nullptr;
+  struct Depsgraph *depsgraph = nullptr;
+
+ public:
+  virtual ~DepsgraphTest();
+
+  /* Sets up Blender just enough to not crash on constructing and evaluating a depsgraph. */
+  static void SetUpTestCase();
+  static void TearDownTestCase();
+
+ protected:
+  /* Creates the main database and the scene. */
+  virtual void SetUp();
+  /* Frees the depsgraph and the main database. */
+  virtual void TearDown();
+
+  /* Add an empty object to the scene. */
+  struct Object *object_add(const char *name);
+
+  /* Create the depsgraph of the scene and build its relations. */
+  void depsgraph_create();
+  /* Free the depsgraph if it's not nullptr. */
+  void depsgraph_free();
+};
+
+#endif /* __DEPSGRAPH_TEST_BASE_H__ */
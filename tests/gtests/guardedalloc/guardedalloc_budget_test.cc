@@ -0,0 +1,112 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+#define BLOCK_LEN (256 * 1024)
+
+namespace {
+
+/* Blocks of a cache, the oldest first. */
+std::vector<void *> cache_blocks;
+
+size_t cache_budget_free(size_t size, void *user_data)
+{
+  int *calls = (int *)user_data;
+  size_t freed = 0;
+  (*calls)++;
+  while (!cache_blocks.empty() && freed < size) {
+    freed += MEM_allocN_len(cache_blocks.front());
+    MEM_freeN(cache_blocks.front());
+    cache_blocks.erase(cache_blocks.begin());
+  }
+  return freed;
+}
+
+void budget_test()
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  int calls = 0;
+  MEM_add_budget_callback(cache_budget_free, &calls);
+
+  /* Without a budget nothing is evicted. */
+  for (int i = 0; i < 8; i++) {
+    cache_blocks.push_back(MEM_mallocN(BLOCK_LEN, __func__));
+  }
+  EXPECT_EQ(0, calls);
+
+  /* The cache is evicted to stay under the soft limit. */
+  MEM_set_memory_budget(mem_in_use + 4 * BLOCK_LEN, mem_in_use + 6 * BLOCK_LEN);
+  size_t soft_limit, hard_limit;
+  MEM_get_memory_budget(&soft_limit, &hard_limit);
+  EXPECT_EQ(mem_in_use + 4 * BLOCK_LEN, soft_limit);
+  EXPECT_EQ(mem_in_use + 6 * BLOCK_LEN, hard_limit);
+
+  for (int i = 0; i < 8; i++) {
+    cache_blocks.push_back((i % 2) ? MEM_mapallocN(BLOCK_LEN, __func__) :
+                                     MEM_callocN(BLOCK_LEN, __func__));
+    ASSERT_NE(nullptr, cache_blocks.back());
+    EXPECT_LE(MEM_get_memory_in_use(), mem_in_use + 4 * BLOCK_LEN);
+  }
+  EXPECT_LT(0, calls);
+  EXPECT_EQ(4, (int)cache_blocks.size());
+
+  /* Small allocations are not checked. */
+  calls = 0;
+  void *small = MEM_mallocN(MEM_BUDGET_CHECK_MIN_LEN / 2, __func__);
+  EXPECT_EQ(0, calls);
+
+  /* Memory which can't be evicted fails at the hard limit, aligned and mapped allocations too.
+   * Without allowing NULL this would abort. */
+  void *uncached = MEM_mallocN(BLOCK_LEN, __func__);
+  ASSERT_NE(nullptr, uncached);
+  MEM_budget_allow_null_begin();
+  EXPECT_EQ(nullptr, MEM_mallocN_aligned(8 * BLOCK_LEN, 64, __func__));
+  EXPECT_EQ(nullptr, MEM_mapallocN(8 * BLOCK_LEN, __func__));
+  MEM_budget_allow_null_begin();
+  EXPECT_EQ(nullptr, MEM_callocN(8 * BLOCK_LEN, __func__));
+  MEM_budget_allow_null_end();
+  EXPECT_EQ(nullptr, MEM_mallocN(8 * BLOCK_LEN, __func__));
+  MEM_budget_allow_null_end();
+  EXPECT_TRUE(cache_blocks.empty());
+  MEM_freeN(uncached);
+  MEM_freeN(small);
+
+  /* Only a hard limit still evicts before failing. */
+  cache_blocks.push_back(MEM_mallocN(BLOCK_LEN, __func__));
+  MEM_set_memory_budget(0, mem_in_use + BLOCK_LEN * 3 / 2);
+  void *ptr = MEM_mallocN(BLOCK_LEN, __func__);
+  EXPECT_NE(nullptr, ptr);
+  EXPECT_TRUE(cache_blocks.empty());
+  MEM_freeN(ptr);
+
+  MEM_set_memory_budget(0, 0);
+  MEM_remove_budget_callback(cache_budget_free, &calls);
+  EXPECT_EQ(mem_in_use, MEM_get_memory_in_use());
+}
+
+}  // namespace
+
+TEST(guardedalloc, LockfreeBudget)
+{
+  budget_test();
+}
+
+TEST(guardedalloc, CachedBudget)
+{
+  MEM_use_cached_allocator();
+  budget_test();
+}
+
+TEST(guardedalloc, GuardedBudget)
+{
+  MEM_use_guarded_allocator();
+  budget_test();
+}
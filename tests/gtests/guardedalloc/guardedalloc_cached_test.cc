@@ -0,0 +1,157 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+#define CHECK_ALIGNMENT(ptr, align) EXPECT_EQ((size_t)ptr % align, 0)
+
+namespace {
+
+/* All tests use the cached allocator, switching is only allowed while nothing is allocated. */
+class CachedAllocTest : public testing::Test {
+ protected:
+  unsigned int blocks_in_use;
+  size_t memory_in_use;
+
+  void SetUp() override
+  {
+    MEM_use_cached_allocator();
+    blocks_in_use = MEM_get_memory_blocks_in_use();
+    memory_in_use = MEM_get_memory_in_use();
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(blocks_in_use, MEM_get_memory_blocks_in_use());
+    EXPECT_EQ(memory_in_use, MEM_get_memory_in_use());
+  }
+};
+
+bool mem_is_filled(const void *ptr, const size_t len, const unsigned char value)
+{
+  for (size_t i = 0; i < len; i++) {
+    if (((const unsigned char *)ptr)[i] != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST_F(CachedAllocTest, SizeClasses)
+{
+  /* Sizes around all size classes, the large blocks and the mapped blocks. */
+  std::vector<void *> blocks;
+  std::vector<size_t> blocks_len;
+  for (size_t len = 0; len < 40000; len = len * 5 / 4 + 1) {
+    void *ptr = MEM_mallocN(len, __func__);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_EQ((len + 3) & ~(size_t)3, MEM_allocN_len(ptr));
+    memset(ptr, (int)(blocks.size() & 0xff), len);
+    blocks.push_back(ptr);
+    blocks_len.push_back(len);
+  }
+  void *ptr_mapped = MEM_mallocN(4 * 1024 * 1024, __func__);
+  EXPECT_EQ(4 * 1024 * 1024, MEM_allocN_len(ptr_mapped));
+  EXPECT_LE(4 * 1024 * 1024, MEM_get_mapped_memory_in_use());
+  MEM_freeN(ptr_mapped);
+
+  for (size_t i = 0; i < blocks.size(); i++) {
+    EXPECT_TRUE(mem_is_filled(blocks[i], blocks_len[i], i & 0xff));
+    MEM_freeN(blocks[i]);
+  }
+}
+
+TEST_F(CachedAllocTest, CallocReused)
+{
+  for (size_t len = 1; len < 100000; len *= 3) {
+    void *ptr = MEM_mallocN(len, __func__);
+    memset(ptr, 0xff, len);
+    MEM_freeN(ptr);
+    ptr = MEM_callocN(len, __func__);
+    EXPECT_TRUE(mem_is_filled(ptr, len, 0));
+    MEM_freeN(ptr);
+  }
+}
+
+TEST_F(CachedAllocTest, Realloc)
+{
+  char *ptr = (char *)MEM_mallocN(10, __func__);
+  memcpy(ptr, "123456789", 10);
+
+  /* Growing within and over size classes keeps the contents. */
+  for (size_t len = 12; len < 100000; len *= 2) {
+    ptr = (char *)MEM_reallocN(ptr, len);
+    EXPECT_EQ(len, MEM_allocN_len(ptr));
+    EXPECT_STREQ("123456789", ptr);
+  }
+  ptr = (char *)MEM_reallocN(ptr, 12);
+  EXPECT_STREQ("123456789", ptr);
+
+  ptr = (char *)MEM_recallocN(ptr, 16);
+  EXPECT_STREQ("123456789", ptr);
+  EXPECT_TRUE(mem_is_filled(ptr + 12, 4, 0));
+  ptr = (char *)MEM_recallocN(ptr, 1000);
+  EXPECT_TRUE(mem_is_filled(ptr + 16, 1000 - 16, 0));
+  MEM_freeN(ptr);
+}
+
+TEST_F(CachedAllocTest, Aligned)
+{
+  for (int alignment = 1; alignment <= 512; alignment *= 2) {
+    void *ptr = MEM_mallocN_aligned(100, alignment, __func__);
+    CHECK_ALIGNMENT(ptr, alignment);
+    void *ptr_dup = MEM_dupallocN(ptr);
+    CHECK_ALIGNMENT(ptr_dup, alignment);
+    ptr = MEM_reallocN(ptr, 5000);
+    CHECK_ALIGNMENT(ptr, alignment);
+    MEM_freeN(ptr_dup);
+    MEM_freeN(ptr);
+  }
+}
+
+static void cached_alloc_thread_free(std::vector<void *> *blocks)
+{
+  for (void *ptr : *blocks) {
+    MEM_freeN(ptr);
+  }
+}
+
+static void cached_alloc_thread_alloc(std::vector<void *> *blocks, const int len)
+{
+  for (int i = 0; i < len; i++) {
+    blocks->push_back(MEM_mallocN((size_t)(i % 300), __func__));
+  }
+}
+
+TEST_F(CachedAllocTest, Threads)
+{
+  /* Blocks allocated by one thread and freed by another,
+   * memory is counted correctly after the threads exit. */
+  std::vector<void *> blocks[4];
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.push_back(std::thread(cached_alloc_thread_alloc, &blocks[i], 10000));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  EXPECT_EQ(blocks_in_use + 40000, MEM_get_memory_blocks_in_use());
+
+  for (int i = 0; i < 4; i++) {
+    threads.push_back(std::thread(cached_alloc_thread_free, &blocks[(i + 1) % 4]));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
@@ -0,0 +1,89 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+#define NUM_RUN_AVERAGED 5
+#define NUM_THREADS 4
+
+/* Small allocations of mixed sizes, freed in a different order, as done when copying ID data
+ * (custom-data layers, modifier data, lists of small structs). */
+static void alloc_workload(const int blocks_len)
+{
+  std::vector<void *> blocks(blocks_len);
+  unsigned int seed = 1;
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < blocks_len; i++) {
+      seed = seed * 1664525u + 1013904223u;
+      /* Mostly small blocks, some up to a few kilobytes. */
+      const size_t len = (seed >> 16) % ((seed & 7) ? 128 : 4096);
+      blocks[i] = MEM_mallocN(len, __func__);
+      if (len) {
+        ((char *)blocks[i])[0] = (char)i;
+      }
+    }
+    for (int i = 0; i < blocks_len; i++) {
+      const int index = (int)(((unsigned int)i * 7919u) % (unsigned int)blocks_len);
+      MEM_freeN(blocks[index]);
+    }
+  }
+}
+
+static void alloc_test(const char *id, const int threads_num)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  const int blocks_len = 100000;
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_num; i++) {
+      threads.push_back(std::thread(alloc_workload, blocks_len));
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    averaged_timing +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  printf("\t%d threads: done in %fs on average over %d runs\n",
+         threads_num,
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+/* Tests run in order, the allocator can only be switched while nothing is allocated. */
+
+TEST(guardedalloc, LockfreeSingleThread)
+{
+  alloc_test("Lockfree - 1 thread", 1);
+}
+
+TEST(guardedalloc, LockfreeThreads)
+{
+  alloc_test("Lockfree - " STRINGIFY(NUM_THREADS) " threads", NUM_THREADS);
+}
+
+TEST(guardedalloc, CachedSingleThread)
+{
+  MEM_use_cached_allocator();
+  alloc_test("Cached - 1 thread", 1);
+}
+
+TEST(guardedalloc, CachedThreads)
+{
+  MEM_use_cached_allocator();
+  alloc_test("Cached - " STRINGIFY(NUM_THREADS) " threads", NUM_THREADS);
+}
@@ -0,0 +1,125 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+namespace {
+
+std::string profile_print_to_string()
+{
+  FILE *fp = tmpfile();
+  MEM_profile_print(fp);
+  rewind(fp);
+  std::string result;
+  char buf[256];
+  while (fgets(buf, sizeof(buf), fp)) {
+    result += buf;
+  }
+  fclose(fp);
+  return result;
+}
+
+/* The profile line of a tag, live blocks & tag are the last two columns. */
+std::string profile_line_find(const std::string &profile, const char *tag)
+{
+  const size_t tag_pos = profile.find(std::string("  ") + tag + "\n");
+  if (tag_pos == std::string::npos) {
+    return "";
+  }
+  const size_t line_start = profile.rfind('\n', tag_pos) + 1;
+  return profile.substr(line_start, tag_pos - line_start);
+}
+
+void profile_test()
+{
+  /* Sample every allocation. */
+  MEM_profile_start(1, 0);
+  EXPECT_TRUE(MEM_profile_is_enabled());
+
+  std::vector<void *> blocks;
+  for (int i = 0; i < 100; i++) {
+    blocks.push_back(MEM_mallocN(1024, "profile_test_a"));
+  }
+  for (int i = 0; i < 10; i++) {
+    blocks.push_back(MEM_callocN(100, "profile_test_b"));
+  }
+
+  std::string profile = profile_print_to_string();
+  std::string line = profile_line_find(profile, "profile_test_a");
+  ASSERT_NE("", line);
+  EXPECT_EQ(" 100", line.substr(line.size() - 4));
+  line = profile_line_find(profile, "profile_test_b");
+  ASSERT_NE("", line);
+  EXPECT_EQ(" 10", line.substr(line.size() - 3));
+  /* Sorted by live memory. */
+  EXPECT_LT(profile.find("profile_test_a"), profile.find("profile_test_b"));
+
+  MEM_profile_stop();
+  EXPECT_FALSE(MEM_profile_is_enabled());
+
+  /* Blocks freed after stopping are still counted. */
+  for (int i = 0; i < 100; i++) {
+    /* The sampled flag is not part of the length. */
+    EXPECT_EQ(1024, MEM_allocN_len(blocks[i]));
+  }
+  for (void *ptr : blocks) {
+    MEM_freeN(ptr);
+  }
+  profile = profile_print_to_string();
+  line = profile_line_find(profile, "profile_test_a");
+  EXPECT_EQ(" 0", line.substr(line.size() - 2));
+  EXPECT_NE(std::string::npos, line.find("0.098"));
+  /* The interval of the stopped profile. */
+  EXPECT_NE(std::string::npos, profile.find("samples every 1 bytes"));
+}
+
+void profile_tag_test()
+{
+  MEM_profile_start(1, 0);
+
+  /* Tags are compared by contents, the strings passed might be freed before printing. */
+  char *tag_a = strdup("profile_tag_test");
+  char *tag_b = strdup("profile_tag_test");
+  void *ptr_a = MEM_mallocN(1024, tag_a);
+  void *ptr_b = MEM_mallocN(1024, tag_b);
+  free(tag_a);
+  free(tag_b);
+
+  MEM_profile_stop();
+
+  std::string profile = profile_print_to_string();
+  std::string line = profile_line_find(profile, "profile_tag_test");
+  ASSERT_NE("", line);
+  EXPECT_EQ(" 2", line.substr(line.size() - 2));
+  EXPECT_EQ(profile.find("profile_tag_test"), profile.rfind("profile_tag_test"));
+
+  MEM_freeN(ptr_a);
+  MEM_freeN(ptr_b);
+}
+
+}  // namespace
+
+TEST(guardedalloc, LockfreeProfile)
+{
+  profile_test();
+}
+
+TEST(guardedalloc, CachedProfile)
+{
+  MEM_use_cached_allocator();
+  profile_test();
+}
+
+TEST(guardedalloc, ProfileTag)
+{
+  profile_tag_test();
+}